@@ -0,0 +1,157 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "mpi.h"
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshFactory.hh"
+#include "TileScheduler.hh"
+#include "JaliStateVector.h"
+
+using namespace Jali;
+
+// Measure the memory bandwidth of a STREAM-like triad over cell data
+// of mesh tiles, with the data allocated by the thread that built the
+// mesh and with the data first touched by the home thread of each
+// tile. On a multi-socket node the second should be faster since each
+// thread then streams through memory attached to its own socket.
+//
+// Usage: TileFirstTouch [cells per side] [num threads] [iterations]
+
+typedef StateVector<double, MeshTile> TileVector;
+
+// Run the triad a = b + s*c on the tile vectors a number of times and
+// return the bandwidth in GB/s
+
+double triad_bandwidth(TileScheduler& scheduler,
+                       std::vector<TileVector>& a,
+                       std::vector<TileVector>& b,
+                       std::vector<TileVector>& c,
+                       int const niter) {
+  double const s = 3.0;
+  auto kernel = [&](MeshTile& tile) {
+    int t = tile.ID();
+    double *ta = static_cast<double *>(a[t].get_raw_data());
+    double const *tb = static_cast<double *>(b[t].get_raw_data());
+    double const *tc = static_cast<double *>(c[t].get_raw_data());
+    int n = a[t].size();
+    for (int i = 0; i < n; i++)
+      ta[i] = tb[i] + s*tc[i];
+  };
+
+  scheduler.run_pinned(kernel);  // warm up
+
+  auto start = std::chrono::steady_clock::now();
+  for (int iter = 0; iter < niter; iter++)
+    scheduler.run_pinned(kernel);
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  double nbytes = 0.0;
+  for (auto const& v : a)
+    nbytes += 3.0*sizeof(double)*v.size();
+  return nbytes*niter/elapsed.count()/1.0e+9;
+}
+
+
+int main(int argc, char *argv[]) {
+
+  MPI_Init(&argc, &argv);
+
+  int n = (argc > 1) ? atoi(argv[1]) : 100;
+  int nthreads = (argc > 2) ? atoi(argv[2]) : 0;
+  int niter = (argc > 3) ? atoi(argv[3]) : 20;
+
+  // Tiles are built by this (the main) thread
+
+  MeshFactory mesh_factory(MPI_COMM_WORLD);
+  if (framework_available(MSTK))
+    mesh_factory.framework(MSTK);
+  else
+    mesh_factory.framework(Simple);
+  mesh_factory.partitioner(Partitioner_type::RCB);
+  mesh_factory.num_tiles(nthreads > 0 ? 4*nthreads : 64);
+
+  std::shared_ptr<Mesh> mesh =
+      mesh_factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, n, n, n);
+
+  TileScheduler scheduler(*mesh, nthreads, true);
+  int ntiles = mesh->num_tiles();
+
+  // Cell data on each tile, allocated and initialized by the main
+  // thread
+
+  std::vector<TileVector> a, b, c;
+  for (auto const& t : mesh->tiles()) {
+    a.emplace_back("a", t, Entity_kind::CELL, Entity_type::ALL, 0.0);
+    b.emplace_back("b", t, Entity_kind::CELL, Entity_type::ALL, 1.0);
+    c.emplace_back("c", t, Entity_kind::CELL, Entity_type::ALL, 2.0);
+  }
+
+  double bw_main = triad_bandwidth(scheduler, a, b, c, niter);
+
+  // Move the tiles and their data to memory of their home threads
+
+  scheduler.first_touch_tiles();
+  scheduler.run_pinned([&](MeshTile& tile) {
+      a[tile.ID()].first_touch();
+      b[tile.ID()].first_touch();
+      c[tile.ID()].first_touch();
+    });
+
+  double bw_local = triad_bandwidth(scheduler, a, b, c, niter);
+
+  std::cout << "Triad on " << mesh->num_cells() << " cells in " << ntiles <<
+      " tiles with " << scheduler.num_threads() << " threads\n";
+  std::cout << "  data touched by main thread:  " << bw_main << " GB/s\n";
+  std::cout << "  data touched by home threads: " << bw_local << " GB/s\n";
+
+  MPI_Finalize();
+}
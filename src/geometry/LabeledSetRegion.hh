@@ -108,6 +108,10 @@ public:
 
   inline std::string entity_str() const { return entity_str_; }
 
+  // File the set is read from and its format
+  inline std::string file() const { return file_; }
+  inline std::string format() const { return format_; }
+
 protected:
   const std::string entity_str_; // what kind of entities make up this set
   const std::string file_; // which file are we supposed to read it from
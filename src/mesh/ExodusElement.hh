@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _JALI_EXODUS_ELEMENT_H_
+#define _JALI_EXODUS_ELEMENT_H_
+
+#include <cctype>
+#include <string>
+
+#include "MeshDefs.hh"
+
+namespace Jali {
+
+// Description of a linear element type of Exodus II files. The local
+// nodes of each side (face in 3D, edge in 2D) are listed in the order
+// of the Exodus side numbering and so that the normal of the side
+// points out of the element
+
+struct ExodusElement {
+  char const *prefix;  // first letters of the Exodus element type name
+  Cell_type type;
+  int celldim;
+  int nnodes;
+  int nsides;
+  int sidesize[6];
+  int sidenodes[6][4];
+};
+
+// The supported element types (the list ends with a NULL prefix)
+
+inline
+ExodusElement const * exodus_elements() {
+  static ExodusElement const elements[7] = {
+    {"TRI", Cell_type::TRI, 2, 3, 3, {2, 2, 2}, {{0, 1}, {1, 2}, {2, 0}}},
+    {"QUA", Cell_type::QUAD, 2, 4, 4, {2, 2, 2, 2},
+     {{0, 1}, {1, 2}, {2, 3}, {3, 0}}},
+    {"TET", Cell_type::TET, 3, 4, 4, {3, 3, 3, 3},
+     {{0, 1, 3}, {1, 2, 3}, {0, 3, 2}, {0, 2, 1}}},
+    {"WED", Cell_type::PRISM, 3, 6, 5, {4, 4, 4, 3, 3},
+     {{0, 1, 4, 3}, {1, 2, 5, 4}, {0, 3, 5, 2}, {0, 2, 1}, {3, 4, 5}}},
+    {"PYR", Cell_type::PYRAMID, 3, 5, 5, {3, 3, 3, 3, 4},
+     {{0, 1, 4}, {1, 2, 4}, {2, 3, 4}, {0, 4, 3}, {0, 3, 2, 1}}},
+    {"HEX", Cell_type::HEX, 3, 8, 6, {4, 4, 4, 4, 4, 4},
+     {{0, 1, 5, 4}, {1, 2, 6, 5}, {2, 3, 7, 6}, {0, 4, 7, 3}, {0, 3, 2, 1},
+      {4, 5, 6, 7}}},
+    {NULL, Cell_type::CELLTYPE_UNKNOWN, 0, 0, 0, {0}, {{0}}}
+  };
+  return elements;
+}
+
+// Element description for an Exodus element type name and number of
+// nodes per element (NULL if it is not a supported linear element)
+
+inline
+ExodusElement const * exodus_element(std::string const& elemtype,
+                                     int const nnodes) {
+  std::string prefix = elemtype.substr(0, 3);
+  for (auto& ch : prefix)
+    ch = std::toupper(ch);
+  for (auto el = exodus_elements(); el->prefix; el++)
+    if (prefix == el->prefix && nnodes == el->nnodes)
+      return el;
+  return NULL;
+}
+
+// Element description for a Jali cell type, whose nodes are in the
+// same order as those of the Exodus element (NULL if not supported)
+
+inline
+ExodusElement const * exodus_element(Cell_type const type) {
+  for (auto el = exodus_elements(); el->prefix; el++)
+    if (type == el->type)
+      return el;
+  return NULL;
+}
+
+}  // end namespace Jali
+
+#endif  // _JALI_EXODUS_ELEMENT_H_
@@ -0,0 +1,311 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "KDTree.hh"
+
+#include <vector>
+#include <algorithm>
+#include <queue>
+#include <utility>
+#include <limits>
+
+namespace Jali {
+
+// Build the tree
+
+void KDTree::build(std::vector<JaliGeometry::Point> const& points) {
+  clear();
+
+  int npoints = points.size();
+  if (!npoints) return;
+
+  dim_ = points[0].dim();
+  coords_.resize(dim_*npoints);
+  for (int i = 0; i < npoints; i++)
+    for (int d = 0; d < dim_; d++)
+      coords_[dim_*i+d] = points[i][d];
+
+  perm_.resize(npoints);
+  for (int i = 0; i < npoints; i++)
+    perm_[i] = i;
+
+  treenodes_.reserve(2*npoints/max_leaf_size_ + 1);
+  build_subtree(0, npoints);
+}  // KDTree::build
+
+
+// Build the subtree for points perm_[begin] to perm_[end-1] and
+// return its index
+
+int KDTree::build_subtree(int begin, int end) {
+  int inode = treenodes_.size();
+  treenodes_.emplace_back();
+  treenodes_[inode].begin = begin;
+  treenodes_[inode].end = end;
+  treenodes_[inode].left = -1;
+  treenodes_[inode].right = -1;
+
+  for (int d = 0; d < 3; d++) {
+    treenodes_[inode].lo[d] = std::numeric_limits<double>::max();
+    treenodes_[inode].hi[d] = -std::numeric_limits<double>::max();
+  }
+  for (int i = begin; i < end; i++) {
+    double const *xyz = &(coords_[dim_*perm_[i]]);
+    for (int d = 0; d < dim_; d++) {
+      treenodes_[inode].lo[d] = std::min(treenodes_[inode].lo[d], xyz[d]);
+      treenodes_[inode].hi[d] = std::max(treenodes_[inode].hi[d], xyz[d]);
+    }
+  }
+
+  if (end - begin <= max_leaf_size_) return inode;
+
+  // Split at the median along the widest dimension
+
+  int splitdim = 0;
+  double maxwidth = -1.0;
+  for (int d = 0; d < dim_; d++) {
+    double width = treenodes_[inode].hi[d] - treenodes_[inode].lo[d];
+    if (width > maxwidth) {
+      maxwidth = width;
+      splitdim = d;
+    }
+  }
+
+  int mid = (begin + end)/2;
+  std::nth_element(perm_.begin() + begin, perm_.begin() + mid,
+                   perm_.begin() + end,
+                   [&](int const& a, int const& b) {
+                     return coords_[dim_*a+splitdim] <
+                         coords_[dim_*b+splitdim];
+                   });
+
+  // treenodes_ may get reallocated in the recursive calls so don't
+  // hold on to references into it
+
+  int left = build_subtree(begin, mid);
+  int right = build_subtree(mid, end);
+  treenodes_[inode].left = left;
+  treenodes_[inode].right = right;
+  return inode;
+}  // KDTree::build_subtree
+
+
+// Refit the tree to new point positions
+
+void KDTree::refit(std::vector<JaliGeometry::Point> const& points) {
+  if (points.size() != perm_.size() || treenodes_.empty()) {
+    build(points);
+    return;
+  }
+
+  int npoints = points.size();
+  for (int i = 0; i < npoints; i++)
+    for (int d = 0; d < dim_; d++)
+      coords_[dim_*i+d] = points[i][d];
+
+  refit_subtree(0);
+}  // KDTree::refit
+
+
+void KDTree::refit_subtree(int inode) {
+  TreeNode& node = treenodes_[inode];
+  if (node.left == -1) {
+    for (int d = 0; d < 3; d++) {
+      node.lo[d] = std::numeric_limits<double>::max();
+      node.hi[d] = -std::numeric_limits<double>::max();
+    }
+    for (int i = node.begin; i < node.end; i++) {
+      double const *xyz = &(coords_[dim_*perm_[i]]);
+      for (int d = 0; d < dim_; d++) {
+        node.lo[d] = std::min(node.lo[d], xyz[d]);
+        node.hi[d] = std::max(node.hi[d], xyz[d]);
+      }
+    }
+  } else {
+    refit_subtree(node.left);
+    refit_subtree(node.right);
+    TreeNode const& lnode = treenodes_[node.left];
+    TreeNode const& rnode = treenodes_[node.right];
+    for (int d = 0; d < dim_; d++) {
+      node.lo[d] = std::min(lnode.lo[d], rnode.lo[d]);
+      node.hi[d] = std::max(lnode.hi[d], rnode.hi[d]);
+    }
+  }
+}  // KDTree::refit_subtree
+
+
+void KDTree::clear() {
+  dim_ = 0;
+  coords_.clear();
+  perm_.clear();
+  treenodes_.clear();
+}
+
+
+bool KDTree::bounding_box(JaliGeometry::Point *lo,
+                          JaliGeometry::Point *hi) const {
+  if (treenodes_.empty()) return false;
+  lo->set(dim_, treenodes_[0].lo);
+  hi->set(dim_, treenodes_[0].hi);
+  return true;
+}
+
+
+// Squared distance from a point to the bounding box of a tree node
+// (0 if the point is inside)
+
+double KDTree::box_distance2(TreeNode const& node, double const *p) const {
+  double dist2 = 0.0;
+  for (int d = 0; d < dim_; d++) {
+    double delta = 0.0;
+    if (p[d] < node.lo[d])
+      delta = node.lo[d] - p[d];
+    else if (p[d] > node.hi[d])
+      delta = p[d] - node.hi[d];
+    dist2 += delta*delta;
+  }
+  return dist2;
+}
+
+double KDTree::point_distance2(int i, double const *p) const {
+  double dist2 = 0.0;
+  double const *xyz = &(coords_[dim_*i]);
+  for (int d = 0; d < dim_; d++)
+    dist2 += (xyz[d]-p[d])*(xyz[d]-p[d]);
+  return dist2;
+}
+
+
+// Closest point
+
+int KDTree::nearest(JaliGeometry::Point const& p) const {
+  std::vector<int> indices;
+  k_nearest(p, 1, &indices);
+  return indices.size() ? indices[0] : -1;
+}
+
+
+// k closest points - depth first search visiting the closer child
+// first and skipping subtrees farther than the k-th best so far
+
+void KDTree::k_nearest(JaliGeometry::Point const& p, int k,
+                       std::vector<int> *indices) const {
+  indices->clear();
+  if (treenodes_.empty() || k <= 0) return;
+
+  double pxyz[3] = {p[0], dim_ > 1 ? p[1] : 0.0, dim_ > 2 ? p[2] : 0.0};
+
+  // max-heap of (distance squared, point index) of the best k so far
+
+  std::priority_queue<std::pair<double, int>> best;
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty()) {
+    int inode = stack.back();
+    stack.pop_back();
+    TreeNode const& node = treenodes_[inode];
+    if (static_cast<int>(best.size()) == k &&
+        box_distance2(node, pxyz) > best.top().first)
+      continue;
+
+    if (node.left == -1) {
+      for (int i = node.begin; i < node.end; i++) {
+        double dist2 = point_distance2(perm_[i], pxyz);
+        if (static_cast<int>(best.size()) < k) {
+          best.emplace(dist2, perm_[i]);
+        } else if (dist2 < best.top().first) {
+          best.pop();
+          best.emplace(dist2, perm_[i]);
+        }
+      }
+    } else {
+      double dleft = box_distance2(treenodes_[node.left], pxyz);
+      double dright = box_distance2(treenodes_[node.right], pxyz);
+      if (dleft < dright) {
+        stack.push_back(node.right);
+        stack.push_back(node.left);
+      } else {
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+      }
+    }
+  }
+
+  indices->resize(best.size());
+  for (int i = best.size()-1; i >= 0; i--) {
+    (*indices)[i] = best.top().second;
+    best.pop();
+  }
+}  // KDTree::k_nearest
+
+
+// All points within a radius
+
+void KDTree::within_radius(JaliGeometry::Point const& p, double r,
+                           std::vector<int> *indices) const {
+  indices->clear();
+  if (treenodes_.empty() || r < 0.0) return;
+
+  double pxyz[3] = {p[0], dim_ > 1 ? p[1] : 0.0, dim_ > 2 ? p[2] : 0.0};
+  double r2 = r*r;
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty()) {
+    int inode = stack.back();
+    stack.pop_back();
+    TreeNode const& node = treenodes_[inode];
+    if (box_distance2(node, pxyz) > r2) continue;
+
+    if (node.left == -1) {
+      for (int i = node.begin; i < node.end; i++)
+        if (point_distance2(perm_[i], pxyz) <= r2)
+          indices->push_back(perm_[i]);
+    } else {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+    }
+  }
+}  // KDTree::within_radius
+
+}  // end namespace Jali
@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef _JALI_KDTREE_H_
+#define _JALI_KDTREE_H_
+
+#include <vector>
+
+#include "Point.hh"
+
+namespace Jali {
+
+/*!
+  @class KDTree "KDTree.hh"
+  @brief k-d tree over a cloud of points for nearest neighbor queries
+
+  The tree is built by recursively splitting the points at the median
+  along the widest dimension of their bounding box. Every node of the
+  tree keeps the bounding box of its points and queries prune
+  subtrees using these boxes. So, when points move, the tree can be
+  "refit" by recomputing the boxes while keeping its structure -
+  queries remain exact although they may get slower if the points
+  move a lot (in which case the tree should be rebuilt).
+
+  Points are identified by their index in the list used to build the
+  tree.
+*/
+
+class KDTree {
+ public:
+
+  /// @brief Constructor (empty tree)
+
+  KDTree() {}
+
+  /// @brief Build the tree from scratch
+
+  void build(std::vector<JaliGeometry::Point> const& points);
+
+  /// @brief Recompute the bounding boxes for new positions of the
+  /// same points, keeping the structure of the tree
+
+  void refit(std::vector<JaliGeometry::Point> const& points);
+
+  /// @brief Clear the tree
+
+  void clear();
+
+  /// @brief Is the tree empty
+
+  bool empty() const {
+    return treenodes_.empty();
+  }
+
+  /// @brief Number of points in the tree
+
+  int num_points() const {
+    return perm_.size();
+  }
+
+  /// @brief Bounding box of all the points in the tree (false if empty)
+
+  bool bounding_box(JaliGeometry::Point *lo, JaliGeometry::Point *hi) const;
+
+  /// @brief Index of the point closest to p (-1 if the tree is empty)
+
+  int nearest(JaliGeometry::Point const& p) const;
+
+  /// @brief Indices of the k points closest to p, sorted by distance
+
+  void k_nearest(JaliGeometry::Point const& p, int k,
+                 std::vector<int> *indices) const;
+
+  /// @brief Indices of all the points within distance r of p (in no
+  /// particular order)
+
+  void within_radius(JaliGeometry::Point const& p, double r,
+                     std::vector<int> *indices) const;
+
+ private:
+
+  // A node of the tree - a leaf if left == -1. The points of the
+  // node are perm_[begin] to perm_[end-1]
+
+  struct TreeNode {
+    double lo[3], hi[3];
+    int begin, end;
+    int left, right;
+  };
+
+  int build_subtree(int begin, int end);
+  void refit_subtree(int inode);
+  double box_distance2(TreeNode const& node, double const *p) const;
+  double point_distance2(int i, double const *p) const;
+
+  static int const max_leaf_size_ = 8;
+
+  int dim_ = 0;
+  std::vector<double> coords_;  // dim_ coordinates per point
+  std::vector<int> perm_;       // point indices in tree order
+  std::vector<TreeNode> treenodes_;
+};  // End class KDTree
+
+}  // end namespace Jali
+
+#endif /* _JALI_KDTREE_H_ */
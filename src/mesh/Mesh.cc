@@ -55,6 +55,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <math.h>
 #include <cmath>
 #include <vector>
+#include <limits>
+#include <cstdint>
+#include <utility>
 
 #include "Geometry.hh"
 #include "dbc.hh"
@@ -107,7 +110,10 @@ void Mesh::cache_type_info() const {
   type_info_cached = true;
 }
 
-// Gather and cache cell to face connectivity info.
+// Gather and cache cell to face connectivity info. The faces are
+// cached in the standard (Exodus II) order, which is the same as some
+// arbitrary order for non-standard cells, so that both ordered and
+// unordered requests can be answered from the cache
 //
 // Method is declared constant because it is not modifying the mesh
 // itself; rather it is modifying mutable data structures - see
@@ -120,7 +126,7 @@ void Mesh::cache_cell2face_info() const {
 
   for (int c = 0; c < ncells; c++)
     cell_get_faces_and_dirs_internal(c, &(cell_face_ids[c]),
-                                     &(cell_face_dirs[c]), false);
+                                     &(cell_face_dirs[c]), true);
 
   cell2face_info_cached = true;
 }
@@ -562,11 +568,128 @@ void Mesh::cache_corner_info() const {
 }  // cache_corner_info
 
 void Mesh::update_geometric_quantities() {
-  if (faces_requested) compute_face_geometric_quantities();
+  check_not_frozen("Mesh::update_geometric_quantities");
+
+  if (faces_requested && cache_geometry_) compute_face_geometric_quantities();
   if (edges_requested) compute_edge_geometric_quantities();
-  compute_cell_geometric_quantities();
+  if (cache_geometry_) compute_cell_geometric_quantities();
   if (sides_requested || wedges_requested) compute_side_geometric_quantities();
   if (corners_requested) compute_corner_geometric_quantities();
+
+  // cell centroids may have moved
+
+  cell_kdtree_stale_ = true;
+}
+
+
+// Spatial search tree over node coordinates (built on first use and
+// refit if the nodes have moved since)
+
+KDTree const& Mesh::node_kdtree() const {
+  if (node_kdtree_.empty() || node_kdtree_stale_) {
+    int nnodes = num_entities(Entity_kind::NODE, Entity_type::ALL);
+    std::vector<JaliGeometry::Point> points(nnodes);
+    for (int n = 0; n < nnodes; n++)
+      node_get_coordinates(n, &(points[n]));
+    if (node_kdtree_.empty())
+      node_kdtree_.build(points);
+    else
+      node_kdtree_.refit(points);
+    node_kdtree_stale_ = false;
+  }
+  return node_kdtree_;
+}
+
+// Spatial search tree over cell centroids
+
+KDTree const& Mesh::cell_kdtree() const {
+  if (cell_kdtree_.empty() || cell_kdtree_stale_) {
+    int ncells = num_entities(Entity_kind::CELL, Entity_type::ALL);
+    std::vector<JaliGeometry::Point> points(ncells);
+    for (int c = 0; c < ncells; c++)
+      points[c] = cell_centroid(c);
+    if (cell_kdtree_.empty())
+      cell_kdtree_.build(points);
+    else
+      cell_kdtree_.refit(points);
+    cell_kdtree_stale_ = false;
+  }
+  return cell_kdtree_;
+}
+
+void Mesh::rebuild_spatial_index() const {
+  check_not_frozen("Mesh::rebuild_spatial_index");
+  node_kdtree_.clear();
+  cell_kdtree_.clear();
+  node_kdtree();
+  cell_kdtree();
+}
+
+
+// Build everything that is built on first use so that const queries
+// only read data from then on, and make the mesh read-only
+
+void Mesh::freeze() {
+  if (frozen_) return;
+
+  // Connectivity and geometry are cached when the mesh is created
+  // but a framework may not have done it yet
+
+  if (!type_info_cached) cache_extra_variables();
+
+  // Build the spatial search trees or refit them if nodes moved
+
+  node_kdtree();
+  cell_kdtree();
+
+  cell_colors();
+  tile_colors();
+
+  // Membership queries use the reverse map if it exists, so the
+  // bitmap is not needed
+
+  for (auto const& set : meshsets_) {
+    set->materialize(MeshSet_rep::REVERSE_MAP);
+    set->build_tile_partition();
+  }
+
+  frozen_ = true;
+}
+
+void Mesh::check_not_frozen(std::string const& caller) const {
+  if (frozen_) {
+    Errors::Message mesg(caller + " - cannot modify a frozen mesh (see "
+                         "Mesh::freeze)");
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
+Entity_ID Mesh::closest_node(const JaliGeometry::Point& p) const {
+  return node_kdtree().nearest(p);
+}
+
+void Mesh::closest_nodes(const JaliGeometry::Point& p, const int k,
+                         Entity_ID_List *nodeids) const {
+  node_kdtree().k_nearest(p, k, nodeids);
+}
+
+void Mesh::nodes_within_radius(const JaliGeometry::Point& p, const double r,
+                               Entity_ID_List *nodeids) const {
+  node_kdtree().within_radius(p, r, nodeids);
+}
+
+Entity_ID Mesh::closest_cell(const JaliGeometry::Point& p) const {
+  return cell_kdtree().nearest(p);
+}
+
+void Mesh::closest_cells(const JaliGeometry::Point& p, const int k,
+                         Entity_ID_List *cellids) const {
+  cell_kdtree().k_nearest(p, k, cellids);
+}
+
+void Mesh::cells_within_radius(const JaliGeometry::Point& p, const double r,
+                               Entity_ID_List *cellids) const {
+  cell_kdtree().within_radius(p, r, cellids);
 }
 
 
@@ -574,7 +697,7 @@ void Mesh::cache_extra_variables() {
   // Should be before side, wedge and corner info is processed
   cache_type_info();
     
-  if (faces_requested) {
+  if (faces_requested && cache_vars_) {
     cache_cell2face_info();
     cache_face2cell_info();
   }
@@ -609,7 +732,8 @@ void Mesh::build_tiles() {
   partitions.resize(num_tiles_ini_);
 
   std::cerr << "Calling partitioner " << partitioner_pref_ << "\n";
-  get_partitioning(num_tiles_ini_, partitioner_pref_, &partitions);
+  get_partitioning(num_tiles_ini_, partitioner_pref_, &partitions,
+                   tile_cell_weights_.empty() ? nullptr : &tile_cell_weights_);
 
   // Make the tiles - make mesh tile will also call a routine of this mesh
   // to add the tile to the mesh's list of tiles
@@ -618,6 +742,73 @@ void Mesh::build_tiles() {
     make_meshtile(*this, partitions[i], num_ghost_layers_tile_, faces_requested,
                   edges_requested, sides_requested, wedges_requested,
                   corners_requested);
+
+  if (num_cells_per_subtile_)
+    subdivide_tiles(num_cells_per_subtile_);
+  else if (tile_local_numbering_)
+    tile_local_numbering(true);
+}
+
+
+// Split the owned cells of each tile into pieces that are contiguous
+// along a Hilbert curve. Cells in a subtile are sorted so that they
+// are swept in memory order (which, after a locality renumbering of
+// the mesh, makes them compact ID ranges)
+
+void Mesh::subdivide_tiles(int const num_cells_per_subtile) {
+  check_not_frozen("Mesh::subdivide_tiles");
+  if (num_cells_per_subtile < 0) {
+    Errors::Message mesg("Mesh::subdivide_tiles - number of cells per "
+                         "subtile must be non-negative");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  num_cells_per_subtile_ = num_cells_per_subtile;
+
+  for (auto const& t : meshtiles) {
+    Entity_ID_List const& cells = t->cells<Entity_type::PARALLEL_OWNED>();
+    int ncells = cells.size();
+    int nsub = num_cells_per_subtile ?
+        (ncells + num_cells_per_subtile - 1)/num_cells_per_subtile : 1;
+
+    std::vector<Entity_ID_List> subtiles;
+    if (nsub > 1) {
+      std::vector<JaliGeometry::Point> cen(ncells);
+      for (int i = 0; i < ncells; i++)
+        cen[i] = cell_centroid(cells[i]);
+      std::vector<int> order;
+      order_along_space_filling_curve(cen, space_dimension(), true, &order);
+
+      subtiles.resize(nsub);
+      for (int k = 0; k < nsub; k++) {
+        int begin = static_cast<int>(static_cast<long>(ncells)*k/nsub);
+        int end = static_cast<int>(static_cast<long>(ncells)*(k+1)/nsub);
+        for (int i = begin; i < end; i++)
+          subtiles[k].push_back(cells[order[i]]);
+        std::sort(subtiles[k].begin(), subtiles[k].end());
+      }
+    }
+    t->set_subtiles(subtiles);
+  }
+
+  // Subtiles reorder the entities of tiles
+
+  if (tile_local_numbering_)
+    tile_local_numbering(true);
+}
+
+
+// Build or discard the tile-local numbering of all tiles
+
+void Mesh::tile_local_numbering(bool const use_local_numbering) {
+  check_not_frozen("Mesh::tile_local_numbering");
+  tile_local_numbering_ = use_local_numbering;
+  for (auto const& t : meshtiles) {
+    if (use_local_numbering)
+      t->build_local_numbering();
+    else
+      t->clear_local_numbering();
+  }
 }
 
 
@@ -641,6 +832,115 @@ void Mesh::add_tile(std::shared_ptr<MeshTile> const tile2add) {
   meshtiles.emplace_back(tile2add);
 }
 
+
+// Discard all tiles and the master tile IDs of entities. Sets drop
+// their per-tile lists since they refer to the old tiles
+
+void Mesh::destroy_tiles() {
+  meshtiles.clear();
+  tiles_initialized_ = false;
+  std::vector<int>().swap(node_master_tile_ID_);
+  std::vector<int>().swap(edge_master_tile_ID_);
+  std::vector<int>().swap(face_master_tile_ID_);
+  std::vector<int>().swap(cell_master_tile_ID_);
+
+  std::vector<Entity_ID_List>().swap(tile_colors_);
+  std::vector<int>().swap(tile_color_ids_);
+
+  for (auto const& set : meshsets_)
+    set->release_tile_partition();
+}
+
+
+// Rebuild tiles balancing the given cell weights
+
+void Mesh::repartition_tiles(std::vector<double> const& cell_weights) {
+  check_not_frozen("Mesh::repartition_tiles");
+
+  int ncells_owned = num_cells<Entity_type::PARALLEL_OWNED>();
+  if (cell_weights.size() != ncells_owned) {
+    Errors::Message mesg("Mesh::repartition_tiles - need one weight per "
+                         "owned cell");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  tile_cell_weights_ = cell_weights;
+
+  destroy_tiles();
+  if (num_tiles_ini_) build_tiles();
+}
+
+
+// Rebuild tiles with a new count, partitioner and halo depth
+
+void Mesh::rebuild_tiles(int const num_tiles,
+                         Partitioner_type const partitioner,
+                         int const num_ghost_layers_tile) {
+  check_not_frozen("Mesh::rebuild_tiles");
+
+  if (num_tiles < 0 || num_ghost_layers_tile < 0) {
+    Errors::Message mesg("Mesh::rebuild_tiles - number of tiles and of "
+                         "tile halo layers must be non-negative");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  num_tiles_ini_ = num_tiles;
+  partitioner_pref_ = partitioner;
+  num_ghost_layers_tile_ = num_ghost_layers_tile;
+
+  destroy_tiles();
+  if (num_tiles_ini_) build_tiles();
+}
+
+void Mesh::repartition_tiles(std::function<double(Entity_ID)> const&
+                             cell_weight) {
+  int ncells_owned = num_cells<Entity_type::PARALLEL_OWNED>();
+  std::vector<double> cell_weights(ncells_owned);
+  for (int c = 0; c < ncells_owned; c++)
+    cell_weights[c] = cell_weight(c);
+  repartition_tiles(cell_weights);
+}
+
+
+// Rebuild tiles if measured tile times are imbalanced
+
+bool Mesh::rebalance_tiles(std::vector<double> const& tile_times,
+                           double const tolerance) {
+  int ntiles = meshtiles.size();
+  if (ntiles == 0) return false;
+  if (static_cast<int>(tile_times.size()) != ntiles) {
+    Errors::Message mesg("Mesh::rebalance_tiles - need one time per tile");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  double maxtime = 0.0, tottime = 0.0;
+  for (auto const& t : tile_times) {
+    maxtime = std::max(maxtime, t);
+    tottime += t;
+  }
+  if (tottime <= 0.0 || maxtime*ntiles <= tolerance*tottime) return false;
+
+  // Scale the current weights of the cells in each tile so that they
+  // add up to the time measured for the tile
+
+  int ncells_owned = num_cells<Entity_type::PARALLEL_OWNED>();
+  std::vector<double> cell_weights(tile_cell_weights_);
+  if (cell_weights.empty()) cell_weights.assign(ncells_owned, 1.0);
+
+  for (auto const& t : meshtiles) {
+    double tileweight = 0.0;
+    for (auto const& c : t->cells<Entity_type::PARALLEL_OWNED>())
+      tileweight += cell_weights[c];
+    if (tileweight <= 0.0) continue;
+    double scale = tile_times[t->ID()]/tileweight;
+    for (auto const& c : t->cells<Entity_type::PARALLEL_OWNED>())
+      cell_weights[c] *= scale;
+  }
+
+  repartition_tiles(cell_weights);
+  return true;
+}
+
   
 Entity_ID Mesh::entity_get_parent(const Entity_kind kind,
                                   const Entity_ID entid) const {
@@ -652,15 +952,15 @@ Entity_ID Mesh::entity_get_parent(const Entity_kind kind,
 
 unsigned int Mesh::cell_get_num_faces(const Entity_ID cellid) const {
 #if JALI_CACHE_VARS != 0
+  if (cache_vars_) {
+    //
+    // Cached version - turn off for profiling or to save memory
+    //
+    assert(cell2face_info_cached);
 
-  //
-  // Cached version - turn off for profiling or to save memory
-  //
-  assert(cell2face_info_cached);
-
-  return cell_face_ids[cellid].size();
-
-#else
+    return cell_face_ids[cellid].size();
+  }
+#endif
 
   // Non-cached version
 
@@ -671,8 +971,6 @@ unsigned int Mesh::cell_get_num_faces(const Entity_ID cellid) const {
 
   return cfaceids.size();
 
-#endif
-
 }
 
 
@@ -681,15 +979,14 @@ void Mesh::cell_get_faces_and_dirs(const Entity_ID cellid,
                                    std::vector<dir_t> *face_dirs,
                                    const bool ordered) const {
 #if JALI_CACHE_VARS != 0
+  if (cache_vars_) {
+    //
+    // Cached version - turn off for profiling or to save memory
+    //
+    assert(cell2face_info_cached);
 
-  //
-  // Cached version - turn off for profiling or to save memory
-  //
-  assert(cell2face_info_cached);
+    // Faces are cached in the standard order (see cache_cell2face_info)
 
-  if (ordered) {
-    cell_get_faces_and_dirs_internal(cellid, faceids, face_dirs, ordered);
-  } else {
     Entity_ID_List &cfaceids = cell_face_ids[cellid];
 
     *faceids = cfaceids;  // copy operation
@@ -698,9 +995,9 @@ void Mesh::cell_get_faces_and_dirs(const Entity_ID cellid,
       std::vector<dir_t> &cfacedirs = cell_face_dirs[cellid];
       *face_dirs = cfacedirs;  // copy operation
     }
+    return;
   }
-
-#else
+#endif
 
   //
   // Non-cached version
@@ -708,8 +1005,6 @@ void Mesh::cell_get_faces_and_dirs(const Entity_ID cellid,
 
   cell_get_faces_and_dirs_internal(cellid, faceids, face_dirs, ordered);
 
-#endif
-
 }
 
 
@@ -719,40 +1014,41 @@ void Mesh::cell_get_faces_and_dirs(const Entity_ID cellid,
 void Mesh::face_get_cells(const Entity_ID faceid, const Entity_type ptype,
                           Entity_ID_List *cellids) const {
 #if JALI_CACHE_VARS != 0
+  if (cache_vars_) {
+    //
+    // Cached version - turn off for profiling or to save memory
+    //
 
-  //
-  // Cached version - turn off for profiling or to save memory
-  //
-
-  assert(face2cell_info_cached);
+    assert(face2cell_info_cached);
 
 
-  cellids->clear();
+    cellids->clear();
 
-  switch (ptype) {
-  case Entity_type::ALL:
-    for (int i = 0; i < 2; i++) {
-      Entity_ID c = face_cell_ids[faceid][i];
-      if (c != -1) cellids->push_back(c);
-    }
-    break;
-  case Entity_type::PARALLEL_OWNED:
-    for (int i = 0; i < 2; i++) {
-      Entity_ID c = face_cell_ids[faceid][i];
-      if (c != -1 && cell_type[c] == Entity_type::PARALLEL_OWNED)
-        cellids->push_back(c);
-    }
-    break;
-  case Entity_type::PARALLEL_GHOST:
-    for (int i = 0; i < 2; i++) {
-      Entity_ID c = face_cell_ids[faceid][i];
-      if (c != -1 && cell_type[c] == Entity_type::PARALLEL_GHOST)
-        cellids->push_back(c);
+    switch (ptype) {
+    case Entity_type::ALL:
+      for (int i = 0; i < 2; i++) {
+        Entity_ID c = face_cell_ids[faceid][i];
+        if (c != -1) cellids->push_back(c);
+      }
+      break;
+    case Entity_type::PARALLEL_OWNED:
+      for (int i = 0; i < 2; i++) {
+        Entity_ID c = face_cell_ids[faceid][i];
+        if (c != -1 && cell_type[c] == Entity_type::PARALLEL_OWNED)
+          cellids->push_back(c);
+      }
+      break;
+    case Entity_type::PARALLEL_GHOST:
+      for (int i = 0; i < 2; i++) {
+        Entity_ID c = face_cell_ids[faceid][i];
+        if (c != -1 && cell_type[c] == Entity_type::PARALLEL_GHOST)
+          cellids->push_back(c);
+      }
+      break;
     }
-    break;
+    return;
   }
-
-#else
+#endif
 
   //
   // Non-cached version
@@ -780,8 +1076,6 @@ void Mesh::face_get_cells(const Entity_ID faceid, const Entity_type ptype,
         cellids->push_back(fcells[i]);
     break;
   }
-
-#endif
 }
 
 
@@ -1555,7 +1849,7 @@ void Mesh::compute_corner_geometry(const Entity_ID cornerid,
 // Volume/Area of cell
 
 double Mesh::cell_volume(const Entity_ID cellid, const bool recompute) const {
-  if (recompute) {
+  if (recompute || !cache_geometry_) {
     double volume;
     JaliGeometry::Point centroid(spacedim);
     compute_cell_geometry(cellid, &volume, &centroid);
@@ -1569,9 +1863,9 @@ double Mesh::cell_volume(const Entity_ID cellid, const bool recompute) const {
 
 double Mesh::face_area(const Entity_ID faceid, const bool recompute) const {
   ASSERT(faces_requested);
-  ASSERT(face_geometry_precomputed);
+  ASSERT(face_geometry_precomputed || !cache_geometry_);
 
-  if (recompute) {
+  if (recompute || !cache_geometry_) {
     double area;
     JaliGeometry::Point centroid(spacedim);
     JaliGeometry::Point normal0(spacedim), normal1(spacedim);
@@ -1654,9 +1948,9 @@ double Mesh::corner_volume(const Entity_ID cornerid,
 
 JaliGeometry::Point Mesh::cell_centroid(const Entity_ID cellid,
                                         const bool recompute) const {
-  ASSERT(cell_geometry_precomputed);
+  ASSERT(cell_geometry_precomputed || !cache_geometry_);
 
-  if (recompute) {
+  if (recompute || !cache_geometry_) {
     double volume;
     JaliGeometry::Point centroid(spacedim);
     compute_cell_geometry(cellid, &volume, &centroid);
@@ -1671,9 +1965,9 @@ JaliGeometry::Point Mesh::cell_centroid(const Entity_ID cellid,
 JaliGeometry::Point Mesh::face_centroid(const Entity_ID faceid,
                                         const bool recompute) const {
   ASSERT(faces_requested);
-  ASSERT(face_geometry_precomputed);
+  ASSERT(face_geometry_precomputed || !cache_geometry_);
 
-  if (recompute) {
+  if (recompute || !cache_geometry_) {
     double area;
     JaliGeometry::Point centroid(spacedim);
     JaliGeometry::Point normal0(spacedim), normal1(spacedim);
@@ -1708,12 +2002,12 @@ JaliGeometry::Point Mesh::face_normal(const Entity_ID faceid,
                                       const Entity_ID cellid,
                                       int *orientation) const {
   ASSERT(faces_requested);
-  ASSERT(face_geometry_precomputed);
+  ASSERT(face_geometry_precomputed || !cache_geometry_);
 
   JaliGeometry::Point normal0(spacedim);
   JaliGeometry::Point normal1(spacedim);
 
-  if (recompute) {
+  if (recompute || !cache_geometry_) {
     double area;
     JaliGeometry::Point centroid(spacedim);
     
@@ -2357,6 +2651,7 @@ void Mesh::init_sets() {
 // Add a meshset to the mesh
 
 void Mesh::add_set(std::shared_ptr<MeshSet> set) {
+  check_not_frozen("Mesh::add_set");
   meshsets_.push_back(set);
 }
 
@@ -2419,15 +2714,7 @@ bool Mesh::valid_set_name(std::string name, Entity_kind kind) const {
       if (rgn->type() == JaliGeometry::Region_type::LABELEDSET) {
         JaliGeometry::LabeledSetRegionPtr lsrgn =
             dynamic_cast<JaliGeometry::LabeledSetRegionPtr> (rgn);
-        std::string entity_type = lsrgn->entity_str();
-
-        if ((kind == Entity_kind::CELL && entity_type == "CELL") ||
-            (kind == Entity_kind::FACE && entity_type == "FACE") ||
-            (kind == Entity_kind::EDGE && entity_type == "EDGE") ||
-            (kind == Entity_kind::NODE && entity_type == "NODE"))
-          return true;
-        else
-          return false;
+        return (kind == labeled_set_kind(lsrgn->entity_str()));
       }
 
       // If we are looking for a cell set the region has to be
@@ -2596,9 +2883,236 @@ void Mesh::get_set_entities(const std::string setname, const Entity_kind kind,
 
 }
 
+// Find cells containing a point. Try the cells around the closest
+// node first and if that fails (the closest node need not be a node
+// of the containing cell on distorted meshes or near a partition
+// boundary), try the cells with the closest centroids and then all
+// cells if the point is within the bounding box of the nodes on this
+// rank
+
+void Mesh::find_cells_containing_point(JaliGeometry::Point const& pnt,
+                                       Entity_ID_List *cells) const {
+  cells->clear();
+
+  Entity_ID minnode = closest_node(pnt);
+  if (minnode == -1) return;
+
+  Entity_ID_List nodecells;
+  node_get_cells(minnode, Entity_type::ALL, &nodecells);
+  for (auto const& c : nodecells)
+    if (point_in_cell(pnt, c))
+      cells->push_back(c);
+
+  if (cells->size()) return;
+
+  JaliGeometry::Point lo, hi;
+  node_kdtree().bounding_box(&lo, &hi);
+  for (int d = 0; d < spacedim; d++)
+    if (pnt[d] < lo[d] || pnt[d] > hi[d]) return;
+
+  Entity_ID_List nearcells;
+  closest_cells(pnt, 16, &nearcells);
+  for (auto const& c : nearcells)
+    if (point_in_cell(pnt, c))
+      cells->push_back(c);
+
+  if (cells->size()) return;
+
+  int ncells = num_entities(Entity_kind::CELL, Entity_type::ALL);
+  for (int c = 0; c < ncells; c++)
+    if (point_in_cell(pnt, c))
+      cells->push_back(c);
+}
+
+
+// Reduction operator for global set statistics. Each set contributes
+// a record of 7 doubles (count, -xmin, -ymin, -zmin, xmax, ymax, zmax)
+// so that the counts are summed and everything else is maxed. The
+// operator works on whole records (len is the number of records)
+
+static void reduce_set_stats(void *in, void *inout, int *len,
+                             MPI_Datatype *) {
+  double *a = static_cast<double *>(in);
+  double *b = static_cast<double *>(inout);
+  for (int i = 0; i < *len; i++) {
+    b[7*i] += a[7*i];
+    for (int j = 1; j < 7; j++)
+      b[7*i+j] = std::max(a[7*i+j], b[7*i+j]);
+  }
+}
+
+// Build a bunch of sets collectively
+
+void Mesh::build_sets_collectively(std::vector<std::string> const& setnames,
+                                   std::vector<Entity_kind> const& kinds) {
+  check_not_frozen("Mesh::build_sets_collectively");
+
+  JaliGeometry::GeometricModelPtr gm = geometric_model();
+  if (!gm) {
+    Errors::Message mesg("Mesh sets not enabled because mesh was created"
+                         " without reference to a geometric model");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  // Pairs of set names and kinds that make sense
+
+  std::vector<std::pair<std::string, Entity_kind>> setspecs;
+  for (auto const& name : setnames)
+    for (auto const& kind : kinds)
+      if (valid_set_name(name, kind))
+        setspecs.emplace_back(name, kind);
+  int nsets = setspecs.size();
+
+  // Find candidate cells for POINT region cell sets on each rank and
+  // pick the lowest global ID among all the candidates so that only
+  // one rank ends up owning the cell
+
+  double const huge = 1.0e+300;
+  int const nogid = std::numeric_limits<int>::max();
+  std::vector<Entity_ID_List> candidates(nsets);
+  std::vector<int> mingid(nsets, nogid);
+  std::vector<bool> is_pointset(nsets, false);
+  for (int i = 0; i < nsets; i++) {
+    if (setspecs[i].second != Entity_kind::CELL) continue;
+    JaliGeometry::RegionPtr region = gm->FindRegion(setspecs[i].first);
+    if (region->type() != JaliGeometry::Region_type::POINT) continue;
+
+    is_pointset[i] = true;
+    JaliGeometry::Point rgnpnt =
+        ((JaliGeometry::PointRegionPtr)region)->point();
+    find_cells_containing_point(rgnpnt, &candidates[i]);
+    for (auto const& c : candidates[i])
+      if (entity_get_type(Entity_kind::CELL, c) ==
+          Entity_type::PARALLEL_OWNED)
+        mingid[i] = std::min(mingid[i], GID(c, Entity_kind::CELL));
+  }
+
+  std::vector<int> globalmingid(nsets, nogid);
+  MPI_Allreduce(mingid.data(), globalmingid.data(), nsets, MPI_INT, MPI_MIN,
+                comm);
+
+  // Build the sets - POINT cell sets are made from the winning cell
+  // (or its ghost copy)
+
+  std::vector<std::shared_ptr<MeshSet>> builtsets(nsets);
+  for (int i = 0; i < nsets; i++) {
+    std::string const& name = setspecs[i].first;
+    Entity_kind kind = setspecs[i].second;
+    if (is_pointset[i]) {
+      Entity_ID_List owned_cells, ghost_cells;
+      for (auto const& c : candidates[i]) {
+        if (GID(c, Entity_kind::CELL) != globalmingid[i]) continue;
+        if (entity_get_type(Entity_kind::CELL, c) ==
+            Entity_type::PARALLEL_OWNED)
+          owned_cells.push_back(c);
+        else
+          ghost_cells.push_back(c);
+      }
+
+      // Replace any set built earlier without the global resolution
+
+      for (auto it = meshsets_.begin(); it != meshsets_.end(); ++it)
+        if ((*it)->name() == name && (*it)->kind() == kind) {
+          meshsets_.erase(it);
+          break;
+        }
+      builtsets[i] = make_meshset(name, *this, kind, owned_cells,
+                                  ghost_cells);
+    } else {
+      builtsets[i] = find_meshset(name, kind);
+    }
+  }
+
+  // Compute the local statistics of all sets and reduce them in one go
+  // (a set that could not be built on this rank contributes nothing
+  // but the rank still takes part in the reduction)
+
+  std::vector<double> stats(7*nsets);
+  for (int i = 0; i < nsets; i++) {
+    double *setstats = &(stats[7*i]);
+    setstats[0] = 0.0;
+    for (int d = 0; d < 3; d++) {
+      setstats[1+d] = -huge;
+      setstats[4+d] = -huge;
+    }
+    if (!builtsets[i]) continue;
+    setstats[0] = builtsets[i]->num_entities(Entity_type::PARALLEL_OWNED);
+
+    Entity_ID_List nodes;
+    for (auto const& ent :
+             builtsets[i]->entities<Entity_type::PARALLEL_OWNED>()) {
+      switch (builtsets[i]->kind()) {
+        case Entity_kind::CELL: cell_get_nodes(ent, &nodes); break;
+        case Entity_kind::FACE: face_get_nodes(ent, &nodes); break;
+        case Entity_kind::EDGE: {
+          nodes.resize(2);
+          edge_get_nodes(ent, &(nodes[0]), &(nodes[1]));
+          break;
+        }
+        case Entity_kind::NODE: nodes.assign(1, ent); break;
+        default: nodes.clear();
+      }
+
+      JaliGeometry::Point xyz;
+      for (auto const& n : nodes) {
+        node_get_coordinates(n, &xyz);
+        for (int d = 0; d < spacedim; d++) {
+          setstats[1+d] = std::max(setstats[1+d], -xyz[d]);
+          setstats[4+d] = std::max(setstats[4+d], xyz[d]);
+        }
+      }
+    }
+  }
+
+  MPI_Datatype statstype;
+  MPI_Type_contiguous(7, MPI_DOUBLE, &statstype);
+  MPI_Type_commit(&statstype);
+  MPI_Op statsop;
+  MPI_Op_create(reduce_set_stats, 1, &statsop);
+  std::vector<double> globalstats(7*nsets);
+  MPI_Allreduce(stats.data(), globalstats.data(), nsets, statstype,
+                statsop, comm);
+  MPI_Op_free(&statsop);
+  MPI_Type_free(&statstype);
+
+  for (int i = 0; i < nsets; i++) {
+    if (!builtsets[i]) continue;
+    double *setstats = &(globalstats[7*i]);
+    builtsets[i]->global_num_owned_ = static_cast<int>(setstats[0]);
+    builtsets[i]->global_bbox_lo_ = JaliGeometry::Point(spacedim);
+    builtsets[i]->global_bbox_hi_ = JaliGeometry::Point(spacedim);
+    for (int d = 0; d < spacedim; d++) {
+      builtsets[i]->global_bbox_lo_[d] = -setstats[1+d];
+      builtsets[i]->global_bbox_hi_[d] = setstats[4+d];
+    }
+  }
+}  // Mesh::build_sets_collectively
+
+
+// Memory used by sets built so far (entity lists plus lazily built
+// bitmaps and reverse maps)
+
+std::size_t Mesh::meshsets_memory_used(const Entity_kind kind) const {
+  std::size_t nbytes = 0;
+  for (auto const& set : meshsets_)
+    if (kind == Entity_kind::ANY_KIND || set->kind() == kind)
+      nbytes += set->memory_used();
+  return nbytes;
+}
+
+// Release lazily built membership structures of sets
+
+void Mesh::release_meshset_caches(const Entity_kind kind) const {
+  check_not_frozen("Mesh::release_meshset_caches");
+  for (auto const& set : meshsets_)
+    if (kind == Entity_kind::ANY_KIND || set->kind() == kind)
+      set->release_cached_representations();
+}
+
 std::shared_ptr<MeshSet> Mesh::build_set(const std::string setname,
                                          const Entity_kind kind,
                                          const bool with_reverse_map) {
+  check_not_frozen("Mesh::build_set (set " + setname + ")");
 
   int celldim = Mesh::cell_dimension();
   int spacedim = Mesh::space_dimension();
@@ -2643,43 +3157,19 @@ std::shared_ptr<MeshSet> Mesh::build_set(const std::string setname,
                             owned_cells, ghost_cells, with_reverse_map);
 
       } else if (region->type() == JaliGeometry::Region_type::POINT) {
-        JaliGeometry::Point vpnt(spacedim);
         JaliGeometry::Point rgnpnt(spacedim);
 
         rgnpnt = ((JaliGeometry::PointRegionPtr)region)->point();
 
-        int nnode = Mesh::num_entities(Entity_kind::NODE,
-                                       Entity_type::ALL);
-
-        double mindist2 = 1.e+16;
-        int minnode = -1;
-        for (int inode = 0; inode < nnode; inode++) {
-          node_get_coordinates(inode, &vpnt);
-
-          double dist2 = (vpnt-rgnpnt)*(vpnt-rgnpnt);
-          if (dist2 < mindist2) {
-            mindist2 = dist2;
-            minnode = inode;
-            if (mindist2 <= 1.0e-32)
-              break;
-          }
-        }
-
         Entity_ID_List cells;
-        node_get_cells(minnode, Entity_type::ALL, &cells);
-
-        int ncells = cells.size();
-        for (int ic = 0; ic < ncells; ic++) {
-          Entity_ID icell = cells[ic];
-
-          // Check if point is contained in cell
-          if (point_in_cell(rgnpnt, icell)) {
-            Entity_type ctype = entity_get_type(Entity_kind::CELL, icell);
-            if (ctype == Entity_type::PARALLEL_OWNED)
-              owned_cells.push_back(icell);
-            else if (ctype == Entity_type::PARALLEL_GHOST)
-              ghost_cells.push_back(icell);
-          }
+        find_cells_containing_point(rgnpnt, &cells);
+
+        for (auto const& icell : cells) {
+          Entity_type ctype = entity_get_type(Entity_kind::CELL, icell);
+          if (ctype == Entity_type::PARALLEL_OWNED)
+            owned_cells.push_back(icell);
+          else if (ctype == Entity_type::PARALLEL_GHOST)
+            ghost_cells.push_back(icell);
         }
 
         mset = make_meshset(setname, *this, Entity_kind::CELL,
@@ -2726,9 +3216,8 @@ std::shared_ptr<MeshSet> Mesh::build_set(const std::string setname,
         JaliGeometry::LabeledSetRegionPtr lsrgn =
             dynamic_cast<JaliGeometry::LabeledSetRegionPtr> (region);
         std::string label = lsrgn->label();
-        std::string entity_type = lsrgn->entity_str();
         
-        if (entity_type != "CELL" && entity_type != "Entity_kind::CELL") {
+        if (labeled_set_kind(lsrgn->entity_str()) != Entity_kind::CELL) {
           Errors::Message mesg("Entity type of labeled set region and build_set request do not match");
           Exceptions::Jali_throw(mesg);
         }
@@ -2817,9 +3306,8 @@ std::shared_ptr<MeshSet> Mesh::build_set(const std::string setname,
         JaliGeometry::LabeledSetRegionPtr lsrgn =
             dynamic_cast<JaliGeometry::LabeledSetRegionPtr> (region);
         std::string label = lsrgn->label();
-        std::string entity_type = lsrgn->entity_str();
 
-        if (entity_type != "FACE" && entity_type != "Entity_kind::FACE") {
+        if (labeled_set_kind(lsrgn->entity_str()) != Entity_kind::FACE) {
           Errors::Message mesg("Entity type of labeled set region and build_set request do not match");
           Exceptions::Jali_throw(mesg);
         }
@@ -2877,9 +3365,8 @@ std::shared_ptr<MeshSet> Mesh::build_set(const std::string setname,
         JaliGeometry::LabeledSetRegionPtr lsrgn =
             dynamic_cast<JaliGeometry::LabeledSetRegionPtr> (region);
         std::string label = lsrgn->label();
-        std::string entity_type = lsrgn->entity_str();
 
-        if (entity_type != "NODE" && entity_type != "Entity_kind::NODE") {
+        if (labeled_set_kind(lsrgn->entity_str()) != Entity_kind::NODE) {
           Errors::Message mesg("Entity type of labeled set region and build_set request do not match");
           Exceptions::Jali_throw(mesg);
         }
@@ -3022,7 +3509,8 @@ bool Mesh::point_in_cell(const JaliGeometry::Point &p,
 void
 Mesh::get_partitioning(int const num_parts,
                        Partitioner_type const partitioner,
-                       std::vector<std::vector<Entity_ID>> *partitions) {
+                       std::vector<std::vector<Entity_ID>> *partitions,
+                       std::vector<double> const *cell_weights) {
 
 
   partitions->resize(num_parts);
@@ -3031,7 +3519,7 @@ Mesh::get_partitioning(int const num_parts,
 
 #ifdef Jali_HAVE_METIS
 
-    get_partitioning_with_metis(num_parts, partitions);
+    get_partitioning_with_metis(num_parts, partitions, cell_weights);
 
 // #elif Jali_HAVE_ZOLTAN
 
@@ -3045,7 +3533,7 @@ Mesh::get_partitioning(int const num_parts,
         "Preferred partitioner METIS not available. " <<
         "Partitioning by entity IDs.\n";
 
-     get_partitioning_by_index_space(num_parts, partitions);
+     get_partitioning_by_index_space(num_parts, partitions, cell_weights);
 
 #endif
   } else if ((partitioner == Partitioner_type::ZOLTAN_GRAPH ||
@@ -3070,13 +3558,26 @@ Mesh::get_partitioning(int const num_parts,
         "Requested partitioner ZOLTAN not available. " <<
         "Partitioning by entity IDs\n";
 
-    get_partitioning_by_index_space(num_parts, partitions);
+    get_partitioning_by_index_space(num_parts, partitions, cell_weights);
 
 // #endif
   } else if (partitioner == Partitioner_type::BLOCK) {
 
+    if (cell_weights)
+      std::cerr << "Mesh::get_partitioning() - " <<
+          "Partitioner_type::BLOCK ignores cell weights\n";
+
     get_partitioning_by_blocks(num_parts, partitions);
 
+  } else if (partitioner == Partitioner_type::RCB) {
+
+    get_partitioning_by_rcb(num_parts, partitions, cell_weights);
+
+  } else if (partitioner == Partitioner_type::HILBERT ||
+             partitioner == Partitioner_type::MORTON) {
+
+    get_partitioning_by_sfc(num_parts, partitioner, partitions, cell_weights);
+
   } else {
     if (space_dimension() != 1) {
       std::cerr << "Mesh::get_partitioning() - " <<
@@ -3084,18 +3585,622 @@ Mesh::get_partitioning(int const num_parts,
           "Partitioning by entity IDs\n";
     }
 
-    get_partitioning_by_index_space(num_parts, partitions);
+    get_partitioning_by_index_space(num_parts, partitions, cell_weights);
+  }
+}
+
+
+// Split an ordered list of cells into contiguous pieces of nearly
+// equal weight - a cell goes to the piece in whose share of the total
+// weight the midpoint of its own weight falls
+
+void Mesh::chop_weighted_order(std::vector<int> const& order,
+                               std::vector<double> const& cell_weights,
+                               int const num_parts,
+                               std::vector<std::vector<int>> *partitions) {
+  double totweight = 0.0;
+  for (auto const& c : order)
+    totweight += cell_weights[c];
+
+  int ncells = order.size();
+  int i = 0;
+  double cumweight = 0.0;
+  for (int p = 0; p < num_parts; p++) {
+    double target = totweight*(p+1)/num_parts;
+    (*partitions)[p].clear();
+    while (i < ncells &&
+           (p == num_parts-1 ||
+            cumweight + 0.5*cell_weights[order[i]] <= target)) {
+      cumweight += cell_weights[order[i]];
+      (*partitions)[p].push_back(order[i++]);
+    }
+  }
+}
+
+
+// Quality of the tile partitioning
+
+void Mesh::tile_partition_quality(double *imbalance, int *num_cut_faces,
+                                  std::vector<int> *halo_sizes) const {
+  int ntiles = meshtiles.size();
+  *imbalance = 0.0;
+  *num_cut_faces = faces_requested ? 0 : -1;
+  halo_sizes->assign(ntiles, 0);
+  if (!ntiles) return;
+
+  int maxcells = 0, totcells = 0;
+  for (auto const& t : meshtiles) {
+    int ntilecells = t->num_cells<Entity_type::PARALLEL_OWNED>();
+    maxcells = std::max(maxcells, ntilecells);
+    totcells += ntilecells;
+  }
+  if (totcells)
+    *imbalance = static_cast<double>(maxcells)*ntiles/totcells;
+
+  if (faces_requested) {
+    int nfaces = num_faces<Entity_type::ALL>();
+    Entity_ID_List fcells;
+    for (int f = 0; f < nfaces; f++) {
+      face_get_cells(f, Entity_type::ALL, &fcells);
+      if (fcells.size() != 2) continue;
+      int tile0 = master_tile_ID_of_cell(fcells[0]);
+      int tile1 = master_tile_ID_of_cell(fcells[1]);
+      if (tile0 != -1 && tile1 != -1 && tile0 != tile1)
+        (*num_cut_faces)++;
+    }
+  }
+
+  Entity_ID_List nbrs;
+  for (auto const& t : meshtiles) {
+    int tileid = t->ID();
+    std::vector<Entity_ID> halo;
+    for (auto const& c : t->cells<Entity_type::PARALLEL_OWNED>()) {
+      cell_get_node_adj_cells(c, Entity_type::ALL, &nbrs);
+      for (auto const& nbr : nbrs)
+        if (master_tile_ID_of_cell(nbr) != tileid)
+          halo.push_back(nbr);
+    }
+    std::sort(halo.begin(), halo.end());
+    (*halo_sizes)[tileid] = std::unique(halo.begin(), halo.end()) -
+        halo.begin();
+  }
+}
+
+void Mesh::report_tile_partition_quality(std::ostream& os) const {
+  double imbalance;
+  int ncut;
+  std::vector<int> halo_sizes;
+  tile_partition_quality(&imbalance, &ncut, &halo_sizes);
+
+  int maxhalo = 0, tothalo = 0;
+  for (auto const& h : halo_sizes) {
+    maxhalo = std::max(maxhalo, h);
+    tothalo += h;
+  }
+
+  os << "Tile partitioning (" << partitioner_pref_ << "): " <<
+      halo_sizes.size() << " tiles, imbalance " << imbalance <<
+      ", cut faces " << ncut << ", halo cells (max/avg) " << maxhalo << "/" <<
+      (halo_sizes.size() ? static_cast<double>(tothalo)/halo_sizes.size() :
+       0.0) << "\n";
+}
+
+
+std::vector<Entity_ID> const& Mesh::original_ids(Entity_kind const kind) const {
+  static std::vector<Entity_ID> const empty_list;
+  int ikind = static_cast<int>(kind);
+  return (ikind >= 0 && ikind < 4) ? original_ids_[ikind] : empty_list;
+}
+
+
+// Greedy first-fit coloring - each item gets the smallest color not
+// taken by an earlier item sharing one of its nodes. Items are visited
+// in order, so items that are close in numbering (and hence usually in
+// space) end up in different colors and each color is spread out
+
+int Mesh::color_by_shared_nodes(std::vector<Entity_ID_List> const& items,
+                                int const num_nodes,
+                                std::vector<int> *color_ids) {
+  int nitems = items.size();
+
+  // Items of each node in compressed row storage
+
+  std::vector<int> offsets(num_nodes+1, 0);
+  for (auto const& nodes : items)
+    for (auto const& n : nodes)
+      offsets[n+1]++;
+  for (int n = 0; n < num_nodes; n++)
+    offsets[n+1] += offsets[n];
+  std::vector<int> node_items(offsets[num_nodes]);
+  std::vector<int> pos(offsets.begin(), offsets.end()-1);
+  for (int i = 0; i < nitems; i++)
+    for (auto const& n : items[i])
+      node_items[pos[n]++] = i;
+
+  // taken_by[k] is the last item that found color k taken by a neighbor
+
+  color_ids->assign(nitems, -1);
+  std::vector<int> taken_by;
+  int ncolors = 0;
+  for (int i = 0; i < nitems; i++) {
+    for (auto const& n : items[i])
+      for (int k = offsets[n]; k < offsets[n+1]; k++) {
+        int color = (*color_ids)[node_items[k]];
+        if (color != -1) taken_by[color] = i;
+      }
+
+    int color = 0;
+    while (color < ncolors && taken_by[color] == i) color++;
+    if (color == ncolors) {
+      ncolors++;
+      taken_by.push_back(-1);
+    }
+    (*color_ids)[i] = color;
+  }
+
+  return ncolors;
+}
+
+
+std::vector<Entity_ID_List> const& Mesh::cell_colors() const {
+  int ncells = num_cells<Entity_type::ALL>();
+  if (cell_color_ids_.size() != ncells) {
+    std::vector<Entity_ID_List> cellnodes(ncells);
+    for (int c = 0; c < ncells; c++)
+      cell_get_nodes(c, &(cellnodes[c]));
+
+    int nnodes = num_nodes<Entity_type::ALL>();
+    int ncolors = color_by_shared_nodes(cellnodes, nnodes, &cell_color_ids_);
+    cell_colors_.assign(ncolors, Entity_ID_List());
+    for (int c = 0; c < ncells; c++)
+      cell_colors_[cell_color_ids_[c]].push_back(c);
+  }
+  return cell_colors_;
+}
+
+int Mesh::cell_color(Entity_ID const cellid) const {
+  cell_colors();
+  return cell_color_ids_[cellid];
+}
+
+
+std::vector<std::vector<int>> const& Mesh::tile_colors() const {
+  int ntiles = meshtiles.size();
+  if (tile_color_ids_.size() != ntiles) {
+    std::vector<Entity_ID_List> tilenodes(ntiles);
+    for (auto const& t : meshtiles)
+      tilenodes[t->ID()] = t->nodes<Entity_type::ALL>();
+
+    int nnodes = num_nodes<Entity_type::ALL>();
+    int ncolors = color_by_shared_nodes(tilenodes, nnodes, &tile_color_ids_);
+    tile_colors_.assign(ncolors, std::vector<int>());
+    for (int t = 0; t < ntiles; t++)
+      tile_colors_[tile_color_ids_[t]].push_back(t);
+  }
+  return tile_colors_;
+}
+
+int Mesh::tile_color(int const tileid) const {
+  tile_colors();
+  return tile_color_ids_[tileid];
+}
+
+
+std::vector<Entity_ID> const& Mesh::previous_GIDs(Entity_kind const kind)
+    const {
+  static std::vector<Entity_ID> const empty_list;
+  int ikind = static_cast<int>(kind);
+  return (ikind >= 0 && ikind < 4) ? previous_gids_[ikind] : empty_list;
+}
+
+
+void Mesh::exchange_bytes(MPI_Comm comm,
+                          std::vector<std::vector<char>> const& sendbufs,
+                          std::vector<std::vector<char>> *recvbufs) {
+  int nprocs;
+  MPI_Comm_size(comm, &nprocs);
+
+  std::vector<int> sendcounts(nprocs), recvcounts(nprocs);
+  for (int p = 0; p < nprocs; p++)
+    sendcounts[p] = sendbufs[p].size();
+  MPI_Alltoall(&(sendcounts[0]), 1, MPI_INT, &(recvcounts[0]), 1, MPI_INT,
+               comm);
+
+  std::vector<int> senddispls(nprocs+1, 0), recvdispls(nprocs+1, 0);
+  for (int p = 0; p < nprocs; p++) {
+    senddispls[p+1] = senddispls[p] + sendcounts[p];
+    recvdispls[p+1] = recvdispls[p] + recvcounts[p];
+  }
+
+  std::vector<char> sendbuf(senddispls[nprocs]+1);
+  std::vector<char> recvbuf(recvdispls[nprocs]+1);
+  for (int p = 0; p < nprocs; p++)
+    std::copy(sendbufs[p].begin(), sendbufs[p].end(),
+              sendbuf.begin() + senddispls[p]);
+
+  MPI_Alltoallv(&(sendbuf[0]), &(sendcounts[0]), &(senddispls[0]), MPI_BYTE,
+                &(recvbuf[0]), &(recvcounts[0]), &(recvdispls[0]), MPI_BYTE,
+                comm);
+
+  recvbufs->resize(nprocs);
+  for (int p = 0; p < nprocs; p++)
+    (*recvbufs)[p].assign(recvbuf.begin() + recvdispls[p],
+                          recvbuf.begin() + recvdispls[p+1]);
+}
+
+
+// Move entity data from the mesh this mesh was redistributed from.
+// The ranks of the two meshes don't know where each other's entities
+// are, so the data meets at a rendezvous rank (global ID modulo number
+// of ranks): the previous owners send (global ID, data) there, the new
+// holders send the global IDs they need and get the data back
+
+void Mesh::redistribute_data(Mesh const& prevmesh, Entity_kind const kind,
+                             int const nbytes, void const *prevdata,
+                             Entity_type const ptype, void *data) const {
+  int ikind = static_cast<int>(kind);
+  if ((kind != Entity_kind::NODE && kind != Entity_kind::CELL) ||
+      (ptype != Entity_type::PARALLEL_OWNED && ptype != Entity_type::ALL)) {
+    Errors::Message mesg("Mesh::redistribute_data - only data on all or "
+                         "owned NODEs or CELLs can be redistributed");
+    Exceptions::Jali_throw(mesg);
+  }
+  int nents = num_entities(kind, ptype);
+  if (nents && previous_gids_[ikind].size() < nents) {
+    Errors::Message mesg("Mesh::redistribute_data - mesh was not made by "
+                         "redistributing another mesh");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  int nprocs;
+  MPI_Comm_size(comm, &nprocs);
+  int const recsize = sizeof(Entity_ID) + nbytes;
+
+  // Previous owners send data to the rendezvous ranks
+
+  std::vector<std::vector<char>> sendbufs(nprocs), recvbufs;
+  char const *prevbytes = static_cast<char const *>(prevdata);
+  int nprev = prevmesh.num_entities(kind, Entity_type::PARALLEL_OWNED);
+  for (int i = 0; i < nprev; i++) {
+    Entity_ID gid = prevmesh.GID(i, kind);
+    std::vector<char>& buf = sendbufs[gid % nprocs];
+    char const *gidbytes = reinterpret_cast<char const *>(&gid);
+    buf.insert(buf.end(), gidbytes, gidbytes + sizeof(Entity_ID));
+    buf.insert(buf.end(), prevbytes + i*nbytes, prevbytes + (i+1)*nbytes);
+  }
+  exchange_bytes(comm, sendbufs, &recvbufs);
+
+  std::vector<std::pair<Entity_ID, char const *>> directory;
+  for (auto const& buf : recvbufs)
+    for (int k = 0; k < buf.size(); k += recsize) {
+      Entity_ID gid;
+      std::copy(&(buf[k]), &(buf[k]) + sizeof(Entity_ID),
+                reinterpret_cast<char *>(&gid));
+      directory.emplace_back(gid, &(buf[k]) + sizeof(Entity_ID));
+    }
+  std::sort(directory.begin(), directory.end());
+
+  // New holders ask the rendezvous ranks for the data. Boundary
+  // ghosts have no entity in the previous mesh (global ID -1) and
+  // their data is left untouched
+
+  std::vector<std::vector<char>> requests(nprocs), received;
+  for (int i = 0; i < nents; i++) {
+    Entity_ID gid = previous_gids_[ikind][i];
+    if (gid < 0) continue;
+    std::vector<char>& buf = requests[gid % nprocs];
+    char const *gidbytes = reinterpret_cast<char const *>(&gid);
+    buf.insert(buf.end(), gidbytes, gidbytes + sizeof(Entity_ID));
+  }
+  exchange_bytes(comm, requests, &received);
+
+  // Unknown global IDs are counted and reported on all ranks so that
+  // no rank is left waiting in the exchange
+
+  int nmissing = 0, nmissing_all = 0;
+  std::vector<std::vector<char>> replies(nprocs), answers;
+  for (int p = 0; p < nprocs; p++) {
+    for (int k = 0; k < received[p].size(); k += sizeof(Entity_ID)) {
+      Entity_ID gid;
+      std::copy(&(received[p][k]), &(received[p][k]) + sizeof(Entity_ID),
+                reinterpret_cast<char *>(&gid));
+      auto it = std::lower_bound(directory.begin(), directory.end(),
+                                 std::make_pair(gid, (char const *) nullptr));
+      if (it == directory.end() || it->first != gid) {
+        nmissing++;
+        continue;
+      }
+      replies[p].insert(replies[p].end(), it->second, it->second + nbytes);
+    }
+  }
+  MPI_Allreduce(&nmissing, &nmissing_all, 1, MPI_INT, MPI_SUM, comm);
+  if (nmissing_all) {
+    Errors::Message mesg("Mesh::redistribute_data - no data for entity "
+                         "in previous mesh");
+    Exceptions::Jali_throw(mesg);
+  }
+  exchange_bytes(comm, replies, &answers);
+
+  // Replies come back in the order of the requests
+
+  char *bytes = static_cast<char *>(data);
+  std::vector<int> pos(nprocs, 0);
+  for (int i = 0; i < nents; i++) {
+    if (previous_gids_[ikind][i] < 0) continue;
+    int p = previous_gids_[ikind][i] % nprocs;
+    std::copy(&(answers[p][pos[p]]), &(answers[p][pos[p]]) + nbytes,
+              bytes + i*nbytes);
+    pos[p] += nbytes;
+  }
+}
+
+
+// Recursive coordinate bisection of the centroids of owned cells -
+// each range of cells is split at the position along the widest
+// dimension that gives the two halves a number of cells proportional
+// to the number of parts they will be split into
+
+void Mesh::get_partitioning_by_rcb(int const num_parts,
+                                   std::vector<std::vector<int>> *partitions,
+                                   std::vector<double> const *cell_weights) {
+  int ncells = num_cells<Entity_type::PARALLEL_OWNED>();
+  std::vector<JaliGeometry::Point> cen(ncells);
+  std::vector<int> order(ncells);
+  for (int c = 0; c < ncells; c++) {
+    cen[c] = cell_centroid(c);
+    order[c] = c;
+  }
+
+  // Each item on the stack is (first cell, one past the last cell,
+  // first part, number of parts)
+
+  std::vector<std::array<int, 4>> stack;
+  stack.push_back({{0, ncells, 0, num_parts}});
+  while (!stack.empty()) {
+    std::array<int, 4> range = stack.back();
+    stack.pop_back();
+    int begin = range[0], end = range[1];
+    int firstpart = range[2], nparts = range[3];
+
+    if (nparts == 1) {
+      (*partitions)[firstpart].assign(order.begin() + begin,
+                                      order.begin() + end);
+      continue;
+    }
+
+    double lo[3] = {1.0e+20, 1.0e+20, 1.0e+20};
+    double hi[3] = {-1.0e+20, -1.0e+20, -1.0e+20};
+    for (int i = begin; i < end; i++)
+      for (int d = 0; d < spacedim; d++) {
+        lo[d] = std::min(lo[d], cen[order[i]][d]);
+        hi[d] = std::max(hi[d], cen[order[i]][d]);
+      }
+    int cutdim = 0;
+    for (int d = 1; d < spacedim; d++)
+      if (hi[d]-lo[d] > hi[cutdim]-lo[cutdim]) cutdim = d;
+
+    int nleftparts = nparts/2;
+    auto compare = [&](int const& a, int const& b) {
+      return cen[a][cutdim] < cen[b][cutdim];
+    };
+    int mid;
+    if (cell_weights) {
+      // split where the cumulative weight reaches the left share
+
+      std::sort(order.begin() + begin, order.begin() + end, compare);
+      double totweight = 0.0;
+      for (int i = begin; i < end; i++)
+        totweight += (*cell_weights)[order[i]];
+      double target = totweight*nleftparts/nparts;
+      double cumweight = 0.0;
+      mid = begin;
+      while (mid < end &&
+             cumweight + 0.5*(*cell_weights)[order[mid]] <= target)
+        cumweight += (*cell_weights)[order[mid++]];
+    } else {
+      mid = begin + static_cast<int>(static_cast<double>(end-begin)*
+                                     nleftparts/nparts + 0.5);
+      std::nth_element(order.begin() + begin, order.begin() + mid,
+                       order.begin() + end, compare);
+    }
+
+    stack.push_back({{begin, mid, firstpart, nleftparts}});
+    stack.push_back({{mid, end, firstpart + nleftparts, nparts - nleftparts}});
+  }
+}
+
+
+// Convert integer coordinates (of nbits bits each) in ndim dimensions
+// to the "transposed" Hilbert index (J. Skilling, "Programming the
+// Hilbert curve", AIP Conf. Proc. 707, 2004)
+
+static void hilbert_axes_to_transpose(unsigned int *x, int nbits, int ndim) {
+  unsigned int m = 1U << (nbits-1);
+
+  // Inverse undo excess work
+
+  for (unsigned int q = m; q > 1; q >>= 1) {
+    unsigned int p = q - 1;
+    for (int i = 0; i < ndim; i++) {
+      if (x[i] & q) {
+        x[0] ^= p;
+      } else {
+        unsigned int t = (x[0] ^ x[i]) & p;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+
+  for (int i = 1; i < ndim; i++)
+    x[i] ^= x[i-1];
+  unsigned int t = 0;
+  for (unsigned int q = m; q > 1; q >>= 1)
+    if (x[ndim-1] & q) t ^= q - 1;
+  for (int i = 0; i < ndim; i++)
+    x[i] ^= t;
+}
+
+// Interleave the bits of ndim integers into a single key (most
+// significant bits first)
+
+static uint64_t interleave_bits(unsigned int const *x, int nbits, int ndim) {
+  uint64_t key = 0;
+  for (int b = nbits-1; b >= 0; b--)
+    for (int i = 0; i < ndim; i++)
+      key = (key << 1) | ((x[i] >> b) & 1U);
+  return key;
+}
+
+
+// Key of a point along a space filling curve through a box
+
+uint64_t Mesh::space_filling_curve_key(JaliGeometry::Point const& point,
+                                       int const dim, double const *lo,
+                                       double const *hi, bool const hilbert) {
+  // Quantize the coordinates to as many bits per dimension as fit in
+  // a 64 bit key
+
+  int nbits = std::min(63/dim, 31);
+  double maxint = static_cast<double>((1U << nbits) - 1);
+  unsigned int x[3] = {0, 0, 0};
+  for (int d = 0; d < dim; d++) {
+    double width = hi[d] - lo[d];
+    if (width > 0.0)
+      x[d] = static_cast<unsigned int>((point[d] - lo[d])/width*maxint);
+  }
+  if (hilbert)
+    hilbert_axes_to_transpose(x, nbits, dim);
+  return interleave_bits(x, nbits, dim);
+}
+
+
+// Order points along a space filling curve through their bounding box
+
+void Mesh::order_along_space_filling_curve(
+    std::vector<JaliGeometry::Point> const& points, int const dim,
+    bool const hilbert, std::vector<int> *order) {
+  int npoints = points.size();
+  double lo[3] = {1.0e+20, 1.0e+20, 1.0e+20};
+  double hi[3] = {-1.0e+20, -1.0e+20, -1.0e+20};
+  for (auto const& p : points) {
+    for (int d = 0; d < dim; d++) {
+      lo[d] = std::min(lo[d], p[d]);
+      hi[d] = std::max(hi[d], p[d]);
+    }
+  }
+
+  std::vector<std::pair<uint64_t, int>> keys(npoints);
+  for (int i = 0; i < npoints; i++)
+    keys[i] = std::make_pair(space_filling_curve_key(points[i], dim, lo, hi,
+                                                     hilbert), i);
+  std::sort(keys.begin(), keys.end());
+
+  order->resize(npoints);
+  for (int i = 0; i < npoints; i++)
+    (*order)[i] = keys[i].second;
+}
+
+
+// Reverse Cuthill-McKee ordering of a graph. Each connected component
+// is started from a vertex of minimum degree and neighbors are visited
+// in order of increasing degree
+
+void Mesh::order_by_reverse_cuthill_mckee(std::vector<int> const& offsets,
+                                          std::vector<int> const& adjacency,
+                                          std::vector<int> *order) {
+  int nverts = static_cast<int>(offsets.size()) - 1;
+  order->clear();
+  if (nverts <= 0) return;
+  order->reserve(nverts);
+
+  auto degree = [&](int const v) { return offsets[v+1] - offsets[v]; };
+
+  std::vector<int> bydegree(nverts);
+  for (int v = 0; v < nverts; v++) bydegree[v] = v;
+  std::stable_sort(bydegree.begin(), bydegree.end(),
+                   [&](int const& a, int const& b) {
+                     return degree(a) < degree(b);
+                   });
+
+  std::vector<bool> visited(nverts, false);
+  std::vector<int> nbrs;
+  for (auto const& seed : bydegree) {
+    if (visited[seed]) continue;
+
+    // Breadth first traversal of this component
+
+    int head = order->size();
+    order->push_back(seed);
+    visited[seed] = true;
+    while (head < static_cast<int>(order->size())) {
+      int v = (*order)[head++];
+      nbrs.clear();
+      for (int j = offsets[v]; j < offsets[v+1]; j++)
+        if (!visited[adjacency[j]]) {
+          visited[adjacency[j]] = true;
+          nbrs.push_back(adjacency[j]);
+        }
+      std::stable_sort(nbrs.begin(), nbrs.end(),
+                       [&](int const& a, int const& b) {
+                         return degree(a) < degree(b);
+                       });
+      order->insert(order->end(), nbrs.begin(), nbrs.end());
+    }
+  }
+
+  std::reverse(order->begin(), order->end());
+}
+
+
+// Sort the owned cells along a space filling curve through their
+// centroids and chop up the sorted list into equal pieces
+
+void Mesh::get_partitioning_by_sfc(int const num_parts,
+                                   Partitioner_type const curvetype,
+                                   std::vector<std::vector<int>> *partitions,
+                                   std::vector<double> const *cell_weights) {
+  int ncells = num_cells<Entity_type::PARALLEL_OWNED>();
+  std::vector<JaliGeometry::Point> cen(ncells);
+  for (int c = 0; c < ncells; c++)
+    cen[c] = cell_centroid(c);
+
+  std::vector<int> order;
+  order_along_space_filling_curve(cen, spacedim,
+                                  curvetype == Partitioner_type::HILBERT,
+                                  &order);
+
+  if (cell_weights) {
+    chop_weighted_order(order, *cell_weights, num_parts, partitions);
+    return;
+  }
+
+  for (int i = 0; i < num_parts; i++) {
+    int begin = static_cast<int>(static_cast<int64_t>(ncells)*i/num_parts);
+    int end = static_cast<int>(static_cast<int64_t>(ncells)*(i+1)/num_parts);
+    (*partitions)[i].assign(order.begin() + begin, order.begin() + end);
   }
 }
 
 
 void Mesh::get_partitioning_by_index_space(int const num_parts,
-                                 std::vector<std::vector<int>> *partitions) {
+                                 std::vector<std::vector<int>> *partitions,
+                                 std::vector<double> const *cell_weights) {
         
   std::cerr << "No partitioner defined - " <<
       "subdividing cell index space into equal parts\n";
 
   int ncells = num_cells<Entity_type::PARALLEL_OWNED>();
+
+  if (cell_weights) {
+    std::vector<int> order(ncells);
+    for (int c = 0; c < ncells; c++) order[c] = c;
+    chop_weighted_order(order, *cell_weights, num_parts, partitions);
+    return;
+  }
+
   int maxcells_per_tile = ceil(static_cast<double>(ncells)/num_parts + 0.5);
   int index = 0;
 
@@ -3118,7 +4223,8 @@ void Mesh::get_partitioning_by_index_space(int const num_parts,
 #ifdef Jali_HAVE_METIS
 
 void Mesh::get_partitioning_with_metis(int const num_parts,
-                                  std::vector<std::vector<int>> *partitions) {
+                                  std::vector<std::vector<int>> *partitions,
+                                  std::vector<double> const *cell_weights) {
 
   std::cerr << "Partitioning mesh on each compute node into " << num_parts <<
       " parts using METIS\n";
@@ -3153,6 +4259,20 @@ void Mesh::get_partitioning_with_metis(int const num_parts,
   idx_t *vwt = nullptr;
   idx_t *adjwt = nullptr;
 
+  // METIS needs integer vertex weights - scale the cell weights so
+  // that the heaviest cell gets a weight of 1000
+
+  if (cell_weights) {
+    double maxweight = 0.0;
+    for (auto const& w : *cell_weights) maxweight = std::max(maxweight, w);
+    vwt = new idx_t[ncells_owned];
+    for (int c = 0; c < ncells_owned; c++)
+      vwt[c] = (maxweight > 0.0) ?
+          std::max(static_cast<idx_t>(1),
+                   static_cast<idx_t>(1000.0*(*cell_weights)[c]/maxweight +
+                                      0.5)) : 1;
+  }
+
   int numflag = 0;  // C style numbering of cells (nodes of the dual graph)
   idx_t ngraphvtx = ncells_owned;
   idx_t nparts = static_cast<idx_t>(num_parts);
@@ -3186,6 +4306,7 @@ void Mesh::get_partitioning_with_metis(int const num_parts,
   delete [] xadj;
   delete [] adjncy;
   delete [] idxpart;
+  delete [] vwt;
 }
 
 #endif
@@ -54,6 +54,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <cassert>
 #include <typeinfo>
+#include <functional>
 
 #include "MeshDefs.hh"
 #include "Point.hh"
@@ -63,6 +64,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Geometry.hh"
 #include "MeshTile.hh"
 #include "MeshSet.hh"
+#include "KDTree.hh"
 
 #define JALI_CACHE_VARS 1  // Switch to 0 to turn caching off
 
@@ -356,6 +358,194 @@ class Mesh {
 
   int num_tiles() const {return meshtiles.size();}
 
+  //! Partitioner used to build the tiles
+
+  Partitioner_type tile_partitioner() const {return partitioner_pref_;}
+
+  //! Number of halo layers around each tile
+
+  int num_ghost_layers_tile() const {return num_ghost_layers_tile_;}
+
+  //! Discard all tiles (same as rebuild_tiles(0)). Master tile IDs of
+  //! all entities become -1 and tiles obtained earlier are no longer
+  //! valid
+
+  void clear_tiles() {
+    check_not_frozen("Mesh::clear_tiles");
+    num_tiles_ini_ = 0;
+    destroy_tiles();
+  }
+
+  //! Discard the current tiles and build new ones, e.g. to match the
+  //! number of threads in a new phase of a run. Master tile IDs are
+  //! recomputed and tiles obtained earlier are no longer valid. Cell
+  //! weights given to repartition_tiles or learned by rebalance_tiles
+  //! are used for the new tiles too
+  //!
+  //! @param num_tiles  number of tiles (0 leaves the mesh without tiles)
+  //! @param partitioner  partitioner to use for this and later rebuilds
+  //! @param num_ghost_layers_tile  number of halo layers around each tile
+
+  void rebuild_tiles(int const num_tiles, Partitioner_type const partitioner,
+                     int const num_ghost_layers_tile);
+
+  //! Discard the current tiles and build 'num_tiles' new ones with the
+  //! current partitioner and halo depth
+
+  void rebuild_tiles(int const num_tiles) {
+    rebuild_tiles(num_tiles, partitioner_pref_, num_ghost_layers_tile_);
+  }
+
+  //! Split each tile into subtiles for cache blocking
+  //!
+  //! The owned cells of each tile are ordered along a Hilbert curve
+  //! and chopped into subtiles of at most 'num_cells_per_subtile'
+  //! cells, so that a thread can sweep its tile in pieces whose data
+  //! stays in cache (e.g. L2). The owned cell, node, edge and face
+  //! lists of each tile are reordered so that each subtile is a
+  //! contiguous range of them (see MeshTile::subtile_cells). The
+  //! subdivision is redone whenever the tiles are rebuilt
+  //!
+  //! @param num_cells_per_subtile  max cells in a subtile (0 means
+  //!                               tiles are not subdivided)
+
+  void subdivide_tiles(int const num_cells_per_subtile);
+
+  //! Max number of cells in a subtile (0 if tiles are not subdivided)
+
+  int num_cells_per_subtile() const {return num_cells_per_subtile_;}
+
+  //! Give each tile its own compact numbering of its entities with
+  //! connectivity and node coordinates in tile-local IDs (see
+  //! MeshTile::local_id), so tile kernels can work on contiguous tile
+  //! data. The local numbering is rebuilt along with the tiles and
+  //! must be rebuilt (by calling this again) if nodes move
+
+  void tile_local_numbering(bool const use_local_numbering);
+
+  //! Whether tiles have a local numbering
+
+  bool tile_local_numbering() const {return tile_local_numbering_;}
+
+  //! Quality of the tile partitioning
+  //!
+  //! @param imbalance  max number of owned cells in a tile divided by
+  //!                   the average number
+  //! @param num_cut_faces  number of faces between cells of different
+  //!                   tiles (-1 if faces were not requested)
+  //! @param halo_sizes number of cells in a one layer (node-connected)
+  //!                   halo around each tile, regardless of the number
+  //!                   of halo layers the tiles were built with
+
+  void tile_partition_quality(double *imbalance, int *num_cut_faces,
+                              std::vector<int> *halo_sizes) const;
+
+  //! Print a summary of the tile partitioning quality
+
+  void report_tile_partition_quality(std::ostream& os) const;
+
+  //! Rebuild the tiles (same number of tiles, partitioner and tile
+  //! halo depth) so that they balance the given cost of the owned
+  //! cells rather than their number. The weights are remembered and
+  //! used for later rebuilds. Tiles and master tile IDs obtained
+  //! before the call are no longer valid after it
+  //!
+  //! @param cell_weights  non-negative cost of each owned cell
+
+  void repartition_tiles(std::vector<double> const& cell_weights);
+
+  //! Rebuild the tiles balancing a per-cell cost given by a callback,
+  //! e.g. [&](Entity_ID c) {return cost[c];} for a StateVector 'cost'
+
+  void repartition_tiles(std::function<double(Entity_ID)> const& cell_weight);
+
+  //! Rebuild the tiles if measured times show they are imbalanced
+  //!
+  //! The cost of each owned cell is estimated by scaling its current
+  //! weight (1 if no weights were given so far) so that the cells of
+  //! each tile add up to the time measured for that tile. The tiles
+  //! are then rebuilt with these weights if the max tile time exceeds
+  //! 'tolerance' times the average
+  //!
+  //! @param tile_times  time measured for each tile
+  //! @param tolerance   acceptable ratio of max to average tile time
+  //!
+  //! Returns true if the tiles were rebuilt
+
+  bool rebalance_tiles(std::vector<double> const& tile_times,
+                       double const tolerance = 1.1);
+
+  //! Original IDs of renumbered entities
+  //!
+  //! If the mesh entities were renumbered for locality at
+  //! construction (see MeshFactory::renumbering), entry i is the ID
+  //! entity i would have had in the native ordering of the mesh
+  //! framework, so data laid out in that ordering can be remapped as
+  //! newdata[i] = olddata[original_ids(kind)[i]]. The list is empty if
+  //! the entities were not renumbered. Only NODE, EDGE, FACE and CELL
+  //! are meaningful here
+
+  std::vector<Entity_ID> const& original_ids(Entity_kind const kind) const;
+
+  //! Global IDs of entities in the mesh this mesh was redistributed from
+  //!
+  //! If this mesh was made by migrating the cells of another mesh to
+  //! new ranks (see MeshFactory::redistribute), entry i is the global
+  //! ID entity i (owned or ghost) had in the other mesh, or -1 for
+  //! boundary ghosts which have no counterpart there. The list is
+  //! empty otherwise. Only NODE and CELL are meaningful here
+
+  std::vector<Entity_ID> const& previous_GIDs(Entity_kind const kind) const;
+
+  //! Move data from a mesh to this mesh, which was made by
+  //! redistributing it (see previous_GIDs)
+  //!
+  //! @param prevmesh  mesh this mesh was redistributed from
+  //! @param kind      kind of entities the data lives on (NODE or CELL)
+  //! @param nbytes    size of the data of one entity in bytes
+  //! @param prevdata  data of entities of 'kind' and parallel type
+  //!                  'ptype' in prevmesh (only values of owned
+  //!                  entities are used)
+  //! @param ptype     PARALLEL_OWNED or ALL
+  //! @param data      data of entities of 'kind' and parallel type
+  //!                  'ptype' in this mesh (preallocated; entries of
+  //!                  boundary ghosts are left untouched)
+  //!
+  //! This is a collective call over the communicator of the mesh
+
+  void redistribute_data(Mesh const& prevmesh, Entity_kind const kind,
+                         int const nbytes, void const *prevdata,
+                         Entity_type const ptype, void *data) const;
+
+  //! Coloring of cells for race-free scatter kernels
+  //!
+  //! Cells of the same color share no node (and hence no edge or
+  //! face), so a kernel accumulating contributions of cells into
+  //! nodes, edges or faces can process all cells of one color
+  //! concurrently without atomics, one color after another. Entry i
+  //! is the list of cells (of all parallel types) with color i. The
+  //! coloring is computed on first use and kept with the mesh
+
+  std::vector<Entity_ID_List> const& cell_colors() const;
+
+  //! Color of a cell (see cell_colors)
+
+  int cell_color(Entity_ID const cellid) const;
+
+  //! Coloring of tiles for race-free scatter kernels
+  //!
+  //! Tiles of the same color share no node, including the nodes of
+  //! their halos, so tiles of one color can be processed concurrently
+  //! even if they write into their halo entities. Entry i is the list
+  //! of tiles with color i. The coloring is recomputed when the tiles
+  //! are rebuilt
+
+  std::vector<std::vector<int>> const& tile_colors() const;
+
+  //! Color of a tile (see tile_colors)
+
+  int tile_color(int const tileid) const;
+
   //! Nodes of mesh (of a particular parallel type OWNED, GHOST or ALL)
 
   template<Entity_type type = Entity_type::ALL>
@@ -456,7 +646,9 @@ class Mesh {
   //! cell, OWNED or GHOST. If ordered = true, the faces will be
   //! returned in a standard order according to Exodus II convention
   //! for standard cells; in all other situations (ordered = false or
-  //! non-standard cells), the list of faces will be in arbitrary order
+  //! non-standard cells), the list of faces will be in arbitrary order.
+  //! The cached cell-face connectivity is kept in the standard order,
+  //! so ordered requests are as cheap as unordered ones
   //!
   //! In 3D, direction is 1 if face normal points out of cell
   //! and -1 if face normal points into cell
@@ -1017,6 +1209,92 @@ class Mesh {
 
   void update_geometric_quantities();
 
+  //
+  // Read-only (frozen) mode
+  //-------------------------
+  //
+  // Some mesh data is built on first use - the spatial search trees,
+  // the cell and tile colorings and the membership maps and per-tile
+  // lists of sets - so threads querying a mesh concurrently can race
+  // to build it. Freezing the mesh builds all of it up front and
+  // makes the mesh read-only. After that the const queries of the
+  // mesh, its tiles and its sets only read data and may be called
+  // from any number of threads at once without locks: entity counts
+  // and lists, types, GIDs, connectivity, geometry (cached or
+  // recomputed), spatial queries, colorings, set membership and set
+  // entities. Sets must be built before freezing; the non-const
+  // versions of find_meshset, get_set_size and get_set_entities throw
+  // for a set that does not exist yet. Queries answered by the
+  // framework are reads of plain arrays in Mesh_simple and Mesh_flat;
+  // Mesh_MSTK answers some of them (e.g. upward adjacencies of nodes)
+  // through MSTK calls that allocate temporary lists and is therefore
+  // only as thread safe as the MSTK library it was built with.
+  //
+  // Modifying a frozen mesh - moving nodes, updating the geometric
+  // quantities, rebuilding the spatial index or the tiles, building
+  // sets or releasing their caches - throws an exception.
+
+  //! Build everything that is otherwise built on first use and make
+  //! the mesh read-only (no-op if it is already frozen). Must not be
+  //! called while other threads are querying the mesh
+
+  virtual
+  void freeze();
+
+  //! Make a frozen mesh modifiable again (e.g. to move nodes between
+  //! multithreaded phases). Lazily built data stays valid until the
+  //! mesh is modified. Must not be called while other threads are
+  //! querying the mesh
+
+  void thaw() {frozen_ = false;}
+
+  //! Whether the mesh is frozen (read-only)
+
+  bool frozen() const {return frozen_;}
+
+  //
+  // Spatial queries
+  //----------------
+  //
+  // These use k-d trees over the node coordinates and the cell
+  // centroids (owned and ghost entities) that are built on first
+  // use. The node tree is refit when node coordinates change and the
+  // cell tree when the geometric quantities are updated
+
+  //! Node closest to a point (-1 if there are no nodes)
+
+  Entity_ID closest_node(const JaliGeometry::Point& p) const;
+
+  //! The k nodes closest to a point (sorted by distance)
+
+  void closest_nodes(const JaliGeometry::Point& p, const int k,
+                     Entity_ID_List *nodeids) const;
+
+  //! Nodes within distance r of a point (in no particular order)
+
+  void nodes_within_radius(const JaliGeometry::Point& p, const double r,
+                           Entity_ID_List *nodeids) const;
+
+  //! Cell with centroid closest to a point (-1 if there are no cells)
+
+  Entity_ID closest_cell(const JaliGeometry::Point& p) const;
+
+  //! The k cells with centroids closest to a point (sorted by distance)
+
+  void closest_cells(const JaliGeometry::Point& p, const int k,
+                     Entity_ID_List *cellids) const;
+
+  //! Cells with centroids within distance r of a point (in no
+  //! particular order)
+
+  void cells_within_radius(const JaliGeometry::Point& p, const double r,
+                           Entity_ID_List *cellids) const;
+
+  //! Rebuild the spatial search trees from scratch (refitting keeps
+  //! queries exact but they can slow down after large node motions)
+
+  void rebuild_spatial_index() const;
+
   //
   // Mesh Sets for ICs, BCs, Material Properties and whatever else
   //--------------------------------------------------------------
@@ -1080,6 +1358,35 @@ class Mesh {
                          const Entity_type type,
                          Entity_ID_List *entids) const;
 
+  //! Build the sets with the given names on entities of the given
+  //! kinds on all ranks at once (COLLECTIVE - must be called on all
+  //! ranks of the mesh communicator with the same arguments)
+  //!
+  //! Cell sets from POINT regions are made consistent across ranks
+  //! so that exactly one rank owns the cell containing the point
+  //! (the one with the lowest global ID if the point is on a shared
+  //! face or node). The global number of entities and the global
+  //! bounding box of every set listed are computed with a single
+  //! reduction and can be queried from the MeshSet afterwards. Sets
+  //! that were built earlier are reused except for POINT cell sets
+  //! which are rebuilt
+
+  void build_sets_collectively(std::vector<std::string> const& setnames,
+                               std::vector<Entity_kind> const& kinds);
+
+  //! Approximate memory (in bytes) used by the sets on entities of
+  //! 'kind' that have been built so far, including any lazily built
+  //! bitmaps or reverse maps
+
+  std::size_t meshsets_memory_used(const Entity_kind kind =
+                                   Entity_kind::ANY_KIND) const;
+
+  //! Release the lazily built bitmaps and reverse maps of all sets
+  //! on entities of 'kind' (they are rebuilt on demand)
+
+  void release_meshset_caches(const Entity_kind kind =
+                              Entity_kind::ANY_KIND) const;
+
 
   //! \brief Export to Exodus II file
   //! Export mesh to Exodus II file. If with_fields is true, the fields in
@@ -1105,6 +1412,23 @@ class Mesh {
 
  protected:
 
+  //! Derived classes must call this when node coordinates change so
+  //! that the spatial search trees get refit
+
+  void node_coordinates_changed() const {
+    node_kdtree_stale_ = true;
+  }
+
+  //! Methods that modify the mesh call this first - throws if the
+  //! mesh is frozen
+
+  void check_not_frozen(std::string const& caller) const;
+
+  //! Build or refit the spatial search trees if needed
+
+  KDTree const& node_kdtree() const;
+  KDTree const& cell_kdtree() const;
+
   int compute_cell_geometric_quantities() const;
   int compute_face_geometric_quantities() const;
   int compute_edge_geometric_quantities() const;
@@ -1173,7 +1497,40 @@ class Mesh {
 
   std::shared_ptr<MeshSet> build_set(const std::string setname,
                                      const Entity_kind kind,
-                                     const bool build_reverse_map = true);
+                                     const bool build_reverse_map = false);
+
+  //! Find cells (owned or ghost) on this rank that contain a point
+
+  void find_cells_containing_point(JaliGeometry::Point const& pnt,
+                                   Entity_ID_List *cells) const;
+
+  //! Order points along a Hilbert (or Morton if hilbert = false)
+  //! space filling curve through their bounding box. On return,
+  //! order[i] is the index of the i'th point along the curve
+
+  static
+  void order_along_space_filling_curve(
+      std::vector<JaliGeometry::Point> const& points, int const dim,
+      bool const hilbert, std::vector<int> *order);
+
+  //! Key of a point along a Hilbert (or Morton if hilbert = false)
+  //! space filling curve through the box with corners lo and hi. Keys
+  //! computed with the same box are comparable across ranks
+
+  static
+  uint64_t space_filling_curve_key(JaliGeometry::Point const& point,
+                                   int const dim, double const *lo,
+                                   double const *hi, bool const hilbert);
+
+  //! Reverse Cuthill-McKee ordering of a graph given in compressed
+  //! form (neighbors of vertex i are adjacency[offsets[i]] through
+  //! adjacency[offsets[i+1]-1]). On return, order[i] is the i'th
+  //! vertex in the new ordering
+
+  static
+  void order_by_reverse_cuthill_mckee(std::vector<int> const& offsets,
+                                      std::vector<int> const& adjacency,
+                                      std::vector<int> *order);
 
   //! get labeled set entities
   //
@@ -1254,9 +1611,11 @@ class Mesh {
   // The following methods are declared const since they do not modify the
   // mesh but just modify cached variables declared as mutable
 
+  virtual
   int compute_cell_geometry(const Entity_ID cellid,
                             double *volume,
                             JaliGeometry::Point *centroid) const;
+  virtual
   int compute_face_geometry(const Entity_ID faceid,
                             double *area,
                             JaliGeometry::Point *centroid,
@@ -1294,6 +1653,22 @@ class Mesh {
   void build_tiles();
   void add_tile(std::shared_ptr<MeshTile> tile2add);
   void init_tiles();
+  void destroy_tiles();
+
+  // Greedy coloring of items that conflict if they share a node -
+  // items[i] lists the nodes of item i and color_ids[i] receives its
+  // color. Returns the number of colors
+
+  static int color_by_shared_nodes(std::vector<Entity_ID_List> const& items,
+                                   int const num_nodes,
+                                   std::vector<int> *color_ids);
+
+  // Exchange variable amounts of bytes with all ranks - sendbufs[p] is
+  // sent to rank p and recvbufs[p] receives what rank p sent
+
+  static void exchange_bytes(MPI_Comm comm,
+                             std::vector<std::vector<char>> const& sendbufs,
+                             std::vector<std::vector<char>> *recvbufs);
   int get_new_tile_ID() const { return meshtiles.size(); }
 
   // Set master tile ID for entities
@@ -1351,18 +1726,43 @@ class Mesh {
   MPI_Comm comm;
 
   // MeshTile data (A meshtile is a list of cell indices that will be
-  // processed together)
+  // processed together). The number of tiles, their halo depth and
+  // the partitioner start out as given to the constructor and can be
+  // changed by rebuild_tiles
 
-  const int num_tiles_ini_;
-  const int num_ghost_layers_tile_;
+  int num_tiles_ini_;
+  int num_ghost_layers_tile_;
   const int num_ghost_layers_distmesh_;
   const bool boundary_ghosts_requested_;
-  const Partitioner_type partitioner_pref_;
+  Partitioner_type partitioner_pref_;
   bool tiles_initialized_ = false;
   std::vector<std::shared_ptr<MeshTile>> meshtiles;
   std::vector<int> node_master_tile_ID_, edge_master_tile_ID_;
   std::vector<int> face_master_tile_ID_, cell_master_tile_ID_;
 
+  // Weights of owned cells used to balance tiles (empty means all
+  // cells count the same)
+
+  std::vector<double> tile_cell_weights_;
+
+  // Max number of cells in a subtile of a tile (0 means no subtiles)
+
+  int num_cells_per_subtile_ = 0;
+
+  // Whether tiles get a tile-local numbering of their entities
+
+  bool tile_local_numbering_ = false;
+
+  // Original IDs of NODE, EDGE, FACE and CELL entities if they were
+  // renumbered at construction
+
+  std::vector<Entity_ID> original_ids_[4];
+
+  // Global IDs of NODE, EDGE, FACE and CELL entities in the mesh this
+  // mesh was redistributed from
+
+  std::vector<Entity_ID> previous_gids_[4];
+
   // MeshSets (collection of entities of a particular kind)
 
   bool meshsets_initialized_ = false;
@@ -1476,12 +1876,37 @@ class Mesh {
     edge_geometry_precomputed, side_geometry_precomputed,
     corner_geometry_precomputed;
 
+  // Whether cell-face connectivity (see JALI_CACHE_VARS) and cell and
+  // face geometry are cached. Frameworks that can answer these
+  // queries directly without storing anything per entity (like
+  // structured Mesh_simple) or that already store the connectivity
+  // in a form as fast as the cache (like Mesh_flat) turn these off
+  // before caching the extra variables, and the queries are then
+  // forwarded to them
+
+  bool cache_vars_ = true;
+  bool cache_geometry_ = true;
+
   // Pointer to geometric model that contains descriptions of
   // geometric regions - These geometric regions are used to define
   // entity sets for properties, boundary conditions etc.
 
   JaliGeometry::GeometricModelPtr geometric_model_;
 
+  // Spatial search trees over node coordinates and cell centroids
+
+  mutable KDTree node_kdtree_, cell_kdtree_;
+  mutable bool node_kdtree_stale_ = false, cell_kdtree_stale_ = false;
+
+  // Colorings of cells and tiles (computed on demand)
+
+  mutable std::vector<Entity_ID_List> cell_colors_, tile_colors_;
+  mutable std::vector<int> cell_color_ids_, tile_color_ids_;
+
+  // Whether the mesh is read-only (see freeze)
+
+  bool frozen_ = false;
+
 
   //! Make the State class a friend so that it can access protected
   //! methods for retrieving and storing mesh fields
@@ -1519,27 +1944,60 @@ class Mesh {
 
  private:
 
-  /// Method to get partitioning of a mesh into num parts
+  /// Method to get partitioning of a mesh into num parts, optionally
+  /// balancing the weights of owned cells rather than their number
 
   void get_partitioning(int const num_parts,
                         Partitioner_type const parttype,
-                        std::vector<std::vector<int>> *partitions);
+                        std::vector<std::vector<int>> *partitions,
+                        std::vector<double> const *cell_weights = nullptr);
+
+  /// Method to split an ordered list of cells into num_parts contiguous
+  /// pieces of nearly equal weight
+
+  static
+  void chop_weighted_order(std::vector<int> const& order,
+                           std::vector<double> const& cell_weights,
+                           int const num_parts,
+                           std::vector<std::vector<int>> *partitions);
 
   /// Method to get crude partitioning by chopping up the index space
 
   void get_partitioning_by_index_space(int const num_parts,
-                                       std::vector<std::vector<int>> *partitions);
+                                       std::vector<std::vector<int>> *partitions,
+                                       std::vector<double> const *cell_weights =
+                                       nullptr);
 
   /// Method to get crude partitioning by subdivision into rectangular blocks
 
   void get_partitioning_by_blocks(int const num_parts,
                                        std::vector<std::vector<int>> *partitions);
 
+  /// Method to get partitioning by recursive coordinate bisection of
+  /// cell centroids
+
+  void get_partitioning_by_rcb(int const num_parts,
+                               std::vector<std::vector<int>> *partitions,
+                               std::vector<double> const *cell_weights =
+                               nullptr);
+
+  /// Method to get partitioning by chopping up a space filling curve
+  /// (Partitioner_type::HILBERT or Partitioner_type::MORTON) through
+  /// the cell centroids
+
+  void get_partitioning_by_sfc(int const num_parts,
+                               Partitioner_type const curvetype,
+                               std::vector<std::vector<int>> *partitions,
+                               std::vector<double> const *cell_weights =
+                               nullptr);
+
   /// Method to get partitioning of a mesh into num parts using METIS
 
 #ifdef Jali_HAVE_METIS
   void get_partitioning_with_metis(int const num_parts,
-                                   std::vector<std::vector<int>> *partitions);
+                                   std::vector<std::vector<int>> *partitions,
+                                   std::vector<double> const *cell_weights =
+                                   nullptr);
 #endif
 
   /// Method to get partitioning of a mesh into num parts using ZOLTAN
@@ -148,6 +148,22 @@ bool entity_valid_kind(const Entity_kind kind) {
   return (kind >= Entity_kind::NODE && kind <= Entity_kind::CELL);
 }
 
+// Kind of the entities of a labeled set region given as "CELL" or
+// "Entity_kind::CELL" (likewise for FACE, EDGE and NODE) - returns
+// Entity_kind::UNKNOWN_KIND for anything else
+
+inline
+Entity_kind labeled_set_kind(std::string const& entity_str) {
+  for (auto const& kind : {Entity_kind::NODE, Entity_kind::EDGE,
+          Entity_kind::FACE, Entity_kind::CELL}) {
+    std::string kind_str = Entity_kind_string(kind);
+    if (entity_str == kind_str ||
+        entity_str == kind_str.substr(kind_str.find("::") + 2))
+      return kind;
+  }
+  return Entity_kind::UNKNOWN_KIND;
+}
+
 
 
 
@@ -247,9 +263,12 @@ enum class Partitioner_type : std::uint8_t {
     BLOCK,
     METIS,
     ZOLTAN_GRAPH,
-    ZOLTAN_RCB
+    ZOLTAN_RCB,
+    RCB,          // built-in recursive coordinate bisection
+    HILBERT,      // built-in Hilbert space filling curve
+    MORTON        // built-in Morton (Z-order) space filling curve
 };
-constexpr int NUM_PARTITIONER_TYPES = 5;
+constexpr int NUM_PARTITIONER_TYPES = 8;
 
 // Return an string description for each partitioner type
 inline
@@ -257,7 +276,9 @@ std::string Partitioner_type_string(const Partitioner_type partitioner_type) {
   static std::string partitioner_type_str[NUM_PARTITIONER_TYPES] =
       {"Partitioner_type::INDEX", "Partitioner_type::BLOCK",
        "Partitioner_type::METIS",
-       "Partitioner_type::ZOLTAN_GRAPH", "Partitioner_type::ZOLTAN_RCB"};
+       "Partitioner_type::ZOLTAN_GRAPH", "Partitioner_type::ZOLTAN_RCB",
+       "Partitioner_type::RCB", "Partitioner_type::HILBERT",
+       "Partitioner_type::MORTON"};
 
   int iptype = static_cast<int>(partitioner_type);
   return (iptype >= 0 && iptype < NUM_PARTITIONER_TYPES) ?
@@ -272,6 +293,35 @@ std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+// Types of locality improving renumbering of mesh entities
+
+enum class Renumbering_type : std::uint8_t {
+    NONE,         // keep the order of the underlying framework
+    RCM,          // reverse Cuthill-McKee ordering of the cell graph
+    HILBERT       // Hilbert space filling curve ordering of cell centers
+};
+constexpr int NUM_RENUMBERING_TYPES = 3;
+
+// Return an string description for each renumbering type
+inline
+std::string Renumbering_type_string(const Renumbering_type renumbering_type) {
+  static std::string renumbering_type_str[NUM_RENUMBERING_TYPES] =
+      {"Renumbering_type::NONE", "Renumbering_type::RCM",
+       "Renumbering_type::HILBERT"};
+
+  int irtype = static_cast<int>(renumbering_type);
+  return (irtype >= 0 && irtype < NUM_RENUMBERING_TYPES) ?
+      renumbering_type_str[irtype] : "";
+}
+
+// Output operator for Renumbering_type
+inline
+std::ostream& operator<<(std::ostream& os,
+                         const Renumbering_type& renumbering_type) {
+  os << " " << Renumbering_type_string(renumbering_type) << " ";
+  return os;
+}
+
 // Types of partitioning algorithms - Add as needed in the format METIS_RCB etc.
 
 enum class Partitioning_scheme {DEFAULT};
@@ -54,9 +54,16 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "MeshDefs.hh"
 #include "Mesh.hh"
+#include "MeshTile.hh"
+#include "errors.hh"
 
 namespace Jali {
 
+// Sets with fewer than 1 in this many of the mesh entities get a
+// sparse reverse map
+
+static int const sparse_reverse_map_inverse_density_ = 16;
+
 /*! 
   @brief Constructor for MeshSet
   
@@ -86,14 +93,163 @@ MeshSet::MeshSet(std::string const& name,
   entityids_all_.insert(entityids_all_.end(), entityids_ghost_.begin(),
                         entityids_ghost_.end());
 
-  if (build_reverse_map) {
-    mesh2subset_.resize(mesh_.num_entities(kind, Entity_type::ALL), -1);
-    int nall = entityids_all_.size();
-    for (int i = 0; i < nall; ++i)
-      mesh2subset_[entityids_all_[i]] = i;
-  }
+  // The reverse map is a full mesh sized array - if it is not
+  // explicitly requested, it is built on first use
+
+  if (build_reverse_map)
+    materialize(MeshSet_rep::REVERSE_MAP);
 }  // MeshSet::MeshSet
 
+
+// Build a representation of the set for membership queries if it
+// does not exist already
+
+void MeshSet::materialize(MeshSet_rep rep) const {
+  int nall = entityids_all_.size();
+  switch (rep) {
+    case MeshSet_rep::BITMAP:
+      if (bitmap_.empty()) {
+        bitmap_.resize(mesh_.num_entities(kind_, Entity_type::ALL), false);
+        for (int i = 0; i < nall; ++i)
+          bitmap_[entityids_all_[i]] = true;
+      }
+      break;
+    case MeshSet_rep::REVERSE_MAP:
+      if (mesh2subset_.empty() && sparse_mesh2subset_.empty()) {
+        int nmesh = mesh_.num_entities(kind_, Entity_type::ALL);
+
+        // Sets holding a small fraction of the mesh entities (like
+        // boundary face sets) get a sorted list of (entity, index)
+        // pairs searched with a binary search; others get a full
+        // mesh sized array for O(1) lookups
+
+        if (nall*sparse_reverse_map_inverse_density_ < nmesh) {
+          sparse_mesh2subset_.reserve(nall);
+          for (int i = 0; i < nall; ++i)
+            sparse_mesh2subset_.emplace_back(entityids_all_[i], i);
+          std::sort(sparse_mesh2subset_.begin(), sparse_mesh2subset_.end());
+        } else {
+          mesh2subset_.resize(nmesh, -1);
+          for (int i = 0; i < nall; ++i)
+            mesh2subset_[entityids_all_[i]] = i;
+        }
+      }
+      break;
+    default:  // ID lists always exist
+      break;
+  }
+}  // MeshSet::materialize
+
+
+// Release the lazily built representations. Other threads may be
+// reading them if the mesh is frozen
+
+void MeshSet::release_cached_representations() const {
+  if (mesh_.frozen()) {
+    Errors::Message mesg("MeshSet::release_cached_representations - "
+                         "cannot modify a set of a frozen mesh");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  Entity_ID_List().swap(mesh2subset_);
+  std::vector<std::pair<Entity_ID, Entity_ID>>().swap(sparse_mesh2subset_);
+  std::vector<bool>().swap(bitmap_);
+  release_tile_partition();
+}
+
+
+// Partition the set entities by mesh tile. Each tile's lists are
+// found by looking up the tile's entities in the set (rather than
+// searching the tile for each set entity) and then put back in set
+// order. Tiles are independent of each other so this loop could be
+// farmed out to threads if needed
+
+void MeshSet::build_tile_partition() const {
+  int ntiles = mesh_.num_tiles();
+  if (tile_entities_all_.size() == ntiles) return;
+
+  tile_entities_owned_.assign(ntiles, Entity_ID_List());
+  tile_entities_ghost_.assign(ntiles, Entity_ID_List());
+  tile_entities_all_.assign(ntiles, Entity_ID_List());
+
+  // the first nowned entries of the set are its owned entities and
+  // the rest are its ghost entities
+
+  int nowned = entityids_owned_.size();
+
+  for (auto const& tile : mesh_.tiles()) {
+    int t = tile->ID();
+    Entity_ID_List owned_idx, ghost_idx, all_idx;
+
+    for (auto const& ent : tile->entities(kind_, Entity_type::PARALLEL_OWNED)) {
+      int idx = index_in_set(ent);
+      if (idx == -1) continue;
+      if (idx < nowned) owned_idx.push_back(idx);
+      all_idx.push_back(idx);
+    }
+    for (auto const& ent : tile->entities(kind_, Entity_type::PARALLEL_GHOST)) {
+      int idx = index_in_set(ent);
+      if (idx == -1) continue;
+      if (idx >= nowned) ghost_idx.push_back(idx);
+      all_idx.push_back(idx);
+    }
+
+    std::sort(owned_idx.begin(), owned_idx.end());
+    std::sort(ghost_idx.begin(), ghost_idx.end());
+    std::sort(all_idx.begin(), all_idx.end());
+
+    tile_entities_owned_[t].reserve(owned_idx.size());
+    for (auto const& i : owned_idx)
+      tile_entities_owned_[t].push_back(entityids_all_[i]);
+    tile_entities_ghost_[t].reserve(ghost_idx.size());
+    for (auto const& i : ghost_idx)
+      tile_entities_ghost_[t].push_back(entityids_all_[i]);
+    tile_entities_all_[t].reserve(all_idx.size());
+    for (auto const& i : all_idx)
+      tile_entities_all_[t].push_back(entityids_all_[i]);
+  }
+}  // MeshSet::build_tile_partition
+
+
+// Set entities in a tile
+
+Entity_ID_List const& MeshSet::entities_in_tile(int tileid,
+                                                Entity_type ptype) const {
+  build_tile_partition();
+  if (tileid < 0 || tileid >= tile_entities_all_.size())
+    return dummylist_;
+
+  if (ptype == Entity_type::PARALLEL_OWNED)
+    return tile_entities_owned_[tileid];
+  else if (ptype == Entity_type::PARALLEL_GHOST)
+    return tile_entities_ghost_[tileid];
+  else if (ptype == Entity_type::ALL)
+    return tile_entities_all_[tileid];
+  else
+    return dummylist_;
+}
+
+
+// Approximate memory used by the set (entity lists and whatever
+// lazily built representations exist at the moment)
+
+std::size_t MeshSet::memory_used() const {
+  std::size_t nbytes = sizeof(MeshSet) + name_.capacity();
+  nbytes += (entityids_owned_.capacity() + entityids_ghost_.capacity() +
+             entityids_all_.capacity() + mesh2subset_.capacity())*
+      sizeof(Entity_ID);
+  nbytes += sparse_mesh2subset_.capacity()*
+      sizeof(std::pair<Entity_ID, Entity_ID>);
+  nbytes += (bitmap_.capacity() + 7)/8;
+  for (auto const& l : tile_entities_owned_)
+    nbytes += sizeof(l) + l.capacity()*sizeof(Entity_ID);
+  for (auto const& l : tile_entities_ghost_)
+    nbytes += sizeof(l) + l.capacity()*sizeof(Entity_ID);
+  for (auto const& l : tile_entities_all_)
+    nbytes += sizeof(l) + l.capacity()*sizeof(Entity_ID);
+  return nbytes;
+}  // MeshSet::memory_used
+
 // Standalone function to make a set and return a pointer to it so
 // that Mesh.hh can use a forward declaration of MeshSet and this
 // function to create new sets
@@ -180,7 +336,7 @@ merge(std::vector<std::shared_ptr<MeshSet>> const& inpsets, bool temporary) {
   }
   
   // If either of these sets has the reverse map, then the result has it too
-  bool build_reverse_map = set0->mesh2subset_.size() ? true : false;
+  bool build_reverse_map = set0->materialized(MeshSet_rep::REVERSE_MAP);
   
   // If the set is temporary, we don't need to call make_meshset and
   // add it to the mesh
@@ -233,7 +389,7 @@ subtract(std::shared_ptr<MeshSet> const& set0,
   std::string newname = "(" + set0->name_ + ")_MINUS_(" + setunion->name_ + ")";
 
   // If either of these sets has the reverse map, then the result has it too
-  bool build_reverse_map = set0->mesh2subset_.size() ? true : false;
+  bool build_reverse_map = set0->materialized(MeshSet_rep::REVERSE_MAP);
   
   // If the set is temporary, we don't need to call make_meshset and
   // add it to the mesh
@@ -303,7 +459,7 @@ intersect(std::vector<std::shared_ptr<MeshSet>> const& inpsets,
     newname += "_INTERSECT_(" + set->name_ + ")";
   }
   
-  bool build_reverse_map = set0->mesh2subset_.size() ? true : false;
+  bool build_reverse_map = set0->materialized(MeshSet_rep::REVERSE_MAP);
   
   // If the set is temporary, we don't need to call make_meshset and
   // add it to the mesh
@@ -350,7 +506,7 @@ complement(std::vector<std::shared_ptr<MeshSet>> inpsets, bool temporary) {
   std::string newname = "NOT_(" + setunion->name_ + ")";
   
   // If this set has the reverse map, then the result has it too
-  bool build_reverse_map = set0->mesh2subset_.size() ? true : false;
+  bool build_reverse_map = set0->materialized(MeshSet_rep::REVERSE_MAP);
   
   // If the set is temporary, we don't need to call make_meshset and
   // add it to the mesh
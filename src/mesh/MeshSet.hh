@@ -49,11 +49,13 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <utility>
 #include <cassert>
 
 #include "mpi.h"
 
 #include "MeshDefs.hh"
+#include "Point.hh"
 
 namespace Jali {
 
@@ -103,6 +105,20 @@ std::shared_ptr<MeshSet>
 complement(std::vector<std::shared_ptr<MeshSet>> inpsets,
            bool temporary = false);
 
+/*!
+  @brief Representations in which membership in a MeshSet can be queried
+
+  ID_LIST is the list of entities itself and always exists. BITMAP
+  is one bit per mesh entity and answers "is this entity in the set"
+  queries. REVERSE_MAP maps a mesh entity to its index in the set -
+  for sets that are small compared to the mesh it is stored as a
+  sorted list of (entity, index) pairs instead of a full mesh sized
+  array. The latter two are built only when first needed (or
+  explicitly requested) and are then kept around until released.
+*/
+
+enum class MeshSet_rep {ID_LIST, BITMAP, REVERSE_MAP};
+
 class MeshSet {
 
  public:
@@ -114,7 +130,7 @@ class MeshSet {
           Entity_kind const& kind,
           Entity_ID_List const& owned_entities,
           Entity_ID_List const& ghost_entities,
-          bool build_reverse_map = true);
+          bool build_reverse_map = false);
 
 
   /// @brief Copy Constructor
@@ -126,7 +142,15 @@ class MeshSet {
       entityids_owned_(meshset_in.entityids_owned_),
       entityids_ghost_(meshset_in.entityids_ghost_),
       entityids_all_(meshset_in.entityids_all_),
-      mesh2subset_(meshset_in.mesh2subset_) {}
+      mesh2subset_(meshset_in.mesh2subset_),
+      sparse_mesh2subset_(meshset_in.sparse_mesh2subset_),
+      bitmap_(meshset_in.bitmap_),
+      tile_entities_owned_(meshset_in.tile_entities_owned_),
+      tile_entities_ghost_(meshset_in.tile_entities_ghost_),
+      tile_entities_all_(meshset_in.tile_entities_all_),
+      global_num_owned_(meshset_in.global_num_owned_),
+      global_bbox_lo_(meshset_in.global_bbox_lo_),
+      global_bbox_hi_(meshset_in.global_bbox_hi_) {}
 
   /// @brief Assignment operator - deleted because we cannot reassign the 
   /// reference to the Mesh
@@ -215,11 +239,121 @@ class MeshSet {
   }
 
   
-  /// @brief check if mesh entity index is in meshset
+  /// @brief index of mesh entity in the meshset (-1 if it is not
+  /// in the set) - builds the reverse map on first use
 
   Entity_ID index_in_set(Entity_ID const& mesh_entity) const {
-    return (mesh2subset_.size() ? mesh2subset_[mesh_entity] : -1);
+    if (entityids_all_.empty()) return -1;
+    if (mesh2subset_.empty() && sparse_mesh2subset_.empty())
+      materialize(MeshSet_rep::REVERSE_MAP);
+    if (mesh2subset_.size())
+      return mesh2subset_[mesh_entity];
+
+    auto it = std::lower_bound(sparse_mesh2subset_.begin(),
+                               sparse_mesh2subset_.end(),
+                               std::make_pair(mesh_entity, Entity_ID(-1)));
+    if (it != sparse_mesh2subset_.end() && it->first == mesh_entity)
+      return it->second;
+    else
+      return -1;
+  }
+
+  /// @brief check if mesh entity is in the meshset - uses the
+  /// reverse map if it exists, otherwise builds (only) a bitmap
+
+  bool contains(Entity_ID const& mesh_entity) const {
+    if (entityids_all_.empty()) return false;
+    if (!mesh2subset_.empty() || !sparse_mesh2subset_.empty())
+      return (index_in_set(mesh_entity) != -1);
+    if (bitmap_.empty())
+      materialize(MeshSet_rep::BITMAP);
+    return (bitmap_.size() ? bitmap_[mesh_entity] : false);
+  }
+
+  /// @brief Build a particular representation of the set now rather
+  /// than on first use (no-op if it already exists)
+
+  void materialize(MeshSet_rep rep) const;
+
+  /// @brief Is a particular representation of the set currently
+  /// built (an empty set needs none, so it counts as built)
+
+  bool materialized(MeshSet_rep rep) const {
+    if (entityids_all_.empty())
+      return true;
+    else if (rep == MeshSet_rep::BITMAP)
+      return !bitmap_.empty();
+    else if (rep == MeshSet_rep::REVERSE_MAP)
+      return (!mesh2subset_.empty() || !sparse_mesh2subset_.empty());
+    else
+      return true;
+  }
+
+  /// @brief Is the reverse map (if built) stored in sparse form
+
+  bool sparse_reverse_map() const {
+    return !sparse_mesh2subset_.empty();
   }
+
+  /// @brief Number of owned entities in the set across all ranks
+  ///
+  /// Returns -1 if the global statistics of the set have not been
+  /// computed (see Mesh::build_sets_collectively)
+
+  int global_num_entities() const {
+    return global_num_owned_;
+  }
+
+  /// @brief Bounding box of the set across all ranks
+  ///
+  /// Returns false if the global statistics of the set have not been
+  /// computed or if the set is empty on all ranks
+
+  bool global_bounding_box(JaliGeometry::Point *lo,
+                           JaliGeometry::Point *hi) const {
+    if (global_num_owned_ <= 0) return false;
+    *lo = global_bbox_lo_;
+    *hi = global_bbox_hi_;
+    return true;
+  }
+
+  /// @brief Set entities in a mesh tile
+  ///
+  /// @param tileid  ID of the tile
+  /// @param ptype   Entity_type in the tile's sense (PARALLEL_OWNED
+  ///                for entities owned by the tile, PARALLEL_GHOST for
+  ///                its halo entities, ALL for both) - owned/ghost
+  ///                also restricts the set entities to those of the
+  ///                same parallel type
+  ///
+  /// The partition of the set entities over all the tiles of the mesh
+  /// is built on the first call and reused after that
+
+  Entity_ID_List const& entities_in_tile(int tileid, Entity_type ptype) const;
+
+  /// @brief Build the per-tile partition of the set entities now
+  /// rather than on first use
+
+  void build_tile_partition() const;
+
+  /// @brief Release the lazily built representations (bitmap,
+  /// reverse map, per-tile lists) - they are rebuilt if needed
+  /// again. Throws if the mesh is frozen (see Mesh::freeze)
+
+  void release_cached_representations() const;
+
+  /// @brief Release the per-tile lists of set entities (must be
+  /// called when the tiles of the mesh are rebuilt)
+
+  void release_tile_partition() const {
+    std::vector<Entity_ID_List>().swap(tile_entities_owned_);
+    std::vector<Entity_ID_List>().swap(tile_entities_ghost_);
+    std::vector<Entity_ID_List>().swap(tile_entities_all_);
+  }
+
+  /// @brief Approximate number of bytes used by this set
+
+  std::size_t memory_used() const;
   
   /// @brief Union of arbitrary number of mesh sets
   ///
@@ -277,13 +411,33 @@ class MeshSet {
   Entity_ID_List entityids_owned_, entityids_ghost_, entityids_all_;
   Entity_ID_List dummylist_;
 
-  Entity_ID_List mesh2subset_;
+  // Lazily built representations for membership queries (see
+  // MeshSet_rep) - mutable since they are only caches
+
+  mutable Entity_ID_List mesh2subset_;
+  mutable std::vector<std::pair<Entity_ID, Entity_ID>> sparse_mesh2subset_;
+  mutable std::vector<bool> bitmap_;
+
+  // Set entities in each tile of the mesh (indexed by tile ID)
+
+  mutable std::vector<Entity_ID_List> tile_entities_owned_;
+  mutable std::vector<Entity_ID_List> tile_entities_ghost_;
+  mutable std::vector<Entity_ID_List> tile_entities_all_;
+
+  // Global statistics (filled in by Mesh::build_sets_collectively)
+
+  int global_num_owned_ = -1;
+  JaliGeometry::Point global_bbox_lo_, global_bbox_hi_;
 
   // Make the State class a friend so that it can access protected
   // methods for retrieving and storing mesh fields
 
   friend class State;
 
+  // Make the Mesh class a friend so that it can fill in the global
+  // statistics of the set
+
+  friend class Mesh;
 
 };  // End class MeshSet
 
@@ -300,7 +454,7 @@ std::shared_ptr<MeshSet> make_meshset(std::string const& name,
                                       Entity_kind const& kind,
                                       Entity_ID_List const& owned_entities,
                                       Entity_ID_List const& ghost_entities,
-                                      bool with_reverse_map = true);
+                                      bool with_reverse_map = false);
 
 
 }  // end namespace Jali
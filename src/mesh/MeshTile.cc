@@ -49,6 +49,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <functional>
 
 
 #include "MeshDefs.hh"
@@ -342,208 +343,230 @@ std::shared_ptr<MeshTile> make_meshtile(Mesh& parent_mesh,
 }
 
 
-//! Get list of tile entities of type 'kind' and 'type' in set ('setname')
+// Split the tile into subtiles - the owned cells are reordered to
+// follow the subtiles and every other owned entity is placed with the
+// first subtile that has a cell using it
+
+void MeshTile::set_subtiles(std::vector<Entity_ID_List> const&
+                            subtile_cells) {
+  std::vector<Entity_ID_List>().swap(subtile_cells_);
+  std::vector<Entity_ID_List>().swap(subtile_nodes_);
+  std::vector<Entity_ID_List>().swap(subtile_edges_);
+  std::vector<Entity_ID_List>().swap(subtile_faces_);
+  if (subtile_cells.size() < 2) return;
+
+  subtile_cells_ = subtile_cells;
+  int nsub = subtile_cells_.size();
+
+  cellids_owned_.clear();
+  for (auto const& cells : subtile_cells_)
+    cellids_owned_.insert(cellids_owned_.end(), cells.begin(), cells.end());
+  cellids_all_ = cellids_owned_;
+  cellids_all_.insert(cellids_all_.end(),
+                      cellids_ghost_.begin(), cellids_ghost_.end());
+
+  auto split_owned =
+      [&](std::function<void(Entity_ID, Entity_ID_List *)> const& cell_ents,
+          Entity_ID_List *owned, Entity_ID_List const& ghost,
+          Entity_ID_List *all, std::vector<Entity_ID_List> *subtile_ents) {
+    if (owned->empty()) return;
+
+    Entity_ID_List sorted(*owned);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<char> placed(sorted.size(), 0);
+
+    subtile_ents->resize(nsub);
+    Entity_ID_List cents;
+    for (int i = 0; i < nsub; i++) {
+      for (auto const& c : subtile_cells_[i]) {
+        cell_ents(c, &cents);
+        for (auto const& e : cents) {
+          auto it = std::lower_bound(sorted.begin(), sorted.end(), e);
+          if (it == sorted.end() || *it != e) continue;  // not owned
+          if (placed[it - sorted.begin()]) continue;
+          placed[it - sorted.begin()] = 1;
+          (*subtile_ents)[i].push_back(e);
+        }
+      }
+    }
 
-void MeshTile::get_set_entities(const Set_Name setname, const Entity_kind kind,
-                                const Entity_type type,
-                                Entity_ID_List *entids) const {
-  entids->clear();
-  switch (kind) {
-    case Entity_kind::NODE:
-      get_nodes_of_set(setname, type, entids);
-      break;
-    case Entity_kind::EDGE:
-      get_edges_of_set(setname, type, entids);
-      break;
-    case Entity_kind::FACE:
-      get_faces_of_set(setname, type, entids);
-      break;
-    case Entity_kind::SIDE:
-      get_sides_of_set(setname, type, entids);
-      break;
-    case Entity_kind::WEDGE:
-      get_wedges_of_set(setname, type, entids);
-      break;
-    case Entity_kind::CORNER:
-      get_corners_of_set(setname, type, entids);
-      break;
-    case Entity_kind::CELL:
-      get_cells_of_set(setname, type, entids);
-      break;
-    default:
-      return;
-  }
+    owned->clear();
+    for (auto const& ents : *subtile_ents)
+      owned->insert(owned->end(), ents.begin(), ents.end());
+    *all = *owned;
+    all->insert(all->end(), ghost.begin(), ghost.end());
+  };
+
+  split_owned([&](Entity_ID c, Entity_ID_List *ents) {
+      mesh_.cell_get_nodes(c, ents);
+    }, &nodeids_owned_, nodeids_ghost_, &nodeids_all_, &subtile_nodes_);
+  split_owned([&](Entity_ID c, Entity_ID_List *ents) {
+      mesh_.cell_get_edges(c, ents);
+    }, &edgeids_owned_, edgeids_ghost_, &edgeids_all_, &subtile_edges_);
+  split_owned([&](Entity_ID c, Entity_ID_List *ents) {
+      mesh_.cell_get_faces(c, ents);
+    }, &faceids_owned_, faceids_ghost_, &faceids_all_, &subtile_faces_);
 }
 
-void MeshTile::get_nodes_of_set(const Set_Name setname, const Entity_type type,
-                                Entity_ID_List *entids) const {
-  Entity_ID_List setents_mesh;
-  mesh_.get_set_entities(setname, Entity_kind::NODE, type, &setents_mesh);
-
-  Entity_ID_List const *entlist_tile;
-  switch (type) {
-    case Entity_type::PARALLEL_OWNED: entlist_tile = &nodeids_owned_; break;
-    case Entity_type::PARALLEL_GHOST: entlist_tile = &nodeids_ghost_; break;
-    case Entity_type::ALL: entlist_tile = &nodeids_all_; break;
-    default: {
-      std::cerr << "Meaningless to ask for nodes of type " << type <<
-          " in a set\n";
-      return;
-    }
-  }
 
-  for (auto const& ent : setents_mesh) {
-    if (std::find(entlist_tile->begin(), entlist_tile->end(), ent) !=
-        entlist_tile->end())
-      entids->push_back(ent);
-  }
-}
+// Reallocate a vector (and any vectors in it) from the calling thread
 
-void MeshTile::get_edges_of_set(const Set_Name setname, const Entity_type type,
-                                Entity_ID_List *entids) const {
-  Entity_ID_List setents_mesh;
-  mesh_.get_set_entities(setname, Entity_kind::EDGE, type, &setents_mesh);
-
-  Entity_ID_List const *entlist_tile;
-  switch (type) {
-    case Entity_type::PARALLEL_OWNED: entlist_tile = &edgeids_owned_; break;
-    case Entity_type::PARALLEL_GHOST: entlist_tile = &edgeids_ghost_; break;
-    case Entity_type::ALL: entlist_tile = &edgeids_all_; break;
-    default: {
-      std::cerr << "Meaningless to ask for edges of type " << type <<
-          " in a set\n";
-      return;
-    }
-  }
+template<class V>
+static void reallocate_here(V *v) {
+  V(v->begin(), v->end()).swap(*v);
+}
 
-  for (auto const& ent : setents_mesh) {
-    if (std::find(entlist_tile->begin(), entlist_tile->end(), ent) !=
-        entlist_tile->end())
-      entids->push_back(ent);
-  }
+void MeshTile::first_touch() {
+  reallocate_here(&nodeids_owned_);
+  reallocate_here(&nodeids_ghost_);
+  reallocate_here(&nodeids_all_);
+  reallocate_here(&edgeids_owned_);
+  reallocate_here(&edgeids_ghost_);
+  reallocate_here(&edgeids_all_);
+  reallocate_here(&faceids_owned_);
+  reallocate_here(&faceids_ghost_);
+  reallocate_here(&faceids_all_);
+  reallocate_here(&sideids_owned_);
+  reallocate_here(&sideids_ghost_);
+  reallocate_here(&sideids_all_);
+  reallocate_here(&wedgeids_owned_);
+  reallocate_here(&wedgeids_ghost_);
+  reallocate_here(&wedgeids_all_);
+  reallocate_here(&cornerids_owned_);
+  reallocate_here(&cornerids_ghost_);
+  reallocate_here(&cornerids_all_);
+  reallocate_here(&cellids_owned_);
+  reallocate_here(&cellids_ghost_);
+  reallocate_here(&cellids_all_);
+
+  reallocate_here(&subtile_cells_);
+  reallocate_here(&subtile_nodes_);
+  reallocate_here(&subtile_edges_);
+  reallocate_here(&subtile_faces_);
+
+  for (int k = 0; k < 4; k++)
+    reallocate_here(&(mesh_to_local_[k]));
+  reallocate_here(&local_cell_node_offsets_);
+  reallocate_here(&local_cell_face_offsets_);
+  reallocate_here(&local_face_cell_offsets_);
+  reallocate_here(&local_cell_nodes_);
+  reallocate_here(&local_cell_faces_);
+  reallocate_here(&local_face_cells_);
+  reallocate_here(&local_cell_face_dirs_);
+  reallocate_here(&local_node_coords_);
 }
 
-void MeshTile::get_faces_of_set(const Set_Name setname, const Entity_type type,
-                                Entity_ID_List *entids) const {
-  Entity_ID_List setents_mesh;
-  mesh_.get_set_entities(setname, Entity_kind::FACE, type, &setents_mesh);
-
-  Entity_ID_List const *entlist_tile;
-  switch (type) {
-    case Entity_type::PARALLEL_OWNED: entlist_tile = &faceids_owned_; break;
-    case Entity_type::PARALLEL_GHOST: entlist_tile = &faceids_ghost_; break;
-    case Entity_type::ALL: entlist_tile = &faceids_all_; break;
-    default: {
-      std::cerr << "Meaningless to ask for faces of type " << type <<
-          " in a set\n";
-      return;
-    }
-  }
 
-  for (auto const& ent : setents_mesh) {
-    if (std::find(entlist_tile->begin(), entlist_tile->end(), ent) !=
-        entlist_tile->end())
-      entids->push_back(ent);
-  }
-}
+// Tile-local numbering - a sorted list of (mesh ID, local ID) pairs
+// for each of NODE, EDGE, FACE and CELL maps mesh IDs to local IDs and
+// the connectivity of the parent mesh is translated with it
 
-void MeshTile::get_sides_of_set(const Set_Name setname, const Entity_type type,
-                                Entity_ID_List *entids) const {
-  Entity_ID_List setents_mesh;
-  mesh_.get_set_entities(setname, Entity_kind::SIDE, type, &setents_mesh);
-
-  Entity_ID_List const *entlist_tile;
-  switch (type) {
-    case Entity_type::PARALLEL_OWNED: entlist_tile = &sideids_owned_; break;
-    case Entity_type::PARALLEL_GHOST: entlist_tile = &sideids_ghost_; break;
-    case Entity_type::ALL: entlist_tile = &sideids_all_; break;
-    default: {
-      std::cerr << "Meaningless to ask for sides of type " << type <<
-          " in a set\n";
-      return;
-    }
+void MeshTile::build_local_numbering() {
+  clear_local_numbering();
+  local_numbering_ = true;
+
+  Entity_kind const kinds[4] = {Entity_kind::NODE, Entity_kind::EDGE,
+                                Entity_kind::FACE, Entity_kind::CELL};
+  for (int k = 0; k < 4; k++) {
+    Entity_ID_List const& ents = entities(kinds[k], Entity_type::ALL);
+    int nents = ents.size();
+    mesh_to_local_[k].resize(nents);
+    for (int i = 0; i < nents; i++)
+      mesh_to_local_[k][i] = std::make_pair(ents[i], i);
+    std::sort(mesh_to_local_[k].begin(), mesh_to_local_[k].end());
   }
 
-  for (auto const& ent : setents_mesh) {
-    if (std::find(entlist_tile->begin(), entlist_tile->end(), ent) !=
-        entlist_tile->end())
-      entids->push_back(ent);
+  Entity_ID_List const& cells = cellids_all_;
+  int ncells = cells.size();
+
+  Entity_ID_List ents;
+  local_cell_node_offsets_.assign(1, 0);
+  for (auto const& c : cells) {
+    mesh_.cell_get_nodes(c, &ents);
+    for (auto const& n : ents)
+      local_cell_nodes_.push_back(local_id(Entity_kind::NODE, n));
+    local_cell_node_offsets_.push_back(local_cell_nodes_.size());
   }
-}
 
-void MeshTile::get_wedges_of_set(const Set_Name setname, const Entity_type type,
-                                Entity_ID_List *entids) const {
-  Entity_ID_List setents_mesh;
-  mesh_.get_set_entities(setname, Entity_kind::WEDGE, type, &setents_mesh);
-
-  Entity_ID_List const *entlist_tile;
-  switch (type) {
-    case Entity_type::PARALLEL_OWNED: entlist_tile = &wedgeids_owned_; break;
-    case Entity_type::PARALLEL_GHOST: entlist_tile = &wedgeids_ghost_; break;
-    case Entity_type::ALL: entlist_tile = &wedgeids_all_; break;
-    default: {
-      std::cerr << "Meaningless to ask for wedges of type " << type <<
-          " in a set\n";
-      return;
+  local_node_coords_.resize(nodeids_all_.size());
+  for (int i = 0; i < nodeids_all_.size(); i++)
+    mesh_.node_get_coordinates(nodeids_all_[i], &(local_node_coords_[i]));
+
+  if (!faceids_all_.empty()) {
+    std::vector<dir_t> dirs;
+    local_cell_face_offsets_.assign(1, 0);
+    for (auto const& c : cells) {
+      mesh_.cell_get_faces_and_dirs(c, &ents, &dirs);
+      for (auto const& f : ents)
+        local_cell_faces_.push_back(local_id(Entity_kind::FACE, f));
+      local_cell_face_dirs_.insert(local_cell_face_dirs_.end(),
+                                   dirs.begin(), dirs.end());
+      local_cell_face_offsets_.push_back(local_cell_faces_.size());
     }
-  }
 
-  for (auto const& ent : setents_mesh) {
-    if (std::find(entlist_tile->begin(), entlist_tile->end(), ent) !=
-        entlist_tile->end())
-      entids->push_back(ent);
+    local_face_cell_offsets_.assign(1, 0);
+    for (auto const& f : faceids_all_) {
+      mesh_.face_get_cells(f, Entity_type::ALL, &ents);
+      for (auto const& c : ents) {
+        Entity_ID lc = local_id(Entity_kind::CELL, c);
+        if (lc != -1) local_face_cells_.push_back(lc);
+      }
+      local_face_cell_offsets_.push_back(local_face_cells_.size());
+    }
   }
 }
 
-void MeshTile::get_corners_of_set(const Set_Name setname,
-                                  const Entity_type type,
-                                  Entity_ID_List *entids) const {
-  Entity_ID_List setents_mesh;
-  mesh_.get_set_entities(setname, Entity_kind::CORNER, type, &setents_mesh);
-
-  Entity_ID_List const *entlist_tile;
-  switch (type) {
-    case Entity_type::PARALLEL_OWNED: entlist_tile = &cornerids_owned_; break;
-    case Entity_type::PARALLEL_GHOST: entlist_tile = &cornerids_ghost_; break;
-    case Entity_type::ALL: entlist_tile = &cornerids_all_; break;
-    default: {
-      std::cerr << "Meaningless to ask for corners of type " << type <<
-          " in a set\n";
-      return;
-    }
-  }
+void MeshTile::clear_local_numbering() {
+  local_numbering_ = false;
+  for (int k = 0; k < 4; k++)
+    std::vector<std::pair<Entity_ID, Entity_ID>>().swap(mesh_to_local_[k]);
+  std::vector<int>().swap(local_cell_node_offsets_);
+  std::vector<int>().swap(local_cell_face_offsets_);
+  std::vector<int>().swap(local_face_cell_offsets_);
+  Entity_ID_List().swap(local_cell_nodes_);
+  Entity_ID_List().swap(local_cell_faces_);
+  Entity_ID_List().swap(local_face_cells_);
+  std::vector<dir_t>().swap(local_cell_face_dirs_);
+  std::vector<JaliGeometry::Point>().swap(local_node_coords_);
+}
 
-  for (auto const& ent : setents_mesh) {
-    if (std::find(entlist_tile->begin(), entlist_tile->end(), ent) !=
-        entlist_tile->end())
-      entids->push_back(ent);
-  }
+Entity_ID MeshTile::local_id(Entity_kind const kind,
+                             Entity_ID const meshid) const {
+  int ikind = static_cast<int>(kind);
+  if (ikind < 0 || ikind > 3) return -1;
+
+  auto const& ids = mesh_to_local_[ikind];
+  auto it = std::lower_bound(ids.begin(), ids.end(), meshid,
+                             [](std::pair<Entity_ID, Entity_ID> const& p,
+                                Entity_ID const id) {
+                               return p.first < id;
+                             });
+  return (it != ids.end() && it->first == meshid) ? it->second : -1;
 }
 
-void MeshTile::get_cells_of_set(const Set_Name setname, const Entity_type type,
+
+//! Get list of tile entities of type 'kind' and 'type' in set ('setname')
+//
+// The set keeps a per-tile partition of its entities (built the first
+// time any tile asks for it) so this is just a copy of a precomputed
+// list
+
+void MeshTile::get_set_entities(const Set_Name setname, const Entity_kind kind,
+                                const Entity_type type,
                                 Entity_ID_List *entids) const {
-  Entity_ID_List setents_mesh;
-  mesh_.get_set_entities(setname, Entity_kind::CELL, type, &setents_mesh);
-
-  Entity_ID_List const *entlist_tile;
-  switch (type) {
-    case Entity_type::PARALLEL_OWNED: entlist_tile = &cellids_owned_; break;
-    case Entity_type::PARALLEL_GHOST: entlist_tile = &cellids_ghost_; break;
-    case Entity_type::ALL: entlist_tile = &cellids_all_; break;
-    default: {
-      std::cerr << "Meaningless to ask for cells of type " << type <<
-          " in a set\n";
-      return;
-    }
+  entids->clear();
+  if (type != Entity_type::PARALLEL_OWNED &&
+      type != Entity_type::PARALLEL_GHOST &&
+      type != Entity_type::ALL) {
+    std::cerr << "Meaningless to ask for entities of type " << type <<
+        " in a set\n";
+    return;
   }
 
-  for (auto const& ent : setents_mesh) {
-    if (std::find(entlist_tile->begin(), entlist_tile->end(), ent) !=
-        entlist_tile->end())
-      entids->push_back(ent);
-  }
+  std::shared_ptr<MeshSet> set = mesh_.find_meshset(setname, kind);
+  if (set)
+    *entids = set->entities_in_tile(mytileid_, type);
 }
- 
 
 }  // end namespace Jali
 
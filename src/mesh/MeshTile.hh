@@ -50,10 +50,12 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <utility>
 
 #include "mpi.h"
 
 #include "MeshDefs.hh"
+#include "Point.hh"
 
 namespace Jali {
 
@@ -156,6 +158,16 @@ class MeshTile {
 
   unsigned int num_entities(Entity_kind kind, Entity_type parallel_type) const;
 
+  /*! 
+    @brief List of entities of a particular kind and parallel type
+    @param kind Entity_kind of the entities (CELL, NODE, WEDGE etc)
+    @param parallel_type Entity_type of entities (PARALLEL_OWNED,
+    PARALLEL_GHOST, ALL)
+  */
+
+  std::vector<Entity_ID> const & entities(Entity_kind kind,
+                                          Entity_type parallel_type) const;
+
   /*! 
     @brief Number of nodes of parallel type
     @tparam ptype Parallel type (Entity_type::PARALLEL_OWNED,
@@ -283,6 +295,140 @@ class MeshTile {
   const & cells() const;
 
 
+  /// @brief Number of subtiles (1 if the tile is not subdivided)
+
+  int num_subtiles() const {
+    return subtile_cells_.empty() ? 1 : subtile_cells_.size();
+  }
+
+  /*!
+    @brief Owned cells of a subtile (see Mesh::subdivide_tiles)
+
+    The owned cells of the tile are the cells of subtile 0, followed
+    by those of subtile 1 and so on. If the tile is not subdivided,
+    subtile 0 is the whole tile
+  */
+
+  std::vector<Entity_ID> const & subtile_cells(int const i) const {
+    return subtile_cells_.empty() ? cellids_owned_ : subtile_cells_[i];
+  }
+
+  /*!
+    @brief Owned nodes of the tile first reached from the cells of a
+    subtile
+
+    Like the cells, the owned nodes of the tile are the nodes of
+    subtile 0, followed by those of subtile 1 and so on
+  */
+
+  std::vector<Entity_ID> const & subtile_nodes(int const i) const {
+    return subtile_nodes_.empty() ? nodeids_owned_ : subtile_nodes_[i];
+  }
+
+  /// @brief Owned edges of the tile first reached from a subtile
+
+  std::vector<Entity_ID> const & subtile_edges(int const i) const {
+    return subtile_edges_.empty() ? edgeids_owned_ : subtile_edges_[i];
+  }
+
+  /// @brief Owned faces of the tile first reached from a subtile
+
+  std::vector<Entity_ID> const & subtile_faces(int const i) const {
+    return subtile_faces_.empty() ? faceids_owned_ : subtile_faces_[i];
+  }
+
+  /*!
+    @brief Reallocate the data of the tile from the calling thread
+
+    On NUMA machines, memory pages are placed near the thread that
+    first writes them. Tiles are built by the thread that builds the
+    mesh, so calling this from the thread that will work on the tile
+    (see TileScheduler::first_touch_tiles) moves its entity lists,
+    subtiles and local connectivity to memory local to that thread
+  */
+
+  void first_touch();
+
+  //
+  // Tile-local numbering (see Mesh::tile_local_numbering)
+  // -------------------------
+  //
+  // The tile-local ID of an entity is its position in the list of
+  // entities of the tile of parallel type ALL, i.e. owned entities
+  // come first and are followed by the halo entities. Connectivity is
+  // stored flattened - e.g. the nodes of local cell c are
+  // local_cell_nodes()[local_cell_node_offsets()[c]] through
+  // local_cell_nodes()[local_cell_node_offsets()[c+1]-1] - so tile
+  // kernels can run on contiguous tile data without touching the
+  // parent mesh
+
+  /// @brief Whether the tile has a local numbering and connectivity
+
+  bool has_local_numbering() const {return local_numbering_;}
+
+  /// @brief Tile-local ID of a mesh entity (-1 if the entity is not
+  /// in the tile or the tile has no local numbering)
+
+  Entity_ID local_id(Entity_kind const kind, Entity_ID const meshid) const;
+
+  /// @brief Mesh ID of a tile-local entity
+
+  Entity_ID mesh_id(Entity_kind const kind, Entity_ID const localid) const {
+    return entities(kind, Entity_type::ALL)[localid];
+  }
+
+  /// @brief Offsets of the nodes of each local cell in local_cell_nodes
+
+  std::vector<int> const & local_cell_node_offsets() const {
+    return local_cell_node_offsets_;
+  }
+
+  /// @brief Local nodes of local cells (in the order of
+  /// Mesh::cell_get_nodes)
+
+  std::vector<Entity_ID> const & local_cell_nodes() const {
+    return local_cell_nodes_;
+  }
+
+  /// @brief Offsets of the faces of each local cell in local_cell_faces
+  /// (empty if faces were not requested)
+
+  std::vector<int> const & local_cell_face_offsets() const {
+    return local_cell_face_offsets_;
+  }
+
+  /// @brief Local faces of local cells
+
+  std::vector<Entity_ID> const & local_cell_faces() const {
+    return local_cell_faces_;
+  }
+
+  /// @brief Directions in which local cells use their faces (same
+  /// layout as local_cell_faces)
+
+  std::vector<dir_t> const & local_cell_face_dirs() const {
+    return local_cell_face_dirs_;
+  }
+
+  /// @brief Offsets of the cells of each local face in local_face_cells
+
+  std::vector<int> const & local_face_cell_offsets() const {
+    return local_face_cell_offsets_;
+  }
+
+  /// @brief Local cells of local faces (cells of a face that are not
+  /// in the tile are left out)
+
+  std::vector<Entity_ID> const & local_face_cells() const {
+    return local_face_cells_;
+  }
+
+  /// @brief Coordinates of local nodes
+
+  std::vector<JaliGeometry::Point> const & local_node_coordinates() const {
+    return local_node_coords_;
+  }
+
   //! Get list of tile entities of type 'kind' and 'ptype' in set ('setname')
 
   void get_set_entities(const Set_Name setname,
@@ -292,21 +438,6 @@ class MeshTile {
 
  private:
 
-  void get_nodes_of_set(const Set_Name setname, const Entity_type ptype,
-                        Entity_ID_List *entids) const;
-  void get_edges_of_set(const Set_Name setname, const Entity_type ptype,
-                        Entity_ID_List *entids) const;
-  void get_faces_of_set(const Set_Name setname, const Entity_type ptype,
-                        Entity_ID_List *entids) const;
-  void get_sides_of_set(const Set_Name setname, const Entity_type ptype,
-                        Entity_ID_List *entids) const;
-  void get_wedges_of_set(const Set_Name setname, const Entity_type ptype,
-                        Entity_ID_List *entids) const;
-  void get_corners_of_set(const Set_Name setname, const Entity_type ptype,
-                        Entity_ID_List *entids) const;
-  void get_cells_of_set(const Set_Name setname, const Entity_type ptype,
-                        Entity_ID_List *entids) const;
-
   // Data
 
   Mesh& mesh_;
@@ -322,6 +453,34 @@ class MeshTile {
   Entity_ID_List cellids_owned_, cellids_ghost_, cellids_all_;
   Entity_ID_List dummy_list_;
 
+  // Owned entities of each subtile (empty if the tile is not
+  // subdivided)
+
+  std::vector<Entity_ID_List> subtile_cells_, subtile_nodes_;
+  std::vector<Entity_ID_List> subtile_edges_, subtile_faces_;
+
+  /// @brief Split the tile into subtiles with the given owned cells
+  /// and reorder the owned entity lists to match (called by Mesh)
+
+  void set_subtiles(std::vector<Entity_ID_List> const& subtile_cells);
+
+  // Tile-local numbering and connectivity
+
+  bool local_numbering_ = false;
+  std::vector<std::pair<Entity_ID, Entity_ID>> mesh_to_local_[4];
+  std::vector<int> local_cell_node_offsets_, local_cell_face_offsets_;
+  std::vector<int> local_face_cell_offsets_;
+  Entity_ID_List local_cell_nodes_, local_cell_faces_, local_face_cells_;
+  std::vector<dir_t> local_cell_face_dirs_;
+  std::vector<JaliGeometry::Point> local_node_coords_;
+
+  /// @brief Build (or discard) the tile-local numbering (called by Mesh)
+
+  void build_local_numbering();
+  void clear_local_numbering();
+
+  friend class Mesh;
+
   
 
   // Make the State class a friend so that it can access protected
@@ -565,6 +724,49 @@ unsigned int MeshTile::num_entities(const Entity_kind kind,
 }
 
 
+// entity list of any kind and parallel type
+
+inline
+std::vector<Entity_ID> const &
+MeshTile::entities(const Entity_kind kind, const Entity_type ptype) const {
+  Entity_ID_List const *owned, *ghost, *all;
+  switch (kind) {
+    case Entity_kind::NODE:
+      owned = &nodeids_owned_; ghost = &nodeids_ghost_; all = &nodeids_all_;
+      break;
+    case Entity_kind::EDGE:
+      owned = &edgeids_owned_; ghost = &edgeids_ghost_; all = &edgeids_all_;
+      break;
+    case Entity_kind::FACE:
+      owned = &faceids_owned_; ghost = &faceids_ghost_; all = &faceids_all_;
+      break;
+    case Entity_kind::SIDE:
+      owned = &sideids_owned_; ghost = &sideids_ghost_; all = &sideids_all_;
+      break;
+    case Entity_kind::WEDGE:
+      owned = &wedgeids_owned_; ghost = &wedgeids_ghost_;
+      all = &wedgeids_all_;
+      break;
+    case Entity_kind::CORNER:
+      owned = &cornerids_owned_; ghost = &cornerids_ghost_;
+      all = &cornerids_all_;
+      break;
+    case Entity_kind::CELL:
+      owned = &cellids_owned_; ghost = &cellids_ghost_; all = &cellids_all_;
+      break;
+    default:
+      return dummy_list_;
+  }
+
+  switch (ptype) {
+    case Entity_type::PARALLEL_OWNED: return *owned;
+    case Entity_type::PARALLEL_GHOST: return *ghost;
+    case Entity_type::ALL: return *all;
+    default: return dummy_list_;
+  }
+}
+
+
 
 
 // entity lists (default implementation prints error message -
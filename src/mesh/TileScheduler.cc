@@ -0,0 +1,358 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "TileScheduler.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshSet.hh"
+
+namespace Jali {
+
+TileScheduler::TileScheduler(Mesh& mesh, int const num_threads,
+                             bool const pin_threads) :
+    mesh_(mesh), num_threads_(num_threads), pin_threads_(pin_threads) {
+  if (num_threads_ <= 0)
+    num_threads_ = std::max(1U, std::thread::hardware_concurrency());
+
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+      if (CPU_ISSET(cpu, &allowed)) cpus_.push_back(cpu);
+#endif
+  if (cpus_.empty()) pin_threads_ = false;
+}
+
+
+// Bind the calling thread to a core (threads beyond the number of
+// cores wrap around)
+
+void TileScheduler::pin_thread(int const i) const {
+#if defined(__linux__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpus_[i % cpus_.size()], &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#endif
+}
+
+
+// Run a kernel on all tiles
+
+void TileScheduler::run(std::function<void(MeshTile&)> const& kernel,
+                        bool const exclusive_halos) {
+  int ntiles = mesh_.num_tiles();
+  std::vector<int> tileids(ntiles);
+  for (int i = 0; i < ntiles; i++) tileids[i] = i;
+  run_tiles(tileids, kernel, exclusive_halos);
+}
+
+
+// Home thread of a tile - the same blocks of tiles that run_tiles
+// gives to each thread when running on all tiles
+
+int TileScheduler::home_thread(int const tileid) const {
+  int ntiles = mesh_.num_tiles();
+  int nthreads = std::min(num_threads_, ntiles);
+  return static_cast<int>((static_cast<long>(tileid + 1)*nthreads - 1) /
+                          ntiles);
+}
+
+
+// Run a kernel on all tiles, each on its home thread
+
+void TileScheduler::run_pinned(std::function<void(MeshTile&)> const& kernel) {
+  int ntiles = mesh_.num_tiles();
+  std::vector<int> tileids(ntiles);
+  for (int i = 0; i < ntiles; i++) tileids[i] = i;
+  run_tiles(tileids, kernel, false, false);
+}
+
+
+void TileScheduler::first_touch_tiles() {
+  run_pinned([](MeshTile& tile) {tile.first_touch();});
+}
+
+
+// Run a kernel on all tiles, color by color
+
+void TileScheduler::run_by_color(std::function<void(MeshTile&)> const& kernel) {
+  for (auto const& tileids : mesh_.tile_colors())
+    run_tiles(tileids, kernel, false);
+}
+
+
+// Run a kernel on the tiles that have entities of a set
+
+void TileScheduler::run_on_set(std::string const& setname,
+                               Entity_kind const kind,
+                               Entity_type const ptype,
+                               std::function<void(MeshTile&,
+                                                  Entity_ID_List const&)> const&
+                               kernel,
+                               bool const exclusive_halos) {
+  std::shared_ptr<MeshSet> set = mesh_.find_meshset(setname, kind);
+  if (!set) {
+    std::cerr << "TileScheduler::run_on_set - No set " << setname <<
+        " of kind " << kind << "\n";
+    return;
+  }
+
+  // Build the per-tile lists now so that threads only read them
+
+  set->build_tile_partition();
+
+  std::vector<int> tileids;
+  for (int i = 0; i < mesh_.num_tiles(); i++)
+    if (!set->entities_in_tile(i, ptype).empty())
+      tileids.push_back(i);
+
+  run_tiles(tileids,
+            [&](MeshTile& tile) {
+              kernel(tile, set->entities_in_tile(tile.ID(), ptype));
+            },
+            exclusive_halos);
+}
+
+
+void TileScheduler::reset_tile_times() {
+  tile_times_.assign(mesh_.num_tiles(), 0.0);
+}
+
+
+bool TileScheduler::rebalance_tiles(double const tolerance) {
+  if (static_cast<int>(tile_times_.size()) != mesh_.num_tiles())
+    return false;
+  if (!mesh_.rebalance_tiles(tile_times_, tolerance)) return false;
+  reset_tile_times();
+  return true;
+}
+
+
+// Tiles that share a node (owned or halo) with each tile
+
+void TileScheduler::get_tile_neighbors(std::vector<std::vector<int>>
+                                       *neighbors) const {
+  int ntiles = mesh_.num_tiles();
+  std::vector<std::vector<int>> node_tiles(mesh_.num_nodes());
+  for (auto const& t : mesh_.tiles())
+    for (auto const& n : t->nodes<Entity_type::ALL>())
+      node_tiles[n].push_back(t->ID());
+
+  neighbors->assign(ntiles, std::vector<int>());
+  for (auto const& ntiles_of_node : node_tiles)
+    for (auto const& t0 : ntiles_of_node)
+      for (auto const& t1 : ntiles_of_node)
+        if (t0 != t1) (*neighbors)[t0].push_back(t1);
+
+  for (auto& nbrs : *neighbors) {
+    std::sort(nbrs.begin(), nbrs.end());
+    nbrs.erase(std::unique(nbrs.begin(), nbrs.end()), nbrs.end());
+  }
+}
+
+
+// Run a kernel on a subset of the tiles. Each thread gets a contiguous
+// block of the tiles in a queue of its own, takes tiles from the front
+// of its queue and (unless told not to) steals from the back of other
+// queues when its own queue is empty. With exclusive halos, a tile
+// whose neighbors are running is put back in the queue and the thread
+// waits till some tile finishes. Threads that find no tile to take
+// also wait for tiles to finish rather than spin
+
+void TileScheduler::run_tiles(std::vector<int> const& tileids,
+                              std::function<void(MeshTile&)> const& kernel,
+                              bool const exclusive_halos, bool const steal) {
+  int ntiles = mesh_.num_tiles();
+  if (static_cast<int>(tile_times_.size()) != ntiles)
+    tile_times_.assign(ntiles, 0.0);
+
+  int nwork = tileids.size();
+  if (nwork == 0) return;
+  int nthreads = std::min(num_threads_, nwork);
+
+  std::vector<std::vector<int>> neighbors;
+  if (exclusive_halos) get_tile_neighbors(&neighbors);
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<int> tiles;
+  };
+  std::vector<WorkQueue> queues(nthreads);
+  for (int i = 0; i < nthreads; i++) {
+    int begin = static_cast<int>(static_cast<long>(nwork)*i/nthreads);
+    int end = static_cast<int>(static_cast<long>(nwork)*(i+1)/nthreads);
+    queues[i].tiles.assign(tileids.begin() + begin, tileids.begin() + end);
+  }
+
+  std::atomic<int> nremaining(nwork);
+  std::atomic<bool> failed(false);
+  std::exception_ptr first_error;
+
+  std::mutex busy_mutex;  // guards running, nfinished, nremaining and
+                          // first_error
+  std::condition_variable busy_cv;
+  std::vector<char> running(ntiles, 0);
+  long nfinished = 0;
+
+  std::vector<std::shared_ptr<MeshTile>> const& tiles = mesh_.tiles();
+
+  auto take_tile = [&](int const me) {
+    {
+      std::lock_guard<std::mutex> lock(queues[me].mutex);
+      if (!queues[me].tiles.empty()) {
+        int t = queues[me].tiles.front();
+        queues[me].tiles.pop_front();
+        return t;
+      }
+    }
+    for (int k = 1; steal && k < nthreads; k++) {
+      WorkQueue& victim = queues[(me + k) % nthreads];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tiles.empty()) {
+        int t = victim.tiles.back();
+        victim.tiles.pop_back();
+        return t;
+      }
+    }
+    return -1;
+  };
+
+  auto worker = [&](int const me) {
+    if (pin_threads_) pin_thread(me);
+
+    while (nremaining > 0 && !failed) {
+      int t = take_tile(me);
+      if (t == -1) {  // others are finishing the last tiles
+        if (!steal) break;
+        std::unique_lock<std::mutex> lock(busy_mutex);
+        long seen = nfinished;
+        busy_cv.wait(lock, [&]() {
+            return nremaining == 0 || nfinished != seen || failed;});
+        continue;
+      }
+
+      if (exclusive_halos) {
+        std::unique_lock<std::mutex> lock(busy_mutex);
+        bool blocked = running[t];
+        for (auto const& nbr : neighbors[t])
+          blocked = blocked || running[nbr];
+        if (blocked) {
+          {
+            std::lock_guard<std::mutex> qlock(queues[me].mutex);
+            queues[me].tiles.push_back(t);
+          }
+          long seen = nfinished;
+          busy_cv.wait(lock, [&]() {return nfinished != seen || failed;});
+          continue;
+        }
+        running[t] = 1;
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      try {
+        kernel(*tiles[t]);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(busy_mutex);
+        if (!failed) first_error = std::current_exception();
+        failed = true;
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      tile_times_[t] += elapsed.count();
+
+      // The count of remaining tiles changes under the lock so that
+      // no waiting thread misses the last tile finishing
+
+      {
+        std::lock_guard<std::mutex> lock(busy_mutex);
+        running[t] = 0;
+        nfinished++;
+        nremaining--;
+      }
+      busy_cv.notify_all();
+    }
+  };
+
+  // The calling thread is worker 0 and gets its binding back at the end
+
+#if defined(__linux__)
+  cpu_set_t caller_cpus;
+  if (pin_threads_)
+    pthread_getaffinity_np(pthread_self(), sizeof(caller_cpus), &caller_cpus);
+#endif
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < nthreads; i++)
+    threads.emplace_back(worker, i);
+  worker(0);
+  for (auto& thr : threads)
+    thr.join();
+
+#if defined(__linux__)
+  if (pin_threads_)
+    pthread_setaffinity_np(pthread_self(), sizeof(caller_cpus), &caller_cpus);
+#endif
+
+  if (first_error)
+    std::rethrow_exception(first_error);
+}
+
+}  // namespace Jali
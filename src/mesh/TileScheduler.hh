@@ -0,0 +1,203 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef _JALI_TILESCHEDULER_H_
+#define _JALI_TILESCHEDULER_H_
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "MeshDefs.hh"
+
+namespace Jali {
+
+class Mesh;
+class MeshTile;
+
+/*!
+  @class TileScheduler "TileScheduler.hh"
+  @brief Runs kernels over the tiles of a mesh on a team of threads
+
+  Each thread starts with a contiguous block of the tiles and, once it
+  runs out of work, steals tiles from the end of the blocks of other
+  threads. So tiles that take longer than others do not leave threads
+  idle as a static loop over the tiles would.
+
+  Kernels that write to the halo (ghost) entities of a tile can ask
+  for exclusive halos - then no two tiles that share a node (either as
+  owned or as halo entities) run at the same time.
+
+  The wall clock time spent in the kernel on each tile is accumulated
+  so that the tile partitioning can be rebalanced with it (see
+  Mesh::rebalance_tiles).
+
+  The scheduler queries the tiles of the mesh on every run, so it
+  stays valid if the tiles are rebuilt (the tile times are reset when
+  that happens).
+
+  On NUMA machines, memory pages are placed near the thread that first
+  writes them. Each tile has a home thread (thread i is home to the
+  i'th contiguous block of tiles) and run_pinned runs every tile on
+  its home thread. If the threads are also pinned to cores, data
+  allocated or first touched in run_pinned (see first_touch_tiles and
+  StateVector::first_touch) stays local to the thread working on it
+  in later runs.
+*/
+
+class TileScheduler {
+ public:
+
+  /// @brief Constructor
+  ///
+  /// @param mesh         mesh whose tiles are to be processed
+  /// @param num_threads  number of threads to use including the
+  ///                     calling thread (0 means as many as the
+  ///                     hardware supports)
+  /// @param pin_threads  whether thread i is bound to the i'th core the
+  ///                     process may run on during each run (only
+  ///                     supported on Linux, ignored elsewhere)
+
+  explicit TileScheduler(Mesh& mesh, int const num_threads = 0,
+                         bool const pin_threads = false);
+
+  /// @brief Number of threads used to run kernels
+
+  int num_threads() const {return num_threads_;}
+
+  /// @brief Run a kernel on every tile of the mesh
+  ///
+  /// @param kernel           function called once for each tile
+  /// @param exclusive_halos  whether tiles sharing nodes must not run
+  ///                         at the same time
+  ///
+  /// Returns once the kernel has run on all tiles. If the kernel
+  /// throws on some tile, the remaining tiles are skipped and the
+  /// first exception is rethrown to the caller
+
+  void run(std::function<void(MeshTile&)> const& kernel,
+           bool const exclusive_halos = false);
+
+  /// @brief Thread that is home to a tile (see run_pinned)
+
+  int home_thread(int const tileid) const;
+
+  /// @brief Run a kernel on every tile on its home thread
+  ///
+  /// Unlike run, tiles are not stolen by other threads, so each tile
+  /// is always processed by the same thread (and, with pinned
+  /// threads, the same core)
+
+  void run_pinned(std::function<void(MeshTile&)> const& kernel);
+
+  /// @brief Have the home thread of each tile first touch the data of
+  /// the tile (see MeshTile::first_touch). Must be called again if
+  /// the tiles are rebuilt
+
+  void first_touch_tiles();
+
+  /// @brief Run a kernel on every tile, one tile color at a time
+  ///
+  /// Tiles of one color (see Mesh::tile_colors) share no nodes and
+  /// run concurrently; the next color starts once all tiles of the
+  /// current color are done. Unlike exclusive halos, this needs no
+  /// locking while tiles are picked, at the cost of a barrier between
+  /// colors
+
+  void run_by_color(std::function<void(MeshTile&)> const& kernel);
+
+  /// @brief Run a kernel on the tiles containing entities of a set
+  ///
+  /// The kernel is called with each tile that has some entities of the
+  /// set (of the given parallel type) and the list of those entities
+  /// (see MeshSet::entities_in_tile)
+
+  void run_on_set(std::string const& setname, Entity_kind const kind,
+                  Entity_type const ptype,
+                  std::function<void(MeshTile&,
+                                     Entity_ID_List const&)> const& kernel,
+                  bool const exclusive_halos = false);
+
+  /// @brief Seconds spent in kernels on each tile since the last reset
+
+  std::vector<double> const& tile_times() const {return tile_times_;}
+
+  /// @brief Reset the accumulated tile times to zero
+
+  void reset_tile_times();
+
+  /// @brief Rebuild the tiles of the mesh if the accumulated tile
+  /// times are imbalanced by more than 'tolerance' (max/avg)
+  ///
+  /// Returns true if the tiles were rebuilt (the tile times are reset
+  /// in that case)
+
+  bool rebalance_tiles(double const tolerance = 1.1);
+
+ private:
+
+  /// @brief Run a kernel on a subset of the tiles (by tile ID)
+
+  void run_tiles(std::vector<int> const& tileids,
+                 std::function<void(MeshTile&)> const& kernel,
+                 bool const exclusive_halos, bool const steal = true);
+
+  /// @brief Bind the calling thread to the core for thread 'i'
+
+  void pin_thread(int const i) const;
+
+  /// @brief Tiles that share a node with each tile
+
+  void get_tile_neighbors(std::vector<std::vector<int>> *neighbors) const;
+
+  Mesh& mesh_;
+  int num_threads_;
+  bool pin_threads_;
+  std::vector<int> cpus_;  // cores the process may run on
+  std::vector<double> tile_times_;
+};  // class TileScheduler
+
+}  // namespace Jali
+
+#endif
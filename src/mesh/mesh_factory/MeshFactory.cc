@@ -44,8 +44,20 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "MeshFactory.hh"
 #include "Geometry.hh"
+#include "BoxRegion.hh"
+#include "LabeledSetRegion.hh"
+#include "LogicalRegion.hh"
+#include "PlaneRegion.hh"
+#include "PointRegion.hh"
+#include "PolygonRegion.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 
 #include "Mesh_simple.hh"
+#include "Mesh_flat.hh"
 
 #ifdef HAVE_MSTK_MESH
 #include "Mesh_MSTK.hh"
@@ -77,6 +89,9 @@ std::string framework_name(MeshFramework_t const& f) {
     case (MSTK):
       return "MSTK";
       break;
+    case (Flat):
+      return "Flat";
+      break;
     default:
       Errors::Message mesg("Unknown framework");
       Exceptions::Jali_throw(mesg);
@@ -85,7 +100,7 @@ std::string framework_name(MeshFramework_t const& f) {
 
 /// Check if a framework is available for use
 bool framework_available(MeshFramework_t const& f) {
-  if (f == Simple || f == MSTK)
+  if (f == Simple || f == MSTK || f == Flat)
     return true;
   else
     return false;
@@ -96,11 +111,14 @@ bool framework_generates(MeshFramework_t const& f, bool const parallel,
                          int const dim) {
   switch (f) {
     case Jali::Simple:
-      return (!parallel && (dim == 1 || dim == 3));
+      return ((!parallel && dim == 1) || dim == 3);
     case Jali::MSTK:
       return (dim == 2 || dim == 3);
     case Jali::STKMESH:
       return (dim == 3 && !parallel);
+    case Jali::Flat:
+      return (framework_generates(Jali::Simple, parallel, dim) ||
+              framework_generates(Jali::MSTK, parallel, dim));
     default:
       return false;
   }
@@ -110,6 +128,7 @@ bool framework_reads(MeshFramework_t const& f, bool const parallel,
                      MeshFormat_t const& format) {
   switch (f) {
     case Jali::MSTK:
+    case Jali::Flat:
       return (format == Jali::ExodusII);
     case Jali::STKMESH:
       return (format == Jali::ExodusII && !parallel);
@@ -124,6 +143,7 @@ bool framework_extracts(MeshFramework_t const& f, bool const parallel,
                         int const dim) {
   switch (f) {
     case Jali::MSTK:
+    case Jali::Flat:
       return (dim == 2 || dim == 3);
     default:
       return false;
@@ -155,6 +175,19 @@ void MeshFactory::reset_options(void) {
   /// Number of ghost/halo layers at the tile level on compute node
   num_ghost_layers_tile_ = num_ghost_layers_tile_default_;
 
+  /// Number of cells per subtile and tile-local numbering
+  num_cells_per_subtile_ = num_cells_per_subtile_default_;
+  tile_local_numbering_ = tile_local_numbering_default_;
+
+  /// Whether MSTK meshes are detached from MSTK
+  detach_framework_ = detach_framework_default_;
+
+  /// Whether ranks read their share of Exodus II files themselves
+  parallel_read_ = parallel_read_default_;
+
+  /// No caching of meshes read from files
+  cache_directory_.clear();
+
   /// Number of ghost/halo layers for mesh partitions across compute nodes
   num_ghost_layers_distmesh_ = num_ghost_layers_distmesh_default_;
 
@@ -164,9 +197,15 @@ void MeshFactory::reset_options(void) {
   /// Partitioner type
   partitioner_ = partitioner_default_;
 
+  /// Renumbering type
+  renumbering_ = renumbering_default_;
+
   /// Geometry type
   geom_type_ = geom_type_default_;
 
+  /// Whether generated Simple meshes compute their connectivity
+  implicit_connectivity_ = implicit_connectivity_default_;
+
   /// Geometric model
   geometric_model_ = nullptr;
 }
@@ -195,15 +234,23 @@ MeshFactory::create(std::string const& filename) {
                                         num_tiles_, num_ghost_layers_tile_,
                                         num_ghost_layers_distmesh_,
                                         request_boundary_ghosts_,
-                                        partitioner_, geom_type_);
+                                        partitioner_, geom_type_,
+                                        renumbering_, parallel_read_);
         if (geometric_model_ &&
             (geometric_model_->dimension() != result->space_dimension())) {
           errmsg.add_data("Geometric model and mesh dimension do not match");
           Exceptions::Jali_throw(errmsg);
         }
+        apply_tile_options(result);
+        if (detach_framework_)
+          std::static_pointer_cast<Mesh_MSTK>(result)->detach();
         return result;
         break;
       }
+      case Flat:
+        if (!cache_directory_.empty())
+          return create_flat_cached(filename);
+        return read_flat(filename);
       default:
         errmsg.add_data("Chosen framework cannot import meshes");
         ierr = 1;
@@ -270,33 +317,35 @@ MeshFactory::create(double const x0, double const y0, double const z0,
   MPI_Allreduce(&ierr, &aerr, 1, MPI_INT, MPI_SUM, comm_);
   if (aerr > 0) Exceptions::Jali_throw(errmsg);
 
-  int numprocs;
-  MPI_Comm_size(comm_, &numprocs);
-
   try {
     switch (framework_) {
       case Simple: {
-        if (numprocs == 1) {
-          result =
-              std::make_shared<Mesh_simple>(x0, y0, z0,
-                                            x1, y1, z1,
-                                            nx, ny, nz,
-                                            comm_, geometric_model_,
-                                            request_faces_, request_edges_,
-                                            request_sides_, request_wedges_,
-                                            request_corners_,
-                                            num_tiles_, num_ghost_layers_tile_,
-                                            num_ghost_layers_distmesh_,
-                                            request_boundary_ghosts_,
-                                            partitioner_);
-          return result;
-        }
-        else {
-          ierr = 1;
-          errmsg.add_data("Simple mesh cannot generate parallel meshes");
-        }
-        break;
+        result =
+            std::make_shared<Mesh_simple>(x0, y0, z0,
+                                          x1, y1, z1,
+                                          nx, ny, nz,
+                                          comm_, geometric_model_,
+                                          request_faces_, request_edges_,
+                                          request_sides_, request_wedges_,
+                                          request_corners_,
+                                          num_tiles_, num_ghost_layers_tile_,
+                                          num_ghost_layers_distmesh_,
+                                          request_boundary_ghosts_,
+                                          partitioner_,
+                                          implicit_connectivity_);
+        apply_tile_options(result);
+        return result;
       }
+      case Flat:
+#ifdef HAVE_MSTK_MESH
+        return create_flat([&]() {
+            return create(x0, y0, z0, x1, y1, z1, nx, ny, nz);
+          }, MSTK);
+#else
+        return create_flat([&]() {
+            return create(x0, y0, z0, x1, y1, z1, nx, ny, nz);
+          }, Simple);
+#endif
       case MSTK: {
         result =
             std::make_shared<Mesh_MSTK>(x0, y0, z0, x1, y1, z1, nx, ny, nz,
@@ -307,7 +356,10 @@ MeshFactory::create(double const x0, double const y0, double const z0,
                                         num_tiles_, num_ghost_layers_tile_,
                                         num_ghost_layers_distmesh_,
                                         request_boundary_ghosts_,
-                                        partitioner_);
+                                        partitioner_, renumbering_);
+        apply_tile_options(result);
+        if (detach_framework_)
+          std::static_pointer_cast<Mesh_MSTK>(result)->detach();
         return result;
       }
       default:
@@ -393,6 +445,7 @@ MeshFactory::create(double const x0, double const y0,
                                             num_ghost_layers_distmesh_,
                                             request_boundary_ghosts_,
                                             partitioner_, geom_type_);
+          apply_tile_options(result);
           return result;
         } else {
           ierr = 1;
@@ -400,6 +453,9 @@ MeshFactory::create(double const x0, double const y0,
         }
         break;
       }
+      case Flat:
+        return create_flat([&]() { return create(x0, y0, x1, y1, nx, ny); },
+                           MSTK);
       case MSTK: {
         result =
             std::make_shared<Mesh_MSTK>(x0, y0, x1, y1, nx, ny,
@@ -410,7 +466,11 @@ MeshFactory::create(double const x0, double const y0,
                                         num_tiles_, num_ghost_layers_tile_,
                                         num_ghost_layers_distmesh_,
                                         request_boundary_ghosts_,
-                                        partitioner_, geom_type_);
+                                        partitioner_, geom_type_,
+                                        renumbering_);
+        apply_tile_options(result);
+        if (detach_framework_)
+          std::static_pointer_cast<Mesh_MSTK>(result)->detach();
         return result;
       }
       default: {
@@ -487,12 +547,15 @@ MeshFactory::create(std::vector<double> const& x) {
                                             num_ghost_layers_distmesh_,
                                             request_boundary_ghosts_,
                                             partitioner_, geom_type_);
+          apply_tile_options(result);
           return result;
         } else {
           ierr = 1;
           errmsg.add_data("Simple framework cannot generate parallel 1D mesh");
         }
       }
+      case Flat:
+        return create_flat([&]() { return create(x); }, Simple);
       default: {
         ierr = 1;
         errmsg.add_data("Chosen framework cannot generate 1D mesh");
@@ -551,9 +614,17 @@ MeshFactory::create(std::shared_ptr<Mesh> const inmesh,
                                         num_tiles_, num_ghost_layers_tile_,
                                         num_ghost_layers_distmesh_,
                                         request_boundary_ghosts_,
-                                        partitioner_, geom_type_);
+                                        partitioner_, geom_type_,
+                                        renumbering_);
+        apply_tile_options(result);
+        if (detach_framework_)
+          std::static_pointer_cast<Mesh_MSTK>(result)->detach();
         return result;
       }
+      case Flat:
+        return create_flat([&]() {
+            return create(inmesh, setnames, setkind, flatten, extrude);
+          }, MSTK);
       default: {
         ierr = 1;
         errmsg.add_data("Chosen framework cannot extract meshes");
@@ -571,4 +642,385 @@ MeshFactory::create(std::shared_ptr<Mesh> const inmesh,
   if (aerr > 0) Exceptions::Jali_throw(errmsg);
 }
 
+
+/**
+ * This creates a mesh by migrating the owned cells of an existing
+ * mesh (along with their faces, nodes and labeled set membership) to
+ * other ranks and rebuilding the ghost layers on the new distribution
+ *
+ * @param inmesh      mesh to be redistributed
+ * @param cell_ranks  target rank of each owned cell of inmesh
+ *
+ * @return
+ */
+std::shared_ptr<Mesh>
+MeshFactory::redistribute(std::shared_ptr<Mesh> const inmesh,
+                          std::vector<int> const& cell_ranks) {
+  std::shared_ptr<Mesh> result;
+  Errors::Message errmsg("MeshFactory::redistribute: error: ");
+  int ierr = 0, aerr = 0;
+
+  try {
+    switch (framework_) {
+      case MSTK: {
+        if (!dynamic_cast<Mesh_MSTK *>(inmesh.get())) {
+          ierr = 1;
+          errmsg.add_data("Only MSTK meshes can be redistributed");
+          break;
+        }
+        result =
+            std::make_shared<Mesh_MSTK>(*inmesh, cell_ranks,
+                                        request_faces_, request_edges_,
+                                        request_sides_, request_wedges_,
+                                        request_corners_,
+                                        num_tiles_, num_ghost_layers_tile_,
+                                        num_ghost_layers_distmesh_,
+                                        request_boundary_ghosts_,
+                                        partitioner_, geom_type_,
+                                        renumbering_);
+        apply_tile_options(result);
+        if (detach_framework_)
+          std::static_pointer_cast<Mesh_MSTK>(result)->detach();
+        return result;
+      }
+      default: {
+        ierr = 1;
+        errmsg.add_data("Chosen framework cannot redistribute meshes");
+      }
+    }
+  } catch (const Errors::Message& msg) {
+    ierr = 1;
+    errmsg.add_data(msg.what());
+  } catch (const std::exception& stde) {
+    ierr = 1;
+    errmsg.add_data("internal error: ");
+    errmsg.add_data(stde.what());
+  }
+  MPI_Allreduce(&ierr, &aerr, 1, MPI_INT, MPI_SUM, comm_);
+  if (aerr > 0) Exceptions::Jali_throw(errmsg);
+  return result;
+}
+
+
+/**
+ * @brief Subdivide the tiles of a newly created mesh and switch on
+ * tile-local numbering if these options are set. Every creation path
+ * calls this on the mesh it returns
+ *
+ * @param mesh           mesh just created
+ */
+void MeshFactory::apply_tile_options(std::shared_ptr<Mesh> const& mesh) const {
+  if (num_cells_per_subtile_)
+    mesh->subdivide_tiles(num_cells_per_subtile_);
+  if (tile_local_numbering_)
+    mesh->tile_local_numbering(true);
+}
+
+
+/**
+ * This creates the source mesh with another framework and only the
+ * entities it has to provide (the flat mesh builds its own sides,
+ * wedges, corners and tiles), then copies it into flat arrays
+ *
+ * @param create_source  function creating the source mesh with the
+ *                       current options
+ * @param source         framework of the source mesh
+ *
+ * @return
+ */
+std::shared_ptr<Mesh>
+MeshFactory::create_flat(std::function<std::shared_ptr<Mesh>()> const&
+                         create_source, MeshFramework_t const source) {
+  bool const request_faces = request_faces_, request_edges = request_edges_;
+  bool const request_sides = request_sides_;
+  bool const request_wedges = request_wedges_;
+  bool const request_corners = request_corners_;
+  int const num_tiles = num_tiles_;
+  int const num_cells_per_subtile = num_cells_per_subtile_;
+  bool const tile_local_numbering = tile_local_numbering_;
+  bool const detach_framework = detach_framework_;
+
+  auto restore_options = [&]() {
+    framework_ = Flat;
+    request_faces_ = request_faces;
+    request_edges_ = request_edges;
+    request_sides_ = request_sides;
+    request_wedges_ = request_wedges;
+    request_corners_ = request_corners;
+    num_tiles_ = num_tiles;
+    num_cells_per_subtile_ = num_cells_per_subtile;
+    tile_local_numbering_ = tile_local_numbering;
+    detach_framework_ = detach_framework;
+  };
+
+  bool const with_sides = request_sides || request_wedges || request_corners;
+  framework_ = source;
+  request_faces_ = request_faces || with_sides;
+  request_edges_ = request_edges || with_sides;
+  request_sides_ = request_wedges_ = request_corners_ = false;
+  num_tiles_ = 0;
+  num_cells_per_subtile_ = 0;
+  tile_local_numbering_ = false;
+  detach_framework_ = false;
+
+  std::shared_ptr<Mesh> srcmesh;
+  try {
+    srcmesh = create_source();
+  } catch (...) {
+    restore_options();
+    throw;
+  }
+  restore_options();
+
+  std::shared_ptr<Mesh> result =
+      std::make_shared<Mesh_flat>(srcmesh,
+                                  request_faces_, request_edges_,
+                                  request_sides_, request_wedges_,
+                                  request_corners_,
+                                  num_tiles_, num_ghost_layers_tile_,
+                                  num_ghost_layers_distmesh_,
+                                  request_boundary_ghosts_,
+                                  partitioner_);
+  srcmesh.reset();
+
+  apply_tile_options(result);
+  return result;
+}
+
+/**
+ * @brief Read a Flat mesh from a file. On one rank an Exodus II file
+ * is streamed straight into the flat arrays. On more ranks it is read
+ * with MSTK, each rank reading only its share of the file (see
+ * parallel_read), and flattened. Files the distributed reader cannot
+ * handle (e.g. with polyhedra) and Nemesis files are imported by MSTK
+ * as usual
+ *
+ * @param filename       mesh file to read
+ *
+ * @return mesh instance
+ */
+std::shared_ptr<Mesh>
+MeshFactory::read_flat(std::string const& filename) {
+  int nprocs;
+  MPI_Comm_size(comm_, &nprocs);
+  int len = filename.length();
+  bool const exodus = (len > 4 && filename.substr(len-4, 4) == ".exo");
+  if (nprocs > 1 || (len > 4 && filename.substr(len-4, 4) == ".par")) {
+    auto create_source = [&]() {
+      if (!exodus || nprocs == 1) return create(filename);
+
+      // create throws on all ranks if any rank fails, so the ranks
+      // fall back together
+
+      bool const parallel_read = parallel_read_;
+      parallel_read_ = true;
+      std::shared_ptr<Mesh> srcmesh;
+      try {
+        srcmesh = create(filename);
+      } catch (Errors::Message const& msg) {
+        int rank;
+        MPI_Comm_rank(comm_, &rank);
+        if (rank == 0)
+          std::cerr << "MeshFactory::read_flat - Reading " << filename <<
+              " in full instead: " << msg.what() << "\n";
+      }
+      parallel_read_ = parallel_read;
+      return srcmesh ? srcmesh : create(filename);
+    };
+    return create_flat(create_source, MSTK);
+  }
+
+  std::shared_ptr<Mesh> result =
+      std::make_shared<Mesh_flat>(filename, comm_, geometric_model_,
+                                  request_faces_, request_edges_,
+                                  request_sides_, request_wedges_,
+                                  request_corners_,
+                                  num_tiles_, num_ghost_layers_tile_,
+                                  num_ghost_layers_distmesh_,
+                                  request_boundary_ghosts_,
+                                  partitioner_, geom_type_);
+  if (geometric_model_ &&
+      (geometric_model_->dimension() != result->space_dimension())) {
+    Errors::Message mesg("Geometric model and mesh dimension do not match");
+    Exceptions::Jali_throw(mesg);
+  }
+  apply_tile_options(result);
+  return result;
+}
+
+/**
+ * @brief Load a Flat mesh from the snapshots of a previous run with
+ * the same input file and options, or create it from the file and
+ * write its snapshots for later runs
+ *
+ * @param filename       mesh file to read
+ *
+ * @return mesh instance
+ */
+std::shared_ptr<Mesh>
+MeshFactory::create_flat_cached(std::string const& filename) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm_, &rank);
+  MPI_Comm_size(comm_, &nprocs);
+
+  std::uint64_t key = snapshot_key(filename);
+
+  std::string basename = filename.substr(filename.find_last_of('/') + 1);
+  std::stringstream snapstream;
+  snapstream << cache_directory_ << "/" << basename << "." << std::hex <<
+      key << std::dec << "." << nprocs << "." << rank << ".jflat";
+  std::string snapshot = snapstream.str();
+
+  // Use the snapshots only if every rank has a matching one. A
+  // snapshot with a matching header may still fail to load (e.g. if
+  // it was truncated) - the snapshot constructor then throws on all
+  // ranks and the mesh is read from the file instead
+
+  int found = Mesh_flat::snapshot_matches(snapshot, key, comm_) ? 1 : 0;
+  MPI_Allreduce(MPI_IN_PLACE, &found, 1, MPI_INT, MPI_MIN, comm_);
+
+  std::shared_ptr<Mesh> result;
+  if (found) {
+    try {
+      result = std::make_shared<Mesh_flat>(snapshot, key, comm_,
+                                           geometric_model_,
+                                           request_faces_, request_edges_,
+                                           request_sides_, request_wedges_,
+                                           request_corners_, num_tiles_,
+                                           num_ghost_layers_tile_,
+                                           num_ghost_layers_distmesh_,
+                                           request_boundary_ghosts_,
+                                           partitioner_, geom_type_);
+    } catch (const Errors::Message& msg) {
+      std::cerr << "MeshFactory::create - " << msg.what() <<
+          " - reading mesh from " << filename << "\n";
+    }
+  }
+  if (result) {
+    apply_tile_options(result);
+    return result;
+  }
+
+  result = read_flat(filename);
+  if (!std::dynamic_pointer_cast<Mesh_flat>(result)->write_snapshot(snapshot,
+                                                                     key))
+    std::cerr << "MeshFactory::create - could not write mesh snapshot " <<
+        snapshot << "\n";
+  return result;
+}
+
+
+/**
+ * @brief Key identifying the snapshots of a mesh read from a file
+ *
+ * @param filename       mesh file to read
+ *
+ * @return 64 bit FNV-1a hash of the file contents and the options
+ */
+std::uint64_t MeshFactory::snapshot_key(std::string const& filename) const {
+  int rank, nprocs;
+  MPI_Comm_rank(comm_, &rank);
+  MPI_Comm_size(comm_, &nprocs);
+
+  auto fnv1a = [](char const *bytes, std::size_t n, std::uint64_t *hash) {
+    for (std::size_t i = 0; i < n; i++) {
+      *hash ^= static_cast<unsigned char>(bytes[i]);
+      *hash *= 1099511628211ULL;
+    }
+  };
+  auto hash_file = [&](std::string const& name, std::uint64_t *hash) {
+    std::ifstream is(name, std::ios::binary);
+    std::vector<char> buf(1 << 20);
+    while (is) {
+      is.read(&(buf[0]), buf.size());
+      fnv1a(&(buf[0]), is.gcount(), hash);
+    }
+  };
+
+  // Rank 0 hashes an Exodus II file read by all ranks. Each rank
+  // hashes its own file of a Nemesis set and the hashes are combined
+
+  std::uint64_t hash = 14695981039346656037ULL;
+  int len = filename.length();
+  if (len > 4 && filename.substr(len-4, 4) == ".par") {
+    std::stringstream partname;
+    partname << filename << "." << nprocs << "." << rank;
+    hash_file(partname.str(), &hash);
+    std::vector<std::uint64_t> hashes(nprocs);
+    MPI_Allgather(&hash, 1, MPI_UINT64_T, &(hashes[0]), 1, MPI_UINT64_T,
+                  comm_);
+    hash = 14695981039346656037ULL;
+    fnv1a(reinterpret_cast<char const *>(&(hashes[0])),
+          nprocs*sizeof(std::uint64_t), &hash);
+  } else {
+    if (rank == 0)
+      hash_file(filename, &hash);
+    MPI_Bcast(&hash, 1, MPI_UINT64_T, 0, comm_);
+  }
+
+  std::stringstream options;
+  options << std::setprecision(17);
+  options << nprocs << " " << request_faces_ << request_edges_ <<
+      request_sides_ << request_wedges_ << request_corners_ << " " <<
+      num_tiles_ << " " << num_ghost_layers_tile_ << " " <<
+      num_ghost_layers_distmesh_ << " " << request_boundary_ghosts_ << " " <<
+      static_cast<int>(partitioner_) << " " << static_cast<int>(geom_type_) <<
+      " " << static_cast<int>(renumbering_) << " " << parallel_read_;
+  // Sets are built from the regions, so their full definitions go
+  // into the key
+
+  if (geometric_model_) {
+    for (int i = 0; i < geometric_model_->Num_Regions(); i++) {
+      JaliGeometry::RegionPtr rgn = geometric_model_->Region_i(i);
+      options << " [" << rgn->name() << " " << rgn->id() << " " <<
+          rgn->dimension() << " " << static_cast<int>(rgn->lifecycle()) <<
+          " " << static_cast<int>(rgn->type());
+      switch (rgn->type()) {
+        case JaliGeometry::Region_type::BOX: {
+          auto box = dynamic_cast<JaliGeometry::BoxRegionPtr>(rgn);
+          options << " " << box->point0() << " " << box->point1();
+          break;
+        }
+        case JaliGeometry::Region_type::PLANE: {
+          auto plane = dynamic_cast<JaliGeometry::PlaneRegionPtr>(rgn);
+          options << " " << plane->point() << " " << plane->normal();
+          break;
+        }
+        case JaliGeometry::Region_type::POINT: {
+          auto point = dynamic_cast<JaliGeometry::PointRegionPtr>(rgn);
+          options << " " << point->point();
+          break;
+        }
+        case JaliGeometry::Region_type::POLYGON: {
+          auto poly = dynamic_cast<JaliGeometry::PolygonRegionPtr>(rgn);
+          for (auto const& p : poly->points())
+            options << " " << p;
+          options << " " << poly->normal();
+          break;
+        }
+        case JaliGeometry::Region_type::LABELEDSET: {
+          auto lsrgn = dynamic_cast<JaliGeometry::LabeledSetRegionPtr>(rgn);
+          options << " " << lsrgn->label() << " " << lsrgn->entity_str() <<
+              " " << lsrgn->file() << " " << lsrgn->format();
+          break;
+        }
+        case JaliGeometry::Region_type::LOGICAL: {
+          auto lgrgn = dynamic_cast<JaliGeometry::LogicalRegionPtr>(rgn);
+          options << " " << static_cast<int>(lgrgn->operation());
+          for (auto const& name : lgrgn->component_regions())
+            options << " " << name;
+          break;
+        }
+        default:
+          break;
+      }
+      options << "]";
+    }
+  }
+  std::string optstr = options.str();
+  fnv1a(optstr.c_str(), optstr.size(), &hash);
+
+  return hash;
+}
+
 }  // namespace Jali
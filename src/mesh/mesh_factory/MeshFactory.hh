@@ -57,8 +57,10 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string>
 #include <vector>
+#include <functional>
 #include <memory>
 #include <utility>
+#include <cstdint>
 
 #include "MeshDefs.hh"
 #include "Mesh.hh"
@@ -74,7 +76,8 @@ enum MeshFramework_t {
   Simple = 1,
   MSTK,
   MOAB,
-  STKMESH
+  STKMESH,
+  Flat      // flat arrays built from a mesh of another framework
 };
 
 /// A type to identify mesh file formats
@@ -127,7 +130,7 @@ class MeshFactory {
 
   /// Set the framework to use
   void framework(MeshFramework_t const& framework) {
-    if (framework == Simple || framework == MSTK) {
+    if (framework == Simple || framework == MSTK || framework == Flat) {
       framework_ = framework;
     } else {
       std::stringstream mesgstrm;
@@ -147,6 +150,25 @@ class MeshFactory {
     partitioner_ = partitioner;
   }
 
+  /// Get the locality improving renumbering of entities for meshes to
+  /// be created (default NONE)
+  Renumbering_type renumbering(void) const {
+    return renumbering_;
+  }
+
+  /// @brief Set the locality improving renumbering of entities
+  ///
+  /// Cells are renumbered by reverse Cuthill-McKee ordering or along a
+  /// Hilbert curve and nodes, edges and faces are renumbered in the
+  /// order the cells first touch them. Owned entities still come
+  /// before ghost entities. Use Mesh::original_ids to remap data laid
+  /// out in the native ordering. Only the MSTK framework renumbers
+  /// entities - the Simple framework numbers them lexicographically
+  /// which is already local
+  void renumbering(Renumbering_type renumbering) {
+    renumbering_ = renumbering;
+  }
+
   /// Get the geometry type for the meshes to be created (default CARTESIAN)
   JaliGeometry::Geom_type mesh_geometry(void) const {
     return geom_type_;
@@ -207,6 +229,100 @@ class MeshFactory {
     num_ghost_layers_tile_ = num_layers;
   }
 
+  /// Get the max number of cells in subtiles of the tiles of the
+  /// meshes to be created (default 0, i.e. tiles are not subdivided)
+
+  int num_cells_per_subtile(void) const {
+    return num_cells_per_subtile_;
+  }
+
+  /// Set the max number of cells in subtiles of the tiles of the
+  /// meshes to be created (see Mesh::subdivide_tiles)
+
+  void num_cells_per_subtile(int n) {
+    num_cells_per_subtile_ = n;
+  }
+
+  /// Get whether tiles of the meshes to be created get a tile-local
+  /// numbering of their entities (default false)
+
+  bool tile_local_numbering(void) const {
+    return tile_local_numbering_;
+  }
+
+  /// Set whether tiles of the meshes to be created get a tile-local
+  /// numbering of their entities (see Mesh::tile_local_numbering)
+
+  void tile_local_numbering(bool use_local_numbering) {
+    tile_local_numbering_ = use_local_numbering;
+  }
+
+  /// Get whether MSTK meshes release their MSTK representation once
+  /// they are created (default false)
+
+  bool detach_framework(void) const {
+    return detach_framework_;
+  }
+
+  /// Set whether MSTK meshes release their MSTK representation once
+  /// they are created and only re-create it for queries that need it
+  /// (see Mesh_MSTK::detach)
+
+  void detach_framework(bool detach) {
+    detach_framework_ = detach;
+  }
+
+  /// Get whether each rank reads only its share of an Exodus II file
+  /// in parallel runs (default false)
+
+  bool parallel_read(void) const {
+    return parallel_read_;
+  }
+
+  /// Set whether each rank reads only its share of an Exodus II file
+  /// in parallel runs with the MSTK framework instead of MSTK reading
+  /// and distributing the whole file (see the Mesh_MSTK constructor).
+  /// The Flat framework always reads its share in parallel runs
+
+  void parallel_read(bool read) {
+    parallel_read_ = read;
+  }
+
+  /// Get the directory of mesh snapshots (empty if meshes read from
+  /// files are not cached, the default)
+
+  std::string const& cache_directory(void) const {
+    return cache_directory_;
+  }
+
+  /// Set a directory in which meshes read from files with the Flat
+  /// framework are cached as binary snapshots (one per rank, see
+  /// Mesh_flat::write_snapshot). Later runs with the same input file,
+  /// number of ranks and options load the snapshots instead of
+  /// importing and processing the file. An empty name disables the
+  /// cache
+
+  void cache_directory(std::string const& dir) {
+    cache_directory_ = dir;
+  }
+
+  /// Get whether generated 3D meshes of the Simple framework compute
+  /// connectivity and coordinates from entity indices instead of
+  /// storing them (default false)
+
+  bool implicit_connectivity(void) const {
+    return implicit_connectivity_;
+  }
+
+  /// Set whether generated 3D meshes of the Simple framework compute
+  /// connectivity and coordinates from entity indices instead of
+  /// storing them (saves memory for large regular meshes; sides,
+  /// wedges and corners cannot be requested then)
+
+  void implicit_connectivity(bool use_implicit_connectivity) {
+    implicit_connectivity_ = use_implicit_connectivity;
+  }
+
   /// @brief Get explicitly represented entity kinds 
   ///
   /// Get the types of entities that are explicitly requested in the
@@ -347,6 +463,13 @@ class MeshFactory {
     return create(inmesh, setnames, setkind, flatten, extrude);
   }
 
+  /// Create a mesh by migrating the owned cells of an existing mesh to
+  /// other ranks (entry i of cell_ranks is the target rank of owned
+  /// cell i). Data on the old mesh can be moved to the new one with
+  /// Mesh::redistribute_data or State::redistribute_from
+  std::shared_ptr<Mesh> redistribute(std::shared_ptr<Mesh> const inmesh,
+                                     std::vector<int> const& cell_ranks);
+
  private:
 
   /// Create a mesh by reading the specified file (or set of files)
@@ -378,6 +501,32 @@ class MeshFactory {
                                bool const extrude = false);
 
 
+  /// Create a mesh with the Flat framework from the mesh made by
+  /// 'create_source' with the 'source' framework (the source mesh is
+  /// released once the flat mesh is built)
+  std::shared_ptr<Mesh>
+  create_flat(std::function<std::shared_ptr<Mesh>()> const& create_source,
+              MeshFramework_t const source);
+
+  /// Subdivide tiles and number entities per tile as requested in a
+  /// newly created mesh
+  void apply_tile_options(std::shared_ptr<Mesh> const& mesh) const;
+
+  /// Read a Flat mesh from 'filename', streaming it from the file
+  /// when running on one rank and reading each rank's share of it
+  /// with MSTK otherwise
+  std::shared_ptr<Mesh> read_flat(std::string const& filename);
+
+  /// Load a Flat mesh read from 'filename' from the snapshot cache, or
+  /// create it and add it to the cache
+  std::shared_ptr<Mesh> create_flat_cached(std::string const& filename);
+
+  /// Key of the snapshots of a mesh read from 'filename' - a hash of
+  /// the contents of the file (or of the file of this rank for a
+  /// Nemesis file set), the number of ranks, the mesh options and the
+  /// definitions of the regions of the geometric model
+  std::uint64_t snapshot_key(std::string const& filename) const;
+
   /// The parallel environment
   MPI_Comm const comm_;
 
@@ -414,6 +563,29 @@ class MeshFactory {
   int const num_ghost_layers_tile_default_ = 0;
   int num_ghost_layers_tile_ = num_ghost_layers_tile_default_;
 
+  /// Max number of cells in a subtile of a tile
+  int const num_cells_per_subtile_default_ = 0;
+  int num_cells_per_subtile_ = num_cells_per_subtile_default_;
+
+  /// Whether tiles get a tile-local numbering
+  bool const tile_local_numbering_default_ = false;
+  bool tile_local_numbering_ = tile_local_numbering_default_;
+
+  /// Whether MSTK meshes are detached from MSTK once created
+  bool const detach_framework_default_ = false;
+  bool detach_framework_ = detach_framework_default_;
+
+  /// Whether ranks read their share of Exodus II files themselves
+  bool const parallel_read_default_ = false;
+  bool parallel_read_ = parallel_read_default_;
+
+  /// Directory of mesh snapshots (no caching if empty)
+  std::string cache_directory_;
+
+  /// Whether generated Simple meshes compute their connectivity
+  bool const implicit_connectivity_default_ = false;
+  bool implicit_connectivity_ = implicit_connectivity_default_;
+
   /// Number of ghost/halo layers for mesh partitions across compute nodes
   int const num_ghost_layers_distmesh_default_ = 1;
   int num_ghost_layers_distmesh_ = num_ghost_layers_distmesh_default_;
@@ -423,6 +595,10 @@ class MeshFactory {
   Partitioner_type const partitioner_default_ = Partitioner_type::INDEX;
   Partitioner_type partitioner_ = partitioner_default_;
 
+  /// Renumbering type
+  Renumbering_type const renumbering_default_ = Renumbering_type::NONE;
+  Renumbering_type renumbering_ = renumbering_default_;
+
   /// Geometry type
   JaliGeometry::Geom_type const geom_type_default_ =
       JaliGeometry::Geom_type::CARTESIAN;
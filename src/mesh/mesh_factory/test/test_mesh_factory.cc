@@ -42,11 +42,60 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 
+#include <cstdio>
 #include <iostream>
+#include <string>
+#include <vector>
 #include <UnitTest++.h>
 
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "dbc.hh"
 #include "../MeshFactory.hh"
+#include "BoxRegion.hh"
+#include "GeometricModel.hh"
+
+// Paths of the mesh snapshots of this rank in a cache directory
+
+std::vector<std::string> rank_snapshots(std::string const& dir) {
+  int nproc, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  std::string suffix = "." + std::to_string(nproc) + "." +
+      std::to_string(rank) + ".jflat";
+
+  std::vector<std::string> snapshots;
+  DIR *dp = opendir(dir.c_str());
+  if (!dp) return snapshots;
+  while (struct dirent *entry = readdir(dp)) {
+    std::string name = entry->d_name;
+    if (name.size() > suffix.size() &&
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+      snapshots.push_back(dir + "/" + name);
+  }
+  closedir(dp);
+  return snapshots;
+}
+
+// Inode of a file - snapshots are written to a temporary file and
+// renamed, so rewriting a snapshot changes its inode
+
+ino_t file_inode(std::string const& name) {
+  struct stat st;
+  return (stat(name.c_str(), &st) == 0) ? st.st_ino : 0;
+}
+
+// Global number of owned cells in a set (built on first use)
+
+int global_set_size(Jali::Mesh& mesh, std::string const& setname) {
+  int nlocal = mesh.get_set_size(setname, Jali::Entity_kind::CELL,
+                                 Jali::Entity_type::PARALLEL_OWNED);
+  int nglobal = 0;
+  MPI_Allreduce(&nlocal, &nglobal, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  return nglobal;
+}
 
 // Check to see if we have some files to read
 
@@ -228,6 +277,112 @@ SUITE (MeshFramework)
   }
 
 
+  // Meshes read with the Flat framework are cached as snapshots in a
+  // directory and loaded from there when the file, the options and
+  // the regions are the same
+
+  TEST (FlatCache) {
+    int nproc, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    bool parallel(nproc > 1);
+
+    // Flat meshes are read through MSTK in parallel
+
+    if (parallel && !Jali::framework_available(Jali::MSTK)) return;
+
+    std::string cachedir = "flat_mesh_cache";
+    if (rank == 0) mkdir(cachedir.c_str(), 0755);
+    MPI_Barrier(MPI_COMM_WORLD);
+    for (auto const& snapshot : rank_snapshots(cachedir))
+      std::remove(snapshot.c_str());
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    JaliGeometry::Point lo(-2.0, -2.0, -1.0), hi1(0.1, 2.0, 2.0),
+        hi2(-0.3, 2.0, 2.0);
+    JaliGeometry::BoxRegion box1("box1", 1, lo, hi1);
+    JaliGeometry::BoxRegion box1_smaller("box1", 1, lo, hi2);
+    std::vector<JaliGeometry::RegionPtr> regions1 = {&box1};
+    std::vector<JaliGeometry::RegionPtr> regions2 = {&box1_smaller};
+    JaliGeometry::GeometricModel gm1(3, regions1), gm2(3, regions2);
+
+    Jali::MeshFactory mesh_factory(MPI_COMM_WORLD);
+    mesh_factory.framework(Jali::Flat);
+    mesh_factory.geometric_model(&gm1);
+    mesh_factory.cache_directory(cachedir);
+
+    // The first read misses and writes one snapshot per rank
+
+    std::shared_ptr<Jali::Mesh> mesh = mesh_factory(EXODUS_TEST_FILE);
+    CHECK(mesh);
+    int ncells = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+    int nset1 = global_set_size(*mesh, "box1");
+    CHECK_EQUAL(75, nset1);
+    mesh.reset();
+
+    std::vector<std::string> snapshots = rank_snapshots(cachedir);
+    CHECK_EQUAL(1, snapshots.size());
+    if (snapshots.size() != 1) return;
+    std::string snapshot = snapshots[0];
+    ino_t inode = file_inode(snapshot);
+
+    // The second read loads the snapshot
+
+    mesh = mesh_factory(EXODUS_TEST_FILE);
+    CHECK_EQUAL(ncells, mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>());
+    CHECK_EQUAL(nset1, global_set_size(*mesh, "box1"));
+    CHECK_EQUAL(inode, file_inode(snapshot));
+    mesh.reset();
+
+    // A region with the same name but a different definition changes
+    // the key, so the mesh is read again under a new snapshot
+
+    mesh_factory.geometric_model(&gm2);
+    mesh = mesh_factory(EXODUS_TEST_FILE);
+    CHECK_EQUAL(50, global_set_size(*mesh, "box1"));
+    CHECK_EQUAL(2, rank_snapshots(cachedir).size());
+    CHECK_EQUAL(inode, file_inode(snapshot));
+    mesh.reset();
+    mesh_factory.geometric_model(&gm1);
+
+    // If the snapshot of one rank is missing all ranks read the file
+    // and rewrite their snapshots (the snapshot is moved away rather
+    // than removed so that its inode is not reused)
+
+    std::string moved = cachedir + "/moved.jflat";
+    if (rank == nproc-1) std::rename(snapshot.c_str(), moved.c_str());
+    MPI_Barrier(MPI_COMM_WORLD);
+    mesh = mesh_factory(EXODUS_TEST_FILE);
+    CHECK_EQUAL(ncells, mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>());
+    CHECK_EQUAL(nset1, global_set_size(*mesh, "box1"));
+    CHECK(file_inode(snapshot) != 0);
+    CHECK(file_inode(snapshot) != inode);
+    inode = file_inode(snapshot);
+    mesh.reset();
+    if (rank == nproc-1) std::remove(moved.c_str());
+
+    // A truncated snapshot has a valid header but cannot be loaded -
+    // all ranks fall back to reading the file
+
+    if (rank == nproc-1) {
+      struct stat st;
+      stat(snapshot.c_str(), &st);
+      CHECK_EQUAL(0, truncate(snapshot.c_str(), st.st_size/2));
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    mesh = mesh_factory(EXODUS_TEST_FILE);
+    CHECK_EQUAL(ncells, mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>());
+    CHECK_EQUAL(nset1, global_set_size(*mesh, "box1"));
+    CHECK(file_inode(snapshot) != inode);
+    mesh.reset();
+
+    for (auto const& snapshot : rank_snapshots(cachedir))
+      std::remove(snapshot.c_str());
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) rmdir(cachedir.c_str());
+  }
+
+
   // Make sure mesh factory options can be set and transmitted
   // correctly to the mesh constructors
 
@@ -0,0 +1,1635 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Mesh_flat.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
+
+#include "exodusII.h"
+
+#include "ExodusElement.hh"
+#include "dbc.hh"
+#include "errors.hh"
+
+namespace Jali {
+
+Mesh_flat::Mesh_flat(const std::shared_ptr<Mesh> inmesh,
+                     const bool request_faces,
+                     const bool request_edges,
+                     const bool request_sides,
+                     const bool request_wedges,
+                     const bool request_corners,
+                     const int num_tiles_ini,
+                     const int num_ghost_layers_tile,
+                     const int num_ghost_layers_distmesh,
+                     const bool request_boundary_ghosts,
+                     const Partitioner_type partitioner) :
+    Mesh(request_faces, request_edges, request_sides, request_wedges,
+         request_corners, num_tiles_ini, num_ghost_layers_tile,
+         num_ghost_layers_distmesh, request_boundary_ghosts, partitioner,
+         inmesh->geom_type(), inmesh->get_comm()) {
+
+  Mesh& src = *inmesh;
+
+  int nnodes = src.num_nodes<Entity_type::ALL>();
+  int nfaces = src.num_faces<Entity_type::ALL>();
+  int nedges = src.num_edges<Entity_type::ALL>();
+  int ncells = src.num_cells<Entity_type::ALL>();
+
+  if ((faces_requested && !nfaces && ncells) ||
+      (edges_requested && !nedges && ncells)) {
+    Errors::Message mesg("Mesh_flat: faces or edges requested but the source "
+                         "mesh has none");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  set_space_dimension(src.space_dimension());
+  set_cell_dimension(src.cell_dimension());
+  set_mesh_type(src.mesh_type());
+  set_geometric_model(src.geometric_model());
+
+  // The flat arrays are as fast to query as the connectivity cache
+
+  Mesh::cache_vars_ = false;
+
+  // Entity lists
+
+  nodeids_owned_ = src.nodes<Entity_type::PARALLEL_OWNED>();
+  nodeids_ghost_ = src.nodes<Entity_type::PARALLEL_GHOST>();
+  nodeids_all_ = src.nodes<Entity_type::ALL>();
+  if (faces_requested) {
+    faceids_owned_ = src.faces<Entity_type::PARALLEL_OWNED>();
+    faceids_ghost_ = src.faces<Entity_type::PARALLEL_GHOST>();
+    faceids_all_ = src.faces<Entity_type::ALL>();
+  }
+  if (edges_requested) {
+    edgeids_owned_ = src.edges<Entity_type::PARALLEL_OWNED>();
+    edgeids_ghost_ = src.edges<Entity_type::PARALLEL_GHOST>();
+    edgeids_all_ = src.edges<Entity_type::ALL>();
+  }
+  cellids_owned_ = src.cells<Entity_type::PARALLEL_OWNED>();
+  cellids_ghost_ = src.cells<Entity_type::PARALLEL_GHOST>();
+  cellids_boundary_ghost_ = src.cells<Entity_type::BOUNDARY_GHOST>();
+  cellids_all_ = src.cells<Entity_type::ALL>();
+
+  // Node coordinates
+
+  int spdim = space_dimension();
+  JaliGeometry::Point xyz(spdim);
+  for (int d = 0; d < spdim; d++)
+    coords_[d].resize(nnodes);
+  for (int n = 0; n < nnodes; n++) {
+    src.node_get_coordinates(n, &xyz);
+    for (int d = 0; d < spdim; d++)
+      coords_[d][n] = xyz[d];
+  }
+
+  // Global IDs (only needed if they differ from local IDs)
+
+  int nprocs;
+  MPI_Comm_size(get_comm(), &nprocs);
+  if (nprocs > 1) {
+    Entity_kind kinds[4] = {Entity_kind::NODE, Entity_kind::EDGE,
+                            Entity_kind::FACE, Entity_kind::CELL};
+    int nents[4] = {nnodes, edges_requested ? nedges : 0,
+                    faces_requested ? nfaces : 0, ncells};
+    for (int k = 0; k < 4; k++) {
+      gids_[k].resize(nents[k]);
+      for (int i = 0; i < nents[k]; i++)
+        gids_[k][i] = src.GID(i, kinds[k]);
+    }
+  }
+
+  // Topology
+
+  cell_types_.resize(ncells);
+  for (int c = 0; c < ncells; c++)
+    cell_types_[c] = src.cell_get_type(c);
+
+  copy_adjacency_(ncells, [&](int c, Entity_ID_List *nodeids) {
+      src.cell_get_nodes(c, nodeids);
+    }, &cell_node_offsets_, &cell_node_ids_);
+
+  copy_adjacency_(nnodes, [&](int n, Entity_ID_List *cellids) {
+      src.node_get_cells(n, Entity_type::ALL, cellids);
+    }, &node_cell_offsets_, &node_cell_ids_);
+
+  if (faces_requested) {
+    std::vector<dir_t> dirs;
+    copy_adjacency_(ncells, [&](int c, Entity_ID_List *faceids) {
+        src.cell_get_faces_and_dirs(c, faceids, &dirs, true);
+        cell_face_dirs_.insert(cell_face_dirs_.end(), dirs.begin(),
+                               dirs.end());
+      }, &cell_face_offsets_, &cell_face_ids_);
+
+    copy_adjacency_(nfaces, [&](int f, Entity_ID_List *nodeids) {
+        src.face_get_nodes(f, nodeids);
+      }, &face_node_offsets_, &face_node_ids_);
+
+    copy_adjacency_(nnodes, [&](int n, Entity_ID_List *faceids) {
+        src.node_get_faces(n, Entity_type::ALL, faceids);
+      }, &node_face_offsets_, &node_face_ids_);
+
+    Entity_ID_List cellids;
+    face_cell_ids_.assign(2*nfaces, -1);
+    for (int f = 0; f < nfaces; f++) {
+      src.face_get_cells(f, Entity_type::ALL, &cellids);
+      for (int i = 0; i < cellids.size() && i < 2; i++)
+        face_cell_ids_[2*f+i] = cellids[i];
+    }
+  }
+
+  if (edges_requested) {
+    std::vector<dir_t> dirs;
+    if (cell_dimension() == 2)
+      copy_adjacency_(ncells, [&](int c, Entity_ID_List *edgeids) {
+          src.cell_2D_get_edges_and_dirs(c, edgeids, &dirs);
+          cell_edge_dirs_.insert(cell_edge_dirs_.end(), dirs.begin(),
+                                 dirs.end());
+        }, &cell_edge_offsets_, &cell_edge_ids_);
+    else
+      copy_adjacency_(ncells, [&](int c, Entity_ID_List *edgeids) {
+          src.cell_get_edges(c, edgeids);
+        }, &cell_edge_offsets_, &cell_edge_ids_);
+
+    if (faces_requested)
+      copy_adjacency_(nfaces, [&](int f, Entity_ID_List *edgeids) {
+          src.face_get_edges_and_dirs(f, edgeids, &dirs, true);
+          face_edge_dirs_.insert(face_edge_dirs_.end(), dirs.begin(),
+                                 dirs.end());
+        }, &face_edge_offsets_, &face_edge_ids_);
+
+    edge_node_ids_.resize(2*nedges);
+    for (int e = 0; e < nedges; e++)
+      src.edge_get_nodes(e, &edge_node_ids_[2*e], &edge_node_ids_[2*e+1]);
+  }
+
+  // Labeled sets have to be copied since the regions only name sets
+  // stored with the source mesh
+
+  JaliGeometry::GeometricModelPtr gm = geometric_model();
+  if (gm) {
+    for (int i = 0; i < gm->Num_Regions(); i++) {
+      JaliGeometry::RegionPtr rgn = gm->Region_i(i);
+      if (rgn->type() != JaliGeometry::Region_type::LABELEDSET) continue;
+
+      JaliGeometry::LabeledSetRegionPtr lsrgn =
+          dynamic_cast<JaliGeometry::LabeledSetRegionPtr>(rgn);
+      Entity_kind kind = labeled_set_kind(lsrgn->entity_str());
+      if (kind == Entity_kind::UNKNOWN_KIND ||
+          (kind == Entity_kind::FACE && !faces_requested) ||
+          (kind == Entity_kind::EDGE && !edges_requested))
+        continue;
+
+      std::array<Entity_ID_List, 2>& set = labeled_sets_[rgn->name()];
+      src.get_set_entities(rgn->name(), kind, Entity_type::PARALLEL_OWNED,
+                           &set[0]);
+      src.get_set_entities(rgn->name(), kind, Entity_type::PARALLEL_GHOST,
+                           &set[1]);
+    }
+  }
+
+  cache_extra_variables();
+
+  if (Mesh::num_tiles_ini_)
+    Mesh::build_tiles();
+}
+
+
+Mesh_flat::Mesh_flat(const std::string& filename, const MPI_Comm& comm,
+                     const JaliGeometry::GeometricModelPtr& gm,
+                     const bool request_faces,
+                     const bool request_edges,
+                     const bool request_sides,
+                     const bool request_wedges,
+                     const bool request_corners,
+                     const int num_tiles_ini,
+                     const int num_ghost_layers_tile,
+                     const int num_ghost_layers_distmesh,
+                     const bool request_boundary_ghosts,
+                     const Partitioner_type partitioner,
+                     const JaliGeometry::Geom_type geom_type,
+                     const int chunk_size) :
+    Mesh(request_faces, request_edges, request_sides, request_wedges,
+         request_corners, num_tiles_ini, num_ghost_layers_tile,
+         num_ghost_layers_distmesh, request_boundary_ghosts, partitioner,
+         geom_type, comm) {
+
+  int nprocs;
+  MPI_Comm_size(comm, &nprocs);
+  if (nprocs > 1) {
+    Errors::Message mesg("Mesh_flat: Exodus II files can only be read "
+                         "directly on a single rank");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  int comp_ws = sizeof(double), io_ws = 0;
+  float version;
+  int exoid = ex_open(filename.c_str(), EX_READ, &comp_ws, &io_ws, &version);
+
+  char title[MAX_LINE_LENGTH+1];
+  int ndim = 0, nnodes, nelems, nblocks, nnodesets, nsidesets;
+  if (exoid < 0 ||
+      ex_get_init(exoid, title, &ndim, &nnodes, &nelems, &nblocks,
+                  &nnodesets, &nsidesets) < 0 ||
+      ndim < 2) {
+    if (exoid >= 0) ex_close(exoid);
+    Errors::Message mesg("Mesh_flat: could not read 2D or 3D mesh from " +
+                         filename);
+    Exceptions::Jali_throw(mesg);
+  }
+
+  // Element blocks
+
+  std::vector<int> blkids(nblocks), blksizes(nblocks);
+  std::vector<ExodusElement const *> blkelems(nblocks, NULL);
+  if (nblocks) ex_get_ids(exoid, EX_ELEM_BLOCK, &(blkids[0]));
+
+  int celldim = 0;
+  for (int b = 0; b < nblocks; b++) {
+    char elemtype[MAX_STR_LENGTH+1];
+    int nperelem, nedges, nfaces, nattr;
+    ex_get_block(exoid, EX_ELEM_BLOCK, blkids[b], elemtype, &(blksizes[b]),
+                 &nperelem, &nedges, &nfaces, &nattr);
+    if (!blksizes[b]) continue;
+
+    blkelems[b] = exodus_element(elemtype, nperelem);
+    if (!blkelems[b] || (celldim && blkelems[b]->celldim != celldim)) {
+      ex_close(exoid);
+      std::stringstream mesg_stream;
+      mesg_stream << "Mesh_flat: cannot read element block " << blkids[b] <<
+          " (elements of type " << elemtype << " with " << nperelem <<
+          " nodes) of " << filename << " - only blocks of linear " <<
+          "elements of the same dimension are supported";
+      Errors::Message mesg(mesg_stream.str());
+      Exceptions::Jali_throw(mesg);
+    }
+    celldim = blkelems[b]->celldim;
+  }
+
+  set_space_dimension(ndim);
+  set_cell_dimension(celldim ? celldim : ndim);
+  set_mesh_type(Mesh_type::GENERAL);
+  set_geometric_model(gm);
+
+  // Node coordinates, read in chunks straight into their arrays
+
+  for (int d = 0; d < ndim; d++)
+    coords_[d].resize(nnodes);
+  for (int n0 = 0; n0 < nnodes; n0 += chunk_size) {
+    int n = std::min(chunk_size, nnodes - n0);
+    ex_get_partial_coord(exoid, n0+1, n, &(coords_[0][n0]), &(coords_[1][n0]),
+                         (ndim > 2) ? &(coords_[2][n0]) : NULL);
+  }
+
+  // Cells in chunks of elements, with their faces and edges found as
+  // they come in
+
+  CellBuilder_ builder;
+  begin_cells_(nelems, NULL, &builder);
+
+  std::vector<Entity_ID> conn;
+  for (int b = 0; b < nblocks; b++) {
+    if (!blksizes[b]) continue;
+    ExodusElement const& el = *(blkelems[b]);
+
+    for (int e0 = 0; e0 < blksizes[b]; e0 += chunk_size) {
+      int ne = std::min(chunk_size, blksizes[b] - e0);
+      conn.resize(ne*el.nnodes);
+      if (ex_get_partial_conn(exoid, EX_ELEM_BLOCK, blkids[b], e0+1, ne,
+                              &(conn[0]), NULL, NULL) < 0) {
+        ex_close(exoid);
+        Errors::Message mesg("Mesh_flat: could not read elements of " +
+                             filename);
+        Exceptions::Jali_throw(mesg);
+      }
+
+      for (auto& n : conn)
+        n--;
+      for (int e = 0; e < ne; e++)
+        add_cell_(el, &(conn[e*el.nnodes]), &builder);
+    }
+  }
+  std::vector<Entity_ID>().swap(conn);
+
+  end_cells_(nnodes, &builder);
+
+  int ncells = cell_types_.size();
+  int nfaces = faces_requested ? face_node_offsets_.size() - 1 : 0;
+  int nedges = edge_node_ids_.size()/2;
+
+  // Entity lists (all entities are owned)
+
+  nodeids_owned_.resize(nnodes);
+  for (int n = 0; n < nnodes; n++)
+    nodeids_owned_[n] = n;
+  nodeids_all_ = nodeids_owned_;
+  if (faces_requested) {
+    faceids_owned_.resize(nfaces);
+    for (int f = 0; f < nfaces; f++)
+      faceids_owned_[f] = f;
+    faceids_all_ = faceids_owned_;
+  }
+  if (edges_requested) {
+    edgeids_owned_.resize(nedges);
+    for (int e = 0; e < nedges; e++)
+      edgeids_owned_[e] = e;
+    edgeids_all_ = edgeids_owned_;
+  }
+  cellids_owned_.resize(ncells);
+  for (int c = 0; c < ncells; c++)
+    cellids_owned_[c] = c;
+  cellids_all_ = cellids_owned_;
+
+  // Labeled sets of the geometric model - cells of the element block
+  // or element set, faces of the side set or nodes of the node set
+  // with the label
+
+  int nelemsets = ex_inquire_int(exoid, EX_INQ_ELEM_SETS);
+  std::map<ex_entity_type, std::vector<int>> setids;
+  setids[EX_ELEM_SET].resize(std::max(nelemsets, 0));
+  setids[EX_SIDE_SET].resize(nsidesets);
+  setids[EX_NODE_SET].resize(nnodesets);
+  for (auto& kv : setids)
+    if (!kv.second.empty())
+      ex_get_ids(exoid, kv.first, &(kv.second[0]));
+
+  // Entries (and sides for side sets) of a set, if the file has it
+  auto read_set = [&](ex_entity_type type, int label,
+                      std::vector<int> *entries, std::vector<int> *extra) {
+    std::vector<int> const& ids = setids[type];
+    int nent = 0, ndf;
+    if (std::find(ids.begin(), ids.end(), label) != ids.end())
+      ex_get_set_param(exoid, type, label, &nent, &ndf);
+    entries->resize(nent);
+    if (extra) extra->resize(nent);
+    if (nent)
+      ex_get_set(exoid, type, label, &((*entries)[0]),
+                 extra ? &((*extra)[0]) : NULL);
+    return nent > 0;
+  };
+
+  int ngr = gm ? gm->Num_Regions() : 0;
+  std::vector<int> entries, sides;
+  for (int i = 0; i < ngr; i++) {
+    JaliGeometry::RegionPtr rgn = gm->Region_i(i);
+    if (rgn->type() != JaliGeometry::Region_type::LABELEDSET) continue;
+
+    JaliGeometry::LabeledSetRegionPtr lsrgn =
+        dynamic_cast<JaliGeometry::LabeledSetRegionPtr>(rgn);
+    Entity_kind kind = labeled_set_kind(lsrgn->entity_str());
+    int label = std::atoi(lsrgn->label().c_str());
+    Entity_ID_List& owned = labeled_sets_[rgn->name()][0];
+
+    if (kind == Entity_kind::CELL) {
+      int b = std::find(blkids.begin(), blkids.end(), label) - blkids.begin();
+      if (b < nblocks) {
+        int c0 = std::accumulate(blksizes.begin(), blksizes.begin() + b, 0);
+        for (int c = c0; c < c0 + blksizes[b]; c++)
+          owned.push_back(c);
+      } else if (read_set(EX_ELEM_SET, label, &entries, NULL)) {
+        for (auto const& e : entries)
+          owned.push_back(e-1);
+      }
+    } else if (kind == Entity_kind::FACE && faces_requested) {
+      if (read_set(EX_SIDE_SET, label, &entries, &sides)) {
+        for (int k = 0; k < entries.size(); k++) {
+          int c = entries[k]-1, side = sides[k]-1;
+          if (c >= 0 && c < ncells && side >= 0 &&
+              side < cell_face_offsets_[c+1] - cell_face_offsets_[c])
+            owned.push_back(cell_face_ids_[cell_face_offsets_[c] + side]);
+        }
+        std::sort(owned.begin(), owned.end());
+        owned.erase(std::unique(owned.begin(), owned.end()), owned.end());
+      }
+    } else if (kind == Entity_kind::NODE) {
+      if (read_set(EX_NODE_SET, label, &entries, NULL)) {
+        for (auto const& n : entries)
+          owned.push_back(n-1);
+      }
+    }
+  }
+
+  ex_close(exoid);
+
+  // The flat arrays are as fast to query as the connectivity cache
+
+  Mesh::cache_vars_ = false;
+
+  cache_extra_variables();
+
+  if (Mesh::num_tiles_ini_)
+    Mesh::build_tiles();
+}
+
+
+Mesh_flat::Mesh_flat(const int space_dim, const std::vector<double>& coords,
+                     const std::vector<Entity_ID>& node_gids,
+                     const int num_owned_nodes,
+                     const std::vector<Cell_type>& cell_types,
+                     const std::vector<int>& cell_node_offsets,
+                     const std::vector<Entity_ID>& cell_node_ids,
+                     const std::vector<Entity_ID>& cell_gids,
+                     const int num_owned_cells,
+                     const MPI_Comm& comm,
+                     const JaliGeometry::GeometricModelPtr& gm,
+                     const bool request_faces,
+                     const bool request_edges,
+                     const bool request_sides,
+                     const bool request_wedges,
+                     const bool request_corners,
+                     const int num_tiles_ini,
+                     const int num_ghost_layers_tile,
+                     const int num_ghost_layers_distmesh,
+                     const bool request_boundary_ghosts,
+                     const Partitioner_type partitioner,
+                     const JaliGeometry::Geom_type geom_type) :
+    Mesh(request_faces, request_edges, request_sides, request_wedges,
+         request_corners, num_tiles_ini, num_ghost_layers_tile,
+         num_ghost_layers_distmesh, request_boundary_ghosts, partitioner,
+         geom_type, comm) {
+
+  int nnodes = node_gids.size();
+  int ncells = cell_types.size();
+
+  if (space_dim < 2 || space_dim > 3 || coords.size() != space_dim*nnodes ||
+      cell_node_offsets.size() != ncells+1 || cell_gids.size() != ncells ||
+      num_owned_nodes > nnodes || num_owned_cells > ncells) {
+    Errors::Message mesg("Mesh_flat: inconsistent sizes of the node and "
+                         "cell arrays");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  std::vector<ExodusElement const *> elems(ncells);
+  for (int c = 0; c < ncells; c++) {
+    elems[c] = exodus_element(cell_types[c]);
+    if (!elems[c] ||
+        elems[c]->nnodes != cell_node_offsets[c+1] - cell_node_offsets[c] ||
+        elems[c]->celldim != elems[0]->celldim) {
+      std::stringstream mesg_stream;
+      mesg_stream << "Mesh_flat: cell " << c << " of type " <<
+          Cell_type_string(cell_types[c]) << " with " <<
+          cell_node_offsets[c+1] - cell_node_offsets[c] << " nodes is " <<
+          "not supported - cells have to be linear elements of the same " <<
+          "dimension";
+      Errors::Message mesg(mesg_stream.str());
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+
+  set_space_dimension(space_dim);
+  set_cell_dimension(ncells ? elems[0]->celldim : space_dim);
+  set_mesh_type(Mesh_type::GENERAL);
+  set_geometric_model(gm);
+
+  for (int d = 0; d < space_dim; d++) {
+    coords_[d].resize(nnodes);
+    for (int n = 0; n < nnodes; n++)
+      coords_[d][n] = coords[space_dim*n+d];
+  }
+
+  // Faces and edges, oriented by the global IDs of their nodes so that
+  // all ranks agree on them
+
+  CellBuilder_ builder;
+  begin_cells_(ncells, &node_gids, &builder);
+  for (int c = 0; c < ncells; c++)
+    add_cell_(*(elems[c]), &(cell_node_ids[cell_node_offsets[c]]), &builder);
+
+  // A face or edge belongs to the owner of the cell with the lowest
+  // GID around it. That rank has all cells around it, as do the other
+  // ranks owning one of the cells, so it is owned here if that cell is
+  // an owned cell. Ranks that only have ghost cells around it see it
+  // as a ghost
+
+  int nfaces = 0, nedges = 0, nowned_faces = 0, nowned_edges = 0;
+  if (builder.build_faces) {
+    nfaces = face_node_offsets_.size() - 1;
+    std::vector<bool> owned(nfaces);
+    for (int f = 0; f < nfaces; f++) {
+      Entity_ID c0 = face_cell_ids_[2*f], c1 = face_cell_ids_[2*f+1];
+      Entity_ID cmin = (c1 >= 0 && cell_gids[c1] < cell_gids[c0]) ? c1 : c0;
+      owned[f] = (cmin < num_owned_cells);
+    }
+    number_owned_first_(Entity_kind::FACE, owned, &nowned_faces);
+  }
+  if (builder.build_edges) {
+    nedges = edge_node_ids_.size()/2;
+    std::vector<Entity_ID> cmin(nedges, -1);
+    for (int c = 0; c < ncells; c++)
+      for (int k = cell_edge_offsets_[c]; k < cell_edge_offsets_[c+1]; k++) {
+        Entity_ID& ce = cmin[cell_edge_ids_[k]];
+        if (ce < 0 || cell_gids[c] < cell_gids[ce])
+          ce = c;
+      }
+    std::vector<bool> owned(nedges);
+    for (int e = 0; e < nedges; e++)
+      owned[e] = (cmin[e] < num_owned_cells);
+    number_owned_first_(Entity_kind::EDGE, owned, &nowned_edges);
+  }
+
+  end_cells_(nnodes, &builder);
+
+  if (cell_dimension() == 2) {
+    nedges = nfaces;
+    nowned_edges = nowned_faces;
+  }
+
+  // Entity lists (owned entities come first)
+
+  Entity_ID_List *lists[4][3] = {
+    {&nodeids_owned_, &nodeids_ghost_, &nodeids_all_},
+    {&edgeids_owned_, &edgeids_ghost_, &edgeids_all_},
+    {&faceids_owned_, &faceids_ghost_, &faceids_all_},
+    {&cellids_owned_, &cellids_ghost_, &cellids_all_}};
+  int nents[4] = {nnodes, edges_requested ? nedges : 0,
+                  faces_requested ? nfaces : 0, ncells};
+  int nowned[4] = {num_owned_nodes, nowned_edges, nowned_faces,
+                   num_owned_cells};
+  for (int k = 0; k < 4; k++) {
+    for (int i = 0; i < nents[k]; i++)
+      lists[k][i < nowned[k] ? 0 : 1]->push_back(i);
+    lists[k][2]->resize(nents[k]);
+    for (int i = 0; i < nents[k]; i++)
+      (*lists[k][2])[i] = i;
+  }
+
+  // Global IDs
+
+  int nprocs;
+  MPI_Comm_size(comm, &nprocs);
+  if (nprocs > 1) {
+    gids_[0] = node_gids;
+    gids_[3] = cell_gids;
+    if (builder.build_faces)
+      global_ids_by_nodes_(face_node_offsets_, face_node_ids_, nowned_faces,
+                           node_gids, &gids_[2]);
+    if (nents[1] && cell_dimension() == 2) {
+      gids_[1] = gids_[2];
+    } else if (nents[1]) {
+      std::vector<int> edge_node_offsets(nedges+1);
+      for (int e = 0; e <= nedges; e++)
+        edge_node_offsets[e] = 2*e;
+      global_ids_by_nodes_(edge_node_offsets, edge_node_ids_, nowned_edges,
+                           node_gids, &gids_[1]);
+    }
+  }
+
+  // The flat arrays are as fast to query as the connectivity cache
+
+  Mesh::cache_vars_ = false;
+
+  cache_extra_variables();
+
+  if (Mesh::num_tiles_ini_)
+    Mesh::build_tiles();
+}
+
+
+// Faces and edges from cells
+//----------------------------
+//
+// Cells are added one at a time. A face is found by hashing its sorted
+// nodes and waits in the table of open faces until its second cell is
+// added. Edges are found by their two nodes. Faces start at the node
+// with the smallest key (a global ID if the nodes have them) and go
+// towards the smaller of its two neighbors, and edges start at their
+// node with the smaller key, so a face or edge has the same node order
+// on every rank that has it and the direction of a cell's face only
+// depends on the cell. In 2D the faces of cells are their edges and are
+// built if either is requested
+
+void Mesh_flat::begin_cells_(const int ncells,
+                             const std::vector<Entity_ID> *node_keys,
+                             CellBuilder_ *builder) {
+  builder->node_keys = node_keys;
+  builder->build_faces = faces_requested ||
+      (edges_requested && cell_dimension() == 2);
+  builder->build_edges = edges_requested && cell_dimension() == 3;
+
+  cell_types_.reserve(ncells);
+  cell_node_offsets_.reserve(ncells+1);
+  cell_node_offsets_.assign(1, 0);
+  if (builder->build_faces) {
+    cell_face_offsets_.reserve(ncells+1);
+    cell_face_offsets_.assign(1, 0);
+    face_node_offsets_.assign(1, 0);
+  }
+  if (builder->build_edges) {
+    cell_edge_offsets_.reserve(ncells+1);
+    cell_edge_offsets_.assign(1, 0);
+    if (builder->build_faces)
+      face_edge_offsets_.assign(1, 0);
+  }
+}
+
+
+void Mesh_flat::add_cell_(const ExodusElement& el, const Entity_ID *nodeids,
+                          CellBuilder_ *builder) {
+  Entity_ID const cellid = cell_types_.size();
+  cell_types_.push_back(el.type);
+  cell_node_ids_.insert(cell_node_ids_.end(), nodeids, nodeids + el.nnodes);
+  cell_node_offsets_.push_back(cell_node_ids_.size());
+
+  std::vector<Entity_ID>& sidenodes = builder->sidenodes;
+  std::vector<Entity_ID>& sorted = builder->sorted;
+  std::vector<Entity_ID>& fsorted = builder->fsorted;
+  std::vector<Entity_ID>& celledges = builder->celledges;
+
+  celledges.clear();
+  for (int i = 0; i < el.nsides; i++) {
+    int const nsn = el.sidesize[i];
+    sidenodes.resize(nsn);
+    for (int j = 0; j < nsn; j++)
+      sidenodes[j] = nodeids[el.sidenodes[i][j]];
+
+    if (builder->build_faces) {
+      sorted = sidenodes;
+      std::sort(sorted.begin(), sorted.end());
+      std::uint64_t hash = 14695981039346656037ULL;
+      for (auto const& n : sorted) {
+        hash ^= static_cast<std::uint64_t>(n);
+        hash *= 1099511628211ULL;
+      }
+
+      Entity_ID faceid = -1;
+      auto range = builder->open_faces.equal_range(hash);
+      for (auto it = range.first; it != range.second; ++it) {
+        int f = it->second;
+        fsorted.assign(face_node_ids_.begin() + face_node_offsets_[f],
+                       face_node_ids_.begin() + face_node_offsets_[f+1]);
+        std::sort(fsorted.begin(), fsorted.end());
+        if (fsorted == sorted) {
+          faceid = f;
+          builder->open_faces.erase(it);
+          break;
+        }
+      }
+
+      if (faceid >= 0) {
+        face_cell_ids_[2*faceid+1] = cellid;
+      } else {
+        faceid = face_node_offsets_.size() - 1;
+        int jmin = 0;
+        for (int j = 1; j < nsn; j++)
+          if (builder->key(sidenodes[j]) < builder->key(sidenodes[jmin]))
+            jmin = j;
+        bool const reverse = nsn > 2 &&
+            builder->key(sidenodes[(jmin+nsn-1)%nsn]) <
+            builder->key(sidenodes[(jmin+1)%nsn]);
+        for (int j = 0; j < nsn; j++)
+          face_node_ids_.push_back(sidenodes[(jmin + (reverse ? nsn-j : j))
+                                             % nsn]);
+        face_node_offsets_.push_back(face_node_ids_.size());
+        face_cell_ids_.push_back(cellid);
+        face_cell_ids_.push_back(-1);
+        builder->open_faces.insert(std::make_pair(hash, faceid));
+
+        if (builder->build_edges) {
+          for (int j = 0; j < nsn; j++) {
+            Entity_ID n0 = face_node_ids_[face_node_offsets_[faceid] + j];
+            Entity_ID n1 =
+                face_node_ids_[face_node_offsets_[faceid] + (j+1)%nsn];
+            Entity_ID edgeid = add_edge_(n0, n1, builder);
+            face_edge_ids_.push_back(edgeid);
+            face_edge_dirs_.push_back(edge_node_ids_[2*edgeid] == n0 ? 1 : -1);
+          }
+          face_edge_offsets_.push_back(face_edge_ids_.size());
+        }
+      }
+
+      // The cell's side either runs with the node order of the face
+      // (the face points out of the cell) or against it. An edge has
+      // one node order, a polygon a cyclic one
+      Entity_ID const *fnodes = &(face_node_ids_[face_node_offsets_[faceid]]);
+      int pos = std::find(fnodes, fnodes + nsn, sidenodes[0]) - fnodes;
+      bool const along = (nsn == 2) ? (pos == 0) :
+          (fnodes[(pos+1)%nsn] == sidenodes[1]);
+      cell_face_ids_.push_back(faceid);
+      cell_face_dirs_.push_back(along ? 1 : -1);
+    }
+
+    if (builder->build_edges) {
+      for (int j = 0; j < nsn; j++) {
+        Entity_ID edgeid = add_edge_(sidenodes[j], sidenodes[(j+1)%nsn],
+                                     builder);
+        if (std::find(celledges.begin(), celledges.end(), edgeid) ==
+            celledges.end())
+          celledges.push_back(edgeid);
+      }
+    }
+  }
+
+  if (builder->build_faces)
+    cell_face_offsets_.push_back(cell_face_ids_.size());
+  if (builder->build_edges) {
+    cell_edge_ids_.insert(cell_edge_ids_.end(), celledges.begin(),
+                          celledges.end());
+    cell_edge_offsets_.push_back(cell_edge_ids_.size());
+  }
+}
+
+
+Entity_ID Mesh_flat::add_edge_(Entity_ID n0, Entity_ID n1,
+                               CellBuilder_ *builder) {
+  if (builder->key(n1) < builder->key(n0))
+    std::swap(n0, n1);
+  std::uint64_t hash =
+      (static_cast<std::uint64_t>(std::min(n0, n1)) << 32) |
+      static_cast<std::uint32_t>(std::max(n0, n1));
+  Entity_ID const nedges = edge_node_ids_.size()/2;
+  auto ins = builder->edges.insert(std::make_pair(hash, nedges));
+  if (ins.second) {
+    edge_node_ids_.push_back(n0);
+    edge_node_ids_.push_back(n1);
+  }
+  return ins.first->second;
+}
+
+
+void Mesh_flat::end_cells_(const int nnodes, CellBuilder_ *builder) {
+  std::unordered_multimap<std::uint64_t, Entity_ID>().swap(
+      builder->open_faces);
+  std::unordered_map<std::uint64_t, Entity_ID>().swap(builder->edges);
+
+  int nfaces = builder->build_faces ? face_node_offsets_.size() - 1 : 0;
+  if (edges_requested && cell_dimension() == 2) {
+    cell_edge_offsets_ = cell_face_offsets_;
+    cell_edge_ids_ = cell_face_ids_;
+    cell_edge_dirs_ = cell_face_dirs_;
+    edge_node_ids_ = face_node_ids_;
+    face_edge_offsets_.resize(nfaces+1);
+    face_edge_ids_.resize(nfaces);
+    face_edge_dirs_.assign(nfaces, 1);
+    for (int f = 0; f <= nfaces; f++)
+      face_edge_offsets_[f] = f;
+    for (int f = 0; f < nfaces; f++)
+      face_edge_ids_[f] = f;
+  }
+
+  invert_adjacency_(cell_node_offsets_, cell_node_ids_, nnodes,
+                    &node_cell_offsets_, &node_cell_ids_);
+  if (faces_requested)
+    invert_adjacency_(face_node_offsets_, face_node_ids_, nnodes,
+                      &node_face_offsets_, &node_face_ids_);
+}
+
+
+namespace {
+
+// Rows of a CSR array in a new order - row i of the result is row
+// oldids[i] of the original
+
+template<class T>
+void reorder_rows(std::vector<Entity_ID> const& oldids,
+                  std::vector<int> const& offsets, std::vector<T> *vals,
+                  std::vector<int> *newoffsets) {
+  int nrows = oldids.size();
+  std::vector<T> newvals;
+  newvals.reserve(vals->size());
+  newoffsets->assign(1, 0);
+  for (int i = 0; i < nrows; i++) {
+    int o = oldids[i];
+    newvals.insert(newvals.end(), vals->begin() + offsets[o],
+                   vals->begin() + offsets[o+1]);
+    newoffsets->push_back(newvals.size());
+  }
+  vals->swap(newvals);
+}
+
+// Pairs of values (one pair per row) in a new order
+
+template<class T>
+void reorder_pairs(std::vector<Entity_ID> const& oldids,
+                   std::vector<T> *vals) {
+  int nrows = oldids.size();
+  std::vector<T> newvals(2*nrows);
+  for (int i = 0; i < nrows; i++) {
+    newvals[2*i] = (*vals)[2*oldids[i]];
+    newvals[2*i+1] = (*vals)[2*oldids[i]+1];
+  }
+  vals->swap(newvals);
+}
+
+}  // end anonymous namespace
+
+
+void Mesh_flat::number_owned_first_(const Entity_kind kind,
+                                    const std::vector<bool>& owned,
+                                    int *nowned) {
+  int nents = owned.size();
+  std::vector<Entity_ID> newids(nents), oldids(nents);
+  *nowned = std::count(owned.begin(), owned.end(), true);
+  int nextids[2] = {0, *nowned};
+  for (int i = 0; i < nents; i++) {
+    newids[i] = nextids[owned[i] ? 0 : 1]++;
+    oldids[newids[i]] = i;
+  }
+
+  if (kind == Entity_kind::FACE) {
+    std::vector<int> offsets;
+    reorder_rows(oldids, face_node_offsets_, &face_node_ids_, &offsets);
+    face_node_offsets_.swap(offsets);
+    reorder_pairs(oldids, &face_cell_ids_);
+    if (!face_edge_offsets_.empty()) {
+      reorder_rows(oldids, face_edge_offsets_, &face_edge_dirs_, &offsets);
+      reorder_rows(oldids, face_edge_offsets_, &face_edge_ids_, &offsets);
+      face_edge_offsets_.swap(offsets);
+    }
+    for (auto& f : cell_face_ids_)
+      f = newids[f];
+  } else {
+    reorder_pairs(oldids, &edge_node_ids_);
+    for (auto& e : cell_edge_ids_)
+      e = newids[e];
+    for (auto& e : face_edge_ids_)
+      e = newids[e];
+  }
+}
+
+
+// Global IDs of faces or edges given by their nodes. The owned ones
+// (the first 'nowned') are numbered after those of lower ranks. Owners
+// leave the GIDs at a rendezvous rank picked by hashing the sorted GIDs
+// of the nodes, where the ranks with ghost copies look them up
+
+void Mesh_flat::global_ids_by_nodes_(const std::vector<int>& node_offsets,
+                                     const std::vector<Entity_ID>& nodeids,
+                                     const int nowned,
+                                     const std::vector<Entity_ID>& node_gids,
+                                     std::vector<Entity_ID> *gids) const {
+  MPI_Comm comm = get_comm();
+  int nprocs, rank;
+  MPI_Comm_size(comm, &nprocs);
+  MPI_Comm_rank(comm, &rank);
+
+  int nents = node_offsets.size() - 1;
+  int offset = 0;
+  MPI_Exscan(&nowned, &offset, 1, MPI_INT, MPI_SUM, comm);
+  if (rank == 0) offset = 0;
+
+  gids->resize(nents);
+  for (int i = 0; i < nowned; i++)
+    (*gids)[i] = offset + i;
+
+  // Keys are the sorted node GIDs, padded to a fixed size
+
+  typedef std::array<Entity_ID, 4> Key;
+  auto get_key = [&](int i) {
+    Key key;
+    key.fill(-1);
+    std::transform(nodeids.begin() + node_offsets[i],
+                   nodeids.begin() + node_offsets[i+1], key.begin(),
+                   [&](Entity_ID n) { return node_gids[n]; });
+    std::sort(key.begin(), key.begin() + node_offsets[i+1] - node_offsets[i]);
+    return key;
+  };
+  auto get_rank = [&](Key const& key) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (auto const& g : key) {
+      hash ^= static_cast<std::uint64_t>(g);
+      hash *= 1099511628211ULL;
+    }
+    return static_cast<int>(hash % nprocs);
+  };
+  auto append = [](std::vector<char> *buf, void const *data, int nbytes) {
+    char const *bytes = static_cast<char const *>(data);
+    buf->insert(buf->end(), bytes, bytes + nbytes);
+  };
+
+  std::vector<std::vector<char>> sendbufs(nprocs), recvbufs;
+  for (int i = 0; i < nowned; i++) {
+    Key key = get_key(i);
+    std::vector<char>& buf = sendbufs[get_rank(key)];
+    append(&buf, &(key[0]), sizeof(Key));
+    append(&buf, &((*gids)[i]), sizeof(Entity_ID));
+  }
+  exchange_bytes(comm, sendbufs, &recvbufs);
+
+  std::map<Key, Entity_ID> directory;
+  int const recsize = sizeof(Key) + sizeof(Entity_ID);
+  for (auto const& buf : recvbufs)
+    for (int k = 0; k < buf.size(); k += recsize) {
+      Key key;
+      Entity_ID gid;
+      std::memcpy(&(key[0]), &(buf[k]), sizeof(Key));
+      std::memcpy(&gid, &(buf[k + sizeof(Key)]), sizeof(Entity_ID));
+      directory[key] = gid;
+    }
+
+  std::vector<std::vector<char>> requests(nprocs), received;
+  std::vector<int> ranks(nents);
+  for (int i = nowned; i < nents; i++) {
+    Key key = get_key(i);
+    ranks[i] = get_rank(key);
+    append(&(requests[ranks[i]]), &(key[0]), sizeof(Key));
+  }
+  exchange_bytes(comm, requests, &received);
+
+  std::vector<std::vector<char>> replies(nprocs), answers;
+  for (int p = 0; p < nprocs; p++)
+    for (int k = 0; k < received[p].size(); k += sizeof(Key)) {
+      Key key;
+      std::memcpy(&(key[0]), &(received[p][k]), sizeof(Key));
+      auto it = directory.find(key);
+      Entity_ID gid = (it == directory.end()) ? -1 : it->second;
+      append(&(replies[p]), &gid, sizeof(Entity_ID));
+    }
+  exchange_bytes(comm, replies, &answers);
+
+  // Answers come back in the order of the requests
+
+  int nmissing = 0, nmissing_all = 0;
+  std::vector<int> pos(nprocs, 0);
+  for (int i = nowned; i < nents; i++) {
+    int p = ranks[i];
+    std::memcpy(&((*gids)[i]), &(answers[p][pos[p]]), sizeof(Entity_ID));
+    pos[p] += sizeof(Entity_ID);
+    if ((*gids)[i] < 0) nmissing++;
+  }
+  MPI_Allreduce(&nmissing, &nmissing_all, 1, MPI_INT, MPI_SUM, comm);
+  if (nmissing_all) {
+    Errors::Message mesg("Mesh_flat: ghost faces or edges without an owner "
+                         "- ghost cells must include all cells sharing a "
+                         "node with an owned cell");
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
+
+void Mesh_flat::invert_adjacency_(const std::vector<int>& down_offsets,
+                                  const std::vector<Entity_ID>& down_ids,
+                                  const int nup,
+                                  std::vector<int> *up_offsets,
+                                  std::vector<Entity_ID> *up_ids) {
+  up_offsets->assign(nup+1, 0);
+  for (auto const& id : down_ids)
+    (*up_offsets)[id+1]++;
+  for (int i = 0; i < nup; i++)
+    (*up_offsets)[i+1] += (*up_offsets)[i];
+
+  std::vector<int> pos(up_offsets->begin(), up_offsets->end() - 1);
+  up_ids->resize(down_ids.size());
+  int ndown = down_offsets.size() - 1;
+  for (int i = 0; i < ndown; i++)
+    for (int k = down_offsets[i]; k < down_offsets[i+1]; k++)
+      (*up_ids)[pos[down_ids[k]]++] = i;
+}
+
+
+// Snapshots
+//----------
+//
+// A snapshot is a header followed by arrays, each stored as a 64 bit
+// element count and the raw elements padded to a multiple of 8 bytes
+
+namespace {
+
+std::uint32_t const snapshot_version = 1;
+char const snapshot_magic[8] = {'J', 'A', 'L', 'I', 'F', 'L', 'A', 'T'};
+
+struct SnapshotHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t endian;  // 0x01020304 as written
+  std::uint64_t key;
+  std::int32_t rank, nprocs;
+  std::int32_t spacedim, celldim, mesh_type, geom_type;
+  std::int32_t faces, edges;
+  std::int32_t id_size, dir_size, celltype_size;
+};
+
+bool header_matches(const SnapshotHeader& header, const std::uint64_t key,
+                    const MPI_Comm& comm) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+  return (std::equal(snapshot_magic, snapshot_magic + 8, header.magic) &&
+          header.version == snapshot_version &&
+          header.endian == 0x01020304 && header.key == key &&
+          header.rank == rank && header.nprocs == nprocs &&
+          header.id_size == sizeof(Entity_ID) &&
+          header.dir_size == sizeof(dir_t) &&
+          header.celltype_size == sizeof(Cell_type));
+}
+
+std::size_t padded(const std::size_t nbytes) {
+  return (nbytes + 7)/8*8;
+}
+
+// Appends arrays to a snapshot
+
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(std::ostream& os) : os_(os) {}
+
+  template<class T>
+  void operator()(std::vector<T>& v) {
+    std::uint64_t n = v.size();
+    os_.write(reinterpret_cast<char const *>(&n), sizeof(n));
+    os_.write(reinterpret_cast<char const *>(v.data()), n*sizeof(T));
+    char const zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    os_.write(zeros, padded(n*sizeof(T)) - n*sizeof(T));
+  }
+
+  void operator()(std::map<std::string, std::array<Entity_ID_List, 2>>&
+                  sets) {
+    std::vector<std::uint64_t> nsets(1, sets.size());
+    (*this)(nsets);
+    for (auto& set : sets) {
+      std::vector<char> name(set.first.begin(), set.first.end());
+      (*this)(name);
+      (*this)(set.second[0]);
+      (*this)(set.second[1]);
+    }
+  }
+
+ private:
+  std::ostream& os_;
+};
+
+// Reads arrays from a snapshot in memory (stops at the first array
+// that does not fit in what is left of the snapshot)
+
+class SnapshotReader {
+ public:
+  SnapshotReader(char const *begin, char const *end) :
+      pos_(begin), end_(end), ok_(true) {}
+
+  bool ok() const { return ok_; }
+
+  template<class T>
+  void operator()(std::vector<T>& v) {
+    std::uint64_t n = 0;
+    if (ok_ && end_ - pos_ >= static_cast<std::ptrdiff_t>(sizeof(n))) {
+      std::memcpy(&n, pos_, sizeof(n));
+      pos_ += sizeof(n);
+    } else {
+      ok_ = false;
+    }
+    if (ok_ && static_cast<std::uint64_t>(end_ - pos_)/sizeof(T) >= n) {
+      v.resize(n);
+      std::memcpy(v.data(), pos_, n*sizeof(T));
+      pos_ += std::min(padded(n*sizeof(T)),
+                       static_cast<std::size_t>(end_ - pos_));
+    } else {
+      ok_ = false;
+      v.clear();
+    }
+  }
+
+  void operator()(std::map<std::string, std::array<Entity_ID_List, 2>>&
+                  sets) {
+    sets.clear();
+    std::vector<std::uint64_t> nsets;
+    (*this)(nsets);
+    if (nsets.size() != 1) ok_ = false;
+    for (std::uint64_t i = 0; ok_ && i < nsets[0]; i++) {
+      std::vector<char> name;
+      (*this)(name);
+      std::array<Entity_ID_List, 2>& set =
+          sets[std::string(name.begin(), name.end())];
+      (*this)(set[0]);
+      (*this)(set[1]);
+    }
+  }
+
+ private:
+  char const *pos_, *end_;
+  bool ok_;
+};
+
+}  // end anonymous namespace
+
+
+template<class Archive>
+void Mesh_flat::snapshot_arrays_(Archive& ar) {
+  ar(nodeids_owned_); ar(nodeids_ghost_); ar(nodeids_all_);
+  ar(edgeids_owned_); ar(edgeids_ghost_); ar(edgeids_all_);
+  ar(faceids_owned_); ar(faceids_ghost_); ar(faceids_all_);
+  ar(cellids_owned_); ar(cellids_ghost_); ar(cellids_boundary_ghost_);
+  ar(cellids_all_);
+
+  for (int d = 0; d < 3; d++)
+    ar(coords_[d]);
+  ar(cell_types_);
+  for (int k = 0; k < 4; k++)
+    ar(gids_[k]);
+
+  ar(cell_face_offsets_); ar(cell_face_ids_); ar(cell_face_dirs_);
+  ar(cell_node_offsets_); ar(cell_node_ids_);
+  ar(face_node_offsets_); ar(face_node_ids_);
+  ar(cell_edge_offsets_); ar(cell_edge_ids_); ar(cell_edge_dirs_);
+  ar(face_edge_offsets_); ar(face_edge_ids_); ar(face_edge_dirs_);
+  ar(edge_node_ids_);
+  ar(face_cell_ids_);
+  ar(node_cell_offsets_); ar(node_cell_ids_);
+  ar(node_face_offsets_); ar(node_face_ids_);
+
+  ar(labeled_sets_);
+}
+
+
+Mesh_flat::Mesh_flat(const std::string& snapshot, const std::uint64_t key,
+                     const MPI_Comm& comm,
+                     const JaliGeometry::GeometricModelPtr& gm,
+                     const bool request_faces,
+                     const bool request_edges,
+                     const bool request_sides,
+                     const bool request_wedges,
+                     const bool request_corners,
+                     const int num_tiles_ini,
+                     const int num_ghost_layers_tile,
+                     const int num_ghost_layers_distmesh,
+                     const bool request_boundary_ghosts,
+                     const Partitioner_type partitioner,
+                     const JaliGeometry::Geom_type geom_type) :
+    Mesh(request_faces, request_edges, request_sides, request_wedges,
+         request_corners, num_tiles_ini, num_ghost_layers_tile,
+         num_ghost_layers_distmesh, request_boundary_ghosts, partitioner,
+         geom_type, comm) {
+
+  bool ok = false;
+  SnapshotHeader header;
+
+  int fd = open(snapshot.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 &&
+      st.st_size >= static_cast<off_t>(sizeof(header))) {
+    std::size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      char const *begin = static_cast<char const *>(map);
+      std::memcpy(&header, begin, sizeof(header));
+      if (header_matches(header, key, comm) &&
+          header.faces == faces_requested && header.edges == edges_requested &&
+          header.geom_type == static_cast<int>(geom_type)) {
+        SnapshotReader reader(begin + sizeof(header), begin + size);
+        snapshot_arrays_(reader);
+        ok = reader.ok();
+      }
+      munmap(map, size);
+    }
+  }
+  if (fd >= 0) close(fd);
+
+  // Fail on every rank if one rank failed, before any collective
+  // calls made while building the mesh
+
+  int ok_all = ok ? 1 : 0;
+  MPI_Allreduce(MPI_IN_PLACE, &ok_all, 1, MPI_INT, MPI_MIN, comm);
+  if (!ok) {
+    Errors::Message mesg("Mesh_flat: snapshot " + snapshot + " is missing, "
+                         "corrupt or was written for another run");
+    Exceptions::Jali_throw(mesg);
+  } else if (!ok_all) {
+    Errors::Message mesg("Mesh_flat: snapshot of another rank is missing, "
+                         "corrupt or was written for another run");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  set_space_dimension(header.spacedim);
+  set_cell_dimension(header.celldim);
+  set_mesh_type(static_cast<Mesh_type>(header.mesh_type));
+  set_geometric_model(gm);
+
+  // The flat arrays are as fast to query as the connectivity cache
+
+  Mesh::cache_vars_ = false;
+
+  cache_extra_variables();
+
+  if (Mesh::num_tiles_ini_)
+    Mesh::build_tiles();
+}
+
+
+bool Mesh_flat::write_snapshot(const std::string& snapshot,
+                               const std::uint64_t key) const {
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::copy(snapshot_magic, snapshot_magic + 8, header.magic);
+  header.version = snapshot_version;
+  header.endian = 0x01020304;
+  header.key = key;
+  MPI_Comm_rank(get_comm(), &header.rank);
+  MPI_Comm_size(get_comm(), &header.nprocs);
+  header.spacedim = space_dimension();
+  header.celldim = cell_dimension();
+  header.mesh_type = static_cast<int>(mesh_type());
+  header.geom_type = static_cast<int>(geom_type());
+  header.faces = faces_requested;
+  header.edges = edges_requested;
+  header.id_size = sizeof(Entity_ID);
+  header.dir_size = sizeof(dir_t);
+  header.celltype_size = sizeof(Cell_type);
+
+  std::string tmpname = snapshot + ".tmp";
+  {
+    std::ofstream os(tmpname, std::ios::binary);
+    if (!os) return false;
+    os.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    SnapshotWriter writer(os);
+    const_cast<Mesh_flat *>(this)->snapshot_arrays_(writer);
+    if (!os) {
+      os.close();
+      std::remove(tmpname.c_str());
+      return false;
+    }
+  }
+  return std::rename(tmpname.c_str(), snapshot.c_str()) == 0;
+}
+
+
+bool Mesh_flat::snapshot_matches(const std::string& snapshot,
+                                 const std::uint64_t key,
+                                 const MPI_Comm& comm) {
+  SnapshotHeader header;
+  std::ifstream is(snapshot, std::ios::binary);
+  return (is.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+          header_matches(header, key, comm));
+}
+
+
+template<class F>
+void Mesh_flat::copy_adjacency_(const int nent, F get_adjacent,
+                                std::vector<int> *offsets,
+                                std::vector<Entity_ID> *ids) {
+  Entity_ID_List adjids;
+  offsets->resize(nent+1);
+  (*offsets)[0] = 0;
+  ids->clear();
+  for (int i = 0; i < nent; i++) {
+    get_adjacent(i, &adjids);
+    ids->insert(ids->end(), adjids.begin(), adjids.end());
+    (*offsets)[i+1] = ids->size();
+  }
+  ids->shrink_to_fit();
+}
+
+
+void Mesh_flat::get_csr_entities_(const std::vector<int>& offsets,
+                                  const std::vector<Entity_ID>& ids,
+                                  const int i, const Entity_kind kind,
+                                  const Entity_type ptype,
+                                  Entity_ID_List *entids) const {
+  auto begin = ids.begin() + offsets[i];
+  auto end = ids.begin() + offsets[i+1];
+  if (ptype == Entity_type::ALL) {
+    entids->assign(begin, end);
+  } else {
+    entids->clear();
+    for (auto it = begin; it != end; ++it)
+      if (entity_get_type(kind, *it) == ptype)
+        entids->push_back(*it);
+  }
+}
+
+
+Entity_ID Mesh_flat::GID(const Entity_ID lid, const Entity_kind kind) const {
+  int k;
+  switch (kind) {
+    case Entity_kind::NODE: k = 0; break;
+    case Entity_kind::EDGE: k = 1; break;
+    case Entity_kind::FACE: k = 2; break;
+    case Entity_kind::CELL: k = 3; break;
+    default:
+      std::cerr << "Global ID requested for unknown entity type" << std::endl;
+      return lid;
+  }
+  return gids_[k].empty() ? lid : gids_[k][lid];
+}
+
+
+std::size_t Mesh_flat::memory_used() const {
+  std::size_t nbytes = 0;
+  for (int d = 0; d < 3; d++)
+    nbytes += coords_[d].capacity()*sizeof(double);
+  for (int k = 0; k < 4; k++)
+    nbytes += gids_[k].capacity()*sizeof(Entity_ID);
+  nbytes += cell_types_.capacity()*sizeof(Cell_type);
+
+  for (auto const *offsets : {&cell_face_offsets_, &cell_node_offsets_,
+          &face_node_offsets_, &cell_edge_offsets_, &face_edge_offsets_,
+          &node_cell_offsets_, &node_face_offsets_})
+    nbytes += offsets->capacity()*sizeof(int);
+  for (auto const *ids : {&cell_face_ids_, &cell_node_ids_, &face_node_ids_,
+          &cell_edge_ids_, &face_edge_ids_, &edge_node_ids_, &face_cell_ids_,
+          &node_cell_ids_, &node_face_ids_})
+    nbytes += ids->capacity()*sizeof(Entity_ID);
+  for (auto const *dirs : {&cell_face_dirs_, &cell_edge_dirs_,
+          &face_edge_dirs_})
+    nbytes += dirs->capacity()*sizeof(dir_t);
+  return nbytes;
+}
+
+
+// Downward adjacencies
+//---------------------
+
+void Mesh_flat::cell_get_faces_and_dirs_internal(const Entity_ID cellid,
+                                                 Entity_ID_List *faceids,
+                                                 std::vector<dir_t> *face_dirs,
+                                                 const bool ordered) const {
+  int begin = cell_face_offsets_[cellid], end = cell_face_offsets_[cellid+1];
+  faceids->assign(cell_face_ids_.begin() + begin,
+                  cell_face_ids_.begin() + end);
+  if (face_dirs)
+    face_dirs->assign(cell_face_dirs_.begin() + begin,
+                      cell_face_dirs_.begin() + end);
+}
+
+
+void Mesh_flat::cell_get_nodes(const Entity_ID cellid,
+                               Entity_ID_List *nodeids) const {
+  nodeids->assign(cell_node_ids_.begin() + cell_node_offsets_[cellid],
+                  cell_node_ids_.begin() + cell_node_offsets_[cellid+1]);
+}
+
+
+void Mesh_flat::face_get_nodes(const Entity_ID faceid,
+                               Entity_ID_List *nodeids) const {
+  nodeids->assign(face_node_ids_.begin() + face_node_offsets_[faceid],
+                  face_node_ids_.begin() + face_node_offsets_[faceid+1]);
+}
+
+
+void Mesh_flat::cell_get_edges_internal(const Entity_ID cellid,
+                                        Entity_ID_List *edgeids) const {
+  edgeids->assign(cell_edge_ids_.begin() + cell_edge_offsets_[cellid],
+                  cell_edge_ids_.begin() + cell_edge_offsets_[cellid+1]);
+}
+
+
+void Mesh_flat::cell_2D_get_edges_and_dirs_internal(const Entity_ID cellid,
+                                                    Entity_ID_List *edgeids,
+                                                    std::vector<dir_t>
+                                                    *edge_dirs) const {
+  int begin = cell_edge_offsets_[cellid], end = cell_edge_offsets_[cellid+1];
+  edgeids->assign(cell_edge_ids_.begin() + begin,
+                  cell_edge_ids_.begin() + end);
+  if (edge_dirs)
+    edge_dirs->assign(cell_edge_dirs_.begin() + begin,
+                      cell_edge_dirs_.begin() + end);
+}
+
+
+void Mesh_flat::face_get_edges_and_dirs_internal(const Entity_ID faceid,
+                                                 Entity_ID_List *edgeids,
+                                                 std::vector<dir_t> *edge_dirs,
+                                                 const bool ordered) const {
+  int begin = face_edge_offsets_[faceid], end = face_edge_offsets_[faceid+1];
+  edgeids->assign(face_edge_ids_.begin() + begin,
+                  face_edge_ids_.begin() + end);
+  if (edge_dirs)
+    edge_dirs->assign(face_edge_dirs_.begin() + begin,
+                      face_edge_dirs_.begin() + end);
+}
+
+
+void Mesh_flat::edge_get_nodes_internal(const Entity_ID edgeid,
+                                        Entity_ID *enode0,
+                                        Entity_ID *enode1) const {
+  *enode0 = edge_node_ids_[2*edgeid];
+  *enode1 = edge_node_ids_[2*edgeid+1];
+}
+
+
+// Upward and same level adjacencies
+//----------------------------------
+
+void Mesh_flat::face_get_cells_internal(const Entity_ID faceid,
+                                        const Entity_type ptype,
+                                        Entity_ID_List *cellids) const {
+  cellids->clear();
+  for (int i = 0; i < 2; i++) {
+    Entity_ID c = face_cell_ids_[2*faceid+i];
+    if (c != -1 && (ptype == Entity_type::ALL ||
+                    entity_get_type(Entity_kind::CELL, c) == ptype))
+      cellids->push_back(c);
+  }
+}
+
+
+void Mesh_flat::node_get_cells(const Entity_ID nodeid,
+                               const Entity_type ptype,
+                               Entity_ID_List *cellids) const {
+  get_csr_entities_(node_cell_offsets_, node_cell_ids_, nodeid,
+                    Entity_kind::CELL, ptype, cellids);
+}
+
+
+void Mesh_flat::node_get_faces(const Entity_ID nodeid,
+                               const Entity_type ptype,
+                               Entity_ID_List *faceids) const {
+  get_csr_entities_(node_face_offsets_, node_face_ids_, nodeid,
+                    Entity_kind::FACE, ptype, faceids);
+}
+
+
+void Mesh_flat::node_get_cell_faces(const Entity_ID nodeid,
+                                    const Entity_ID cellid,
+                                    const Entity_type ptype,
+                                    Entity_ID_List *faceids) const {
+  faceids->clear();
+  for (int i = cell_face_offsets_[cellid]; i < cell_face_offsets_[cellid+1];
+       i++) {
+    Entity_ID f = cell_face_ids_[i];
+    if (ptype != Entity_type::ALL &&
+        entity_get_type(Entity_kind::FACE, f) != ptype)
+      continue;
+    auto fbegin = face_node_ids_.begin() + face_node_offsets_[f];
+    auto fend = face_node_ids_.begin() + face_node_offsets_[f+1];
+    if (std::find(fbegin, fend, nodeid) != fend)
+      faceids->push_back(f);
+  }
+}
+
+
+void Mesh_flat::cell_get_face_adj_cells(const Entity_ID cellid,
+                                        const Entity_type ptype,
+                                        Entity_ID_List *fadj_cellids) const {
+  fadj_cellids->clear();
+  for (int i = cell_face_offsets_[cellid]; i < cell_face_offsets_[cellid+1];
+       i++) {
+    Entity_ID f = cell_face_ids_[i];
+    Entity_ID c = face_cell_ids_[2*f];
+    if (c == cellid) c = face_cell_ids_[2*f+1];
+    if (c != -1 && (ptype == Entity_type::ALL ||
+                    entity_get_type(Entity_kind::CELL, c) == ptype))
+      fadj_cellids->push_back(c);
+  }
+}
+
+
+void Mesh_flat::cell_get_node_adj_cells(const Entity_ID cellid,
+                                        const Entity_type ptype,
+                                        Entity_ID_List *nadj_cellids) const {
+  nadj_cellids->clear();
+  for (int i = cell_node_offsets_[cellid]; i < cell_node_offsets_[cellid+1];
+       i++) {
+    Entity_ID n = cell_node_ids_[i];
+    for (int j = node_cell_offsets_[n]; j < node_cell_offsets_[n+1]; j++) {
+      Entity_ID c = node_cell_ids_[j];
+      if (c == cellid ||
+          (ptype != Entity_type::ALL &&
+           entity_get_type(Entity_kind::CELL, c) != ptype))
+        continue;
+      if (std::find(nadj_cellids->begin(), nadj_cellids->end(), c) ==
+          nadj_cellids->end())
+        nadj_cellids->push_back(c);
+    }
+  }
+}
+
+
+// Geometry
+//---------
+
+void Mesh_flat::node_get_coordinates(const Entity_ID nodeid,
+                                     JaliGeometry::Point *ncoord) const {
+  int spdim = space_dimension();
+  if (spdim == 3)
+    ncoord->set(coords_[0][nodeid], coords_[1][nodeid], coords_[2][nodeid]);
+  else if (spdim == 2)
+    ncoord->set(coords_[0][nodeid], coords_[1][nodeid]);
+  else
+    ncoord->set(coords_[0][nodeid]);
+}
+
+void Mesh_flat::node_get_coordinates(const Entity_ID nodeid,
+                                     std::array<double, 3> *ncoord) const {
+  assert(space_dimension() == 3);
+  (*ncoord)[0] = coords_[0][nodeid];
+  (*ncoord)[1] = coords_[1][nodeid];
+  (*ncoord)[2] = coords_[2][nodeid];
+}
+
+void Mesh_flat::node_get_coordinates(const Entity_ID nodeid,
+                                     std::array<double, 2> *ncoord) const {
+  assert(space_dimension() == 2);
+  (*ncoord)[0] = coords_[0][nodeid];
+  (*ncoord)[1] = coords_[1][nodeid];
+}
+
+void Mesh_flat::node_get_coordinates(const Entity_ID nodeid,
+                                     double *ncoord) const {
+  assert(space_dimension() == 1);
+  *ncoord = coords_[0][nodeid];
+}
+
+
+void Mesh_flat::face_get_coordinates(const Entity_ID faceid,
+                                     std::vector<JaliGeometry::Point>
+                                     *fcoords) const {
+  fcoords->clear();
+  JaliGeometry::Point xyz(space_dimension());
+  for (int i = face_node_offsets_[faceid]; i < face_node_offsets_[faceid+1];
+       i++) {
+    node_get_coordinates(face_node_ids_[i], &xyz);
+    fcoords->push_back(xyz);
+  }
+}
+
+
+void Mesh_flat::cell_get_coordinates(const Entity_ID cellid,
+                                     std::vector<JaliGeometry::Point>
+                                     *ccoords) const {
+  ccoords->clear();
+  JaliGeometry::Point xyz(space_dimension());
+  for (int i = cell_node_offsets_[cellid]; i < cell_node_offsets_[cellid+1];
+       i++) {
+    node_get_coordinates(cell_node_ids_[i], &xyz);
+    ccoords->push_back(xyz);
+  }
+}
+
+
+void Mesh_flat::node_set_coordinates(const Entity_ID nodeid,
+                                     const JaliGeometry::Point coords) {
+  check_not_frozen("Mesh_flat::node_set_coordinates");
+  for (int d = 0; d < space_dimension(); d++)
+    coords_[d][nodeid] = coords[d];
+
+  node_coordinates_changed();
+}
+
+void Mesh_flat::node_set_coordinates(const Entity_ID nodeid,
+                                     const double *coords) {
+  check_not_frozen("Mesh_flat::node_set_coordinates");
+  ASSERT(coords != NULL);
+  for (int d = 0; d < space_dimension(); d++)
+    coords_[d][nodeid] = coords[d];
+
+  node_coordinates_changed();
+}
+
+
+void Mesh_flat::get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr
+                                         r,
+                                         const Entity_kind kind,
+                                         Entity_ID_List *owned_entities,
+                                         Entity_ID_List *ghost_entities) const {
+  owned_entities->clear();
+  ghost_entities->clear();
+
+  auto it = labeled_sets_.find(r->name());
+  if (it != labeled_sets_.end()) {
+    *owned_entities = it->second[0];
+    *ghost_entities = it->second[1];
+  }
+}
+
+}  // end namespace Jali
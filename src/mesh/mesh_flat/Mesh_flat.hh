@@ -0,0 +1,416 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _JALI_MESH_FLAT_H_
+#define _JALI_MESH_FLAT_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mpi.h"
+
+#include "Mesh.hh"
+#include "LabeledSetRegion.hh"
+#include "errors.hh"
+
+namespace Jali {
+
+struct ExodusElement;
+
+// A mesh framework that stores its topology in flat compressed row
+// (CSR) arrays - an offsets array and an IDs array for each
+// adjacency - and its node coordinates as one array per coordinate
+// direction.
+//
+// A Mesh_flat is built from a mesh of any other framework (for
+// example one read from a file by MSTK) keeping its entity IDs, GIDs,
+// parallel types and labeled sets. The source mesh can be released
+// afterwards. Since the flat arrays are as fast to query as the
+// cached connectivity of the base class, cell-face connectivity is
+// not cached a second time.
+//
+// A serial Mesh_flat can also be read directly from an Exodus II file,
+// building the flat arrays as the element blocks stream in, and any
+// Mesh_flat can be built from the nodes of its cells alone, deriving
+// its faces and edges by hashing.
+//
+// The arrays of each rank can be written to a binary snapshot file
+// and a Mesh_flat loaded from it in later runs, skipping the import
+// and processing of the source mesh.
+
+class Mesh_flat : public virtual Mesh {
+ public:
+
+  // Build a flat copy of 'inmesh' (which must have faces and edges
+  // if they or sides, wedges or corners are requested). The labeled
+  // sets of the geometric model of inmesh are built on inmesh to be
+  // copied. The remaining arguments are as for other frameworks
+  Mesh_flat(const std::shared_ptr<Mesh> inmesh,
+            const bool request_faces = true,
+            const bool request_edges = false,
+            const bool request_sides = false,
+            const bool request_wedges = false,
+            const bool request_corners = false,
+            const int num_tiles_ini = 0,
+            const int num_ghost_layers_tile = 0,
+            const int num_ghost_layers_distmesh = 1,
+            const bool request_boundary_ghosts = false,
+            const Partitioner_type partitioner = Partitioner_type::METIS);
+
+  // Read a mesh from an Exodus II file (on a single rank) without
+  // building it in another framework first. Element blocks are read
+  // in chunks of 'chunk_size' elements and their faces (and edges if
+  // requested) are found through hash tables as the chunks come in,
+  // so the memory needed beyond the final arrays is one chunk and
+  // the tables. Faces leave their table once their second cell is
+  // read. Only blocks of linear triangles, quads, tets, prisms,
+  // pyramids and hexes are supported. Element blocks and element,
+  // side and node sets are the labeled sets of the mesh
+  Mesh_flat(const std::string& filename, const MPI_Comm& comm,
+            const JaliGeometry::GeometricModelPtr& gm =
+            (JaliGeometry::GeometricModelPtr) NULL,
+            const bool request_faces = true,
+            const bool request_edges = false,
+            const bool request_sides = false,
+            const bool request_wedges = false,
+            const bool request_corners = false,
+            const int num_tiles_ini = 0,
+            const int num_ghost_layers_tile = 0,
+            const int num_ghost_layers_distmesh = 1,
+            const bool request_boundary_ghosts = false,
+            const Partitioner_type partitioner = Partitioner_type::METIS,
+            const JaliGeometry::Geom_type geom_type =
+            JaliGeometry::Geom_type::CARTESIAN,
+            const int chunk_size = 65536);
+
+  // Build a mesh from its nodes and the nodes of its cells alone (for
+  // example the partition of a mesh held by an application), without
+  // another framework. Faces and edges are found by hashing the nodes
+  // of cell sides. Node i is at coords[space_dim*i] and up, and cells
+  // are linear triangles, quads, tets, prisms, pyramids or hexes with
+  // their nodes in Exodus II order. The first num_owned_nodes nodes
+  // and num_owned_cells cells are owned. In parallel, the ghost cells
+  // must include every cell sharing a node with an owned cell; a face
+  // or edge is then owned by the owner of the cell with the lowest GID
+  // around it and has the same node order and GID on all ranks
+  Mesh_flat(const int space_dim, const std::vector<double>& coords,
+            const std::vector<Entity_ID>& node_gids,
+            const int num_owned_nodes,
+            const std::vector<Cell_type>& cell_types,
+            const std::vector<int>& cell_node_offsets,
+            const std::vector<Entity_ID>& cell_node_ids,
+            const std::vector<Entity_ID>& cell_gids,
+            const int num_owned_cells,
+            const MPI_Comm& comm,
+            const JaliGeometry::GeometricModelPtr& gm =
+            (JaliGeometry::GeometricModelPtr) NULL,
+            const bool request_faces = true,
+            const bool request_edges = false,
+            const bool request_sides = false,
+            const bool request_wedges = false,
+            const bool request_corners = false,
+            const int num_tiles_ini = 0,
+            const int num_ghost_layers_tile = 0,
+            const int num_ghost_layers_distmesh = 1,
+            const bool request_boundary_ghosts = false,
+            const Partitioner_type partitioner = Partitioner_type::METIS,
+            const JaliGeometry::Geom_type geom_type =
+            JaliGeometry::Geom_type::CARTESIAN);
+
+  // Load the mesh of this rank from a snapshot written by
+  // write_snapshot with the same key on the same rank of a
+  // communicator of the same size, with the same requests for faces
+  // and edges and the same geometry type. Sides, wedges, corners,
+  // tiles and geometric quantities are rebuilt. The file is mapped
+  // into memory and the arrays are copied out of the mapping. Throws
+  // on all ranks if the snapshot of any rank cannot be loaded
+  Mesh_flat(const std::string& snapshot, const std::uint64_t key,
+            const MPI_Comm& comm,
+            const JaliGeometry::GeometricModelPtr& gm =
+            (JaliGeometry::GeometricModelPtr) NULL,
+            const bool request_faces = true,
+            const bool request_edges = false,
+            const bool request_sides = false,
+            const bool request_wedges = false,
+            const bool request_corners = false,
+            const int num_tiles_ini = 0,
+            const int num_ghost_layers_tile = 0,
+            const int num_ghost_layers_distmesh = 1,
+            const bool request_boundary_ghosts = false,
+            const Partitioner_type partitioner = Partitioner_type::METIS,
+            const JaliGeometry::Geom_type geom_type =
+            JaliGeometry::Geom_type::CARTESIAN);
+
+  virtual ~Mesh_flat() {}
+
+  // Write the arrays, entity lists and labeled sets of this rank to a
+  // versioned binary snapshot tagged with 'key' (e.g. a hash of the
+  // input file and the mesh options). The snapshot is written under a
+  // temporary name and renamed once complete. Returns false if it
+  // could not be written
+  bool write_snapshot(const std::string& snapshot,
+                      const std::uint64_t key) const;
+
+  // Whether 'snapshot' was written by this rank of a communicator of
+  // this size with 'key' and the current snapshot version
+  static bool snapshot_matches(const std::string& snapshot,
+                               const std::uint64_t key,
+                               const MPI_Comm& comm);
+
+  // Get cell type
+  Cell_type cell_get_type(const Entity_ID cellid) const {
+    return cell_types_[cellid];
+  }
+
+  // Global ID of any entity
+  Entity_ID GID(const Entity_ID lid, const Entity_kind kind) const;
+
+  // Approximate memory (in bytes) used by the flat arrays
+  std::size_t memory_used() const;
+
+  //
+  // Mesh Entity Adjacencies
+  //-------------------------
+
+  // Nodes of a cell (in the order of the source mesh - standard
+  // Exodus II order for standard cells)
+  void cell_get_nodes(const Entity_ID cellid, Entity_ID_List *nodeids) const;
+
+  // Nodes of a face (ccw with respect to the face normal in 3D)
+  void face_get_nodes(const Entity_ID faceid, Entity_ID_List *nodeids) const;
+
+  // Cells of type 'ptype' connected to a node
+  void node_get_cells(const Entity_ID nodeid, const Entity_type ptype,
+                      Entity_ID_List *cellids) const;
+
+  // Faces of type 'ptype' connected to a node
+  void node_get_faces(const Entity_ID nodeid, const Entity_type ptype,
+                      Entity_ID_List *faceids) const;
+
+  // Faces of type 'ptype' of a cell connected to a node
+  void node_get_cell_faces(const Entity_ID nodeid, const Entity_ID cellid,
+                           const Entity_type ptype,
+                           Entity_ID_List *faceids) const;
+
+  // Face connected neighboring cells of a cell
+  void cell_get_face_adj_cells(const Entity_ID cellid, const Entity_type ptype,
+                               Entity_ID_List *fadj_cellids) const;
+
+  // Node connected neighboring cells of a cell
+  void cell_get_node_adj_cells(const Entity_ID cellid, const Entity_type ptype,
+                               Entity_ID_List *nadj_cellids) const;
+
+  //
+  // Mesh entity geometry
+  //---------------------
+
+  void node_get_coordinates(const Entity_ID nodeid,
+                            JaliGeometry::Point *ncoord) const;
+  void node_get_coordinates(const Entity_ID nodeid,
+                            std::array<double, 3> *ncoord) const;
+  void node_get_coordinates(const Entity_ID nodeid,
+                            std::array<double, 2> *ncoord) const;
+  void node_get_coordinates(const Entity_ID nodeid, double *ncoord) const;
+
+  void face_get_coordinates(const Entity_ID faceid,
+                            std::vector<JaliGeometry::Point> *fcoords) const;
+
+  void cell_get_coordinates(const Entity_ID cellid,
+                            std::vector<JaliGeometry::Point> *ccoords) const;
+
+  void node_set_coordinates(const Entity_ID nodeid,
+                            const JaliGeometry::Point coords);
+
+  void node_set_coordinates(const Entity_ID nodeid, const double *coords);
+
+ protected:
+
+  void get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr r,
+                                const Entity_kind kind,
+                                Entity_ID_List *owned_entities,
+                                Entity_ID_List *ghost_entities) const;
+
+ private:
+
+  // Copy the IDs of an adjacency of every entity of a kind into CSR
+  // arrays
+  template<class F>
+  void copy_adjacency_(const int nent, F get_adjacent,
+                       std::vector<int> *offsets,
+                       std::vector<Entity_ID> *ids);
+
+  // Tables used while cells are added by add_cell_ - faces waiting for
+  // their second cell and edges, keyed by hashes of their nodes
+  struct CellBuilder_ {
+    std::unordered_multimap<std::uint64_t, Entity_ID> open_faces;
+    std::unordered_map<std::uint64_t, Entity_ID> edges;
+    const std::vector<Entity_ID> *node_keys;  // node IDs if NULL
+    bool build_faces, build_edges;
+    std::vector<Entity_ID> sidenodes, sorted, fsorted, celledges;
+
+    Entity_ID key(const Entity_ID n) const {
+      return node_keys ? (*node_keys)[n] : n;
+    }
+  };
+
+  // Start adding cells (about 'ncells' of them). Faces and edges are
+  // oriented by the 'node_keys' of their nodes
+  void begin_cells_(const int ncells,
+                    const std::vector<Entity_ID> *node_keys,
+                    CellBuilder_ *builder);
+
+  // Add a cell of type 'el' with nodes 'nodeids' (in Exodus order),
+  // creating the faces and edges it does not share with earlier cells
+  void add_cell_(const ExodusElement& el, const Entity_ID *nodeids,
+                 CellBuilder_ *builder);
+
+  // Edge between two nodes, created if it is not there yet
+  Entity_ID add_edge_(Entity_ID n0, Entity_ID n1, CellBuilder_ *builder);
+
+  // Finish the connectivity after the last cell of a mesh with 'nnodes'
+  // nodes
+  void end_cells_(const int nnodes, CellBuilder_ *builder);
+
+  // Renumber the faces or edges (kind FACE or EDGE) so that the owned
+  // ones come first, keeping their order otherwise
+  void number_owned_first_(const Entity_kind kind,
+                           const std::vector<bool>& owned, int *nowned);
+
+  // Global IDs of faces or edges with nodes 'nodeids' (in CSR form),
+  // the first 'nowned' of them owned
+  void global_ids_by_nodes_(const std::vector<int>& node_offsets,
+                            const std::vector<Entity_ID>& nodeids,
+                            const int nowned,
+                            const std::vector<Entity_ID>& node_gids,
+                            std::vector<Entity_ID> *gids) const;
+
+  // Build the upward adjacency 'up' (of nup entities) in CSR form
+  // from the downward adjacency 'down'
+  void invert_adjacency_(const std::vector<int>& down_offsets,
+                         const std::vector<Entity_ID>& down_ids,
+                         const int nup, std::vector<int> *up_offsets,
+                         std::vector<Entity_ID> *up_ids);
+
+  // Apply 'ar' to each array kept in a snapshot, in snapshot order
+  template<class Archive>
+  void snapshot_arrays_(Archive& ar);
+
+  // Copy the list of entities between offsets[i] and offsets[i+1]
+  // restricted to entities of type 'ptype' (owned entities of each
+  // kind are not necessarily numbered first in the source mesh)
+  void get_csr_entities_(const std::vector<int>& offsets,
+                         const std::vector<Entity_ID>& ids, const int i,
+                         const Entity_kind kind, const Entity_type ptype,
+                         Entity_ID_List *entids) const;
+
+  void cell_get_faces_and_dirs_internal(const Entity_ID cellid,
+                                        Entity_ID_List *faceids,
+                                        std::vector<dir_t> *face_dirs,
+                                        const bool ordered = false) const;
+
+  void face_get_cells_internal(const Entity_ID faceid,
+                               const Entity_type ptype,
+                               Entity_ID_List *cellids) const;
+
+  void face_get_edges_and_dirs_internal(const Entity_ID faceid,
+                                        Entity_ID_List *edgeids,
+                                        std::vector<dir_t> *edge_dirs,
+                                        const bool ordered = true) const;
+
+  void cell_get_edges_internal(const Entity_ID cellid,
+                               Entity_ID_List *edgeids) const;
+
+  void cell_2D_get_edges_and_dirs_internal(const Entity_ID cellid,
+                                           Entity_ID_List *edgeids,
+                                           std::vector<dir_t> *edge_dirs)
+      const;
+
+  void edge_get_nodes_internal(const Entity_ID edgeid, Entity_ID *enode0,
+                               Entity_ID *enode1) const;
+
+  // Node coordinates, one array per coordinate direction
+  std::vector<double> coords_[3];
+
+  std::vector<Cell_type> cell_types_;
+
+  // GIDs of nodes, edges, faces and cells (empty in serial where GIDs
+  // are the local IDs)
+  std::vector<Entity_ID> gids_[4];
+
+  // Downward adjacencies
+  std::vector<int> cell_face_offsets_;
+  std::vector<Entity_ID> cell_face_ids_;
+  std::vector<dir_t> cell_face_dirs_;
+  std::vector<int> cell_node_offsets_;
+  std::vector<Entity_ID> cell_node_ids_;
+  std::vector<int> face_node_offsets_;
+  std::vector<Entity_ID> face_node_ids_;
+
+  std::vector<int> cell_edge_offsets_;
+  std::vector<Entity_ID> cell_edge_ids_;
+  std::vector<dir_t> cell_edge_dirs_;  // only in 2D
+  std::vector<int> face_edge_offsets_;
+  std::vector<Entity_ID> face_edge_ids_;
+  std::vector<dir_t> face_edge_dirs_;
+  std::vector<Entity_ID> edge_node_ids_;  // 2 per edge
+
+  // Upward adjacencies (the cells of a face are stored as 2 entries
+  // per face with -1 for a missing cell)
+  std::vector<Entity_ID> face_cell_ids_;
+  std::vector<int> node_cell_offsets_;
+  std::vector<Entity_ID> node_cell_ids_;
+  std::vector<int> node_face_offsets_;
+  std::vector<Entity_ID> node_face_ids_;
+
+  // Owned and ghost entities of the labeled sets of the source mesh
+  std::map<std::string, std::array<Entity_ID_List, 2>> labeled_sets_;
+};
+
+}  // end namespace Jali
+
+#endif  // _JALI_MESH_FLAT_H_
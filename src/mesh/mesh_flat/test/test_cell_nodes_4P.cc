@@ -0,0 +1,179 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "mpi.h"
+
+#include "UnitTest++.h"
+#include "../Mesh_flat.hh"
+#include "Mesh_simple.hh"
+
+// Gather the GIDs and sorted node GIDs of the owned faces or edges on
+// all ranks and check that the owned ones number the entities of the
+// whole brick exactly once and that every copy of an entity (owned or
+// ghost) has the GID its owner gave it
+
+static void check_gids(Jali::Mesh const& mesh, Jali::Entity_kind const kind,
+                       int const nglobal) {
+  auto get_key = [&](Jali::Entity_ID const i) {
+    Jali::Entity_ID_List nodeids;
+    if (kind == Jali::Entity_kind::FACE) {
+      mesh.face_get_nodes(i, &nodeids);
+    } else {
+      nodeids.resize(2);
+      mesh.edge_get_nodes(i, &nodeids[0], &nodeids[1]);
+    }
+    std::vector<int> key(4, -1);
+    for (int k = 0; k < nodeids.size(); k++)
+      key[k] = mesh.GID(nodeids[k], Jali::Entity_kind::NODE);
+    std::sort(key.begin(), key.begin() + nodeids.size());
+    return key;
+  };
+
+  int nowned = mesh.num_entities(kind, Jali::Entity_type::PARALLEL_OWNED);
+  std::vector<int> records;
+  for (int i = 0; i < nowned; i++) {
+    records.push_back(mesh.GID(i, kind));
+    std::vector<int> key = get_key(i);
+    records.insert(records.end(), key.begin(), key.end());
+  }
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  int nrecords = records.size();
+  std::vector<int> counts(nproc), offsets(nproc, 0);
+  MPI_Allgather(&nrecords, 1, MPI_INT, counts.data(), 1, MPI_INT,
+                MPI_COMM_WORLD);
+  for (int p = 1; p < nproc; p++)
+    offsets[p] = offsets[p-1] + counts[p-1];
+  CHECK_EQUAL(5*nglobal, offsets[nproc-1] + counts[nproc-1]);
+
+  std::vector<int> allrecords(5*nglobal);
+  MPI_Allgatherv(records.data(), nrecords, MPI_INT, allrecords.data(),
+                 counts.data(), offsets.data(), MPI_INT, MPI_COMM_WORLD);
+  std::map<int, std::vector<int>> keys;
+  for (int i = 0; i < nglobal; i++)
+    keys[allrecords[5*i]].assign(allrecords.begin() + 5*i + 1,
+                                 allrecords.begin() + 5*i + 5);
+  CHECK_EQUAL(nglobal, keys.size());
+  CHECK_EQUAL(0, keys.begin()->first);
+  CHECK_EQUAL(nglobal-1, keys.rbegin()->first);
+
+  int nall = mesh.num_entities(kind, Jali::Entity_type::ALL);
+  for (int i = 0; i < nall; i++)
+    CHECK(keys[mesh.GID(i, kind)] == get_key(i));
+}
+
+// A flat mesh built from the nodes of the cells of a distributed mesh
+// has the faces and edges of the distributed brick, numbered and
+// oriented consistently across ranks
+
+TEST(FLAT_MESH_FROM_CELL_NODES) {
+  int const nx = 6, ny = 5, nz = 4;
+  Jali::Mesh_simple src(0.0, 0.0, 0.0, 6.0, 5.0, 4.0, nx, ny, nz,
+                        MPI_COMM_WORLD, NULL, true, false, false, false,
+                        false, 0, 0, 1);
+
+  std::vector<double> coords;
+  std::vector<Jali::Entity_ID> node_gids, cell_gids, cell_node_ids;
+  std::vector<int> cell_node_offsets(1, 0);
+  std::vector<Jali::Cell_type> cell_types;
+  for (auto const& n : src.nodes()) {
+    JaliGeometry::Point xyz;
+    src.node_get_coordinates(n, &xyz);
+    for (int d = 0; d < 3; d++)
+      coords.push_back(xyz[d]);
+    node_gids.push_back(src.GID(n, Jali::Entity_kind::NODE));
+  }
+  for (auto const& c : src.cells()) {
+    Jali::Entity_ID_List nodeids;
+    src.cell_get_nodes(c, &nodeids);
+    cell_node_ids.insert(cell_node_ids.end(), nodeids.begin(), nodeids.end());
+    cell_node_offsets.push_back(cell_node_ids.size());
+    cell_types.push_back(src.cell_get_type(c));
+    cell_gids.push_back(src.GID(c, Jali::Entity_kind::CELL));
+  }
+
+  Jali::Mesh_flat flat(3, coords, node_gids,
+                       src.num_nodes<Jali::Entity_type::PARALLEL_OWNED>(),
+                       cell_types, cell_node_offsets, cell_node_ids,
+                       cell_gids,
+                       src.num_cells<Jali::Entity_type::PARALLEL_OWNED>(),
+                       MPI_COMM_WORLD, NULL, true, true);
+
+  CHECK_EQUAL(src.num_cells(), flat.num_cells());
+  CHECK_EQUAL(src.num_nodes(), flat.num_nodes());
+  check_gids(flat, Jali::Entity_kind::FACE,
+             nx*ny*(nz+1) + nx*(ny+1)*nz + (nx+1)*ny*nz);
+  check_gids(flat, Jali::Entity_kind::EDGE,
+             (nx+1)*(ny+1)*nz + (nx+1)*ny*(nz+1) + nx*(ny+1)*(nz+1));
+
+  // Cells have the volumes and face neighbors of the source cells and
+  // their faces point out of them with dir +1
+
+  Jali::Entity_ID_List faceids, srcadj, flatadj;
+  std::vector<Jali::dir_t> dirs;
+  for (auto const& c : flat.cells()) {
+    CHECK_EQUAL(src.GID(c, Jali::Entity_kind::CELL),
+                flat.GID(c, Jali::Entity_kind::CELL));
+    CHECK_CLOSE(src.cell_volume(c), flat.cell_volume(c), 1.0e-12);
+
+    JaliGeometry::Point ccen = flat.cell_centroid(c);
+    flat.cell_get_faces_and_dirs(c, &faceids, &dirs);
+    for (int i = 0; i < faceids.size(); i++) {
+      JaliGeometry::Point normal = flat.face_normal(faceids[i])*dirs[i];
+      CHECK((flat.face_centroid(faceids[i]) - ccen)*normal > 0.0);
+    }
+  }
+  for (auto const& c : flat.cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+    src.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &srcadj);
+    flat.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &flatadj);
+    std::sort(srcadj.begin(), srcadj.end());
+    std::sort(flatadj.begin(), flatadj.end());
+    CHECK(srcadj == flatadj);
+  }
+}
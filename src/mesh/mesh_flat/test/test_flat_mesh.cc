@@ -0,0 +1,337 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mpi.h"
+
+#include "UnitTest++.h"
+#include "../Mesh_flat.hh"
+#include "Mesh_simple.hh"
+#include "GeometricModel.hh"
+#include "LabeledSetRegion.hh"
+
+// A flat copy of a mesh must answer all queries exactly like the
+// mesh it was built from, even after the source mesh is released
+
+TEST(FLAT_MESH_3D) {
+  std::shared_ptr<Jali::Mesh> src =
+      std::make_shared<Jali::Mesh_simple>(0.0, 0.0, 0.0, 1.0, 2.0, 3.0,
+                                          3, 4, 5, MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> copy =
+      std::make_shared<Jali::Mesh_simple>(0.0, 0.0, 0.0, 1.0, 2.0, 3.0,
+                                          3, 4, 5, MPI_COMM_WORLD);
+  Jali::Mesh_flat flat(src, true, false, false, false, false, 2);
+  src.reset();
+
+  CHECK_EQUAL(copy->num_cells(), flat.num_cells());
+  CHECK_EQUAL(copy->num_faces(), flat.num_faces());
+  CHECK_EQUAL(copy->num_nodes(), flat.num_nodes());
+  CHECK_EQUAL(copy->num_cells<Jali::Entity_type::PARALLEL_OWNED>(),
+              flat.num_cells<Jali::Entity_type::PARALLEL_OWNED>());
+  CHECK_EQUAL(3, flat.space_dimension());
+  CHECK_EQUAL(3, flat.cell_dimension());
+  CHECK(flat.memory_used() > 0);
+
+  Jali::Entity_ID_List clist, flist;
+  std::vector<Jali::dir_t> cdirs, fdirs;
+
+  for (auto const& c : copy->cells()) {
+    CHECK(copy->cell_get_type(c) == flat.cell_get_type(c));
+    CHECK_EQUAL(copy->GID(c, Jali::Entity_kind::CELL),
+                flat.GID(c, Jali::Entity_kind::CELL));
+
+    copy->cell_get_faces_and_dirs(c, &clist, &cdirs);
+    flat.cell_get_faces_and_dirs(c, &flist, &fdirs);
+    CHECK(clist == flist);
+    CHECK(cdirs == fdirs);
+
+    copy->cell_get_nodes(c, &clist);
+    flat.cell_get_nodes(c, &flist);
+    CHECK(clist == flist);
+
+    copy->cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &clist);
+    flat.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &flist);
+    CHECK(clist == flist);
+
+    copy->cell_get_node_adj_cells(c, Jali::Entity_type::ALL, &clist);
+    flat.cell_get_node_adj_cells(c, Jali::Entity_type::ALL, &flist);
+    std::sort(clist.begin(), clist.end());
+    std::sort(flist.begin(), flist.end());
+    CHECK(clist == flist);
+
+    CHECK_CLOSE(copy->cell_volume(c), flat.cell_volume(c), 1.0e-12);
+    JaliGeometry::Point ccen = copy->cell_centroid(c);
+    JaliGeometry::Point fcen = flat.cell_centroid(c);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(ccen[d], fcen[d], 1.0e-12);
+  }
+
+  for (auto const& f : copy->faces()) {
+    copy->face_get_nodes(f, &clist);
+    flat.face_get_nodes(f, &flist);
+    CHECK(clist == flist);
+
+    copy->face_get_cells(f, Jali::Entity_type::ALL, &clist);
+    flat.face_get_cells(f, Jali::Entity_type::ALL, &flist);
+    CHECK(clist == flist);
+
+    CHECK_CLOSE(copy->face_area(f), flat.face_area(f), 1.0e-12);
+  }
+
+  for (auto const& n : copy->nodes()) {
+    std::array<double, 3> cxyz, fxyz;
+    copy->node_get_coordinates(n, &cxyz);
+    flat.node_get_coordinates(n, &fxyz);
+    CHECK_ARRAY_EQUAL(cxyz, fxyz, 3);
+
+    copy->node_get_cells(n, Jali::Entity_type::ALL, &clist);
+    flat.node_get_cells(n, Jali::Entity_type::ALL, &flist);
+    CHECK(clist == flist);
+
+    copy->node_get_faces(n, Jali::Entity_type::ALL, &clist);
+    flat.node_get_faces(n, Jali::Entity_type::ALL, &flist);
+    CHECK(clist == flist);
+  }
+
+  // Tiles are built on the flat mesh
+
+  CHECK_EQUAL(2, flat.num_tiles());
+  int ntilecells = 0;
+  for (auto const& t : flat.tiles())
+    ntilecells += t->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  CHECK_EQUAL(flat.num_cells<Jali::Entity_type::PARALLEL_OWNED>(),
+              ntilecells);
+
+  // Moving a node changes the geometry of the flat mesh
+
+  double newxyz[3] = {0.1, 0.1, 0.1};
+  flat.node_set_coordinates(0, newxyz);
+  flat.update_geometric_quantities();
+  CHECK(std::abs(flat.cell_volume(0) - copy->cell_volume(0)) > 1.0e-6);
+}
+
+
+// A flat mesh loaded from a snapshot answers queries like the mesh
+// that wrote it
+
+TEST(FLAT_MESH_SNAPSHOT) {
+  std::shared_ptr<Jali::Mesh> src =
+      std::make_shared<Jali::Mesh_simple>(0.0, 0.0, 0.0, 1.0, 2.0, 3.0,
+                                          3, 4, 5, MPI_COMM_WORLD);
+  Jali::Mesh_flat flat(src);
+  src.reset();
+
+  std::string snapshot = "flat_mesh_snapshot.jflat";
+  CHECK(flat.write_snapshot(snapshot, 42));
+  CHECK(Jali::Mesh_flat::snapshot_matches(snapshot, 42, MPI_COMM_WORLD));
+  CHECK(!Jali::Mesh_flat::snapshot_matches(snapshot, 43, MPI_COMM_WORLD));
+  CHECK(!Jali::Mesh_flat::snapshot_matches("no_such_snapshot.jflat", 42,
+                                           MPI_COMM_WORLD));
+  CHECK_THROW(std::make_shared<Jali::Mesh_flat>(snapshot, 43,
+                                                MPI_COMM_WORLD),
+              Errors::Message);
+
+  Jali::Mesh_flat loaded(snapshot, 42, MPI_COMM_WORLD, NULL, true, false,
+                         false, false, false, 2);
+  std::remove(snapshot.c_str());
+
+  CHECK_EQUAL(3, loaded.space_dimension());
+  CHECK_EQUAL(3, loaded.cell_dimension());
+  CHECK_EQUAL(flat.num_cells(), loaded.num_cells());
+  CHECK_EQUAL(flat.num_faces(), loaded.num_faces());
+  CHECK_EQUAL(flat.num_nodes(), loaded.num_nodes());
+  CHECK_EQUAL(flat.num_cells<Jali::Entity_type::PARALLEL_OWNED>(),
+              loaded.num_cells<Jali::Entity_type::PARALLEL_OWNED>());
+  CHECK(loaded.memory_used() <= flat.memory_used());
+  CHECK_EQUAL(2, loaded.num_tiles());
+
+  Jali::Entity_ID_List flist, llist;
+  std::vector<Jali::dir_t> fdirs, ldirs;
+
+  for (auto const& c : flat.cells()) {
+    CHECK(flat.cell_get_type(c) == loaded.cell_get_type(c));
+
+    flat.cell_get_faces_and_dirs(c, &flist, &fdirs);
+    loaded.cell_get_faces_and_dirs(c, &llist, &ldirs);
+    CHECK(flist == llist);
+    CHECK(fdirs == ldirs);
+
+    flat.cell_get_nodes(c, &flist);
+    loaded.cell_get_nodes(c, &llist);
+    CHECK(flist == llist);
+
+    CHECK_EQUAL(flat.cell_volume(c), loaded.cell_volume(c));
+  }
+
+  for (auto const& f : flat.faces()) {
+    flat.face_get_cells(f, Jali::Entity_type::ALL, &flist);
+    loaded.face_get_cells(f, Jali::Entity_type::ALL, &llist);
+    CHECK(flist == llist);
+  }
+
+  for (auto const& n : flat.nodes()) {
+    std::array<double, 3> fxyz, lxyz;
+    flat.node_get_coordinates(n, &fxyz);
+    loaded.node_get_coordinates(n, &lxyz);
+    CHECK_ARRAY_EQUAL(fxyz, lxyz, 3);
+
+    flat.node_get_faces(n, Jali::Entity_type::ALL, &flist);
+    loaded.node_get_faces(n, Jali::Entity_type::ALL, &llist);
+    CHECK(flist == llist);
+  }
+}
+
+
+// A flat mesh streamed from an Exodus II file in small chunks has
+// consistent faces and edges and the labeled sets of the file
+
+TEST(FLAT_MESH_EXODUS) {
+  std::string filename = "test/hex_3x3x3_sets.exo";
+
+  // Entity kinds of labeled sets may be spelled either way
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::LabeledSetRegion lsrgn1("mat1", 1, "CELL", filename,
+                                        "Exodus II", "10000");
+  gregions.push_back(&lsrgn1);
+  JaliGeometry::LabeledSetRegion lsrgn2("cellset2", 2, "Entity_kind::CELL",
+                                        filename, "Exodus II", "2");
+  gregions.push_back(&lsrgn2);
+  JaliGeometry::LabeledSetRegion lsrgn3("face101", 3, "FACE", filename,
+                                        "Exodus II", "101");
+  gregions.push_back(&lsrgn3);
+  JaliGeometry::LabeledSetRegion lsrgn4("nodeset20004", 4, "Entity_kind::NODE",
+                                        filename, "Exodus II", "20004");
+  gregions.push_back(&lsrgn4);
+  JaliGeometry::GeometricModel gm(3, gregions);
+
+  Jali::Mesh_flat flat(filename, MPI_COMM_SELF, &gm, true, true, false,
+                       false, false, 0, 0, 1, false,
+                       Jali::Partitioner_type::METIS,
+                       JaliGeometry::Geom_type::CARTESIAN, 4);
+
+  CHECK_EQUAL(3, flat.space_dimension());
+  CHECK_EQUAL(3, flat.cell_dimension());
+  CHECK_EQUAL(27, flat.num_cells());
+  CHECK_EQUAL(108, flat.num_faces());
+  CHECK_EQUAL(144, flat.num_edges());
+  CHECK_EQUAL(64, flat.num_nodes());
+
+  CHECK_EQUAL(9, flat.get_set_size("mat1", Jali::Entity_kind::CELL,
+                                   Jali::Entity_type::ALL));
+  CHECK_EQUAL(9, flat.get_set_size("cellset2", Jali::Entity_kind::CELL,
+                                   Jali::Entity_type::ALL));
+  CHECK_EQUAL(9, flat.get_set_size("face101", Jali::Entity_kind::FACE,
+                                   Jali::Entity_type::ALL));
+  CHECK_EQUAL(8, flat.get_set_size("nodeset20004", Jali::Entity_kind::NODE,
+                                   Jali::Entity_type::ALL));
+
+  // Faces point out of cells with dir +1, edges of faces are edges
+  // of their cells and the cells of a node are the cells it is in
+
+  double volume = 0.0;
+  Jali::Entity_ID_List faceids, edgeids, cedgeids, cellids;
+  std::vector<Jali::dir_t> fdirs, edirs;
+  for (auto const& c : flat.cells()) {
+    volume += flat.cell_volume(c);
+    JaliGeometry::Point ccen = flat.cell_centroid(c);
+
+    flat.cell_get_faces_and_dirs(c, &faceids, &fdirs);
+    flat.cell_get_edges(c, &cedgeids);
+    CHECK_EQUAL(6, faceids.size());
+    CHECK_EQUAL(12, cedgeids.size());
+    for (int i = 0; i < faceids.size(); i++) {
+      JaliGeometry::Point normal = flat.face_normal(faceids[i])*fdirs[i];
+      CHECK((flat.face_centroid(faceids[i]) - ccen)*normal > 0.0);
+
+      flat.face_get_edges_and_dirs(faceids[i], &edgeids, &edirs);
+      CHECK_EQUAL(4, edgeids.size());
+      for (auto const& e : edgeids)
+        CHECK(std::find(cedgeids.begin(), cedgeids.end(), e) !=
+              cedgeids.end());
+    }
+  }
+  CHECK_CLOSE(1.0, volume, 1.0e-12);
+
+  int nboundary = 0;
+  for (auto const& f : flat.faces()) {
+    flat.face_get_cells(f, Jali::Entity_type::ALL, &cellids);
+    if (cellids.size() == 1) nboundary++;
+  }
+  CHECK_EQUAL(54, nboundary);
+
+  Jali::Entity_ID_List nodeids;
+  for (auto const& n : flat.nodes()) {
+    flat.node_get_cells(n, Jali::Entity_type::ALL, &cellids);
+    for (auto const& c : cellids) {
+      flat.cell_get_nodes(c, &nodeids);
+      CHECK(std::find(nodeids.begin(), nodeids.end(), n) != nodeids.end());
+    }
+  }
+}
+
+TEST(FLAT_MESH_1D) {
+  std::vector<double> x = {0.0, 0.5, 1.5, 3.0};
+  std::shared_ptr<Jali::Mesh> src =
+      std::make_shared<Jali::Mesh_simple>(x, MPI_COMM_WORLD);
+  Jali::Mesh_flat flat(src);
+
+  CHECK_EQUAL(1, flat.space_dimension());
+  CHECK_EQUAL(3, flat.num_cells());
+  CHECK_EQUAL(4, flat.num_nodes());
+  for (auto const& n : flat.nodes()) {
+    double xn;
+    flat.node_get_coordinates(n, &xn);
+    CHECK_EQUAL(x[n], xn);
+  }
+  CHECK_CLOSE(0.5, flat.cell_volume(0), 1.0e-12);
+  CHECK_CLOSE(1.5, flat.cell_volume(2), 1.0e-12);
+}
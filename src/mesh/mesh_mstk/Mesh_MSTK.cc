@@ -46,11 +46,23 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // Mesh class based on MSTK framework
 
 #include <cstring>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #include "Mesh_MSTK.hh"
 
 #include <mpi.h>
 
+#include "exodusII.h"
+
+#include "ExodusElement.hh"
 #include "dbc.hh"
 #include "errors.hh"
 
@@ -73,12 +85,14 @@ Mesh_MSTK::Mesh_MSTK(const std::string filename, const MPI_Comm& incomm,
                      const int num_ghost_layers_distmesh,
                      const bool boundary_ghosts_requested,
                      const Partitioner_type partitioner,
-                     const JaliGeometry::Geom_type geom_type) :
+                     const JaliGeometry::Geom_type geom_type,
+                     const Renumbering_type renumbering,
+                     const bool parallel_read) :
 Mesh(request_faces, request_edges, request_sides, request_wedges,
      request_corners, num_tiles_ini, num_ghost_layers_tile,
      num_ghost_layers_distmesh, boundary_ghosts_requested,
      partitioner, geom_type, incomm),
-  mpicomm(incomm), meshxyz(NULL),
+  mpicomm(incomm), meshxyz(NULL), renumbering_(renumbering),
   faces_initialized(false), edges_initialized(false),
   target_cell_volumes(NULL), min_cell_volumes(NULL) {
 
@@ -110,6 +124,9 @@ Mesh(request_faces, request_edges, request_sides, request_wedges,
 
     if (numprocs == 1) {
       ok = MESH_ImportFromExodusII(mesh, filename.c_str(), NULL, mpicomm);
+    } else if (parallel_read) {
+      ok = read_exodus_distributed_(filename, partitioner,
+                                    num_ghost_layers_distmesh);
     } else {
       int opts[5] = {0, 0, 0, 0, 0};
 
@@ -190,8 +207,12 @@ Mesh(request_faces, request_edges, request_sides, request_wedges,
 
   // Do all the processing required for setting up the mesh for Jali
 
+  double tstart = MPI_Wtime();
+
   post_create_steps_();
 
+  if (!read_timings_.empty())
+    read_timings_.emplace_back("setup", MPI_Wtime() - tstart);
 }
 
 
@@ -216,12 +237,13 @@ Mesh_MSTK::Mesh_MSTK(const double x0, const double y0, const double z0,
                      const int num_ghost_layers_tile,
                      const int num_ghost_layers_distmesh,
                      const bool boundary_ghosts_requested,
-                     const Partitioner_type partitioner) :
+                     const Partitioner_type partitioner,
+                     const Renumbering_type renumbering) :
 Mesh(request_faces, request_edges, request_sides, request_wedges,
      request_corners, num_tiles, num_ghost_layers_tile,
      num_ghost_layers_distmesh, boundary_ghosts_requested,
      partitioner, JaliGeometry::Geom_type::CARTESIAN, incomm),
-    mpicomm(incomm), meshxyz(NULL),
+    mpicomm(incomm), meshxyz(NULL), renumbering_(renumbering),
     faces_initialized(false), edges_initialized(false),
     target_cell_volumes(NULL), min_cell_volumes(NULL) {
 
@@ -355,12 +377,13 @@ Mesh_MSTK::Mesh_MSTK(const double x0, const double y0,
                      const int num_ghost_layers_distmesh,
                      const bool boundary_ghosts_requested,
                      const Partitioner_type partitioner,
-                     const JaliGeometry::Geom_type geom_type) :
+                     const JaliGeometry::Geom_type geom_type,
+                     const Renumbering_type renumbering) :
 Mesh(request_faces, request_edges, request_sides, request_wedges,
      request_corners, num_tiles, num_ghost_layers_tile,
      num_ghost_layers_distmesh, boundary_ghosts_requested,
      partitioner, geom_type, incomm),
-    mpicomm(incomm), meshxyz(NULL),
+    mpicomm(incomm), meshxyz(NULL), renumbering_(renumbering),
     faces_initialized(false), edges_initialized(false),
                    target_cell_volumes(NULL), min_cell_volumes(NULL) {
 
@@ -483,12 +506,14 @@ Mesh_MSTK::Mesh_MSTK(const std::shared_ptr<Mesh> inmesh,
                      const int num_ghost_layers_distmesh,
                      const bool boundary_ghosts_requested,
                      const Partitioner_type partitioner,
-                     const JaliGeometry::Geom_type geom_type) :
+                     const JaliGeometry::Geom_type geom_type,
+                     const Renumbering_type renumbering) :
     mpicomm(inmesh->get_comm()),
   Mesh(request_faces, request_edges, request_sides, request_wedges,
        request_corners, num_tiles, num_ghost_layers_tile,
        num_ghost_layers_distmesh, boundary_ghosts_requested,
-       partitioner, geom_type, inmesh->get_comm()) {
+       partitioner, geom_type, inmesh->get_comm()),
+  renumbering_(renumbering) {
 
   Mesh_MSTK *inmesh_mstk = dynamic_cast<Mesh_MSTK *>(inmesh.get());
   Mesh_ptr mstk_source_mesh = inmesh_mstk->mesh;
@@ -547,12 +572,14 @@ Mesh_MSTK::Mesh_MSTK(const Mesh& inmesh,
                      const int num_ghost_layers_distmesh,
                      const bool boundary_ghosts_requested,
                      const Partitioner_type partitioner,
-                     const JaliGeometry::Geom_type geom_type) :
+                     const JaliGeometry::Geom_type geom_type,
+                     const Renumbering_type renumbering) :
   mpicomm(inmesh.get_comm()),
   Mesh(request_faces, request_edges, request_sides, request_wedges,
        request_corners, num_tiles, num_ghost_layers_tile,
        num_ghost_layers_distmesh, boundary_ghosts_requested,
-       partitioner, geom_type, inmesh.get_comm()) {
+       partitioner, geom_type, inmesh.get_comm()),
+  renumbering_(renumbering) {
 
   Mesh_ptr inmesh_mstk = ((Mesh_MSTK&) inmesh).mesh;
 
@@ -616,12 +643,14 @@ Mesh_MSTK::Mesh_MSTK(const Mesh& inmesh,
                      const int num_ghost_layers_distmesh,
                      const bool boundary_ghosts_requested,
                      const Partitioner_type partitioner,
-                     const JaliGeometry::Geom_type geom_type) :
+                     const JaliGeometry::Geom_type geom_type,
+                     const Renumbering_type renumbering) :
 mpicomm(inmesh.get_comm()),
   Mesh(request_faces, request_edges, request_sides, request_wedges,
        request_corners, num_tiles, num_ghost_layers_tile,
        num_ghost_layers_distmesh, boundary_ghosts_requested,
-       partitioner, geom_type, inmesh.get_comm()) {
+       partitioner, geom_type, inmesh.get_comm()),
+  renumbering_(renumbering) {
 
   // store pointers to the MESH_XXXFromID functions so that they can
   // be called without a switch statement
@@ -665,6 +694,11 @@ void Mesh_MSTK::extract_mstk_mesh(const Mesh_MSTK& inmesh,
   double rval, xyz[3];
   void *pval;
 
+  // Entities of this mesh will point to their parents in inmesh, so
+  // inmesh must keep its MSTK representation from now on
+
+  inmesh.attach_();
+  inmesh.has_derived_meshes_ = true;
   Mesh_ptr inmesh_mstk = inmesh.mesh;
 
   if (extrude) {
@@ -1148,9 +1182,886 @@ void Mesh_MSTK::extract_mstk_mesh(const Mesh_MSTK& inmesh,
 }
 
 
+//---------------------------------------------------------
+// Migrate the owned cells of a mesh to other ranks and make a new
+// MSTK mesh from them
+//---------------------------------------------------------
+
+Mesh_MSTK::Mesh_MSTK(const Mesh& inmesh,
+                     const std::vector<int>& cell_ranks,
+                     const bool request_faces,
+                     const bool request_edges,
+                     const bool request_sides,
+                     const bool request_wedges,
+                     const bool request_corners,
+                     const int num_tiles,
+                     const int num_ghost_layers_tile,
+                     const int num_ghost_layers_distmesh,
+                     const bool boundary_ghosts_requested,
+                     const Partitioner_type partitioner,
+                     const JaliGeometry::Geom_type geom_type,
+                     const Renumbering_type renumbering) :
+  mpicomm(inmesh.get_comm()), meshxyz(NULL),
+  Mesh(request_faces, request_edges, request_sides, request_wedges,
+       request_corners, num_tiles, num_ghost_layers_tile,
+       num_ghost_layers_distmesh, boundary_ghosts_requested,
+       partitioner, geom_type, inmesh.get_comm()),
+  renumbering_(renumbering) {
+
+  pre_create_steps_(inmesh.space_dimension(), inmesh.get_comm(),
+                    inmesh.geometric_model());
+
+  if (inmesh.cell_dimension() < 2) {
+    Errors::Message mesg("Redistribution of 1D meshes is not supported");
+    Exceptions::Jali_throw(mesg);
+  }
+  set_cell_dimension(inmesh.cell_dimension());
+
+  int nowned = inmesh.num_entities(Entity_kind::CELL,
+                                   Entity_type::PARALLEL_OWNED);
+  if (cell_ranks.size() != nowned) {
+    Errors::Message mesg("Number of target ranks does not match number of owned cells");
+    Exceptions::Jali_throw(mesg);
+  }
+  for (auto const& p : cell_ranks)
+    if (p < 0 || p >= numprocs) {
+      Errors::Message mesg("Target rank of cell is out of range");
+      Exceptions::Jali_throw(mesg);
+    }
+
+  migrate_mstk_mesh((Mesh_MSTK&) inmesh, cell_ranks,
+                    num_ghost_layers_distmesh);
+}
+
+
+// Send owned cells of a mesh (with their faces/edges and vertices) to
+// their target ranks and build this mesh from the cells received.
+// For private use of Mesh_MSTK class only
+//
+// Each cell is packed as integers
+//
+//   cell GID, GEntID, nsets, setidx ...,
+//   nsides, for each side (face in 3D, edge in 2D)
+//     dir, GEntDim, GEntID, nsets, setidx ...,
+//     nverts, for each vertex
+//       GID, GEntDim, GEntID, nsets, setidx ...
+//
+// and the coordinates of the vertices in the same order as reals.
+// Global IDs are Jali's (0-based) global IDs in inmesh and setidx are
+// indices into the list of labeled sets of the geometric model
+
+void Mesh_MSTK::migrate_mstk_mesh(const Mesh_MSTK& inmesh,
+                                  const std::vector<int>& cell_ranks,
+                                  const int num_ghost_layers_distmesh) {
+  int ival, idx;
+  double rval, xyz[3];
+  void *pval;
+
+  inmesh.attach_();
+  Mesh_ptr inmesh_mstk = inmesh.mesh;
+  MType celltype = entity_kind_to_mtype(Entity_kind::CELL);
+  MType sidetype = entity_kind_to_mtype(Entity_kind::FACE);
+
+  // Labeled sets and the entities (of inmesh) in each
+
+  std::vector<std::string> setnames;
+  std::vector<MType> settypes;
+  std::unordered_map<MEntity_ptr, std::vector<int>> entsets;
+
+  JaliGeometry::GeometricModelPtr gm = Mesh::geometric_model();
+  unsigned int ngr = gm ? gm->Num_Regions() : 0;
+  for (int i = 0; i < ngr; ++i) {
+    JaliGeometry::RegionPtr rgn = gm->Region_i(i);
+    if (rgn->type() != JaliGeometry::Region_type::LABELEDSET) continue;
+
+    JaliGeometry::LabeledSetRegionPtr lsrgn =
+        dynamic_cast<JaliGeometry::LabeledSetRegionPtr> (rgn);
+
+    Entity_kind kind = labeled_set_kind(lsrgn->entity_str());
+    if (kind != Entity_kind::CELL && kind != Entity_kind::FACE &&
+        kind != Entity_kind::NODE)
+      continue;
+
+    std::string internal_name = internal_name_of_set(rgn, kind);
+    int iset = setnames.size();
+    setnames.push_back(internal_name);
+    settypes.push_back(entity_kind_to_mtype(kind));
+
+    MSet_ptr mset = MESH_MSetByName(inmesh_mstk, internal_name.c_str());
+    if (!mset) continue;
+
+    MEntity_ptr ent;
+    idx = 0;
+    while ((ent = MSet_Next_Entry(mset, &idx)))
+      entsets[ent].push_back(iset);
+  }
+
+  auto pack_sets = [&](MEntity_ptr ent, std::vector<int> *ibuf) {
+    auto it = entsets.find(ent);
+    if (it == entsets.end()) {
+      ibuf->push_back(0);
+    } else {
+      ibuf->push_back(it->second.size());
+      ibuf->insert(ibuf->end(), it->second.begin(), it->second.end());
+    }
+  };
+
+  // Pack the owned cells for their target ranks
+
+  std::vector<std::vector<int>> isend(numprocs);
+  std::vector<std::vector<double>> rsend(numprocs);
+  for (int c = 0; c < cell_ranks.size(); ++c) {
+    MEntity_ptr cell = inmesh.cell_id_to_handle[c];
+    std::vector<int>& ibuf = isend[cell_ranks[c]];
+    std::vector<double>& rbuf = rsend[cell_ranks[c]];
+
+    ibuf.push_back(MEnt_GlobalID(cell)-1);
+    ibuf.push_back(MEnt_GEntID(cell));
+    pack_sets(cell, &ibuf);
+
+    List_ptr csides = (celltype == MREGION) ?
+        MR_Faces((MRegion_ptr) cell) : MF_Edges((MFace_ptr) cell, 1, 0);
+    int ncs = List_Num_Entries(csides);
+    ibuf.push_back(ncs);
+    for (int i = 0; i < ncs; ++i) {
+      MEntity_ptr side = List_Entry(csides, i);
+      ibuf.push_back((celltype == MREGION) ?
+                     MR_FaceDir_i((MRegion_ptr) cell, i) :
+                     MF_EdgeDir_i((MFace_ptr) cell, i));
+      ibuf.push_back(MEnt_GEntDim(side));
+      ibuf.push_back(MEnt_GEntID(side));
+      pack_sets(side, &ibuf);
+
+      List_ptr sverts;
+      if (sidetype == MFACE) {
+        sverts = MF_Vertices((MFace_ptr) side, 1, 0);
+      } else {
+        sverts = List_New(2);
+        List_Add(sverts, ME_Vertex((MEdge_ptr) side, 0));
+        List_Add(sverts, ME_Vertex((MEdge_ptr) side, 1));
+      }
+      int nsv = List_Num_Entries(sverts);
+      ibuf.push_back(nsv);
+      for (int j = 0; j < nsv; ++j) {
+        MVertex_ptr mv = List_Entry(sverts, j);
+        ibuf.push_back(MV_GlobalID(mv)-1);
+        ibuf.push_back(MV_GEntDim(mv));
+        ibuf.push_back(MV_GEntID(mv));
+        pack_sets(mv, &ibuf);
+        MV_Coords(mv, xyz);
+        rbuf.insert(rbuf.end(), xyz, xyz+3);
+      }
+      List_Delete(sverts);
+    }
+    List_Delete(csides);
+  }
+
+  // Exchange the packed cells (as bytes)
+
+  std::vector<std::vector<char>> sendbufs(numprocs), irecv, rrecv;
+  for (int p = 0; p < numprocs; ++p) {
+    char const *bytes = reinterpret_cast<char const *>(isend[p].data());
+    sendbufs[p].assign(bytes, bytes + isend[p].size()*sizeof(int));
+  }
+  exchange_bytes(mpicomm, sendbufs, &irecv);
+  for (int p = 0; p < numprocs; ++p) {
+    char const *bytes = reinterpret_cast<char const *>(rsend[p].data());
+    sendbufs[p].assign(bytes, bytes + rsend[p].size()*sizeof(double));
+  }
+  exchange_bytes(mpicomm, sendbufs, &rrecv);
+
+
+  // Create new mesh in MSTK and the received entities in it. Vertices
+  // are identified by their previous global IDs and faces (edges in
+  // 2D) by the sorted previous global IDs of their vertices. Cells
+  // sharing a face may have come from different ranks whose copies of
+  // the face need not agree on its orientation, so the direction in
+  // which a cell uses a face is flipped if needed. An edge has one
+  // node order, a polygon a cyclic one
+
+  mesh = MESH_New(MESH_RepType(inmesh_mstk));
+
+  MAttrib_ptr vprevgid_att = MAttrib_New(mesh, "vprev_gid", INT, MVERTEX);
+  MAttrib_ptr cprevgid_att = MAttrib_New(mesh, "cprev_gid", INT, celltype);
+
+  std::unordered_map<int, MVertex_ptr> gid2vertex;
+  std::map<std::vector<int>,
+           std::pair<MEntity_ptr, std::vector<int>>> verts2side;
+  std::unordered_map<MEntity_ptr, std::set<int>> newentsets;
+
+  for (int p = 0; p < numprocs; ++p) {
+    int const *ibuf = reinterpret_cast<int const *>(irecv[p].data());
+    double const *rbuf = reinterpret_cast<double const *>(rrecv[p].data());
+    int ni = irecv[p].size()/sizeof(int);
+    int ii = 0, ir = 0;
+
+    while (ii < ni) {
+      int cellgid = ibuf[ii++];
+      int cellgentid = ibuf[ii++];
+      int ncsets = ibuf[ii++];
+      std::vector<int> cellsets(ibuf+ii, ibuf+ii+ncsets);
+      ii += ncsets;
+
+      int ncs = ibuf[ii++];
+      std::vector<MEntity_ptr> csides(ncs);
+      std::vector<int> csidedirs(ncs);
+      for (int i = 0; i < ncs; ++i) {
+        int dir = ibuf[ii++];
+        int sgentdim = ibuf[ii++];
+        int sgentid = ibuf[ii++];
+        int nssets = ibuf[ii++];
+        std::vector<int> sidesets(ibuf+ii, ibuf+ii+nssets);
+        ii += nssets;
+
+        int nsv = ibuf[ii++];
+        std::vector<int> svgids(nsv);
+        std::vector<MVertex_ptr> sverts(nsv);
+        for (int j = 0; j < nsv; ++j) {
+          int vgid = ibuf[ii++];
+          int vgentdim = ibuf[ii++];
+          int vgentid = ibuf[ii++];
+          int nvsets = ibuf[ii++];
+
+          MVertex_ptr mv;
+          auto vit = gid2vertex.find(vgid);
+          if (vit != gid2vertex.end()) {
+            mv = vit->second;
+          } else {
+            mv = MV_New(mesh);
+            MV_Set_Coords(mv, (double *) (rbuf+ir));
+            MV_Set_GEntDim(mv, vgentdim);
+            MV_Set_GEntID(mv, vgentid);
+            MEnt_Set_AttVal(mv, vprevgid_att, vgid, 0.0, NULL);
+            gid2vertex[vgid] = mv;
+          }
+          for (int k = 0; k < nvsets; ++k)
+            newentsets[mv].insert(ibuf[ii+k]);
+          ii += nvsets;
+          ir += 3;
+
+          svgids[j] = vgid;
+          sverts[j] = mv;
+        }
+
+        std::vector<int> key(svgids);
+        std::sort(key.begin(), key.end());
+        auto sit = verts2side.find(key);
+        if (sit != verts2side.end()) {
+          std::vector<int> const& prevgids = sit->second.second;
+          int pos = std::find(prevgids.begin(), prevgids.end(), svgids[0]) -
+              prevgids.begin();
+          bool const along = (nsv == 2) ? (pos == 0) :
+              (prevgids[(pos+1)%nsv] == svgids[1]);
+          if (!along)
+            dir = !dir;
+          csides[i] = sit->second.first;
+        } else {
+          if (sidetype == MFACE) {
+            csides[i] = MF_New(mesh);
+            MF_Set_Vertices((MFace_ptr) csides[i], nsv, &(sverts[0]));
+            MF_Set_GEntDim((MFace_ptr) csides[i], sgentdim);
+            MF_Set_GEntID((MFace_ptr) csides[i], sgentid);
+          } else {
+            csides[i] = ME_New(mesh);
+            ME_Set_Vertex((MEdge_ptr) csides[i], 0, sverts[0]);
+            ME_Set_Vertex((MEdge_ptr) csides[i], 1, sverts[1]);
+            ME_Set_GEntDim((MEdge_ptr) csides[i], sgentdim);
+            ME_Set_GEntID((MEdge_ptr) csides[i], sgentid);
+          }
+          verts2side[key] = std::make_pair(csides[i], svgids);
+        }
+        for (auto const& s : sidesets)
+          newentsets[csides[i]].insert(s);
+        csidedirs[i] = dir;
+      }
+
+      MEntity_ptr cell;
+      if (celltype == MREGION) {
+        cell = MR_New(mesh);
+        MR_Set_Faces((MRegion_ptr) cell, ncs, (MFace_ptr *) &(csides[0]),
+                     &(csidedirs[0]));
+        MR_Set_GEntID((MRegion_ptr) cell, cellgentid);
+      } else {
+        cell = MF_New(mesh);
+        MF_Set_Edges((MFace_ptr) cell, ncs, (MEdge_ptr *) &(csides[0]),
+                     &(csidedirs[0]));
+        MF_Set_GEntDim((MFace_ptr) cell, 2);
+        MF_Set_GEntID((MFace_ptr) cell, cellgentid);
+      }
+      MEnt_Set_AttVal(cell, cprevgid_att, cellgid, 0.0, NULL);
+      for (auto const& s : cellsets)
+        newentsets[cell].insert(s);
+    }
+  }
+
+  // Labeled sets of the new mesh (owned entities as sent; ghosts are
+  // not added)
+
+  std::vector<MSet_ptr> newsets(setnames.size());
+  for (int i = 0; i < setnames.size(); ++i)
+    newsets[i] = MSet_New(mesh, setnames[i].c_str(), settypes[i]);
+  for (auto const& es : newentsets)
+    for (auto const& s : es.second)
+      MSet_Add(newsets[s], es.first);
+
+
+  if (!serial_run) {
+    // Assign global IDs and build ghost entities and then have the
+    // ghosts pick up the previous global IDs of their masters
+
+    int input_type = 0; /* No parallel info is given */
+    int status = MSTK_Weave_DistributedMeshes(mesh, cell_dimension(),
+                                              num_ghost_layers_distmesh,
+                                              input_type,
+                                              mpicomm);
+    status &= MESH_UpdateAttributes(mesh, mpicomm);
+    if (!status) {
+      Errors::Message mesg("Could not build parallel mesh after migration");
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+
+
+  // Do all the processing required for setting up the mesh for Jali
+
+  post_create_steps_();
+
+
+  // Record the global IDs of nodes and cells in inmesh
+
+  int nv = vtx_id_to_handle.size();
+  previous_gids_[(int) Entity_kind::NODE].resize(nv);
+  for (int i = 0; i < nv; ++i) {
+    if (!MEnt_Get_AttVal(vtx_id_to_handle[i], vprevgid_att, &ival, &rval,
+                         &pval))
+      ival = -1;  // boundary ghosts have no counterpart in inmesh
+    previous_gids_[(int) Entity_kind::NODE][i] = ival;
+  }
+
+  int nc = cell_id_to_handle.size();
+  previous_gids_[(int) Entity_kind::CELL].resize(nc);
+  for (int i = 0; i < nc; ++i) {
+    if (!MEnt_Get_AttVal(cell_id_to_handle[i], cprevgid_att, &ival, &rval,
+                         &pval))
+      ival = -1;  // boundary ghosts have no counterpart in inmesh
+    previous_gids_[(int) Entity_kind::CELL][i] = ival;
+  }
+}
+
+
+// Read an Exodus II file with every rank reading only a share of the
+// elements and the nodes they use and build the distributed mesh from
+// them. For private use of Mesh_MSTK class only
+//
+// Each rank reads a contiguous range of elements in file order, the
+// coordinates of their nodes (in runs of nearby node numbers) and the
+// entries of the node and side sets that concern them. Unless the
+// partitioner asks to keep this split, the elements are then sent to
+// ranks by splitting a space filling curve through their centroids
+// at keys sampled on all ranks. Global IDs of nodes and cells are
+// their (0-based) numbers in the file. Returns 0 on all ranks if any
+// rank could not read its share of the file
+
+int Mesh_MSTK::read_exodus_distributed_(const std::string filename,
+                                        const Partitioner_type partitioner,
+                                        const int num_ghost_layers_distmesh) {
+  double tstart = MPI_Wtime();
+  read_timings_.clear();
+
+  // A rank that fails to read its share must still take part in the
+  // reduction of the read status that ends the read phase, or the
+  // other ranks would hang in the collective calls that follow. Each
+  // rank makes exactly one call to this
+
+  auto read_ok_everywhere = [&](bool const ok) {
+    int ok_all = ok ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &ok_all, 1, MPI_INT, MPI_MIN, mpicomm);
+    return (ok_all == 1);
+  };
+
+  int comp_ws = sizeof(double), io_ws = 0;
+  float version;
+  int exoid = ex_open(filename.c_str(), EX_READ, &comp_ws, &io_ws, &version);
+  if (exoid < 0) {
+    read_ok_everywhere(false);
+    return 0;
+  }
+
+  char title[MAX_LINE_LENGTH+1];
+  int ndim, nnodes, nelems, nblocks, nnodesets, nsidesets;
+  if (ex_get_init(exoid, title, &ndim, &nnodes, &nelems, &nblocks,
+                  &nnodesets, &nsidesets) < 0) {
+    ex_close(exoid);
+    read_ok_everywhere(false);
+    return 0;
+  }
+
+  // Element blocks (every rank reads the block headers)
+
+  std::vector<int> blkids(nblocks), blksizes(nblocks);
+  std::vector<ExodusElement const *> blkelems(nblocks, NULL);
+  if (nblocks && ex_get_ids(exoid, EX_ELEM_BLOCK, &(blkids[0])) < 0) {
+    ex_close(exoid);
+    read_ok_everywhere(false);
+    return 0;
+  }
+
+  int celldim = 0;
+  for (int b = 0; b < nblocks; b++) {
+    char elemtype[MAX_STR_LENGTH+1];
+    int nperelem, nedges, nfaces, nattr;
+    if (ex_get_block(exoid, EX_ELEM_BLOCK, blkids[b], elemtype,
+                     &(blksizes[b]), &nperelem, &nedges, &nfaces,
+                     &nattr) < 0) {
+      ex_close(exoid);
+      read_ok_everywhere(false);
+      return 0;
+    }
+    if (!blksizes[b]) continue;
+
+    blkelems[b] = exodus_element(elemtype, nperelem);
+    if (!blkelems[b] || (celldim && blkelems[b]->celldim != celldim)) {
+      ex_close(exoid);
+      read_ok_everywhere(false);
+      std::stringstream mesg_stream;
+      mesg_stream << "Cannot read element block " << blkids[b] <<
+          " (elements of type " << elemtype << " with " << nperelem <<
+          " nodes) of " << filename << " in parallel - only blocks of " <<
+          "linear elements of the same dimension are supported (read " <<
+          "it without parallel_read)";
+      Errors::Message mesg(mesg_stream.str());
+      Exceptions::Jali_throw(mesg);
+    }
+    celldim = blkelems[b]->celldim;
+  }
+
+  // Nodes of the elements in the range of this rank. Cell c is
+  // element cellgids[c] of block cellblks[c] and its nodes are
+  // cellverts[celloffsets[c]] through cellverts[celloffsets[c+1]-1]
+
+  int ebegin = static_cast<int>(static_cast<int64_t>(nelems)*myprocid/
+                                numprocs);
+  int eend = static_cast<int>(static_cast<int64_t>(nelems)*(myprocid+1)/
+                              numprocs);
+
+  std::vector<int> cellgids, cellblks, celloffsets(1, 0), cellverts;
+  int bstart = 0;  // number of the first element of block in file
+  for (int b = 0; b < nblocks; b++) {
+    int lo = std::max(ebegin, bstart);
+    int hi = std::min(eend, bstart + blksizes[b]);
+    if (lo < hi) {
+      int nv = blkelems[b]->nnodes;
+      std::vector<int> conn((hi-lo)*nv);
+      if (ex_get_partial_conn(exoid, EX_ELEM_BLOCK, blkids[b], lo-bstart+1,
+                              hi-lo, &(conn[0]), NULL, NULL) < 0) {
+        ex_close(exoid);
+        read_ok_everywhere(false);
+        return 0;
+      }
+      for (int e = lo; e < hi; e++) {
+        cellgids.push_back(e);
+        cellblks.push_back(b);
+        for (int k = 0; k < nv; k++)
+          cellverts.push_back(conn[(e-lo)*nv+k]-1);
+        celloffsets.push_back(cellverts.size());
+      }
+    }
+    bstart += blksizes[b];
+  }
+
+  // Coordinates of the nodes used by these elements, read in runs of
+  // node numbers with small gaps
+
+  std::vector<int> usednodes(cellverts);
+  std::sort(usednodes.begin(), usednodes.end());
+  usednodes.erase(std::unique(usednodes.begin(), usednodes.end()),
+                  usednodes.end());
+
+  std::unordered_map<int, std::array<double, 3>> nodexyz;
+  int const maxgap = 1024;
+  int nused = usednodes.size();
+  int i = 0;
+  while (i < nused) {
+    int j = i+1;
+    while (j < nused && usednodes[j] - usednodes[j-1] <= maxgap) j++;
+
+    int first = usednodes[i];
+    int count = usednodes[j-1] - first + 1;
+    std::vector<double> x(count), y(count), z(count, 0.0);
+    if (ex_get_partial_coord(exoid, first+1, count, &(x[0]), &(y[0]),
+                             (ndim > 2) ? &(z[0]) : NULL) < 0) {
+      ex_close(exoid);
+      read_ok_everywhere(false);
+      return 0;
+    }
+    for (int k = i; k < j; k++) {
+      int m = usednodes[k] - first;
+      nodexyz[usednodes[k]] = {{x[m], y[m], z[m]}};
+    }
+    i = j;
+  }
+
+  // Side and node sets - the set lists are read in full but only the
+  // entries of elements and nodes of this rank are kept. The side set
+  // entries of cell c are (set index, side) pairs in cellsidesets[c]
+
+  std::vector<int> sidesetids(nsidesets), nodesetids(nnodesets);
+  std::vector<std::vector<int>> cellsidesets(cellgids.size());
+  std::unordered_map<int, std::vector<int>> nodesets;
+
+  bool setsok = true;
+  if (nsidesets)
+    setsok = (ex_get_ids(exoid, EX_SIDE_SET, &(sidesetids[0])) >= 0);
+  for (int s = 0; setsok && s < nsidesets; s++) {
+    int nent = 0, ndf;
+    setsok = (ex_get_set_param(exoid, EX_SIDE_SET, sidesetids[s], &nent,
+                               &ndf) >= 0);
+    if (!setsok || !nent) continue;
+    std::vector<int> elems(nent), sides(nent);
+    setsok = (ex_get_set(exoid, EX_SIDE_SET, sidesetids[s], &(elems[0]),
+                         &(sides[0])) >= 0);
+    if (!setsok) continue;
+    for (int k = 0; k < nent; k++) {
+      int e = elems[k]-1;
+      if (e < ebegin || e >= eend) continue;
+      cellsidesets[e-ebegin].push_back(s);
+      cellsidesets[e-ebegin].push_back(sides[k]-1);
+    }
+  }
+
+  if (setsok && nnodesets)
+    setsok = (ex_get_ids(exoid, EX_NODE_SET, &(nodesetids[0])) >= 0);
+  for (int s = 0; setsok && s < nnodesets; s++) {
+    int nent = 0, ndf;
+    setsok = (ex_get_set_param(exoid, EX_NODE_SET, nodesetids[s], &nent,
+                               &ndf) >= 0);
+    if (!setsok || !nent) continue;
+    std::vector<int> nodes(nent);
+    setsok = (ex_get_set(exoid, EX_NODE_SET, nodesetids[s], &(nodes[0]),
+                         NULL) >= 0);
+    if (!setsok) continue;
+    for (auto const& n : nodes)
+      if (nodexyz.count(n-1))
+        nodesets[n-1].push_back(s);
+  }
+
+  ex_close(exoid);
+  if (!read_ok_everywhere(setsok)) return 0;
+
+  double tnow = MPI_Wtime();
+  read_timings_.emplace_back("read", tnow - tstart);
+  tstart = tnow;
+
+
+  // Split the elements along a space filling curve through their
+  // centroids unless the split in file order is to be kept
+
+  if (partitioner != Partitioner_type::INDEX &&
+      partitioner != Partitioner_type::BLOCK) {
+    int ncells = cellgids.size();
+    int dim = (ndim > 2) ? 3 : 2;
+
+    std::vector<JaliGeometry::Point> cen(ncells);
+    double lo[3] = {1.0e+20, 1.0e+20, 1.0e+20};
+    double hi[3] = {-1.0e+20, -1.0e+20, -1.0e+20};
+    for (int c = 0; c < ncells; c++) {
+      double sum[3] = {0.0, 0.0, 0.0};
+      for (int k = celloffsets[c]; k < celloffsets[c+1]; k++)
+        for (int d = 0; d < 3; d++)
+          sum[d] += nodexyz[cellverts[k]][d];
+      int nv = celloffsets[c+1] - celloffsets[c];
+      cen[c] = JaliGeometry::Point(sum[0]/nv, sum[1]/nv, sum[2]/nv);
+      for (int d = 0; d < dim; d++) {
+        lo[d] = std::min(lo[d], cen[c][d]);
+        hi[d] = std::max(hi[d], cen[c][d]);
+      }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, lo, 3, MPI_DOUBLE, MPI_MIN, mpicomm);
+    MPI_Allreduce(MPI_IN_PLACE, hi, 3, MPI_DOUBLE, MPI_MAX, mpicomm);
+
+    bool hilbert = (partitioner != Partitioner_type::MORTON);
+    std::vector<uint64_t> keys(ncells);
+    for (int c = 0; c < ncells; c++)
+      keys[c] = space_filling_curve_key(cen[c], dim, lo, hi, hilbert);
+
+    // Every rank contributes keys at regular positions in its sorted
+    // keys and the keys splitting all these samples into equal parts
+    // split the curve between ranks
+
+    int const max_samples = 64;
+    std::vector<uint64_t> sorted(keys);
+    std::sort(sorted.begin(), sorted.end());
+    int nsamples = std::min(max_samples, ncells);
+    std::vector<uint64_t> samples(nsamples);
+    for (int k = 0; k < nsamples; k++)
+      samples[k] = sorted[static_cast<int64_t>(2*k+1)*ncells/(2*nsamples)];
+
+    std::vector<int> nallsamples(numprocs), displs(numprocs+1, 0);
+    MPI_Allgather(&nsamples, 1, MPI_INT, &(nallsamples[0]), 1, MPI_INT,
+                  mpicomm);
+    for (int p = 0; p < numprocs; p++)
+      displs[p+1] = displs[p] + nallsamples[p];
+    std::vector<uint64_t> allsamples(displs[numprocs]+1);
+    MPI_Allgatherv(nsamples ? &(samples[0]) : NULL, nsamples, MPI_UINT64_T,
+                   &(allsamples[0]), &(nallsamples[0]), &(displs[0]),
+                   MPI_UINT64_T, mpicomm);
+    allsamples.resize(displs[numprocs]);
+    std::sort(allsamples.begin(), allsamples.end());
+
+    int ntotal = allsamples.size();
+    std::vector<uint64_t> splitters(numprocs-1);
+    for (int p = 0; p < numprocs-1; p++)
+      splitters[p] = ntotal ?
+          allsamples[static_cast<int64_t>(ntotal)*(p+1)/numprocs] : 0;
+
+    // Send each cell (with its nodes and set entries) to its rank as
+    // integers
+    //
+    //   cell number, block index, nsidesetentries, (set index, side) ...,
+    //   nverts, for each vertex
+    //     node number, nnodesets, set index ...
+    //
+    // and the coordinates of its nodes in the same order as reals
+
+    std::vector<std::vector<int>> isend(numprocs);
+    std::vector<std::vector<double>> rsend(numprocs);
+    for (int c = 0; c < ncells; c++) {
+      int p = std::upper_bound(splitters.begin(), splitters.end(), keys[c]) -
+          splitters.begin();
+      std::vector<int>& ibuf = isend[p];
+      std::vector<double>& rbuf = rsend[p];
+
+      ibuf.push_back(cellgids[c]);
+      ibuf.push_back(cellblks[c]);
+      ibuf.push_back(cellsidesets[c].size()/2);
+      ibuf.insert(ibuf.end(), cellsidesets[c].begin(), cellsidesets[c].end());
+      ibuf.push_back(celloffsets[c+1] - celloffsets[c]);
+      for (int k = celloffsets[c]; k < celloffsets[c+1]; k++) {
+        int n = cellverts[k];
+        ibuf.push_back(n);
+        auto it = nodesets.find(n);
+        if (it == nodesets.end()) {
+          ibuf.push_back(0);
+        } else {
+          ibuf.push_back(it->second.size());
+          ibuf.insert(ibuf.end(), it->second.begin(), it->second.end());
+        }
+        rbuf.insert(rbuf.end(), nodexyz[n].begin(), nodexyz[n].end());
+      }
+    }
+
+    std::vector<std::vector<char>> sendbufs(numprocs), irecv, rrecv;
+    for (int p = 0; p < numprocs; ++p) {
+      char const *bytes = reinterpret_cast<char const *>(isend[p].data());
+      sendbufs[p].assign(bytes, bytes + isend[p].size()*sizeof(int));
+    }
+    exchange_bytes(mpicomm, sendbufs, &irecv);
+    for (int p = 0; p < numprocs; ++p) {
+      char const *bytes = reinterpret_cast<char const *>(rsend[p].data());
+      sendbufs[p].assign(bytes, bytes + rsend[p].size()*sizeof(double));
+    }
+    exchange_bytes(mpicomm, sendbufs, &rrecv);
+
+    // Unpack the cells received
+
+    cellgids.clear();
+    cellblks.clear();
+    celloffsets.assign(1, 0);
+    cellverts.clear();
+    cellsidesets.clear();
+    nodexyz.clear();
+    nodesets.clear();
+
+    for (int p = 0; p < numprocs; ++p) {
+      int const *ibuf = reinterpret_cast<int const *>(irecv[p].data());
+      double const *rbuf = reinterpret_cast<double const *>(rrecv[p].data());
+      int ni = irecv[p].size()/sizeof(int);
+      int ii = 0, ir = 0;
+
+      while (ii < ni) {
+        cellgids.push_back(ibuf[ii++]);
+        cellblks.push_back(ibuf[ii++]);
+        int nss = ibuf[ii++];
+        cellsidesets.emplace_back(ibuf+ii, ibuf+ii+2*nss);
+        ii += 2*nss;
+
+        int nv = ibuf[ii++];
+        for (int k = 0; k < nv; k++) {
+          int n = ibuf[ii++];
+          int nns = ibuf[ii++];
+          if (!nodexyz.count(n)) {
+            nodexyz[n] = {{rbuf[ir], rbuf[ir+1], rbuf[ir+2]}};
+            if (nns)
+              nodesets[n].assign(ibuf+ii, ibuf+ii+nns);
+          }
+          ii += nns;
+          ir += 3;
+          cellverts.push_back(n);
+        }
+        celloffsets.push_back(cellverts.size());
+      }
+    }
+  }
+
+  tnow = MPI_Wtime();
+  read_timings_.emplace_back("partition", tnow - tstart);
+  tstart = tnow;
+
+
+  // Build the MSTK mesh of this rank. Vertices are created in the
+  // order of their node numbers and sides are identified by the
+  // sorted node numbers of their vertices. The first cell using a
+  // side creates it with the vertex order of the element's side, so
+  // later cells using it in the opposite order use it in reverse
+
+  MType celltype = (celldim == 3) ? MREGION : MFACE;
+
+  std::vector<int> nodenums;
+  nodenums.reserve(nodexyz.size());
+  for (auto const& nx : nodexyz)
+    nodenums.push_back(nx.first);
+  std::sort(nodenums.begin(), nodenums.end());
+
+  std::unordered_map<int, MVertex_ptr> gid2vertex;
+  for (auto const& n : nodenums) {
+    MVertex_ptr mv = MV_New(mesh);
+    MV_Set_Coords(mv, &(nodexyz[n][0]));
+    MEnt_Set_GlobalID(mv, n+1);
+    gid2vertex[n] = mv;
+  }
+
+  std::vector<MSet_ptr> blksets(nblocks), sidesets(nsidesets),
+      nodesetsets(nnodesets);
+  for (int b = 0; b < nblocks; b++) {
+    std::string name = "matset_" + std::to_string(blkids[b]);
+    blksets[b] = MSet_New(mesh, name.c_str(), celltype);
+  }
+  for (int s = 0; s < nsidesets; s++) {
+    std::string name = "sideset_" + std::to_string(sidesetids[s]);
+    sidesets[s] = MSet_New(mesh, name.c_str(),
+                           (celldim == 3) ? MFACE : MEDGE);
+  }
+  for (int s = 0; s < nnodesets; s++) {
+    std::string name = "nodeset_" + std::to_string(nodesetids[s]);
+    nodesetsets[s] = MSet_New(mesh, name.c_str(), MVERTEX);
+  }
+
+  std::map<std::vector<int>,
+           std::pair<MEntity_ptr, std::vector<int>>> verts2side;
+  std::vector<std::vector<MEntity_ptr>> sidesetents(nsidesets);
+
+  int ncells = cellgids.size();
+  for (int c = 0; c < ncells; c++) {
+    int b = cellblks[c];
+    ExodusElement const& et = *(blkelems[b]);
+    int const *cverts = &(cellverts[celloffsets[c]]);
+
+    std::vector<MEntity_ptr> csides(et.nsides);
+    std::vector<int> csidedirs(et.nsides);
+    for (int i = 0; i < et.nsides; i++) {
+      int nsv = et.sidesize[i];
+      std::vector<int> svgids(nsv);
+      std::vector<MVertex_ptr> sverts(nsv);
+      for (int j = 0; j < nsv; j++) {
+        svgids[j] = cverts[et.sidenodes[i][j]];
+        sverts[j] = gid2vertex[svgids[j]];
+      }
+
+      int dir = 1;
+      std::vector<int> key(svgids);
+      std::sort(key.begin(), key.end());
+      auto sit = verts2side.find(key);
+      if (sit != verts2side.end()) {
+        std::vector<int> const& prevgids = sit->second.second;
+        int pos = std::find(prevgids.begin(), prevgids.end(), svgids[0]) -
+            prevgids.begin();
+        bool const along = (nsv == 2) ? (pos == 0) :
+            (prevgids[(pos+1)%nsv] == svgids[1]);
+        if (!along)
+          dir = 0;
+        csides[i] = sit->second.first;
+      } else {
+        if (celldim == 3) {
+          csides[i] = MF_New(mesh);
+          MF_Set_Vertices((MFace_ptr) csides[i], nsv, &(sverts[0]));
+        } else {
+          csides[i] = ME_New(mesh);
+          ME_Set_Vertex((MEdge_ptr) csides[i], 0, sverts[0]);
+          ME_Set_Vertex((MEdge_ptr) csides[i], 1, sverts[1]);
+        }
+        verts2side[key] = std::make_pair(csides[i], svgids);
+      }
+      csidedirs[i] = dir;
+    }
+
+    MEntity_ptr cell;
+    if (celldim == 3) {
+      cell = MR_New(mesh);
+      MR_Set_Faces((MRegion_ptr) cell, et.nsides, (MFace_ptr *) &(csides[0]),
+                   &(csidedirs[0]));
+      MR_Set_GEntID((MRegion_ptr) cell, blkids[b]);
+    } else {
+      cell = MF_New(mesh);
+      MF_Set_Edges((MFace_ptr) cell, et.nsides, (MEdge_ptr *) &(csides[0]),
+                   &(csidedirs[0]));
+      MF_Set_GEntDim((MFace_ptr) cell, 2);
+      MF_Set_GEntID((MFace_ptr) cell, blkids[b]);
+    }
+    MEnt_Set_GlobalID(cell, cellgids[c]+1);
+    MSet_Add(blksets[b], cell);
+
+    for (int k = 0; k < cellsidesets[c].size(); k += 2) {
+      int side = cellsidesets[c][k+1];
+      if (side >= 0 && side < et.nsides)
+        sidesetents[cellsidesets[c][k]].push_back(csides[side]);
+    }
+  }
+
+  // A side is listed in a side set once even if the set names it
+  // through both cells using it
+
+  for (int s = 0; s < nsidesets; s++) {
+    std::sort(sidesetents[s].begin(), sidesetents[s].end());
+    sidesetents[s].erase(std::unique(sidesetents[s].begin(),
+                                     sidesetents[s].end()),
+                         sidesetents[s].end());
+    for (auto const& ent : sidesetents[s])
+      MSet_Add(sidesets[s], ent);
+  }
+  for (auto const& ns : nodesets)
+    for (auto const& s : ns.second)
+      MSet_Add(nodesetsets[s], gid2vertex[ns.first]);
+
+  tnow = MPI_Wtime();
+  read_timings_.emplace_back("build", tnow - tstart);
+  tstart = tnow;
+
+
+  // Match up the meshes of the ranks by the global IDs of their
+  // vertices and cells and build ghost layers (labeled sets get no
+  // ghost entities)
+
+  int input_type = 1;  // Global IDs of vertices and cells are given
+  int ok = MSTK_Weave_DistributedMeshes(mesh, celldim,
+                                        num_ghost_layers_distmesh,
+                                        input_type, mpicomm);
+
+  read_timings_.emplace_back("weave", MPI_Wtime() - tstart);
+
+  return ok;
+}
+
+
 // Destructor with cleanup
 
 Mesh_MSTK::~Mesh_MSTK() {
+  if (!detached_) release_mstk_();
+}
+
+
+// Delete the MSTK mesh and everything Jali keeps on it
+
+void Mesh_MSTK::release_mstk_() {
   if (Mesh::faces_requested) delete [] faceflip;
   if (Mesh::edges_requested) delete [] edgeflip;
 
@@ -1187,12 +2098,14 @@ Mesh_MSTK::~Mesh_MSTK() {
   if (rparentatt) MAttrib_Delete(rparentatt);
 
   MESH_Delete(mesh);
-}
+}  // Mesh_MSTK::release_mstk_
 
 
 // Get cell type
 
 Cell_type Mesh_MSTK::cell_get_type(const Entity_ID cellid) const {
+  if (detached_data_cached_) return detached_cell_types_[cellid];
+
   MEntity_ptr cell;
   int ival;
   Cell_type celltype;
@@ -1226,6 +2139,7 @@ void Mesh_MSTK::cell_get_faces_and_dirs_ordered(const Entity_ID cellid,
                                                 Entity_ID_List *faceids,
                                                 std::vector<dir_t> *face_dirs)
     const {
+  attach_();
 
   MEntity_ptr cell;
 
@@ -1363,6 +2277,7 @@ void Mesh_MSTK::cell_get_faces_and_dirs_unordered(const Entity_ID cellid,
                                                   Entity_ID_List *faceids,
                                                   std::vector<dir_t> *face_dirs)
     const {
+  attach_();
 
   MEntity_ptr cell;
 
@@ -1475,6 +2390,7 @@ void Mesh_MSTK::cell_get_faces_and_dirs_internal(const Entity_ID cellid,
 
 void Mesh_MSTK::cell_get_edges_internal(const Entity_ID cellid,
                                         Entity_ID_List *edgeids) const {
+  attach_();
 
   ASSERT(edges_initialized);
 
@@ -1554,6 +2470,7 @@ void Mesh_MSTK::cell_2D_get_edges_and_dirs_internal(const Entity_ID cellid,
                                                     Entity_ID_List *edgeids,
                                                     std::vector<dir_t> *edgedirs)
     const {
+  attach_();
 
   ASSERT(cell_dimension() == 2);
 
@@ -1628,6 +2545,14 @@ void Mesh_MSTK::cell_get_nodes(const Entity_ID cellid,
 
   ASSERT(nodeids != NULL);
 
+  if (detached_data_cached_) {
+    nodeids->assign(&(detached_cell_nodes_[0]) +
+                    detached_cell_node_offsets_[cellid],
+                    &(detached_cell_nodes_[0]) +
+                    detached_cell_node_offsets_[cellid+1]);
+    return;
+  }
+
   cell = cell_id_to_handle[cellid];
 
   /* Reserved for next major MSTK release
@@ -1682,6 +2607,7 @@ void Mesh_MSTK::face_get_edges_and_dirs_internal(const Entity_ID faceid,
                                                  Entity_ID_List *edgeids,
                                                  std::vector<dir_t> *edge_dirs,
                                                  bool ordered) const {
+  attach_();
 
   ASSERT(edgeids != NULL);
 
@@ -1768,6 +2694,14 @@ void Mesh_MSTK::face_get_nodes(const Entity_ID faceid,
 
   ASSERT(nodeids != NULL);
 
+  if (detached_data_cached_) {
+    nodeids->assign(&(detached_face_nodes_[0]) +
+                    detached_face_node_offsets_[faceid],
+                    &(detached_face_nodes_[0]) +
+                    detached_face_node_offsets_[faceid+1]);
+    return;
+  }
+
   genface = face_id_to_handle[faceid];
 
   if (cell_dimension() == 3) {  // Volume mesh
@@ -1816,6 +2750,7 @@ void Mesh_MSTK::face_get_nodes(const Entity_ID faceid,
 void Mesh_MSTK::edge_get_nodes_internal(const Entity_ID edgeid,
                                         Entity_ID *nodeid0,
                                         Entity_ID *nodeid1) const {
+  attach_();
   ASSERT(edges_initialized);
 
   MEdge_ptr edge = (MEdge_ptr) edge_id_to_handle[edgeid];
@@ -1837,6 +2772,7 @@ void Mesh_MSTK::edge_get_nodes_internal(const Entity_ID edgeid,
 void Mesh_MSTK::node_get_cells(const Entity_ID nodeid,
                                const Entity_type ptype,
                                std::vector<Entity_ID> *cellids) const {
+  attach_();
   int idx, lid, nc;
   List_ptr cell_list;
   MEntity_ptr ment;
@@ -1927,6 +2863,7 @@ void Mesh_MSTK::node_get_cells(const Entity_ID nodeid,
 void Mesh_MSTK::node_get_faces(const Entity_ID nodeid,
                                const Entity_type ptype,
                                std::vector<Entity_ID> *faceids) const {
+  attach_();
   int idx, lid, n;
   List_ptr face_list;
   MEntity_ptr ment;
@@ -2017,6 +2954,7 @@ void Mesh_MSTK::node_get_cell_faces(const Entity_ID nodeid,
                                     const Entity_ID cellid,
                                     const Entity_type ptype,
                                     std::vector<Entity_ID> *faceids) const {
+  attach_();
   int idx, lid, n;
   List_ptr cell_list;
   MEntity_ptr ment;
@@ -2102,6 +3040,7 @@ void Mesh_MSTK::node_get_cell_faces(const Entity_ID nodeid,
 void Mesh_MSTK::face_get_cells_internal(const Entity_ID faceid,
                                         const Entity_type ptype,
                                         std::vector<Entity_ID> *cellids) const {
+  attach_();
   int lid, n;
 
   ASSERT(faces_initialized);
@@ -2190,6 +3129,7 @@ void Mesh_MSTK::cell_get_face_adj_cells(const Entity_ID cellid,
                                         const Entity_type ptype,
                                         std::vector<Entity_ID> *fadj_cellids)
     const {
+  attach_();
 
   int lid;
 
@@ -2280,6 +3220,7 @@ void Mesh_MSTK::cell_get_node_adj_cells(const Entity_ID cellid,
                                         const Entity_type ptype,
                                         std::vector<Entity_ID> *nadj_cellids)
     const {
+  attach_();
 
   int lid, mkid;
   List_ptr cell_list;
@@ -2375,6 +3316,11 @@ void Mesh_MSTK::node_get_coordinates(const Entity_ID nodeid,
 
   ASSERT(ncoords != NULL);
 
+  if (detached_data_cached_) {
+    ncoords->set(spdim, &(detached_coords_[spdim*nodeid]));
+    return;
+  }
+
   vtx = vtx_id_to_handle[nodeid];
 
   MV_Coords(vtx, coords);
@@ -2390,6 +3336,11 @@ void Mesh_MSTK::node_get_coordinates(const Entity_ID nodeid,
   ASSERT(ncoords != NULL);
   ASSERT(spdim == 3);
 
+  if (detached_data_cached_) {
+    std::copy_n(&(detached_coords_[3*nodeid]), 3, ncoords->begin());
+    return;
+  }
+
   vtx = vtx_id_to_handle[nodeid];
 
   MV_Coords(vtx, coords);
@@ -2407,6 +3358,11 @@ void Mesh_MSTK::node_get_coordinates(const Entity_ID nodeid,
   ASSERT(ncoords != NULL);
   ASSERT(spdim == 2);
 
+  if (detached_data_cached_) {
+    std::copy_n(&(detached_coords_[2*nodeid]), 2, ncoords->begin());
+    return;
+  }
+
   vtx = vtx_id_to_handle[nodeid];
 
   MV_Coords(vtx, coords);
@@ -2431,6 +3387,17 @@ void Mesh_MSTK::cell_get_coordinates(const Entity_ID cellid,
 
   ASSERT(ccoords != NULL);
 
+  if (detached_data_cached_) {
+    int offset = detached_cell_node_offsets_[cellid];
+    nn = detached_cell_node_offsets_[cellid+1] - offset;
+    ccoords->resize(nn);
+    for (int i = 0; i < nn; ++i) {
+      int n = detached_cell_nodes_[offset+i];
+      (*ccoords)[i].set(spdim, &(detached_coords_[spdim*n]));
+    }
+    return;
+  }
+
   cell = cell_id_to_handle[cellid];
 
   if (celldim == 3) {
@@ -2483,6 +3450,17 @@ void Mesh_MSTK::face_get_coordinates(const Entity_ID faceid,
   ASSERT(faces_initialized);
   ASSERT(fcoords != NULL);
 
+  if (detached_data_cached_) {
+    int offset = detached_face_node_offsets_[faceid];
+    int nn = detached_face_node_offsets_[faceid+1] - offset;
+    fcoords->resize(nn);
+    for (int i = 0; i < nn; ++i) {
+      int n = detached_face_nodes_[offset+i];
+      (*fcoords)[i].set(spdim, &(detached_coords_[spdim*n]));
+    }
+    return;
+  }
+
   genface = face_id_to_handle[faceid];
 
   if (celldim == 3) {
@@ -2528,19 +3506,27 @@ void Mesh_MSTK::face_get_coordinates(const Entity_ID faceid,
 
 void Mesh_MSTK::node_set_coordinates(const Jali::Entity_ID nodeid,
                                       const double *coords) {
-  MVertex_ptr v = vtx_id_to_handle[nodeid];
-  MV_Set_Coords(v, (double *) coords);
+  check_not_frozen("Mesh_MSTK::node_set_coordinates");
+
+  int spdim = Mesh::space_dimension();
+  if (detached_data_cached_)
+    std::copy_n(coords, spdim, &(detached_coords_[spdim*nodeid]));
+
+  if (!detached_) {
+    MVertex_ptr v = vtx_id_to_handle[nodeid];
+    MV_Set_Coords(v, (double *) coords);
+  }
+
+  node_coordinates_changed();
 }
 
 void Mesh_MSTK::node_set_coordinates(const Jali::Entity_ID nodeid,
                                      const JaliGeometry::Point coords) {
-  MVertex_ptr v = vtx_id_to_handle[nodeid];
-
   double coordarray[3] = {0.0, 0.0, 0.0};
   for (int i = 0; i < Mesh::space_dimension(); i++)
     coordarray[i] = coords[i];
 
-  MV_Set_Coords(v, (double *) coordarray);
+  node_set_coordinates(nodeid, coordarray);
 }
 
 
@@ -3000,14 +3986,23 @@ Mesh_MSTK::get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr rgn,
 
   std::string internal_name = internal_name_of_set(rgn, kind);
   std::string label = rgn->label();
-  std::string entity_type = rgn->entity_str();
+  Entity_kind rgn_kind = labeled_set_kind(rgn->entity_str());
 
   owned_entities->clear();
   ghost_entities->clear();
 
+  if (detached_data_cached_) {
+    auto it = detached_sets_.find(internal_name);
+    if (it != detached_sets_.end()) {
+      *owned_entities = it->second.owned;
+      *ghost_entities = it->second.ghost;
+    }
+    return;
+  }
+
   switch (kind) {
     case Entity_kind::CELL: {   // cellsets
-      if (entity_type != "CELL" && entity_type != "Entity_kind::CELL") {
+      if (rgn_kind != Entity_kind::CELL) {
         Errors::Message mesg("Entity type of labeled set region and get_labeled_set_entities request do not match");
         Exceptions::Jali_throw(mesg);
       }
@@ -3046,7 +4041,7 @@ Mesh_MSTK::get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr rgn,
       break;
     }
     case Entity_kind::FACE: {  // sidesets
-      if (entity_type != "FACE" && entity_type != "Entity_kind::FACE") {
+      if (rgn_kind != Entity_kind::FACE) {
         Errors::Message mesg("Entity type of labeled set region and get_labeled_set_entities request do not match");
         Exceptions::Jali_throw(mesg);
       }
@@ -3065,7 +4060,7 @@ Mesh_MSTK::get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr rgn,
       break;
     }
     case Entity_kind::NODE: {  // Nodesets
-      if (entity_type != "NODE" && entity_type != "Entity_kind::NODE") {
+      if (rgn_kind != Entity_kind::NODE) {
         Errors::Message mesg("Entity type of labeled set region and get_labeled_set_entities request do not match");
         Exceptions::Jali_throw(mesg);
       }
@@ -3261,31 +4256,46 @@ Entity_ID Mesh_MSTK::entity_get_parent(const Entity_kind kind,
   int ival;
   double rval;
   void *pval;
-  MEntity_ptr ment;
-  MAttrib_ptr att;
+  MAttrib_ptr att = NULL;
 
   switch (kind) {
     case Entity_kind::CELL:
       att = (cell_dimension() == 3) ? rparentatt : fparentatt;
-      ment = (MEntity_ptr) cell_id_to_handle[entid];
       break;
     case Entity_kind::FACE:
       att = (cell_dimension() == 3) ? fparentatt : eparentatt;
-      ment = (MEntity_ptr) face_id_to_handle[entid];
       break;
     case Entity_kind::EDGE:
       att = eparentatt;
-      ment = (MEntity_ptr) edge_id_to_handle[entid];
       break;
     case Entity_kind::NODE:
-      if (!vparentatt) return 0;
       att = vparentatt;
-      ment = (MEntity_ptr) vtx_id_to_handle[entid];
+      break;
+    default:
       break;
   }
 
+  // Meshes not derived from another mesh (including detached ones,
+  // whose handle maps are empty) have no parent attributes
+
   if (!att) return 0;
 
+  MEntity_ptr ment;
+  switch (kind) {
+    case Entity_kind::CELL:
+      ment = (MEntity_ptr) cell_id_to_handle[entid];
+      break;
+    case Entity_kind::FACE:
+      ment = (MEntity_ptr) face_id_to_handle[entid];
+      break;
+    case Entity_kind::EDGE:
+      ment = (MEntity_ptr) edge_id_to_handle[entid];
+      break;
+    default:
+      ment = (MEntity_ptr) vtx_id_to_handle[entid];
+      break;
+  }
+
   MEnt_Get_AttVal(ment, att, &ival, &rval, &pval);
   if (pval)
     return MEnt_ID((MEntity_ptr)pval)-1;
@@ -3302,6 +4312,9 @@ Entity_ID Mesh_MSTK::GID(const Entity_ID lid, const Entity_kind kind) const {
   MEntity_ptr ent;
   unsigned int gid;
 
+  if (detached_data_cached_)
+    return serial_run ? lid : detached_gids_[static_cast<int>(kind)][lid];
+
   switch (kind) {
   case Entity_kind::NODE:
     ent = vtx_id_to_handle[lid];
@@ -3330,6 +4343,471 @@ Entity_ID Mesh_MSTK::GID(const Entity_ID lid, const Entity_kind kind) const {
 
 
 
+// Bytes of heap memory in use by the process, or 0 where this
+// cannot be queried
+
+static std::size_t heap_bytes_in_use() {
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#endif
+#endif
+  return 0;
+}
+
+
+template<class T>
+static std::size_t vector_bytes(std::vector<T> const& v) {
+  return v.capacity()*sizeof(T);
+}
+
+
+// Release the MSTK representation of the mesh, keeping flat copies of
+// whatever is not cached in the base class
+
+std::size_t Mesh_MSTK::detach() {
+  check_not_frozen("Mesh_MSTK::detach");
+  if (detached_) return 0;
+
+  int celldim = cell_dimension();
+  bool cached = cell2face_info_cached && face2cell_info_cached &&
+      (!Mesh::edges_requested || edge2node_info_cached);
+  if ((celldim != 2 && celldim != 3) || !faces_initialized || !cached ||
+      parent_mesh || has_derived_meshes_) {
+    std::cerr << "Mesh_MSTK::detach - Only 2D and 3D meshes with cached " <<
+        "faces that are not derived from or parents of other meshes can " <<
+        "be detached - keeping the MSTK mesh\n";
+    return 0;
+  }
+
+  std::size_t heap_before = heap_bytes_in_use();
+
+  if (!detached_data_cached_) cache_detached_data_();
+  save_fields_();
+
+  std::size_t mapbytes = vector_bytes(vtx_id_to_handle) +
+      vector_bytes(edge_id_to_handle) + vector_bytes(face_id_to_handle) +
+      vector_bytes(cell_id_to_handle) +
+      (num_faces() + (Mesh::edges_requested ? num_edges() : 0))*sizeof(bool);
+
+  detached_rep_ = MESH_RepType(mesh);
+  release_mstk_();
+  clear_internals_();
+  OwnedVerts = NotOwnedVerts = NULL;
+  OwnedEdges = NotOwnedEdges = NULL;
+  OwnedFaces = NotOwnedFaces = NULL;
+  OwnedCells = GhostCells = BoundaryGhostCells = NULL;
+  boundary_ghost_att = NULL;
+  edgeflip = NULL;
+  entities_deleted = false;
+  deleted_vertices = deleted_edges = deleted_faces = deleted_regions = NULL;
+
+  std::vector<MEntity_ptr>().swap(vtx_id_to_handle);
+  std::vector<MEntity_ptr>().swap(edge_id_to_handle);
+  std::vector<MEntity_ptr>().swap(face_id_to_handle);
+  std::vector<MEntity_ptr>().swap(cell_id_to_handle);
+  detached_ = true;
+
+  // Without a way to measure the heap, only count what Jali itself
+  // kept on top of the MSTK mesh
+
+  std::size_t heap_after = heap_bytes_in_use();
+  if (heap_before)
+    return (heap_before > heap_after) ? heap_before - heap_after : 0;
+  else
+    return mapbytes;
+}  // Mesh_MSTK::detach
+
+
+// Copy the node coordinates, the nodes of cells and faces, the cell
+// types, the classification and global IDs of the entities and the
+// labeled sets into flat arrays
+
+void Mesh_MSTK::cache_detached_data_() {
+  int spdim = space_dimension();
+  int nnodes = num_nodes();
+  int nfaces = num_faces();
+  int ncells = num_cells();
+
+  detached_coords_.resize(spdim*nnodes);
+  for (int n = 0; n < nnodes; ++n) {
+    double xyz[3];
+    MV_Coords(vtx_id_to_handle[n], xyz);
+    std::copy_n(xyz, spdim, &(detached_coords_[spdim*n]));
+  }
+
+  Entity_ID_List nodeids;
+  detached_cell_node_offsets_.assign(1, 0);
+  detached_cell_node_offsets_.reserve(ncells+1);
+  detached_cell_types_.resize(ncells);
+  for (int c = 0; c < ncells; ++c) {
+    cell_get_nodes(c, &nodeids);
+    detached_cell_nodes_.insert(detached_cell_nodes_.end(), nodeids.begin(),
+                                nodeids.end());
+    detached_cell_node_offsets_.push_back(detached_cell_nodes_.size());
+    detached_cell_types_[c] = cell_get_type(c);
+  }
+
+  detached_face_node_offsets_.assign(1, 0);
+  detached_face_node_offsets_.reserve(nfaces+1);
+  for (int f = 0; f < nfaces; ++f) {
+    face_get_nodes(f, &nodeids);
+    detached_face_nodes_.insert(detached_face_nodes_.end(), nodeids.begin(),
+                                nodeids.end());
+    detached_face_node_offsets_.push_back(detached_face_nodes_.size());
+  }
+
+  detached_cell_nodes_.shrink_to_fit();
+  detached_face_nodes_.shrink_to_fit();
+
+  // Classification of the entities on the geometric model (the
+  // export groups cells into element blocks by it) and their parallel
+  // information
+
+  for (Entity_kind kind : {Entity_kind::NODE, Entity_kind::EDGE,
+          Entity_kind::FACE, Entity_kind::CELL}) {
+    std::vector<MEntity_ptr> const *handles;
+    switch (kind) {
+      case Entity_kind::NODE: handles = &vtx_id_to_handle; break;
+      case Entity_kind::EDGE: handles = &edge_id_to_handle; break;
+      case Entity_kind::FACE: handles = &face_id_to_handle; break;
+      default: handles = &cell_id_to_handle; break;
+    }
+    int nent = handles->size();
+    std::vector<int>& gentdims = detached_gentdims_[static_cast<int>(kind)];
+    std::vector<int>& gentids = detached_gentids_[static_cast<int>(kind)];
+    gentdims.resize(nent);
+    gentids.resize(nent);
+    for (int i = 0; i < nent; ++i) {
+      gentdims[i] = MEnt_GEntDim((*handles)[i]);
+      gentids[i] = MEnt_GEntID((*handles)[i]);
+    }
+    if (serial_run) continue;
+
+    std::vector<int>& gids = detached_gids_[static_cast<int>(kind)];
+    std::vector<int>& masters = detached_masters_[static_cast<int>(kind)];
+    std::vector<PType>& ptypes = detached_ptypes_[static_cast<int>(kind)];
+    gids.resize(nent);
+    masters.resize(nent);
+    ptypes.resize(nent);
+    for (int i = 0; i < nent; ++i) {
+      gids[i] = MEnt_GlobalID((*handles)[i])-1;
+      masters[i] = MEnt_MasterParID((*handles)[i]);
+      ptypes[i] = MEnt_PType((*handles)[i]);
+    }
+  }
+
+  // Labeled sets are answered from the copies from now on
+
+  JaliGeometry::GeometricModelPtr gm = Mesh::geometric_model();
+  unsigned int ngr = gm ? gm->Num_Regions() : 0;
+  for (int i = 0; i < ngr; ++i) {
+    JaliGeometry::RegionPtr rgn = gm->Region_i(i);
+    if (rgn->type() != JaliGeometry::Region_type::LABELEDSET) continue;
+
+    JaliGeometry::LabeledSetRegionPtr lsrgn =
+        dynamic_cast<JaliGeometry::LabeledSetRegionPtr> (rgn);
+
+    Entity_kind kind = labeled_set_kind(lsrgn->entity_str());
+    if (kind != Entity_kind::CELL && kind != Entity_kind::FACE &&
+        kind != Entity_kind::NODE)
+      continue;
+
+    SavedSet saved;
+    saved.mtype = entity_kind_to_mtype(kind);
+    get_labeled_set_entities(lsrgn, kind, &saved.owned, &saved.ghost);
+    detached_sets_[internal_name_of_set(rgn, kind)] = saved;
+  }
+
+  detached_data_cached_ = true;
+}  // Mesh_MSTK::cache_detached_data_
+
+
+// Handles of the entities of an MSTK type by Jali local ID (NULL if
+// the entities of this type have no Jali IDs)
+
+std::vector<MEntity_ptr> *Mesh_MSTK::handles_of_mtype_(MType const mtype) {
+  int celldim = cell_dimension();
+  switch (mtype) {
+    case MVERTEX: return &vtx_id_to_handle;
+    case MEDGE:
+      if (celldim == 2) return &face_id_to_handle;
+      return edges_initialized ? &edge_id_to_handle : NULL;
+    case MFACE: return (celldim == 2) ? &cell_id_to_handle : &face_id_to_handle;
+    case MREGION: return (celldim == 3) ? &cell_id_to_handle : NULL;
+    default: return NULL;
+  }
+}
+
+
+// Copy the fields stored on the mesh so that they can be put back on
+// a re-created MSTK mesh. Fields on entities without Jali IDs (like
+// edges of 3D meshes without edges) cannot be put back and are lost
+
+void Mesh_MSTK::save_fields_() {
+  detached_fields_.clear();
+
+  MAttrib_ptr mattrib;
+  char attname[256];
+  int idx = 0;
+  while ((mattrib = MESH_Next_Attrib(mesh, &idx))) {
+    if (mattrib == celltype_att || mattrib == boundary_ghost_att) continue;
+
+    SavedField field;
+    MAttrib_Get_Name(mattrib, attname);
+    field.name = attname;
+    field.mtype = MAttrib_Get_EntDim(mattrib);
+    field.atttype = MAttrib_Get_Type(mattrib);
+    if (field.atttype == POINTER) continue;
+
+    std::vector<MEntity_ptr> *handles = handles_of_mtype_(field.mtype);
+    if (!handles) {
+      std::cerr << "Mesh_MSTK::detach - Field " << field.name <<
+          " is not on nodes, faces or cells and will be lost\n";
+      continue;
+    }
+
+    field.ncomp = (field.atttype == VECTOR || field.atttype == TENSOR) ?
+        MAttrib_Get_NumComps(mattrib) : 1;
+    int nent = handles->size();
+    field.values.assign(field.ncomp*nent, 0.0);
+    for (int i = 0; i < nent; ++i) {
+      int ival;
+      double rval;
+      void *pval;
+      if (!MEnt_Get_AttVal((*handles)[i], mattrib, &ival, &rval, &pval))
+        continue;
+      if (field.atttype == INT)
+        field.values[i] = ival;
+      else if (field.atttype == DOUBLE)
+        field.values[i] = rval;
+      else if (pval)
+        std::copy_n((double *) pval, field.ncomp,
+                    &(field.values[field.ncomp*i]));
+    }
+    detached_fields_.push_back(field);
+  }
+}  // Mesh_MSTK::save_fields_
+
+
+// Re-create the MSTK mesh from the flat copies of the mesh data and
+// the adjacencies cached in the base class. Entities are created in
+// the order of their local IDs and faces with the node order Jali
+// reports for them, so no face needs to be flipped (edges still may)
+
+void Mesh_MSTK::reattach_() {
+  int celldim = cell_dimension();
+  int spdim = space_dimension();
+  int nnodes = num_nodes();
+  int nedges = Mesh::edges_requested ? num_edges() : 0;
+  int nfaces = num_faces();
+  int ncells = num_cells();
+
+  mesh = MESH_New(detached_rep_);
+  if (!serial_run)
+    MESH_Set_Prtn(mesh, myprocid, numprocs);
+
+  vtx_id_to_handle.resize(nnodes);
+  for (int n = 0; n < nnodes; ++n) {
+    double xyz[3] = {0.0, 0.0, 0.0};
+    std::copy_n(&(detached_coords_[spdim*n]), spdim, xyz);
+    MVertex_ptr mv = MV_New(mesh);
+    MV_Set_Coords(mv, xyz);
+    MEnt_Set_ID(mv, n+1);
+    vtx_id_to_handle[n] = mv;
+  }
+
+  face_id_to_handle.resize(nfaces);
+  faceflip = new bool[nfaces];
+  for (int f = 0; f < nfaces; ++f) {
+    int offset = detached_face_node_offsets_[f];
+    int nfn = detached_face_node_offsets_[f+1] - offset;
+    std::vector<MVertex_ptr> fverts(nfn);
+    for (int i = 0; i < nfn; ++i)
+      fverts[i] = vtx_id_to_handle[detached_face_nodes_[offset+i]];
+
+    MEntity_ptr face;
+    if (celldim == 3) {
+      face = MF_New(mesh);
+      MF_Set_Vertices((MFace_ptr) face, nfn, &(fverts[0]));
+    } else {
+      face = ME_New(mesh);
+      ME_Set_Vertex((MEdge_ptr) face, 0, fverts[0]);
+      ME_Set_Vertex((MEdge_ptr) face, 1, fverts[1]);
+    }
+    MEnt_Set_ID(face, f+1);
+    face_id_to_handle[f] = face;
+    faceflip[f] = false;
+  }
+
+  cell_id_to_handle.resize(ncells);
+  MType celltype = (celldim == 3) ? MREGION : MFACE;
+  celltype_att = MAttrib_New(mesh, "Cell_type", INT, celltype);
+  for (int c = 0; c < ncells; ++c) {
+    Entity_ID_List const& cfaces = cell_face_ids[c];
+    std::vector<dir_t> const& cfdirs = cell_face_dirs[c];
+    int ncf = cfaces.size();
+    std::vector<MEntity_ptr> csides(ncf);
+    std::vector<int> csidedirs(ncf);
+    for (int i = 0; i < ncf; ++i) {
+      csides[i] = face_id_to_handle[cfaces[i]];
+      csidedirs[i] = (cfdirs[i] > 0) ? 1 : 0;
+    }
+
+    MEntity_ptr cell;
+    if (celldim == 3) {
+      cell = MR_New(mesh);
+      MR_Set_Faces((MRegion_ptr) cell, ncf, (MFace_ptr *) &(csides[0]),
+                   &(csidedirs[0]));
+    } else {
+      cell = MF_New(mesh);
+      MF_Set_Edges((MFace_ptr) cell, ncf, (MEdge_ptr *) &(csides[0]),
+                   &(csidedirs[0]));
+    }
+    MEnt_Set_ID(cell, c+1);
+    MEnt_Set_AttVal(cell, celltype_att,
+                    static_cast<int>(detached_cell_types_[c]), 0.0, NULL);
+    cell_id_to_handle[c] = cell;
+  }
+
+  // Edges (created along with the faces in 3D and the same as the
+  // faces in 2D) are found from their nodes
+
+  if (Mesh::edges_requested) {
+    edge_id_to_handle.resize(nedges);
+    edgeflip = new bool[nedges];
+    for (int e = 0; e < nedges; ++e) {
+      std::array<Entity_ID, 2> const& enodes = edge_node_ids[e];
+      MEdge_ptr edge = MVs_CommonEdge(vtx_id_to_handle[enodes[0]],
+                                      vtx_id_to_handle[enodes[1]]);
+      if (celldim == 3) MEnt_Set_ID(edge, e+1);
+      edge_id_to_handle[e] = edge;
+      edgeflip[e] = (ME_Vertex(edge, 0) != vtx_id_to_handle[enodes[0]]);
+    }
+  }
+
+  // Classification on the geometric model and parallel information
+
+  for (Entity_kind kind : {Entity_kind::NODE, Entity_kind::EDGE,
+          Entity_kind::FACE, Entity_kind::CELL}) {
+    std::vector<MEntity_ptr> const *handles;
+    switch (kind) {
+      case Entity_kind::NODE: handles = &vtx_id_to_handle; break;
+      case Entity_kind::EDGE: handles = &edge_id_to_handle; break;
+      case Entity_kind::FACE: handles = &face_id_to_handle; break;
+      default: handles = &cell_id_to_handle; break;
+    }
+    std::vector<int> const& gentdims =
+        detached_gentdims_[static_cast<int>(kind)];
+    std::vector<int> const& gentids =
+        detached_gentids_[static_cast<int>(kind)];
+    int ngent = std::min(handles->size(), gentdims.size());
+    for (int i = 0; i < ngent; ++i) {
+      MEnt_Set_GEntDim((*handles)[i], gentdims[i]);
+      MEnt_Set_GEntID((*handles)[i], gentids[i]);
+    }
+    if (serial_run) continue;
+
+    std::vector<int> const& gids = detached_gids_[static_cast<int>(kind)];
+    std::vector<int> const& masters =
+        detached_masters_[static_cast<int>(kind)];
+    std::vector<PType> const& ptypes =
+        detached_ptypes_[static_cast<int>(kind)];
+    int nent = std::min(handles->size(), gids.size());
+    for (int i = 0; i < nent; ++i) {
+      MEnt_Set_GlobalID((*handles)[i], gids[i]+1);
+      MEnt_Set_MasterParID((*handles)[i], masters[i]);
+      MEnt_Set_PType((*handles)[i], ptypes[i]);
+    }
+  }
+
+  // Owned and ghost entity lists in the order of the Jali IDs
+
+  auto make_set = [&](char const *name, MType const mtype,
+                      std::vector<MEntity_ptr> const& handles,
+                      Entity_ID_List const& ids) {
+    MSet_ptr mset = MSet_New(mesh, name, mtype);
+    for (auto const& id : ids)
+      MSet_Add(mset, handles[id]);
+    return mset;
+  };
+
+  MType facetype = (celldim == 3) ? MFACE : MEDGE;
+  OwnedVerts = make_set("OwnedVerts", MVERTEX, vtx_id_to_handle,
+                        nodes<Entity_type::PARALLEL_OWNED>());
+  NotOwnedVerts = make_set("NotOwnedVerts", MVERTEX, vtx_id_to_handle,
+                           nodes<Entity_type::PARALLEL_GHOST>());
+  if (Mesh::edges_requested) {
+    OwnedEdges = make_set("OwnedEdges", MEDGE, edge_id_to_handle,
+                          edges<Entity_type::PARALLEL_OWNED>());
+    NotOwnedEdges = make_set("NotOwnedEdges", MEDGE, edge_id_to_handle,
+                             edges<Entity_type::PARALLEL_GHOST>());
+  }
+  OwnedFaces = make_set("OwnedFaces", facetype, face_id_to_handle,
+                        faces<Entity_type::PARALLEL_OWNED>());
+  NotOwnedFaces = make_set("NotOwnedFaces", facetype, face_id_to_handle,
+                           faces<Entity_type::PARALLEL_GHOST>());
+  OwnedCells = make_set("OwnedCells", celltype, cell_id_to_handle,
+                        cells<Entity_type::PARALLEL_OWNED>());
+  GhostCells = make_set("GhostCells", celltype, cell_id_to_handle,
+                        cells<Entity_type::PARALLEL_GHOST>());
+  BoundaryGhostCells = make_set("BoundaryGhostCells", celltype,
+                                cell_id_to_handle,
+                                cells<Entity_type::BOUNDARY_GHOST>());
+  if (Mesh::boundary_ghosts_requested_) {
+    boundary_ghost_att = MAttrib_New(mesh, "bndry_ghost", INT, celltype);
+    for (auto const& c : cells<Entity_type::BOUNDARY_GHOST>())
+      MEnt_Set_AttVal(cell_id_to_handle[c], boundary_ghost_att, 1, 0.0, NULL);
+  }
+
+  // Labeled sets (so that they are exported) and fields
+
+  for (auto const& saved : detached_sets_) {
+    std::vector<MEntity_ptr> *handles = handles_of_mtype_(saved.second.mtype);
+    MSet_ptr mset = MSet_New(mesh, saved.first.c_str(), saved.second.mtype);
+    for (auto const& id : saved.second.owned)
+      MSet_Add(mset, (*handles)[id]);
+    for (auto const& id : saved.second.ghost)
+      MSet_Add(mset, (*handles)[id]);
+  }
+
+  for (auto const& field : detached_fields_) {
+    MAttrib_ptr mattrib = (field.atttype == VECTOR ||
+                           field.atttype == TENSOR) ?
+        MAttrib_New(mesh, field.name.c_str(), field.atttype, field.mtype,
+                    field.ncomp) :
+        MAttrib_New(mesh, field.name.c_str(), field.atttype, field.mtype);
+    std::vector<MEntity_ptr> *handles = handles_of_mtype_(field.mtype);
+    int nent = handles->size();
+    for (int i = 0; i < nent; ++i) {
+      if (field.atttype == INT) {
+        MEnt_Set_AttVal((*handles)[i], mattrib,
+                        static_cast<int>(field.values[i]), 0.0, NULL);
+      } else if (field.atttype == DOUBLE) {
+        MEnt_Set_AttVal((*handles)[i], mattrib, 0, field.values[i], NULL);
+      } else {
+        double *vec = new double[field.ncomp];
+        std::copy_n(&(field.values[field.ncomp*i]), field.ncomp, vec);
+        MEnt_Set_AttVal((*handles)[i], mattrib, 0, 0.0, vec);
+      }
+    }
+  }
+  std::vector<SavedField>().swap(detached_fields_);
+
+  detached_ = false;
+}  // Mesh_MSTK::reattach_
+
+
+// Re-create the MSTK mesh if it was released since queries needing it
+// would otherwise re-create it from whichever thread gets there first
+
+void Mesh_MSTK::freeze() {
+  attach_();
+  Mesh::freeze();
+}
+
+
 // Procedure to perform all the post-mesh creation steps in a constructor
 
 void Mesh_MSTK::post_create_steps_() {
@@ -3348,6 +4826,12 @@ void Mesh_MSTK::post_create_steps_() {
   // types (tet, hex, prism) or if they are general polytopes
   label_celltype();
 
+  // Compute the order in which IDs are to be assigned to entities if
+  // locality improving renumbering was requested
+
+  if (renumbering_ != Renumbering_type::NONE)
+    compute_locality_ordering_();
+
   // Initialize data structures for various entities - vertices/nodes
   // and cells are always initialized; edges and faces only if
   // requested
@@ -3357,6 +4841,12 @@ void Mesh_MSTK::post_create_steps_() {
   if (Mesh::faces_requested) init_faces();
   init_cells();
 
+  if (renumbering_ != Renumbering_type::NONE) {
+    record_original_ids_();
+    for (int i = 0; i < 4; i++)
+      std::vector<MEntity_ptr>().swap(id_order_[i]);
+  }
+
   if (Mesh::geometric_model() != NULL)
     init_set_info();
 
@@ -3367,6 +4857,177 @@ void Mesh_MSTK::post_create_steps_() {
 }
 
 
+// Next entity of a given type in the native MSTK order
+
+static MEntity_ptr mesh_next_entity(Mesh_ptr mesh, MType const mtype,
+                                    int *idx) {
+  switch (mtype) {
+    case MVERTEX: return MESH_Next_Vertex(mesh, idx);
+    case MEDGE: return MESH_Next_Edge(mesh, idx);
+    case MFACE: return MESH_Next_Face(mesh, idx);
+    case MREGION: return MESH_Next_Region(mesh, idx);
+    default: return NULL;
+  }
+}
+
+
+// Next entity of a given type in the order in which local IDs are
+// assigned - the native MSTK order unless the mesh is being renumbered
+
+MEntity_ptr Mesh_MSTK::next_in_id_order_(MType const mtype, int *idx) const {
+  std::vector<MEntity_ptr> const& order = id_order_[mtype];
+  if (order.empty())
+    return mesh_next_entity(mesh, mtype, idx);
+  return (*idx < static_cast<int>(order.size())) ? order[(*idx)++] : NULL;
+}
+
+
+// Compute an order of the cells that improves memory locality
+// (reverse Cuthill-McKee ordering of the face connected cell graph or
+// ordering along a Hilbert curve through the cell centers) and order
+// the nodes, edges and faces by first touch from the cells in that
+// order. The owned and ghost lists are built by walking these orders,
+// so owned entities still come before ghost entities
+
+void Mesh_MSTK::compute_locality_ordering_() {
+  int celldim = cell_dimension();
+  if (celldim != 2 && celldim != 3) {
+    std::cerr << "Mesh_MSTK: Renumbering implemented only for 2D and 3D " <<
+        "meshes - keeping the native ordering\n";
+    return;
+  }
+
+  MType celltype = (celldim == 3) ? MREGION : MFACE;
+
+  std::vector<MEntity_ptr> cells;
+  std::unordered_map<MEntity_ptr, int> cellindex;
+  int idx = 0;
+  MEntity_ptr ment;
+  while ((ment = mesh_next_entity(mesh, celltype, &idx))) {
+    cellindex[ment] = cells.size();
+    cells.push_back(ment);
+  }
+  int ncells = cells.size();
+
+  std::vector<int> order;
+  if (renumbering_ == Renumbering_type::RCM) {
+    std::vector<int> offsets(1, 0), adjacency;
+    offsets.reserve(ncells+1);
+    for (auto const& cell : cells) {
+      List_ptr cfaces = (celldim == 3) ? MR_Faces(cell) : MF_Edges(cell, 1, 0);
+      int idx2 = 0;
+      MEntity_ptr face;
+      while ((face = List_Next_Entry(cfaces, &idx2))) {
+        List_ptr fcells = (celldim == 3) ? MF_Regions(face) : ME_Faces(face);
+        if (!fcells) continue;
+        int idx3 = 0;
+        MEntity_ptr cell2;
+        while ((cell2 = List_Next_Entry(fcells, &idx3)))
+          if (cell2 != cell)
+            adjacency.push_back(cellindex[cell2]);
+        List_Delete(fcells);
+      }
+      List_Delete(cfaces);
+      offsets.push_back(adjacency.size());
+    }
+    Mesh::order_by_reverse_cuthill_mckee(offsets, adjacency, &order);
+  } else {
+    std::vector<JaliGeometry::Point> centers(ncells);
+    double xyz[3];
+    for (int i = 0; i < ncells; i++) {
+      List_ptr cverts = (celldim == 3) ? MR_Vertices(cells[i]) :
+          MF_Vertices(cells[i], 1, 0);
+      double cen[3] = {0.0, 0.0, 0.0};
+      int nv = List_Num_Entries(cverts);
+      for (int j = 0; j < nv; j++) {
+        MV_Coords(List_Entry(cverts, j), xyz);
+        for (int d = 0; d < 3; d++) cen[d] += xyz[d]/nv;
+      }
+      List_Delete(cverts);
+      centers[i].set(cen[0], cen[1], cen[2]);
+    }
+    Mesh::order_along_space_filling_curve(centers, space_dimension(), true,
+                                          &order);
+  }
+
+  id_order_[celltype].resize(ncells);
+  for (int i = 0; i < ncells; i++)
+    id_order_[celltype][i] = cells[order[i]];
+
+  // Lower dimensional entities in the order in which the renumbered
+  // cells first touch them, followed by any entities not connected to
+  // cells in their native order
+
+  bool do_edges = Mesh::edges_requested ||
+      (celldim == 2 && Mesh::faces_requested);
+  bool do_faces = (celldim == 3 && Mesh::faces_requested);
+
+  std::unordered_set<MEntity_ptr> seen;
+  auto append_new = [&](List_ptr ents, MType const mtype) {
+    int idx2 = 0;
+    MEntity_ptr ent;
+    while ((ent = List_Next_Entry(ents, &idx2)))
+      if (seen.insert(ent).second)
+        id_order_[mtype].push_back(ent);
+    List_Delete(ents);
+  };
+
+  for (auto const& cell : id_order_[celltype]) {
+    if (celldim == 3) {
+      append_new(MR_Vertices(cell), MVERTEX);
+      if (do_edges) append_new(MR_Edges(cell), MEDGE);
+      if (do_faces) append_new(MR_Faces(cell), MFACE);
+    } else {
+      append_new(MF_Vertices(cell, 1, 0), MVERTEX);
+      if (do_edges) append_new(MF_Edges(cell, 1, 0), MEDGE);
+    }
+  }
+
+  for (int mtype = MVERTEX; mtype < celltype; mtype++) {
+    if (id_order_[mtype].empty()) continue;
+    idx = 0;
+    while ((ment = mesh_next_entity(mesh, (MType) mtype, &idx)))
+      if (seen.insert(ment).second)
+        id_order_[mtype].push_back(ment);
+  }
+}
+
+
+// Record for each renumbered entity the ID it would have had in the
+// native MSTK order, i.e. its position in the native order after the
+// owned, ghost (and boundary ghost) entities are split up
+
+void Mesh_MSTK::record_original_ids_() {
+  auto record = [&](Entity_kind const kind, MType const mtype,
+                    int const nall, int const nowned, int const nghost) {
+    std::vector<Entity_ID>& ids = Mesh::original_ids_[static_cast<int>(kind)];
+    ids.resize(nall);
+    int count[3] = {0, nowned, nowned + nghost};
+    int idx = 0;
+    MEntity_ptr ment;
+    while ((ment = mesh_next_entity(mesh, mtype, &idx))) {
+      int newid = MEnt_ID(ment)-1;
+      int ptype = (newid < nowned) ? 0 : ((newid < nowned + nghost) ? 1 : 2);
+      ids[newid] = count[ptype]++;
+    }
+  };
+
+  int celldim = cell_dimension();
+  record(Entity_kind::NODE, MVERTEX, vtx_id_to_handle.size(),
+         MSet_Num_Entries(OwnedVerts), MSet_Num_Entries(NotOwnedVerts));
+  if (edges_initialized)
+    record(Entity_kind::EDGE, MEDGE, edge_id_to_handle.size(),
+           MSet_Num_Entries(OwnedEdges), MSet_Num_Entries(NotOwnedEdges));
+  if (faces_initialized)
+    record(Entity_kind::FACE, (celldim == 3) ? MFACE : MEDGE,
+           face_id_to_handle.size(),
+           MSet_Num_Entries(OwnedFaces), MSet_Num_Entries(NotOwnedFaces));
+  record(Entity_kind::CELL, (celldim == 3) ? MREGION : MFACE,
+         cell_id_to_handle.size(),
+         MSet_Num_Entries(OwnedCells), MSet_Num_Entries(GhostCells));
+}
+
+
 // Some initializations
 
 void Mesh_MSTK::clear_internals_() {
@@ -3723,7 +5384,7 @@ void Mesh_MSTK::init_pvert_lists() {
   OwnedVerts = MSet_New(mesh, "OwnedVerts", MVERTEX);
 
   idx = 0;
-  while ((vtx = MESH_Next_Vertex(mesh, &idx))) {
+  while ((vtx = next_in_id_order_(MVERTEX, &idx))) {
     if (MV_PType(vtx) == PGHOST)
       MSet_Add(NotOwnedVerts, vtx);
     else
@@ -3745,7 +5406,7 @@ void Mesh_MSTK::init_pedge_lists() {
   OwnedEdges = MSet_New(mesh, "OwnedEdges", MEDGE);
 
   idx = 0;
-  while ((edge = MESH_Next_Edge(mesh, &idx))) {
+  while ((edge = next_in_id_order_(MEDGE, &idx))) {
     if (ME_PType(edge) == PGHOST)
       MSet_Add(NotOwnedEdges, edge);
     else
@@ -3848,7 +5509,7 @@ void Mesh_MSTK::init_pface_lists() {
     OwnedFaces = MSet_New(mesh, "OwnedFaces", MFACE);
 
     idx = 0;
-    while ((face = MESH_Next_Face(mesh, &idx))) {
+    while ((face = next_in_id_order_(MFACE, &idx))) {
       if (MF_PType(face) == PGHOST)
         MSet_Add(NotOwnedFaces, face);
       else
@@ -3862,7 +5523,7 @@ void Mesh_MSTK::init_pface_lists() {
     OwnedFaces = MSet_New(mesh, "OwnedFaces", MEDGE);
 
     idx = 0;
-    while ((edge = MESH_Next_Edge(mesh, &idx))) {
+    while ((edge = next_in_id_order_(MEDGE, &idx))) {
       if (ME_PType(edge) == PGHOST)
         MSet_Add(NotOwnedFaces, edge);
       else
@@ -4056,7 +5717,7 @@ void Mesh_MSTK::init_pcell_lists() {
     BoundaryGhostCells = MSet_New(mesh, "BoundaryGhostCells", MREGION);
 
     idx = 0;
-    while ((region = MESH_Next_Region(mesh, &idx))) {
+    while ((region = next_in_id_order_(MREGION, &idx))) {
       if (MR_PType(region) == PGHOST)
         MSet_Add(GhostCells, region);
       else {
@@ -4078,7 +5739,7 @@ void Mesh_MSTK::init_pcell_lists() {
     BoundaryGhostCells = MSet_New(mesh, "BoundaryGhostCells", MFACE);
 
     idx = 0;
-    while ((face = MESH_Next_Face(mesh, &idx))) {
+    while ((face = next_in_id_order_(MFACE, &idx))) {
       if (MF_PType(face) == PGHOST)
         MSet_Add(GhostCells, face);
       else {
@@ -4129,14 +5790,11 @@ void Mesh_MSTK::init_set_info() {
 
       std::string internal_name;
       std::string label = lsrgn->label();
-      std::string entity_type_str = lsrgn->entity_str();
+      Entity_kind kind = labeled_set_kind(lsrgn->entity_str());
 
-      if (entity_type_str == "Entity_kind::CELL")
-        internal_name = internal_name_of_set(rgn, Entity_kind::CELL);
-      else if (entity_type_str == "Entity_kind::FACE")
-        internal_name = internal_name_of_set(rgn, Entity_kind::FACE);
-      else if (entity_type_str == "Entity_kind::NODE")
-        internal_name = internal_name_of_set(rgn, Entity_kind::NODE);
+      if (kind == Entity_kind::CELL || kind == Entity_kind::FACE ||
+          kind == Entity_kind::NODE)
+        internal_name = internal_name_of_set(rgn, kind);
 
       mset = MESH_MSetByName(mesh, internal_name.c_str());
 
@@ -4150,16 +5808,16 @@ void Mesh_MSTK::init_set_info() {
       entdim = MSet_EntDim(mset);
       if (Mesh::cell_dimension() == 3) {
 
-        if ((entity_type_str == "Entity_kind::CELL" && entdim != MREGION) ||
-            (entity_type_str == "Entity_kind::FACE" && entdim != MFACE) ||
-            (entity_type_str == "Entity_kind::NODE" && entdim != MVERTEX)) {
+        if ((kind == Entity_kind::CELL && entdim != MREGION) ||
+            (kind == Entity_kind::FACE && entdim != MFACE) ||
+            (kind == Entity_kind::NODE && entdim != MVERTEX)) {
           Errors::Message mesg("Mismatch of entity type in labeled set region and mesh set");
           Jali_throw(mesg);
         }
       } else if (Mesh::cell_dimension() == 2) {
-        if ((entity_type_str == "Entity_kind::CELL" && entdim != MFACE) ||
-            (entity_type_str == "Entity_kind::FACE" && entdim != MEDGE) ||
-            (entity_type_str == "Entity_kind::NODE" && entdim != MVERTEX)) {
+        if ((kind == Entity_kind::CELL && entdim != MFACE) ||
+            (kind == Entity_kind::FACE && entdim != MEDGE) ||
+            (kind == Entity_kind::NODE && entdim != MVERTEX)) {
           std::cerr <<
               "Mismatch of entity type in labeled set region and mesh set\n";
           throw std::exception();
@@ -5003,12 +6661,10 @@ void Mesh_MSTK::inherit_labeled_sets(MAttrib_ptr copyatt) {
       std::string internal_name;
       std::string label = lsrgn->label();
 
-      if (lsrgn->entity_str() == "Entity_kind::CELL")
-        internal_name = internal_name_of_set(rgn, Entity_kind::CELL);
-      else if (lsrgn->entity_str() == "Entity_kind::FACE")
-        internal_name = internal_name_of_set(rgn, Entity_kind::FACE);
-      else if (lsrgn->entity_str() == "Entity_kind::NODE")
-        internal_name = internal_name_of_set(rgn, Entity_kind::NODE);
+      Entity_kind kind = labeled_set_kind(lsrgn->entity_str());
+      if (kind == Entity_kind::CELL || kind == Entity_kind::FACE ||
+          kind == Entity_kind::NODE)
+        internal_name = internal_name_of_set(rgn, kind);
 
 
       MSet_ptr mset_parent = MESH_MSetByName(parent_mstk_mesh,
@@ -5086,6 +6742,7 @@ inline
 void Mesh_MSTK::get_field_info(Entity_kind on_what, int *num,
                                std::vector<std::string> *varnames,
                                std::vector<std::string> *vartypes) const {
+  attach_();
   MAttrib_ptr mattrib;
   char attname[256];
 
@@ -5119,6 +6776,7 @@ void Mesh_MSTK::get_field_info(Entity_kind on_what, int *num,
 
 bool Mesh_MSTK::get_field(std::string field_name, Entity_kind on_what,
                           int *data) const {
+  attach_();
   MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
   if (!mattrib) return false;
 
@@ -5164,6 +6822,7 @@ bool Mesh_MSTK::get_field(std::string field_name, Entity_kind on_what,
 
 bool Mesh_MSTK::get_field(std::string field_name, Entity_kind on_what,
                           double *data) const {
+  attach_();
   MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
   if (!mattrib) return false;
 
@@ -5208,6 +6867,7 @@ bool Mesh_MSTK::get_field(std::string field_name, Entity_kind on_what,
 
 bool Mesh_MSTK::store_field(std::string field_name, Entity_kind on_what,
                             int *data) {
+  attach_();
   MType mtype = entity_kind_to_mtype(on_what);
 
   MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
@@ -5255,6 +6915,7 @@ bool Mesh_MSTK::store_field(std::string field_name, Entity_kind on_what,
 
 bool Mesh_MSTK::store_field(std::string field_name, Entity_kind on_what,
                             double *data) {
+  attach_();
   MType mtype = entity_kind_to_mtype(on_what);
 
   MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
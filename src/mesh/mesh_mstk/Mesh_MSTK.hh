@@ -49,6 +49,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdint>
 #include <memory>
 #include <vector>
+#include <map>
+#include <string>
 #include <sstream>
 #include <typeinfo>
 #include <algorithm>
@@ -79,6 +81,19 @@ class Mesh_MSTK : public Mesh {
 
   // Constructors that read the mesh from a file
 
+  // With parallel_read, each rank of a multi-rank communicator reads
+  // only its share of the elements (and the nodes they use) of an
+  // Exodus II (.exo) file instead of MSTK reading the whole file and
+  // distributing it. The initial share is a contiguous range of
+  // elements in file order, which is kept if the partitioner is
+  // Partitioner_type::INDEX or BLOCK (for files whose elements are
+  // already ordered by partition). Otherwise elements are split
+  // geometrically along a Hilbert curve (Morton curve for
+  // Partitioner_type::MORTON) through their centroids. Only blocks of
+  // linear triangles, quads, tets, prisms, pyramids and hexes are
+  // supported. The time spent in each phase of reading is available
+  // through read_timings()
+
   // The request_faces and request_edges arguments have to be at the
   // end and not in the middle because if we omit them and specify a
   // pointer argument like gm or verbosity_obj, then there is implicit
@@ -102,7 +117,9 @@ class Mesh_MSTK : public Mesh {
             const bool request_boundary_ghosts = false,
             const Partitioner_type partitioner = Partitioner_type::METIS,
             const JaliGeometry::Geom_type geom_type =
-            JaliGeometry::Geom_type::CARTESIAN);
+            JaliGeometry::Geom_type::CARTESIAN,
+            const Renumbering_type renumbering = Renumbering_type::NONE,
+            const bool parallel_read = false);
   
   // Constructors that generate a mesh internally (regular hexahedral mesh only)
 
@@ -123,7 +140,8 @@ class Mesh_MSTK : public Mesh {
             const int num_ghost_layers_tile = 0,
             const int num_ghost_layers_distmesh = 1,
             const bool request_boundary_ghosts = false,
-            const Partitioner_type partitioner = Partitioner_type::METIS);
+            const Partitioner_type partitioner = Partitioner_type::METIS,
+            const Renumbering_type renumbering = Renumbering_type::NONE);
 
 
   // 2D
@@ -144,7 +162,8 @@ class Mesh_MSTK : public Mesh {
             const bool request_boundary_ghosts = false,
             const Partitioner_type partitioner = Partitioner_type::METIS,
             const JaliGeometry::Geom_type geom_type =
-            JaliGeometry::Geom_type::CARTESIAN);
+            JaliGeometry::Geom_type::CARTESIAN,
+            const Renumbering_type renumbering = Renumbering_type::NONE);
 
   // Construct a mesh by extracting a subset of entities from another
   // mesh. The subset may be specified by a setname or a list of
@@ -169,7 +188,8 @@ class Mesh_MSTK : public Mesh {
             const bool request_boundary_ghosts = false,
             const Partitioner_type partitioner = Partitioner_type::METIS,
             const JaliGeometry::Geom_type geom_type =
-            JaliGeometry::Geom_type::CARTESIAN);
+            JaliGeometry::Geom_type::CARTESIAN,
+            const Renumbering_type renumbering = Renumbering_type::NONE);
 
   Mesh_MSTK(const Mesh& inmesh,
             const std::vector<std::string>& setnames,
@@ -187,7 +207,8 @@ class Mesh_MSTK : public Mesh {
             const bool request_boundary_ghosts = false,
             const Partitioner_type partitioner = Partitioner_type::METIS,
             const JaliGeometry::Geom_type geom_type =
-            JaliGeometry::Geom_type::CARTESIAN);
+            JaliGeometry::Geom_type::CARTESIAN,
+            const Renumbering_type renumbering = Renumbering_type::NONE);
 
   Mesh_MSTK(const Mesh& inmesh,
             const std::vector<int>& entity_list,
@@ -205,12 +226,72 @@ class Mesh_MSTK : public Mesh {
             const bool request_boundary_ghosts = false,
             const Partitioner_type partitioner = Partitioner_type::METIS,
             const JaliGeometry::Geom_type geom_type =
-            JaliGeometry::Geom_type::CARTESIAN);
+            JaliGeometry::Geom_type::CARTESIAN,
+            const Renumbering_type renumbering = Renumbering_type::NONE);
+
+  // Construct a mesh by migrating the owned cells of another mesh
+  // to the ranks given in cell_ranks (one entry per owned cell of
+  // inmesh). Nodes, faces and labeled set membership of owned
+  // entities travel with the cells and ghost layers are rebuilt on
+  // the new distribution. The global IDs the entities had in inmesh
+  // are available through previous_GIDs. This is a collective call
+  // over the communicator of inmesh
+
+  Mesh_MSTK(const Mesh& inmesh,
+            const std::vector<int>& cell_ranks,
+            const bool request_faces,
+            const bool request_edges,
+            const bool request_sides,
+            const bool request_wedges,
+            const bool request_corners,
+            const int num_tiles,
+            const int num_ghost_layers_tile,
+            const int num_ghost_layers_distmesh,
+            const bool request_boundary_ghosts,
+            const Partitioner_type partitioner,
+            const JaliGeometry::Geom_type geom_type =
+            JaliGeometry::Geom_type::CARTESIAN,
+            const Renumbering_type renumbering = Renumbering_type::NONE);
 
 
   ~Mesh_MSTK();
 
 
+  // Release the MSTK representation of the mesh ("detach"). Node
+  // coordinates, nodes of cells and faces, cell types, global IDs and
+  // labeled sets are copied into flat arrays, which together with the
+  // adjacencies cached in the base class answer most queries from
+  // then on. Queries needing anything else (upward adjacencies of
+  // nodes, mesh fields, export to files) and meshes derived from this
+  // one re-create the MSTK mesh from these arrays. Only 2D and 3D
+  // meshes with faces that were not derived from another mesh can be
+  // detached. Re-creating the MSTK mesh from a const method is not
+  // thread safe.
+  //
+  // Returns the number of bytes saved (0 if the mesh was not detached)
+
+  std::size_t detach();
+
+  // Whether the MSTK representation is currently released
+
+  bool detached() const {return detached_;}
+
+  // Make the mesh read-only (see Mesh::freeze). A detached mesh is
+  // re-attached first and cannot be detached while frozen. This
+  // overrides the virtual Mesh::freeze, so freezing through a Mesh
+  // pointer re-attaches the mesh too
+
+  void freeze();
+
+  // Wall clock time (in seconds on this rank) spent in each phase of
+  // a parallel read of the mesh from file, in the order of the phases
+  // (empty if the mesh was not read in parallel)
+
+  std::vector<std::pair<std::string, double>> const& read_timings() const {
+    return read_timings_;
+  }
+
+
   // Get cell type
 
   Cell_type cell_get_type(const Entity_ID cellid) const;
@@ -395,6 +476,7 @@ class Mesh_MSTK : public Mesh {
 
   void write_to_exodus_file(const std::string exodusfilename,
                             bool with_fields = true) const {
+    attach_();
     if (with_fields)
       MESH_ExportToFile(mesh, exodusfilename.c_str(), "exodusii", 0, NULL,
                         NULL, mpicomm);
@@ -410,6 +492,7 @@ class Mesh_MSTK : public Mesh {
 
   void write_to_gmv_file(const std::string gmvfilename,
                          bool with_fields = true) const {
+    attach_();
     if (with_fields)
       MESH_ExportToFile(mesh, gmvfilename.c_str(), "gmv", 0, NULL, NULL,
                         mpicomm);
@@ -538,6 +621,23 @@ class Mesh_MSTK : public Mesh {
   Cell_type MRegion_Celltype(MRegion_ptr r);
   void label_celltype();
 
+  void release_mstk_();
+  void cache_detached_data_();
+  void save_fields_();
+  void reattach_();
+
+  // Re-create the MSTK mesh if it was released (see detach)
+
+  void attach_() const {
+    if (detached_) const_cast<Mesh_MSTK *>(this)->reattach_();
+  }
+
+  std::vector<MEntity_ptr> *handles_of_mtype_(MType const mtype);
+
+  void compute_locality_ordering_();
+  void record_original_ids_();
+  MEntity_ptr next_in_id_order_(MType const mtype, int *idx) const;
+
   void init_pvert_lists();
   void init_pedge_lists();
   void init_pedge_dirs();
@@ -583,6 +683,17 @@ class Mesh_MSTK : public Mesh {
                          const Partitioner_type partitioner =
                          Partitioner_type::METIS);
 
+  void migrate_mstk_mesh(const Mesh_MSTK& inmesh,
+                         const std::vector<int>& cell_ranks,
+                         const int num_ghost_layers_distmesh);
+
+  // Have each rank read its share of the elements of an Exodus II
+  // file and build the distributed mesh from them
+
+  int read_exodus_distributed_(const std::string filename,
+                               const Partitioner_type partitioner,
+                               const int num_ghost_layers_distmesh);
+
   // internal name of sets (particularly labeled sets)
 
   std::string
@@ -739,6 +850,14 @@ class Mesh_MSTK : public Mesh {
   mutable std::vector<MEntity_ptr> face_id_to_handle;
   std::vector<MEntity_ptr> cell_id_to_handle;
 
+  // Locality improving renumbering requested at construction and,
+  // while the mesh is being initialized, the order (indexed by MType)
+  // in which local IDs are assigned to entities of each type. Empty
+  // lists mean the native MSTK order
+
+  Renumbering_type renumbering_ = Renumbering_type::NONE;
+  std::vector<MEntity_ptr> id_order_[4];
+
 
   // flag whether to flip a face dir or not when returning nodes of a
   // face (relevant only on partition boundaries)
@@ -761,6 +880,44 @@ class Mesh_MSTK : public Mesh {
 
   const Mesh_MSTK *parent_mesh;
 
+  // Flat copies of the mesh data that is not cached in the base
+  // class, built when the mesh is first detached and kept (and kept
+  // up to date) from then on, so queries are answered the same way
+  // whether or not the MSTK mesh has been re-created. Global IDs,
+  // master partitions and parallel types are kept only for
+  // distributed meshes and the fields stored on the mesh only while
+  // it is detached
+
+  struct SavedField {
+    std::string name;
+    MType mtype;
+    MAttType atttype;
+    int ncomp;
+    std::vector<double> values;
+  };
+
+  struct SavedSet {
+    MType mtype;
+    Entity_ID_List owned, ghost;
+  };
+
+  bool detached_ = false, detached_data_cached_ = false;
+  mutable bool has_derived_meshes_ = false;
+  RepType detached_rep_;
+  std::vector<double> detached_coords_;
+  std::vector<int> detached_cell_node_offsets_, detached_cell_nodes_;
+  std::vector<int> detached_face_node_offsets_, detached_face_nodes_;
+  std::vector<Cell_type> detached_cell_types_;
+  std::vector<int> detached_gentdims_[4], detached_gentids_[4];
+  std::vector<int> detached_gids_[4], detached_masters_[4];
+  std::vector<PType> detached_ptypes_[4];
+  std::vector<SavedField> detached_fields_;
+  std::map<std::string, SavedSet> detached_sets_;
+
+  // Phases of a parallel read from file and their wall clock times
+
+  std::vector<std::pair<std::string, double>> read_timings_;
+
   // variables needed for mesh deformation
 
   double *meshxyz;
@@ -775,6 +932,7 @@ template<std::size_t N>
 inline
 bool Mesh_MSTK::get_field_internal(std::string field_name, Entity_kind on_what,
                                    std::array<double, N> *data) const {
+  attach_();
   MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
   if (!mattrib) return false;
 
@@ -834,6 +992,7 @@ inline
 bool Mesh_MSTK::store_field_internal(std::string field_name,
                                      Entity_kind on_what,
                                      std::array<double,N> *data) {
+  attach_();
   MType mtype = entity_kind_to_mtype(on_what);
   MAttType atttype;
 
@@ -0,0 +1,292 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <UnitTest++.h>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+#include "../Mesh_MSTK.hh"
+#include "LabeledSetRegion.hh"
+#include "GeometricModel.hh"
+#include "errors.hh"
+
+// Mesh_MSTK with its field access made public for the test
+
+class Mesh_MSTK_Fields : public Jali::Mesh_MSTK {
+ public:
+  using Jali::Mesh_MSTK::Mesh_MSTK;
+  using Jali::Mesh_MSTK::store_field;
+  using Jali::Mesh_MSTK::get_field;
+};
+
+// Test that a mesh detached from MSTK answers queries as before, both
+// from its flat copies and after the MSTK mesh is re-created
+
+TEST(MSTK_HEX_GEN_DETACH) {
+
+  Mesh_MSTK_Fields mesh(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 4, 4, 4,
+                        MPI_COMM_WORLD, NULL, true, true);
+
+  int nnodes = mesh.num_nodes<Jali::Entity_type::ALL>();
+  int nedges = mesh.num_edges<Jali::Entity_type::ALL>();
+  int nfaces = mesh.num_faces<Jali::Entity_type::ALL>();
+  int ncells = mesh.num_cells<Jali::Entity_type::ALL>();
+
+  std::vector<JaliGeometry::Point> nodexyz(nnodes);
+  for (int n = 0; n < nnodes; n++)
+    mesh.node_get_coordinates(n, &(nodexyz[n]));
+
+  std::vector<Jali::Entity_ID_List> cellnodes(ncells), cellfaces(ncells),
+      nodecells(nnodes), facenodes(nfaces);
+  for (int c = 0; c < ncells; c++) {
+    mesh.cell_get_nodes(c, &(cellnodes[c]));
+    mesh.cell_get_faces(c, &(cellfaces[c]), true);
+  }
+  for (int f = 0; f < nfaces; f++)
+    mesh.face_get_nodes(f, &(facenodes[f]));
+  for (int n = 0; n < nnodes; n++)
+    mesh.node_get_cells(n, Jali::Entity_type::ALL, &(nodecells[n]));
+
+  std::vector<double> cellfield(ncells);
+  for (int c = 0; c < ncells; c++)
+    cellfield[c] = 0.5*c;
+  CHECK(mesh.store_field("cellfield", Jali::Entity_kind::CELL,
+                         &(cellfield[0])));
+
+  CHECK(mesh.detach() > 0);
+  CHECK(mesh.detached());
+  CHECK_EQUAL(0, mesh.detach());
+
+  // Queries answered without MSTK
+
+  for (int n = 0; n < nnodes; n++) {
+    JaliGeometry::Point xyz;
+    mesh.node_get_coordinates(n, &xyz);
+    CHECK_ARRAY_CLOSE(nodexyz[n], xyz, 3, 1.0e-12);
+    CHECK_EQUAL(n, mesh.GID(n, Jali::Entity_kind::NODE));
+  }
+  for (int c = 0; c < ncells; c++) {
+    Jali::Entity_ID_List nodeids, faceids;
+    mesh.cell_get_nodes(c, &nodeids);
+    CHECK_ARRAY_EQUAL(cellnodes[c], nodeids, nodeids.size());
+    CHECK(mesh.cell_get_type(c) == Jali::Cell_type::HEX);
+    CHECK_CLOSE(1.0/64.0, mesh.cell_volume(c), 1.0e-12);
+  }
+  for (int f = 0; f < nfaces; f++) {
+    Jali::Entity_ID_List nodeids;
+    mesh.face_get_nodes(f, &nodeids);
+    CHECK_ARRAY_EQUAL(facenodes[f], nodeids, nodeids.size());
+  }
+  for (int e = 0; e < nedges; e++) {
+    Jali::Entity_ID n0, n1;
+    mesh.edge_get_nodes(e, &n0, &n1);
+    CHECK(n0 != n1);
+  }
+  CHECK(mesh.detached());
+
+  // Moving a node while detached
+
+  JaliGeometry::Point newxyz = nodexyz[0] + JaliGeometry::Point(0.1, 0.0, 0.0);
+  mesh.node_set_coordinates(0, newxyz);
+  CHECK(mesh.detached());
+
+  // Queries that need MSTK re-create it
+
+  for (int n = 0; n < nnodes; n++) {
+    Jali::Entity_ID_List cellids;
+    mesh.node_get_cells(n, Jali::Entity_type::ALL, &cellids);
+    CHECK(!mesh.detached());
+    std::sort(cellids.begin(), cellids.end());
+    std::sort(nodecells[n].begin(), nodecells[n].end());
+    CHECK_ARRAY_EQUAL(nodecells[n], cellids, cellids.size());
+  }
+  for (int c = 0; c < ncells; c++) {
+    Jali::Entity_ID_List faceids;
+    mesh.cell_get_faces(c, &faceids, true);
+    CHECK_ARRAY_EQUAL(cellfaces[c], faceids, faceids.size());
+  }
+
+  JaliGeometry::Point xyz;
+  mesh.node_get_coordinates(0, &xyz);
+  CHECK_ARRAY_CLOSE(newxyz, xyz, 3, 1.0e-12);
+
+  std::vector<double> cellfield2(ncells, 0.0);
+  CHECK(mesh.get_field("cellfield", Jali::Entity_kind::CELL,
+                       &(cellfield2[0])));
+  CHECK_ARRAY_CLOSE(cellfield, cellfield2, ncells, 1.0e-12);
+
+  // The mesh can be detached again
+
+  CHECK(mesh.detach() > 0);
+  CHECK(mesh.detached());
+}
+
+
+TEST(MSTK_QUAD_GEN_DETACH) {
+
+  Jali::Mesh_MSTK mesh(0.0, 0.0, 1.0, 1.0, 3, 3, MPI_COMM_WORLD, NULL,
+                       true, true);
+
+  int ncells = mesh.num_cells<Jali::Entity_type::ALL>();
+  std::vector<Jali::Entity_ID_List> cellfaces(ncells);
+  std::vector<std::vector<Jali::dir_t>> cellfacedirs(ncells);
+  for (int c = 0; c < ncells; c++)
+    mesh.cell_get_faces_and_dirs(c, &(cellfaces[c]), &(cellfacedirs[c]),
+                                 true);
+
+  CHECK(mesh.detach() > 0);
+  CHECK(mesh.detached());
+
+  for (int c = 0; c < ncells; c++) {
+    CHECK(mesh.cell_get_type(c) == Jali::Cell_type::QUAD);
+    CHECK_CLOSE(1.0/9.0, mesh.cell_volume(c), 1.0e-12);
+  }
+  CHECK(mesh.detached());
+
+  for (int c = 0; c < ncells; c++) {
+    Jali::Entity_ID_List faceids;
+    std::vector<Jali::dir_t> facedirs;
+    mesh.cell_get_faces_and_dirs(c, &faceids, &facedirs, true);
+    CHECK_ARRAY_EQUAL(cellfaces[c], faceids, faceids.size());
+    CHECK_ARRAY_EQUAL(cellfacedirs[c], facedirs, facedirs.size());
+  }
+  CHECK(mesh.detached());
+
+  // Upward adjacencies of nodes re-create the MSTK mesh
+
+  Jali::Entity_ID_List nodefaces;
+  mesh.node_get_faces(0, Jali::Entity_type::ALL, &nodefaces);
+  CHECK(!nodefaces.empty());
+  CHECK(!mesh.detached());
+}
+
+
+// A mesh exported after it was detached and re-attached keeps the
+// element blocks of the file it was read from
+
+TEST(MSTK_DETACH_EXPORT_BLOCKS) {
+
+  std::string blockids[3] = {"10000", "20000", "30000"};
+
+  {
+    Jali::Mesh_MSTK mesh("test/hex_3x3x3_sets.exo", MPI_COMM_WORLD);
+    int ncells = mesh.num_cells<Jali::Entity_type::ALL>();
+    for (int c = 0; c < ncells; c++) {
+      Jali::Entity_ID_List faceids;
+      mesh.cell_get_faces(c, &faceids);
+    }
+
+    CHECK(mesh.detach() > 0);
+    mesh.write_to_exodus_file("hex_3x3x3_detached.exo");
+    CHECK(!mesh.detached());
+  }
+
+  std::string filename = "hex_3x3x3_detached.exo";
+  std::vector<JaliGeometry::LabeledSetRegion *> blocks;
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  for (int i = 0; i < 3; i++) {
+    blocks.push_back(new JaliGeometry::LabeledSetRegion(
+        "block" + blockids[i], i+1, "CELL", filename, "Exodus II",
+        blockids[i]));
+    gregions.push_back(blocks[i]);
+  }
+  JaliGeometry::GeometricModel gm(3, gregions);
+
+  Jali::Mesh_MSTK mesh(filename, MPI_COMM_WORLD, &gm);
+  CHECK_EQUAL(27, mesh.num_cells<Jali::Entity_type::ALL>());
+  for (int i = 0; i < 3; i++)
+    CHECK_EQUAL(9, mesh.get_set_size("block" + blockids[i],
+                                     Jali::Entity_kind::CELL,
+                                     Jali::Entity_type::ALL));
+
+  for (auto& block : blocks)
+    delete block;
+}
+
+
+// Freezing a detached mesh through a Mesh reference re-creates the
+// MSTK mesh up front so that threads querying the frozen mesh never
+// re-attach it behind each other's backs
+
+TEST(MSTK_FROZEN_DETACH) {
+
+  Jali::Mesh_MSTK mstkmesh(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 3, 3, 3,
+                           MPI_COMM_WORLD, NULL, true, true);
+  Jali::Mesh& mesh = mstkmesh;
+
+  int ncells = mesh.num_cells<Jali::Entity_type::ALL>();
+  std::vector<Jali::Entity_ID_List> cellfaces(ncells);
+  for (int c = 0; c < ncells; c++)
+    mesh.cell_get_faces(c, &(cellfaces[c]), true);
+
+  CHECK(mstkmesh.detach() > 0);
+  CHECK(mstkmesh.detached());
+
+  mesh.freeze();
+  CHECK(mesh.frozen());
+  CHECK(!mstkmesh.detached());
+  CHECK_THROW(mstkmesh.detach(), Errors::Message);
+
+  int const nthreads = 4;
+  std::vector<int> mismatches(nthreads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; t++)
+    threads.emplace_back([&, t]() {
+        for (int c = 0; c < ncells; c++) {
+          Jali::Entity_ID_List faceids;
+          mesh.cell_get_faces(c, &faceids, true);
+          if (faceids != cellfaces[c]) mismatches[t]++;
+        }
+      });
+  for (auto& thr : threads)
+    thr.join();
+  for (int t = 0; t < nthreads; t++)
+    CHECK_EQUAL(0, mismatches[t]);
+  CHECK(!mstkmesh.detached());
+
+  mesh.thaw();
+  CHECK(mstkmesh.detach() > 0);
+}
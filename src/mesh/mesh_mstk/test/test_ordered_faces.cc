@@ -0,0 +1,137 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <UnitTest++.h>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "../Mesh_MSTK.hh"
+
+// Number of nodes two faces have in common
+
+int num_common_nodes(Jali::Entity_ID_List const& fnodes1,
+                     Jali::Entity_ID_List const& fnodes2) {
+  int ncommon = 0;
+  for (auto const& n : fnodes1)
+    if (std::find(fnodes2.begin(), fnodes2.end(), n) != fnodes2.end())
+      ncommon++;
+  return ncommon;
+}
+
+// Check that the ordered faces of standard cells returned from the
+// cache are in the order cell_get_faces_and_dirs_ordered builds them:
+// the lateral faces going around the base face, then the base face,
+// then the top face if there is one, all with outward directions
+
+void check_ordered_faces(Jali::Mesh const& mesh, Jali::Entity_ID const c,
+                         int const nlateral, int const nlateralnodes,
+                         int const nbasenodes, bool const has_top) {
+  Jali::Entity_ID_List faceids, ufaceids;
+  std::vector<Jali::dir_t> facedirs;
+  mesh.cell_get_faces_and_dirs(c, &faceids, &facedirs, true);
+  int nfaces = nlateral + 1 + (has_top ? 1 : 0);
+  CHECK_EQUAL(nfaces, faceids.size());
+  CHECK_EQUAL(nfaces, facedirs.size());
+  if (faceids.size() != nfaces || facedirs.size() != nfaces) return;
+
+  // Same faces as the unordered query
+
+  mesh.cell_get_faces(c, &ufaceids);
+  std::vector<Jali::Entity_ID> sorted1(faceids), sorted2(ufaceids);
+  std::sort(sorted1.begin(), sorted1.end());
+  std::sort(sorted2.begin(), sorted2.end());
+  CHECK(sorted1 == sorted2);
+
+  std::vector<Jali::Entity_ID_List> fnodes(nfaces);
+  for (int i = 0; i < nfaces; i++)
+    mesh.face_get_nodes(faceids[i], &(fnodes[i]));
+
+  Jali::Entity_ID_List const& basenodes = fnodes[nlateral];
+  CHECK_EQUAL(nbasenodes, basenodes.size());
+  for (int i = 0; i < nlateral; i++) {
+    CHECK_EQUAL(nlateralnodes, fnodes[i].size());
+    CHECK_EQUAL(2, num_common_nodes(fnodes[i], basenodes));
+    CHECK_EQUAL(2, num_common_nodes(fnodes[i], fnodes[(i+1)%nlateral]));
+  }
+  if (has_top) {
+    CHECK_EQUAL(nbasenodes, fnodes[nfaces-1].size());
+    CHECK_EQUAL(0, num_common_nodes(fnodes[nfaces-1], basenodes));
+  }
+
+  JaliGeometry::Point ccen = mesh.cell_centroid(c);
+  for (int i = 0; i < nfaces; i++) {
+    JaliGeometry::Point outvec = mesh.face_centroid(faceids[i]) - ccen;
+    CHECK(outvec*mesh.face_normal(faceids[i])*facedirs[i] > 0.0);
+  }
+}
+
+
+// Read one hex, tet, prism and pyramid (in that order) and check
+// their cached ordered faces
+
+TEST(MSTK_ORDERED_FACES) {
+
+  Jali::Mesh_MSTK mesh("test/hex_tet_prism_pyramid.exo", MPI_COMM_WORLD);
+
+  CHECK_EQUAL(4, mesh.num_cells<Jali::Entity_type::ALL>());
+
+  int const nlateral[4] = {4, 3, 3, 4};
+  int const nlateralnodes[4] = {4, 3, 4, 3};
+  int const nbasenodes[4] = {4, 3, 3, 4};
+  bool const has_top[4] = {true, false, true, false};
+  Jali::Cell_type const celltypes[4] = {Jali::Cell_type::HEX,
+                                        Jali::Cell_type::TET,
+                                        Jali::Cell_type::PRISM,
+                                        Jali::Cell_type::PYRAMID};
+
+  for (auto const& c : mesh.cells()) {
+    int i = std::find(celltypes, celltypes+4, mesh.cell_get_type(c)) -
+        celltypes;
+    CHECK(i < 4);
+    if (i == 4) continue;
+    check_ordered_faces(mesh, c, nlateral[i], nlateralnodes[i],
+                        nbasenodes[i], has_top[i]);
+  }
+}
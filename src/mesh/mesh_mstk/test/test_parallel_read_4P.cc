@@ -0,0 +1,299 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <UnitTest++.h>
+
+#include <iostream>
+#include <vector>
+
+#include "../Mesh_MSTK.hh"
+#include "LabeledSetRegion.hh"
+#include "GeometricModel.hh"
+
+// Test for reading an Exodus II file with every processor reading its
+// own share of the elements
+
+TEST(MSTK_PARALLEL_READ_4P) {
+
+  int rank, size;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  // Reference mesh read in full on each processor - in serial the
+  // cells are numbered in the order of the file
+
+  Jali::Mesh *refmesh(new Jali::Mesh_MSTK("test/hex_5x5x5.exo",
+                                          MPI_COMM_SELF));
+  int nrefcells = refmesh->num_cells<Jali::Entity_type::ALL>();
+
+  double refvol = 0.0;
+  for (int c = 0; c < nrefcells; c++)
+    refvol += refmesh->cell_volume(c);
+
+  // Keep the split of elements in file order and split them along a
+  // Hilbert curve
+
+  Jali::Partitioner_type partitioners[2] = {Jali::Partitioner_type::INDEX,
+                                            Jali::Partitioner_type::HILBERT};
+
+  for (auto const& partitioner : partitioners) {
+    Jali::Mesh_MSTK *mesh(new Jali::Mesh_MSTK(
+        "test/hex_5x5x5.exo", MPI_COMM_WORLD, NULL,
+        true, false, false, false, false, 0, 0, 1, false, partitioner,
+        JaliGeometry::Geom_type::CARTESIAN, Jali::Renumbering_type::NONE,
+        true));
+
+    // Every cell of the file is owned by exactly one processor and
+    // agrees with the cell of the same global ID in the reference mesh
+
+    int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+    CHECK(nowned > 0);
+    CHECK(mesh->num_cells<Jali::Entity_type::PARALLEL_GHOST>() > 0);
+
+    std::vector<int> count(nrefcells, 0);
+    double vol = 0.0;
+    for (int c = 0; c < nowned; c++) {
+      int gid = mesh->GID(c, Jali::Entity_kind::CELL);
+      CHECK(gid >= 0 && gid < nrefcells);
+      if (gid < 0 || gid >= nrefcells) continue;
+      count[gid]++;
+
+      JaliGeometry::Point cen = mesh->cell_centroid(c);
+      JaliGeometry::Point refcen = refmesh->cell_centroid(gid);
+      for (int d = 0; d < 3; d++)
+        CHECK_CLOSE(refcen[d], cen[d], 1.0e-10);
+      vol += mesh->cell_volume(c);
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &(count[0]), nrefcells, MPI_INT, MPI_SUM,
+                  MPI_COMM_WORLD);
+    for (int g = 0; g < nrefcells; g++)
+      CHECK_EQUAL(1, count[g]);
+
+    double totvol;
+    MPI_Allreduce(&vol, &totvol, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    CHECK_CLOSE(refvol, totvol, 1.0e-10);
+
+    // Timings are reported for each phase of the read
+
+    std::vector<std::pair<std::string, double>> const& timings =
+        mesh->read_timings();
+    CHECK_EQUAL(5, timings.size());
+    for (auto const& phase : timings) {
+      CHECK(phase.second >= 0.0);
+      if (rank == 0)
+        std::cerr << "Parallel read (" << partitioner << ") " <<
+            phase.first << ": " << phase.second << " s\n";
+    }
+
+    delete mesh;
+  }
+
+  delete refmesh;
+}
+
+
+// Element block, side and node sets of a file read in parallel have
+// the same members as when the file is read in full
+
+TEST(MSTK_PARALLEL_READ_SETS_4P) {
+
+  int rank, size;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  std::string filename = "test/hex_3x3x3_sets.exo";
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::LabeledSetRegion lsrgn1("block20000", 1, "CELL", filename,
+                                        "Exodus II", "20000");
+  gregions.push_back(&lsrgn1);
+  JaliGeometry::LabeledSetRegion lsrgn2("sideset1", 2, "FACE", filename,
+                                        "Exodus II", "1");
+  gregions.push_back(&lsrgn2);
+  JaliGeometry::LabeledSetRegion lsrgn3("sideset102", 3, "FACE", filename,
+                                        "Exodus II", "102");
+  gregions.push_back(&lsrgn3);
+  JaliGeometry::LabeledSetRegion lsrgn4("nodeset10001", 4, "NODE", filename,
+                                        "Exodus II", "10001");
+  gregions.push_back(&lsrgn4);
+  JaliGeometry::GeometricModel gm(3, gregions);
+
+  std::string setnames[4] = {"block20000", "sideset1", "sideset102",
+                             "nodeset10001"};
+  Jali::Entity_kind setkinds[4] = {Jali::Entity_kind::CELL,
+                                   Jali::Entity_kind::FACE,
+                                   Jali::Entity_kind::FACE,
+                                   Jali::Entity_kind::NODE};
+  int expected[4] = {9, 54, 9, 8};
+
+  // Number of members of each set and the sum of their centroids
+  // (which does not depend on how the entities are numbered)
+
+  auto set_summary = [&](Jali::Mesh *mesh, int i, Jali::Entity_type type,
+                         int *nset, JaliGeometry::Point *sum) {
+    Jali::Entity_ID_List setents;
+    mesh->get_set_entities(setnames[i], setkinds[i], type, &setents);
+    *nset = setents.size();
+    *sum = JaliGeometry::Point(0.0, 0.0, 0.0);
+    for (auto const& ent : setents) {
+      if (setkinds[i] == Jali::Entity_kind::CELL) {
+        *sum += mesh->cell_centroid(ent);
+      } else if (setkinds[i] == Jali::Entity_kind::FACE) {
+        *sum += mesh->face_centroid(ent);
+      } else {
+        JaliGeometry::Point xyz;
+        mesh->node_get_coordinates(ent, &xyz);
+        *sum += xyz;
+      }
+    }
+  };
+
+  Jali::Mesh *refmesh(new Jali::Mesh_MSTK(filename, MPI_COMM_SELF, &gm));
+
+  Jali::Partitioner_type partitioners[2] = {Jali::Partitioner_type::INDEX,
+                                            Jali::Partitioner_type::HILBERT};
+
+  for (auto const& partitioner : partitioners) {
+    Jali::Mesh *mesh(new Jali::Mesh_MSTK(
+        filename, MPI_COMM_WORLD, &gm,
+        true, false, false, false, false, 0, 0, 1, false, partitioner,
+        JaliGeometry::Geom_type::CARTESIAN, Jali::Renumbering_type::NONE,
+        true));
+
+    for (int i = 0; i < 4; i++) {
+      int nref;
+      JaliGeometry::Point refsum;
+      set_summary(refmesh, i, Jali::Entity_type::ALL, &nref, &refsum);
+      CHECK_EQUAL(expected[i], nref);
+
+      int nset, nset_all;
+      JaliGeometry::Point sum;
+      set_summary(mesh, i, Jali::Entity_type::PARALLEL_OWNED, &nset, &sum);
+      MPI_Allreduce(&nset, &nset_all, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+      CHECK_EQUAL(nref, nset_all);
+
+      double sum_all[3];
+      MPI_Allreduce(&(sum[0]), sum_all, 3, MPI_DOUBLE, MPI_SUM,
+                    MPI_COMM_WORLD);
+      CHECK_ARRAY_CLOSE(refsum, sum_all, 3, 1.0e-10);
+    }
+
+    delete mesh;
+  }
+
+  delete refmesh;
+}
+
+
+// A 2D file of quads and triangles read in parallel has the cells of
+// the full file and every cell goes around its edges consistently
+// (the second cell on an interior edge uses it in reverse)
+
+TEST(MSTK_PARALLEL_READ_2D_4P) {
+
+  int size;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  std::string filename = "test/quad_tri_4x4.exo";
+
+  Jali::Mesh *refmesh(new Jali::Mesh_MSTK(filename, MPI_COMM_SELF));
+  int nrefcells = refmesh->num_cells<Jali::Entity_type::ALL>();
+  CHECK_EQUAL(24, nrefcells);
+
+  Jali::Partitioner_type partitioners[2] = {Jali::Partitioner_type::INDEX,
+                                            Jali::Partitioner_type::HILBERT};
+
+  for (auto const& partitioner : partitioners) {
+    Jali::Mesh *mesh(new Jali::Mesh_MSTK(
+        filename, MPI_COMM_WORLD, NULL,
+        true, false, false, false, false, 0, 0, 1, false, partitioner,
+        JaliGeometry::Geom_type::CARTESIAN, Jali::Renumbering_type::NONE,
+        true));
+    CHECK_EQUAL(2, mesh->cell_dimension());
+
+    std::vector<int> count(nrefcells, 0);
+    double area = 0.0;
+    for (auto const& c : mesh->cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+      int gid = mesh->GID(c, Jali::Entity_kind::CELL);
+      CHECK(gid >= 0 && gid < nrefcells);
+      if (gid < 0 || gid >= nrefcells) continue;
+      count[gid]++;
+
+      JaliGeometry::Point cen = mesh->cell_centroid(c);
+      JaliGeometry::Point refcen = refmesh->cell_centroid(gid);
+      for (int d = 0; d < 2; d++)
+        CHECK_CLOSE(refcen[d], cen[d], 1.0e-10);
+      CHECK_CLOSE(refmesh->cell_volume(gid), mesh->cell_volume(c), 1.0e-10);
+      area += mesh->cell_volume(c);
+
+      Jali::Entity_ID_List cfaces;
+      std::vector<Jali::dir_t> cfdirs;
+      mesh->cell_get_faces_and_dirs(c, &cfaces, &cfdirs);
+      CHECK_EQUAL(refmesh->cell_get_type(gid) == Jali::Cell_type::QUAD ?
+                  4 : 3, cfaces.size());
+      for (int i = 0; i < cfaces.size(); i++) {
+        JaliGeometry::Point normal = mesh->face_normal(cfaces[i])*cfdirs[i];
+        CHECK((mesh->face_centroid(cfaces[i]) - cen)*normal > 0.0);
+      }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &(count[0]), nrefcells, MPI_INT, MPI_SUM,
+                  MPI_COMM_WORLD);
+    for (int g = 0; g < nrefcells; g++)
+      CHECK_EQUAL(1, count[g]);
+
+    double totarea;
+    MPI_Allreduce(&area, &totarea, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    CHECK_CLOSE(1.0, totarea, 1.0e-10);
+
+    delete mesh;
+  }
+
+  delete refmesh;
+}
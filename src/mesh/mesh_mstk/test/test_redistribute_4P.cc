@@ -0,0 +1,323 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <UnitTest++.h>
+
+#include <iostream>
+#include <vector>
+
+#include "../Mesh_MSTK.hh"
+#include "LabeledSetRegion.hh"
+#include "GeometricModel.hh"
+
+// Test for migration of the cells of a hex mesh to other processors
+
+TEST(MSTK_REDISTRIBUTE_4P) {
+
+  int rank, size;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  // Create a 4x4x4 cell hex mesh
+
+  Jali::Mesh *mesh(new Jali::Mesh_MSTK(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 4, 4, 4,
+                                       MPI_COMM_WORLD));
+
+  // Send all owned cells to the next processor
+
+  int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  std::vector<int> cell_ranks(nowned, (rank+1)%size);
+
+  Jali::Mesh *newmesh(new Jali::Mesh_MSTK(*mesh, cell_ranks,
+                                          true, false, false, false, false,
+                                          0, 0, 1, false,
+                                          Jali::Partitioner_type::METIS));
+
+  // The previous processor's cells are here now
+
+  int nowned_new = newmesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  int nowned_prev;
+  MPI_Sendrecv(&nowned, 1, MPI_INT, (rank+1)%size, 0,
+               &nowned_prev, 1, MPI_INT, (rank+size-1)%size, 0,
+               MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  CHECK_EQUAL(nowned_prev, nowned_new);
+
+  double vol = 0.0, totvol;
+  for (int c = 0; c < nowned_new; c++)
+    vol += newmesh->cell_volume(c);
+  MPI_Allreduce(&vol, &totvol, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  CHECK_CLOSE(1.0, totvol, 1.0e-10);
+
+  // Move cell centroids and node coordinates of the old mesh to the
+  // new one and compare them with those computed on the new mesh
+
+  int ncells = mesh->num_cells<Jali::Entity_type::ALL>();
+  std::vector<double> oldcen(3*ncells);
+  for (int c = 0; c < ncells; c++) {
+    JaliGeometry::Point cen = mesh->cell_centroid(c);
+    for (int d = 0; d < 3; d++) oldcen[3*c+d] = cen[d];
+  }
+
+  int ncells_new = newmesh->num_cells<Jali::Entity_type::ALL>();
+  CHECK_EQUAL(ncells_new,
+              newmesh->previous_GIDs(Jali::Entity_kind::CELL).size());
+  std::vector<double> newcen(3*ncells_new);
+  newmesh->redistribute_data(*mesh, Jali::Entity_kind::CELL,
+                             3*sizeof(double), &(oldcen[0]),
+                             Jali::Entity_type::ALL, &(newcen[0]));
+  for (int c = 0; c < ncells_new; c++) {
+    JaliGeometry::Point cen = newmesh->cell_centroid(c);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(cen[d], newcen[3*c+d], 1.0e-10);
+  }
+
+  int nnodes = mesh->num_nodes<Jali::Entity_type::ALL>();
+  std::vector<double> oldxyz(3*nnodes);
+  for (int n = 0; n < nnodes; n++) {
+    JaliGeometry::Point xyz;
+    mesh->node_get_coordinates(n, &xyz);
+    for (int d = 0; d < 3; d++) oldxyz[3*n+d] = xyz[d];
+  }
+
+  int nnodes_new = newmesh->num_nodes<Jali::Entity_type::ALL>();
+  std::vector<double> newxyz(3*nnodes_new);
+  newmesh->redistribute_data(*mesh, Jali::Entity_kind::NODE,
+                             3*sizeof(double), &(oldxyz[0]),
+                             Jali::Entity_type::ALL, &(newxyz[0]));
+  for (int n = 0; n < nnodes_new; n++) {
+    JaliGeometry::Point xyz;
+    newmesh->node_get_coordinates(n, &xyz);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(xyz[d], newxyz[3*n+d], 1.0e-10);
+  }
+
+  delete newmesh;
+  delete mesh;
+}
+
+
+// Boundary ghost cells of the new mesh have no counterpart in the old
+// mesh and their data is left alone when data is redistributed
+
+TEST(MSTK_REDISTRIBUTE_BOUNDARY_GHOSTS_4P) {
+
+  int rank, size;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  Jali::Mesh *mesh(new Jali::Mesh_MSTK(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 4, 4, 4,
+                                       MPI_COMM_WORLD));
+
+  int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  std::vector<int> cell_ranks(nowned, (rank+1)%size);
+
+  Jali::Mesh *newmesh(new Jali::Mesh_MSTK(*mesh, cell_ranks,
+                                          true, false, false, false, false,
+                                          0, 0, 1, true,
+                                          Jali::Partitioner_type::METIS));
+
+  std::vector<Jali::Entity_ID> const& prevgids =
+      newmesh->previous_GIDs(Jali::Entity_kind::CELL);
+  int ncells_new = newmesh->num_cells<Jali::Entity_type::ALL>();
+  CHECK_EQUAL(ncells_new, prevgids.size());
+
+  int nbndry = 0, nbndry_all;
+  for (int c = 0; c < ncells_new; c++)
+    if (prevgids[c] < 0) nbndry++;
+  MPI_Allreduce(&nbndry, &nbndry_all, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  CHECK(nbndry_all > 0);
+
+  int ncells = mesh->num_cells<Jali::Entity_type::ALL>();
+  std::vector<double> oldvol(ncells);
+  for (int c = 0; c < ncells; c++)
+    oldvol[c] = mesh->cell_volume(c);
+
+  std::vector<double> newvol(ncells_new, -7.0);
+  newmesh->redistribute_data(*mesh, Jali::Entity_kind::CELL, sizeof(double),
+                             &(oldvol[0]), Jali::Entity_type::ALL,
+                             &(newvol[0]));
+  for (int c = 0; c < ncells_new; c++) {
+    if (prevgids[c] < 0)
+      CHECK_EQUAL(-7.0, newvol[c]);
+    else
+      CHECK_CLOSE(newmesh->cell_volume(c), newvol[c], 1.0e-10);
+  }
+
+  delete newmesh;
+  delete mesh;
+}
+
+
+// Labeled sets (declared with either spelling of the entity kind)
+// keep their members when the cells move to other processors
+
+TEST(MSTK_REDISTRIBUTE_LABELED_SETS_4P) {
+
+  int rank, size;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  std::string filename = "test/hex_3x3x3_sets.exo";
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::LabeledSetRegion lsrgn1("mat1", 1, "CELL", filename,
+                                        "Exodus II", "10000");
+  gregions.push_back(&lsrgn1);
+  JaliGeometry::LabeledSetRegion lsrgn2("face101", 2, "FACE", filename,
+                                        "Exodus II", "101");
+  gregions.push_back(&lsrgn2);
+  JaliGeometry::LabeledSetRegion lsrgn3("nodeset20004", 3, "Entity_kind::NODE",
+                                        filename, "Exodus II", "20004");
+  gregions.push_back(&lsrgn3);
+  JaliGeometry::GeometricModel gm(3, gregions);
+
+  Jali::Mesh *mesh(new Jali::Mesh_MSTK(filename, MPI_COMM_WORLD, &gm,
+                                       true, false, false, false, false,
+                                       0, 0, 1, false,
+                                       Jali::Partitioner_type::METIS));
+
+  int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  std::vector<int> cell_ranks(nowned, (rank+1)%size);
+
+  Jali::Mesh *newmesh(new Jali::Mesh_MSTK(*mesh, cell_ranks,
+                                          true, false, false, false, false,
+                                          0, 0, 1, false,
+                                          Jali::Partitioner_type::METIS));
+
+  std::string setnames[3] = {"mat1", "face101", "nodeset20004"};
+  Jali::Entity_kind setkinds[3] = {Jali::Entity_kind::CELL,
+                                   Jali::Entity_kind::FACE,
+                                   Jali::Entity_kind::NODE};
+  int expected[3] = {9, 9, 8};
+  for (int i = 0; i < 3; i++) {
+    int nset = newmesh->get_set_size(setnames[i], setkinds[i],
+                                     Jali::Entity_type::PARALLEL_OWNED);
+    int nset_all;
+    MPI_Allreduce(&nset, &nset_all, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    CHECK_EQUAL(expected[i], nset_all);
+  }
+
+  delete newmesh;
+  delete mesh;
+}
+
+
+// Edges of a 2D mesh read in parallel are oriented independently on
+// each processor. Cells that come together from different processors
+// must still go around their edges consistently
+
+TEST(MSTK_REDISTRIBUTE_2D_4P) {
+
+  int size;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  Jali::Mesh *mesh(new Jali::Mesh_MSTK(
+      "test/quad_tri_4x4.exo", MPI_COMM_WORLD, NULL,
+      true, false, false, false, false, 0, 0, 1, false,
+      Jali::Partitioner_type::INDEX, JaliGeometry::Geom_type::CARTESIAN,
+      Jali::Renumbering_type::NONE, true));
+
+  // Send the cells of each quadrant of the square to one processor
+
+  int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  std::vector<int> cell_ranks(nowned);
+  for (int c = 0; c < nowned; c++) {
+    JaliGeometry::Point cen = mesh->cell_centroid(c);
+    cell_ranks[c] = (cen[0] > 0.5 ? 1 : 0) + (cen[1] > 0.5 ? 2 : 0);
+  }
+
+  Jali::Mesh *newmesh(new Jali::Mesh_MSTK(*mesh, cell_ranks,
+                                          true, false, false, false, false,
+                                          0, 0, 1, false,
+                                          Jali::Partitioner_type::METIS));
+  CHECK_EQUAL(2, newmesh->cell_dimension());
+
+  int ncells = mesh->num_cells<Jali::Entity_type::ALL>();
+  std::vector<double> oldcen(2*ncells);
+  for (int c = 0; c < ncells; c++) {
+    JaliGeometry::Point cen = mesh->cell_centroid(c);
+    for (int d = 0; d < 2; d++) oldcen[2*c+d] = cen[d];
+  }
+
+  int ncells_new = newmesh->num_cells<Jali::Entity_type::ALL>();
+  std::vector<double> newcen(2*ncells_new);
+  newmesh->redistribute_data(*mesh, Jali::Entity_kind::CELL,
+                             2*sizeof(double), &(oldcen[0]),
+                             Jali::Entity_type::ALL, &(newcen[0]));
+
+  int nowned_new = newmesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  double area = 0.0;
+  for (int c = 0; c < nowned_new; c++) {
+    JaliGeometry::Point cen = newmesh->cell_centroid(c);
+    for (int d = 0; d < 2; d++)
+      CHECK_CLOSE(cen[d], newcen[2*c+d], 1.0e-10);
+    area += newmesh->cell_volume(c);
+
+    Jali::Entity_ID_List cfaces;
+    std::vector<Jali::dir_t> cfdirs;
+    newmesh->cell_get_faces_and_dirs(c, &cfaces, &cfdirs);
+    for (int i = 0; i < cfaces.size(); i++) {
+      JaliGeometry::Point normal = newmesh->face_normal(cfaces[i])*cfdirs[i];
+      CHECK((newmesh->face_centroid(cfaces[i]) - cen)*normal > 0.0);
+    }
+  }
+
+  int nowned_all;
+  MPI_Allreduce(&nowned_new, &nowned_all, 1, MPI_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+  CHECK_EQUAL(24, nowned_all);
+
+  double totarea;
+  MPI_Allreduce(&area, &totarea, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  CHECK_CLOSE(1.0, totarea, 1.0e-10);
+
+  delete newmesh;
+  delete mesh;
+}
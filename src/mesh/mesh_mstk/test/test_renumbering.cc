@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <UnitTest++.h>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "../Mesh_MSTK.hh"
+
+// Test locality improving renumbering of a generated hex mesh - the
+// renumbered mesh must describe the same entities as the natively
+// numbered mesh, related through the original IDs
+
+TEST(MSTK_HEX_GEN_RENUMBERING) {
+
+  Jali::Mesh_MSTK native(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 6, 6,
+                         MPI_COMM_WORLD, NULL, true, true);
+
+  for (Jali::Entity_kind kind : {Jali::Entity_kind::NODE,
+          Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::CELL})
+    CHECK(native.original_ids(kind).empty());
+
+  for (Jali::Renumbering_type renumbering : {Jali::Renumbering_type::RCM,
+          Jali::Renumbering_type::HILBERT}) {
+    Jali::Mesh_MSTK mesh(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 6, 6,
+                         MPI_COMM_WORLD, NULL, true, true, false, false,
+                         false, 0, 0, 1, false, Jali::Partitioner_type::METIS,
+                         renumbering);
+
+    // Original IDs must be a permutation of the entity IDs
+
+    for (Jali::Entity_kind kind : {Jali::Entity_kind::NODE,
+            Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+            Jali::Entity_kind::CELL}) {
+      int nent = mesh.num_entities(kind, Jali::Entity_type::ALL);
+      CHECK_EQUAL(nent, native.num_entities(kind, Jali::Entity_type::ALL));
+
+      std::vector<Jali::Entity_ID> ids = mesh.original_ids(kind);
+      CHECK_EQUAL(nent, ids.size());
+      std::sort(ids.begin(), ids.end());
+      for (int i = 0; i < nent; i++)
+        CHECK_EQUAL(i, ids[i]);
+    }
+
+    // Entities must match their originals
+
+    std::vector<Jali::Entity_ID> const& orignodes =
+        mesh.original_ids(Jali::Entity_kind::NODE);
+    int nnodes = mesh.num_nodes<Jali::Entity_type::ALL>();
+    for (int n = 0; n < nnodes; n++) {
+      JaliGeometry::Point xyz, origxyz;
+      mesh.node_get_coordinates(n, &xyz);
+      native.node_get_coordinates(orignodes[n], &origxyz);
+      CHECK_ARRAY_CLOSE(origxyz, xyz, 3, 1.0e-12);
+    }
+
+    std::vector<Jali::Entity_ID> const& origedges =
+        mesh.original_ids(Jali::Entity_kind::EDGE);
+    int nedges = mesh.num_edges<Jali::Entity_type::ALL>();
+    for (int e = 0; e < nedges; e++) {
+      Jali::Entity_ID n0, n1, orign0, orign1;
+      mesh.edge_get_nodes(e, &n0, &n1);
+      native.edge_get_nodes(origedges[e], &orign0, &orign1);
+      CHECK_EQUAL(orign0, orignodes[n0]);
+      CHECK_EQUAL(orign1, orignodes[n1]);
+    }
+
+    std::vector<Jali::Entity_ID> const& origfaces =
+        mesh.original_ids(Jali::Entity_kind::FACE);
+    int nfaces = mesh.num_faces<Jali::Entity_type::ALL>();
+    for (int f = 0; f < nfaces; f++) {
+      JaliGeometry::Point cen = mesh.face_centroid(f);
+      JaliGeometry::Point origcen = native.face_centroid(origfaces[f]);
+      CHECK_ARRAY_CLOSE(origcen, cen, 3, 1.0e-12);
+    }
+
+    std::vector<Jali::Entity_ID> const& origcells =
+        mesh.original_ids(Jali::Entity_kind::CELL);
+    int ncells = mesh.num_cells<Jali::Entity_type::ALL>();
+    for (int c = 0; c < ncells; c++) {
+      Jali::Entity_ID_List cnodes, orignodes_of_cell;
+      mesh.cell_get_nodes(c, &cnodes);
+      native.cell_get_nodes(origcells[c], &orignodes_of_cell);
+      CHECK_EQUAL(orignodes_of_cell.size(), cnodes.size());
+      for (int i = 0; i < cnodes.size(); i++)
+        CHECK_EQUAL(orignodes_of_cell[i], orignodes[cnodes[i]]);
+    }
+
+    // Consecutive cells should mostly be neighbors of each other
+
+    int nconsecutive_nbrs = 0;
+    for (int c = 0; c < ncells-1; c++) {
+      Jali::Entity_ID_List nbrs;
+      mesh.cell_get_node_adj_cells(c, Jali::Entity_type::ALL, &nbrs);
+      if (std::find(nbrs.begin(), nbrs.end(), c+1) != nbrs.end())
+        nconsecutive_nbrs++;
+    }
+    CHECK(nconsecutive_nbrs > (ncells-1)/2);
+  }
+}
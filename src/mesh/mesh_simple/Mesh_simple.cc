@@ -44,14 +44,30 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Mesh_simple.hh"
 
 #include <algorithm>
+#include <sstream>
 
-#include "mpi.h"   // only for MPI_COMM_WORLD in Mesh constructor
+#include "mpi.h"
 
 #include "dbc.hh"
 #include "errors.hh"
 
 namespace Jali {
 
+// Remove entities that are not of the requested parallel type from a
+// list (owned entities of each kind are numbered before ghosts)
+
+static void filter_by_ptype(const Entity_type ptype, const int num_owned,
+                            Entity_ID_List *ids) {
+  if (ptype == Entity_type::PARALLEL_OWNED)
+    ids->erase(std::remove_if(ids->begin(), ids->end(),
+                              [&](Entity_ID id) { return id >= num_owned; }),
+               ids->end());
+  else if (ptype == Entity_type::PARALLEL_GHOST)
+    ids->erase(std::remove_if(ids->begin(), ids->end(),
+                              [&](Entity_ID id) { return id < num_owned; }),
+               ids->end());
+}
+
 Mesh_simple::Mesh_simple(double x0, double y0, double z0,
                          double x1, double y1, double z1,
                          int nx, int ny, int nz,
@@ -66,11 +82,14 @@ Mesh_simple::Mesh_simple(double x0, double y0, double z0,
                          const int num_ghost_layers_tile,
                          const int num_ghost_layers_distmesh,
                          const bool boundary_ghosts_requested,
-                         const Partitioner_type partitioner) :
+                         const Partitioner_type partitioner,
+                         const bool implicit_connectivity) :
     nx_(nx), ny_(ny), nz_(nz),
+    implicit_connectivity_(implicit_connectivity),
     x0_(x0), x1_(x1),
     y0_(y0), y1_(y1),
     z0_(z0), z1_(z1),
+    nx_global_(nx), ny_global_(ny), nz_global_(nz),
     nodes_per_face_(4), faces_per_cell_(6), nodes_per_cell_(8),
     faces_per_node_aug_(13), cells_per_node_aug_(9),
   Mesh(request_faces, request_edges, request_sides, request_wedges,
@@ -80,10 +99,25 @@ Mesh_simple::Mesh_simple(double x0, double y0, double z0,
 
   assert(!boundary_ghosts_requested);  // Cannot yet make boundary ghosts
 
+  if (implicit_connectivity_) {
+    if (request_sides || request_wedges || request_corners) {
+      Errors::Message mesg("Sides, wedges and corners cannot be requested "
+                           "for meshes with implicit connectivity");
+      Exceptions::Jali_throw(mesg);
+    }
+
+    // Nothing to cache - queries are answered from entity indices
+
+    Mesh::cache_vars_ = false;
+    Mesh::cache_geometry_ = false;
+  }
+
   Mesh::set_mesh_type(Mesh_type::RECTANGULAR);
   if (gm != (JaliGeometry::GeometricModelPtr) NULL)
     Mesh::set_geometric_model(gm);
 
+  decompose_3d_(num_ghost_layers_distmesh);
+
   clear_internals_3d_();
   update_internals_3d_();
 
@@ -148,6 +182,15 @@ Mesh_simple::Mesh_simple(const std::vector<double>& x,
 
   assert(!boundary_ghosts_requested);  // Cannot yet make boundary ghosts
 
+  // 1D meshes are not distributed - all entities are owned
+
+  cellbox_ = {{nx_, 1, 1}, {0, 0, 0}, {nx_, 1, 1}};
+  nodebox_ = {{nx_+1, 1, 1}, {0, 0, 0}, {nx_+1, 1, 1}};
+  for (int orient = 0; orient < 3; orient++) {
+    face_owned_start_[orient] = 0;
+    face_ghost_start_[orient] = nx_+1;
+  }
+
   clear_internals_1d_();
   update_internals_1d_();
 
@@ -227,6 +270,92 @@ Mesh_simple::Mesh_simple(const Mesh& inmesh,
 
 Mesh_simple::~Mesh_simple() { }
 
+
+// Split the cells of the brick into a grid of blocks, one per rank,
+// and set up the index boxes of the entities on this rank. Nodes and
+// faces on the boundary between two blocks are owned by the block
+// with the higher cell indices
+
+void Mesh_simple::decompose_3d_(int num_ghost_layers) {
+  int nprocs = 1, rank = 0;
+  MPI_Comm_size(get_comm(), &nprocs);
+  MPI_Comm_rank(get_comm(), &rank);
+  if (nprocs == 1) num_ghost_layers = 0;
+
+  // Split the directions with more cells into more blocks
+
+  int nglobal[3] = {nx_global_, ny_global_, nz_global_};
+  int dirs[3] = {0, 1, 2};
+  std::stable_sort(dirs, dirs+3,
+                   [&](int a, int b) { return nglobal[a] > nglobal[b]; });
+
+  int sorted_nblocks[3] = {0, 0, 0};
+  MPI_Dims_create(nprocs, 3, sorted_nblocks);
+
+  int nblocks[3];
+  for (int d = 0; d < 3; d++)
+    nblocks[dirs[d]] = sorted_nblocks[d];
+
+  for (int d = 0; d < 3; d++)
+    if (nblocks[d] > nglobal[d]) {
+      std::stringstream mesg_stream;
+      mesg_stream << "Cannot split " << nglobal[d] << " cells in direction " <<
+          d << " among " << nblocks[d] << " blocks of ranks";
+      Errors::Message mesg(mesg_stream.str());
+      Exceptions::Jali_throw(mesg);
+    }
+
+  int block[3] = {rank % nblocks[0], (rank / nblocks[0]) % nblocks[1],
+                  rank / (nblocks[0]*nblocks[1])};
+
+  // Owned cells of the block and the cells on this rank including
+  // the ghost layers (in global indices), then local indices of the
+  // owned cells and nodes
+
+  int clo[3], chi[3], nhi[3], n[3];
+  for (int d = 0; d < 3; d++) {
+    int owned_lo = static_cast<int>((static_cast<int64_t>(block[d])*
+                                     nglobal[d])/nblocks[d]);
+    int owned_hi = static_cast<int>((static_cast<int64_t>(block[d]+1)*
+                                     nglobal[d])/nblocks[d]);
+    int all_lo = std::max(owned_lo - num_ghost_layers, 0);
+    int all_hi = std::min(owned_hi + num_ghost_layers, nglobal[d]);
+
+    offset_[d] = all_lo;
+    n[d] = all_hi - all_lo;
+    clo[d] = owned_lo - all_lo;
+    chi[d] = owned_hi - all_lo;
+    nhi[d] = (owned_hi == nglobal[d]) ? chi[d] + 1 : chi[d];
+  }
+
+  nx_ = n[0];
+  ny_ = n[1];
+  nz_ = n[2];
+
+  cellbox_ = {{n[0], n[1], n[2]}, {clo[0], clo[1], clo[2]},
+              {chi[0], chi[1], chi[2]}};
+  nodebox_ = {{n[0]+1, n[1]+1, n[2]+1}, {clo[0], clo[1], clo[2]},
+              {nhi[0], nhi[1], nhi[2]}};
+  facebox_[0] = {{n[0], n[1], n[2]+1}, {clo[0], clo[1], clo[2]},
+                 {chi[0], chi[1], nhi[2]}};
+  facebox_[1] = {{n[0], n[1]+1, n[2]}, {clo[0], clo[1], clo[2]},
+                 {chi[0], nhi[1], chi[2]}};
+  facebox_[2] = {{n[0]+1, n[1], n[2]}, {clo[0], clo[1], clo[2]},
+                 {nhi[0], chi[1], chi[2]}};
+
+  int nowned_faces = 0;
+  for (int orient = 0; orient < 3; orient++) {
+    face_owned_start_[orient] = nowned_faces;
+    nowned_faces += facebox_[orient].num_owned();
+  }
+  int nfaces = nowned_faces;
+  for (int orient = 0; orient < 3; orient++) {
+    face_ghost_start_[orient] = nfaces;
+    nfaces += facebox_[orient].num_all() - facebox_[orient].num_owned();
+  }
+}
+
+
 void Mesh_simple::clear_internals_3d_() {
   coordinates_.resize(0);
 
@@ -366,21 +495,12 @@ void Mesh_simple::update_internals_3d_() {
   num_nodes_ = (nx_+1)*(ny_+1)*(nz_+1);
   num_faces_ = (nx_+1)*(ny_)*(nz_) + (nx_)*(ny_+1)*(nz_) + (nx_)*(ny_)*(nz_+1);
 
-  coordinates_.resize(3*num_nodes_);
-
-  double hx = (x1_ - x0_)/nx_;
-  double hy = (y1_ - y0_)/ny_;
-  double hz = (z1_ - z0_)/nz_;
-
-  for (int iz = 0; iz <= nz_; ++iz)
-    for (int iy = 0; iy <= ny_; ++iy)
-      for (int ix = 0; ix <= nx_; ++ix) {
-        int istart = 3*node_index_(ix, iy, iz);
+  if (implicit_connectivity_) {
+    update_entity_lists_3d_();
+    return;
+  }
 
-        coordinates_[ istart ]     = x0_ + ix*hx;
-        coordinates_[ istart + 1 ] = y0_ + iy*hy;
-        coordinates_[ istart + 2 ] = z0_ + iz*hz;
-      }
+  materialize_coordinates_3d_();
 
   cell_to_face_.resize(faces_per_cell_*num_cells_);
   cell_to_face_dirs_.resize(faces_per_cell_*num_cells_);
@@ -546,22 +666,22 @@ void Mesh_simple::update_internals_3d_() {
 
         jstart = faces_per_node_aug_*node_index_(ix, iy, iz);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = xzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
 
         jstart = faces_per_node_aug_*node_index_(ix+1, iy, iz);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = xzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
 
         jstart = faces_per_node_aug_*node_index_(ix+1, iy, iz+1);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = xzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
 
         jstart = faces_per_node_aug_*node_index_(ix, iy, iz+1);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = xzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
       }
   // finally we do the yz faces
@@ -579,35 +699,64 @@ void Mesh_simple::update_internals_3d_() {
 
         jstart = faces_per_node_aug_*node_index_(ix, iy, iz);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = yzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
 
         jstart = faces_per_node_aug_*node_index_(ix, iy+1, iz);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = yzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
 
         jstart = faces_per_node_aug_*node_index_(ix, iy+1, iz+1);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = yzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
 
         jstart = faces_per_node_aug_*node_index_(ix, iy, iz+1);
         nfaces = node_to_face_[jstart];
-        node_to_face_[jstart+1+nfaces] = xyface_index_(ix, iy, iz);
+        node_to_face_[jstart+1+nfaces] = yzface_index_(ix, iy, iz);
         (node_to_face_[jstart])++;
       }
 
-  // populate entity ids arrays in the base class so that iterators work
+  update_entity_lists_3d_();
+}
 
-  int lid;
-  std::vector<int>::iterator it;
 
-  Mesh::nodeids_owned_.resize(num_nodes_);
-  for (int i = 0; i < num_nodes_; ++i)
+// Store the coordinates of the nodes of the brick (only done on demand
+// for meshes with implicit connectivity)
+
+void Mesh_simple::materialize_coordinates_3d_() {
+  coordinates_.resize(3*num_nodes_);
+
+  double hx = (x1_ - x0_)/nx_global_;
+  double hy = (y1_ - y0_)/ny_global_;
+  double hz = (z1_ - z0_)/nz_global_;
+
+  for (int iz = 0; iz <= nz_; ++iz)
+    for (int iy = 0; iy <= ny_; ++iy)
+      for (int ix = 0; ix <= nx_; ++ix) {
+        int istart = 3*node_index_(ix, iy, iz);
+
+        coordinates_[ istart ]     = x0_ + (offset_[0] + ix)*hx;
+        coordinates_[ istart + 1 ] = y0_ + (offset_[1] + iy)*hy;
+        coordinates_[ istart + 2 ] = z0_ + (offset_[2] + iz)*hz;
+      }
+}
+
+
+// Populate entity ids arrays in the base class so that iterators work
+
+void Mesh_simple::update_entity_lists_3d_() {
+  int num_owned_nodes = nodebox_.num_owned();
+  Mesh::nodeids_owned_.resize(num_owned_nodes);
+  for (int i = 0; i < num_owned_nodes; ++i)
     nodeids_owned_[i] = i;
-  Mesh::nodeids_ghost_.resize(0);
+  Mesh::nodeids_ghost_.resize(num_nodes_ - num_owned_nodes);
+  for (int i = num_owned_nodes; i < num_nodes_; ++i)
+    nodeids_ghost_[i-num_owned_nodes] = i;
   Mesh::nodeids_all_ = Mesh::nodeids_owned_;
+  Mesh::nodeids_all_.insert(nodeids_all_.end(), nodeids_ghost_.begin(),
+                            nodeids_ghost_.end());
 
   // Simple mesh does not handle edges in 3D
 
@@ -616,23 +765,32 @@ void Mesh_simple::update_internals_3d_() {
   Mesh::edgeids_all_.resize(0);
 
   if (Mesh::faces_requested) {
-    Mesh::faceids_owned_.resize(num_faces_);
-    for (int i = 0; i < num_faces_; ++i)
+    int num_owned_faces = face_ghost_start_[0];
+    Mesh::faceids_owned_.resize(num_owned_faces);
+    for (int i = 0; i < num_owned_faces; ++i)
       faceids_owned_[i] = i;
-    Mesh::faceids_ghost_.resize(0);
+    Mesh::faceids_ghost_.resize(num_faces_ - num_owned_faces);
+    for (int i = num_owned_faces; i < num_faces_; ++i)
+      faceids_ghost_[i-num_owned_faces] = i;
     Mesh::faceids_all_ = Mesh::faceids_owned_;
+    Mesh::faceids_all_.insert(faceids_all_.end(), faceids_ghost_.begin(),
+                              faceids_ghost_.end());
   } else {
     Mesh::faceids_owned_.resize(0);
     Mesh::faceids_ghost_.resize(0);
     Mesh::faceids_all_.resize(0);
   }
 
-  Mesh::cellids_owned_.resize(num_cells_);
-  for (int i = 0; i < num_cells_; ++i)
+  int num_owned_cells = cellbox_.num_owned();
+  Mesh::cellids_owned_.resize(num_owned_cells);
+  for (int i = 0; i < num_owned_cells; ++i)
     cellids_owned_[i] = i;
-  Mesh::cellids_ghost_.resize(0);
+  Mesh::cellids_ghost_.resize(num_cells_ - num_owned_cells);
+  for (int i = num_owned_cells; i < num_cells_; ++i)
+    cellids_ghost_[i-num_owned_cells] = i;
   Mesh::cellids_all_ = Mesh::cellids_owned_;
-
+  Mesh::cellids_all_.insert(cellids_all_.end(), cellids_ghost_.begin(),
+                            cellids_ghost_.end());
 }
 
 
@@ -641,9 +799,37 @@ Jali::Cell_type Mesh_simple::cell_get_type(const Jali::Entity_ID cellid) const {
   return Cell_type::HEX;
 }
 
+// Global IDs are the IDs the entities would have in a serial mesh of
+// the whole brick
+
 Entity_ID Mesh_simple::GID(const Jali::Entity_ID lid,
                            const Jali::Entity_kind kind) const {
-  return lid;  // Its a serial code
+  if (Mesh::space_dimension() == 1)
+    return lid;  // 1D meshes are serial
+
+  int NX = nx_global_, NY = ny_global_, NZ = nz_global_;
+  int orient, i, j, k;
+  switch (kind) {
+    case Entity_kind::NODE:
+      node_ijk_(lid, &i, &j, &k);
+      i += offset_[0]; j += offset_[1]; k += offset_[2];
+      return i + j*(NX+1) + k*(NX+1)*(NY+1);
+    case Entity_kind::CELL:
+      cell_ijk_(lid, &i, &j, &k);
+      i += offset_[0]; j += offset_[1]; k += offset_[2];
+      return i + j*NX + k*NX*NY;
+    case Entity_kind::FACE:
+      face_ijk_(lid, &orient, &i, &j, &k);
+      i += offset_[0]; j += offset_[1]; k += offset_[2];
+      if (orient == 0)
+        return i + j*NX + k*NX*NY;
+      else if (orient == 1)
+        return NX*NY*(NZ+1) + i + j*NX + k*NX*(NY+1);
+      else
+        return NX*NY*(NZ+1) + NX*(NY+1)*NZ + i + j*(NX+1) + k*(NX+1)*NY;
+    default:
+      return lid;
+  }
 }
 
 
@@ -654,6 +840,20 @@ void Mesh_simple::cell_get_faces_and_dirs_internal(const Jali::Entity_ID cellid,
                                                    *faceids,
                                                    std::vector<dir_t> *cfacedirs,
                                                    const bool ordered) const {
+  if (implicit_connectivity_) {
+    int i, j, k;
+    cell_ijk_(cellid, &i, &j, &k);
+
+    *faceids = {(Entity_ID) xzface_index_(i, j, k),
+                (Entity_ID) yzface_index_(i+1, j, k),
+                (Entity_ID) xzface_index_(i, j+1, k),
+                (Entity_ID) yzface_index_(i, j, k),
+                (Entity_ID) xyface_index_(i, j, k),
+                (Entity_ID) xyface_index_(i, j, k+1)};
+    if (cfacedirs) *cfacedirs = {1, 1, -1, -1, -1, 1};
+    return;
+  }
+
   unsigned int offset = (unsigned int) faces_per_cell_*cellid;
 
   faceids->clear();
@@ -671,6 +871,21 @@ void Mesh_simple::cell_get_faces_and_dirs_internal(const Jali::Entity_ID cellid,
 
 void Mesh_simple::cell_get_nodes(Jali::Entity_ID cell,
                                  Jali::Entity_ID_List *nodeids) const {
+  if (implicit_connectivity_) {
+    int i, j, k;
+    cell_ijk_(cell, &i, &j, &k);
+
+    *nodeids = {(Entity_ID) node_index_(i, j, k),
+                (Entity_ID) node_index_(i+1, j, k),
+                (Entity_ID) node_index_(i+1, j+1, k),
+                (Entity_ID) node_index_(i, j+1, k),
+                (Entity_ID) node_index_(i, j, k+1),
+                (Entity_ID) node_index_(i+1, j, k+1),
+                (Entity_ID) node_index_(i+1, j+1, k+1),
+                (Entity_ID) node_index_(i, j+1, k+1)};
+    return;
+  }
+
   unsigned int offset = (unsigned int) nodes_per_cell_*cell;
 
   nodeids->clear();
@@ -684,6 +899,28 @@ void Mesh_simple::cell_get_nodes(Jali::Entity_ID cell,
 
 void Mesh_simple::face_get_nodes(Jali::Entity_ID face,
                                  Jali::Entity_ID_List *nodeids) const {
+  if (implicit_connectivity_) {
+    int orient, i, j, k;
+    face_ijk_(face, &orient, &i, &j, &k);
+
+    if (orient == 0)
+      *nodeids = {(Entity_ID) node_index_(i, j, k),
+                  (Entity_ID) node_index_(i+1, j, k),
+                  (Entity_ID) node_index_(i+1, j+1, k),
+                  (Entity_ID) node_index_(i, j+1, k)};
+    else if (orient == 1)
+      *nodeids = {(Entity_ID) node_index_(i, j, k),
+                  (Entity_ID) node_index_(i+1, j, k),
+                  (Entity_ID) node_index_(i+1, j, k+1),
+                  (Entity_ID) node_index_(i, j, k+1)};
+    else
+      *nodeids = {(Entity_ID) node_index_(i, j, k),
+                  (Entity_ID) node_index_(i, j+1, k),
+                  (Entity_ID) node_index_(i, j+1, k+1),
+                  (Entity_ID) node_index_(i, j, k+1)};
+    return;
+  }
+
   unsigned int offset = (unsigned int) nodes_per_face_*face;
 
   nodeids->clear();
@@ -700,6 +937,13 @@ void Mesh_simple::face_get_nodes(Jali::Entity_ID face,
 
 void Mesh_simple::node_get_coordinates(const Jali::Entity_ID local_node_id,
                                        JaliGeometry::Point *ncoords) const {
+  if (implicit_connectivity_ && coordinates_.empty()) {
+    std::array<double, 3> xyz;
+    node_get_coordinates(local_node_id, &xyz);
+    ncoords->set(xyz[0], xyz[1], xyz[2]);
+    return;
+  }
+
   unsigned int offset = (unsigned int) Mesh::space_dimension()*local_node_id;
 
   ncoords->set(Mesh::space_dimension(), &(coordinates_[offset]));
@@ -707,6 +951,17 @@ void Mesh_simple::node_get_coordinates(const Jali::Entity_ID local_node_id,
 void Mesh_simple::node_get_coordinates(const Jali::Entity_ID local_node_id,
                                        std::array<double, 3> *ncoords) const {
   assert(Mesh::space_dimension() == 3);
+  if (implicit_connectivity_ && coordinates_.empty()) {
+    int i, j, k;
+    node_ijk_(local_node_id, &i, &j, &k);
+    double hx = (x1_ - x0_)/nx_global_;
+    double hy = (y1_ - y0_)/ny_global_;
+    double hz = (z1_ - z0_)/nz_global_;
+    (*ncoords)[0] = x0_ + (offset_[0] + i)*hx;
+    (*ncoords)[1] = y0_ + (offset_[1] + j)*hy;
+    (*ncoords)[2] = z0_ + (offset_[2] + k)*hz;
+    return;
+  }
   unsigned int offset = 3*local_node_id;
   (*ncoords)[0] = coordinates_[offset];
   (*ncoords)[1] = coordinates_[offset + 1];
@@ -757,6 +1012,11 @@ void Mesh_simple::cell_get_coordinates(Jali::Entity_ID local_cell_id,
 
 void Mesh_simple::node_set_coordinates(const Jali::Entity_ID local_node_id,
                                       const double *ncoord) {
+  check_not_frozen("Mesh_simple::node_set_coordinates");
+
+  if (implicit_connectivity_ && coordinates_.empty())
+    materialize_coordinates_3d_();
+
   int spdim = Mesh::space_dimension();
   unsigned int offset = (unsigned int) spdim*local_node_id;
 
@@ -769,10 +1029,17 @@ void Mesh_simple::node_set_coordinates(const Jali::Entity_ID local_node_id,
     *destination_begin = ncoord[i];
     destination_begin++;
   }
+
+  node_coordinates_changed();
 }
 
 void Mesh_simple::node_set_coordinates(const Jali::Entity_ID local_node_id,
                                        const JaliGeometry::Point ncoord) {
+  check_not_frozen("Mesh_simple::node_set_coordinates");
+
+  if (implicit_connectivity_ && coordinates_.empty())
+    materialize_coordinates_3d_();
+
   int spdim = Mesh::space_dimension();
   unsigned int offset = (unsigned int) spdim*local_node_id;
 
@@ -782,12 +1049,29 @@ void Mesh_simple::node_set_coordinates(const Jali::Entity_ID local_node_id,
     *destination_begin = ncoord[i];
     destination_begin++;
   }
+
+  node_coordinates_changed();
 }
 
 
 void Mesh_simple::node_get_cells(const Jali::Entity_ID nodeid,
                                  const Jali::Entity_type ptype,
                                  Jali::Entity_ID_List *cellids) const {
+  if (implicit_connectivity_) {
+    int i, j, k;
+    node_ijk_(nodeid, &i, &j, &k);
+
+    // in increasing order of cell IDs like the explicit version
+
+    cellids->clear();
+    for (int ck = std::max(k-1, 0); ck <= std::min(k, nz_-1); ck++)
+      for (int cj = std::max(j-1, 0); cj <= std::min(j, ny_-1); cj++)
+        for (int ci = std::max(i-1, 0); ci <= std::min(i, nx_-1); ci++)
+          cellids->push_back(cell_index_(ci, cj, ck));
+    filter_by_ptype(ptype, cellbox_.num_owned(), cellids);
+    return;
+  }
+
   unsigned int offset = (unsigned int) cells_per_node_aug_*nodeid;
   unsigned int ncells = node_to_cell_[offset];
 
@@ -795,6 +1079,8 @@ void Mesh_simple::node_get_cells(const Jali::Entity_ID nodeid,
 
   for (int i = 0; i < ncells; i++)
     cellids->push_back(node_to_cell_[offset+i+1]);
+
+  filter_by_ptype(ptype, cellbox_.num_owned(), cellids);
 }
 
 
@@ -802,6 +1088,27 @@ void Mesh_simple::node_get_cells(const Jali::Entity_ID nodeid,
 void Mesh_simple::node_get_faces(const Jali::Entity_ID nodeid,
                                  const Jali::Entity_type ptype,
                                  Jali::Entity_ID_List *faceids) const {
+  if (implicit_connectivity_) {
+    int i, j, k;
+    node_ijk_(nodeid, &i, &j, &k);
+
+    // xy, then xz and then yz faces, each in increasing order of IDs
+    // like the explicit version
+
+    faceids->clear();
+    for (int fj = std::max(j-1, 0); fj <= std::min(j, ny_-1); fj++)
+      for (int fi = std::max(i-1, 0); fi <= std::min(i, nx_-1); fi++)
+        faceids->push_back(xyface_index_(fi, fj, k));
+    for (int fk = std::max(k-1, 0); fk <= std::min(k, nz_-1); fk++)
+      for (int fi = std::max(i-1, 0); fi <= std::min(i, nx_-1); fi++)
+        faceids->push_back(xzface_index_(fi, j, fk));
+    for (int fk = std::max(k-1, 0); fk <= std::min(k, nz_-1); fk++)
+      for (int fj = std::max(j-1, 0); fj <= std::min(j, ny_-1); fj++)
+        faceids->push_back(yzface_index_(i, fj, fk));
+    filter_by_ptype(ptype, face_ghost_start_[0], faceids);
+    return;
+  }
+
   unsigned int offset = (unsigned int) faces_per_node_aug_*nodeid;
   unsigned int nfaces = node_to_face_[offset];
 
@@ -809,6 +1116,8 @@ void Mesh_simple::node_get_faces(const Jali::Entity_ID nodeid,
 
   for (int i = 0; i < nfaces; i++)
     faceids->push_back(node_to_face_[offset+i+1]);
+
+  filter_by_ptype(ptype, face_ghost_start_[0], faceids);
 }
 
 
@@ -819,24 +1128,16 @@ void Mesh_simple::node_get_cell_faces(const Jali::Entity_ID nodeid,
                                       const Jali::Entity_ID cellid,
                                       const Jali::Entity_type ptype,
                                       Jali::Entity_ID_List *faceids) const {
-  unsigned int offset = (unsigned int) faces_per_cell_*cellid;
+  Jali::Entity_ID_List cellfaceids, fnodes;
+  cell_get_faces_and_dirs_internal(cellid, &cellfaceids, nullptr);
 
   faceids->clear();
 
-  for (int i = 0; i < faces_per_cell_; i++) {
-    Entity_ID cellfaceid = cell_to_face_[offset+i];
-
-    unsigned int offset2 = (unsigned int) nodes_per_face_*cellfaceid;
-
-    Jali::Entity_ID_List fnodes;
+  for (auto const& cellfaceid : cellfaceids) {
     face_get_nodes(cellfaceid, &fnodes);
 
-    for (int j = 0; j < nodes_per_face_; j++) {
-      if (face_to_node_[offset2+j] == nodeid) {
-        faceids->push_back(cellfaceid);
-        break;
-      }
-    }
+    if (std::find(fnodes.begin(), fnodes.end(), nodeid) != fnodes.end())
+      faceids->push_back(cellfaceid);
   }
 }
 
@@ -844,6 +1145,26 @@ void Mesh_simple::node_get_cell_faces(const Jali::Entity_ID nodeid,
 void Mesh_simple::face_get_cells_internal(const Jali::Entity_ID faceid,
                                           const Jali::Entity_type ptype,
                                           Jali::Entity_ID_List *cellids) const {
+  if (implicit_connectivity_) {
+    int orient, i, j, k;
+    face_ijk_(faceid, &orient, &i, &j, &k);
+
+    // same order as the explicit version
+
+    cellids->clear();
+    if (orient == 0) {
+      if (k < nz_) cellids->push_back(cell_index_(i, j, k));
+      if (k > 0) cellids->push_back(cell_index_(i, j, k-1));
+    } else if (orient == 1) {
+      if (j > 0) cellids->push_back(cell_index_(i, j-1, k));
+      if (j < ny_) cellids->push_back(cell_index_(i, j, k));
+    } else {
+      if (i < nx_) cellids->push_back(cell_index_(i, j, k));
+      if (i > 0) cellids->push_back(cell_index_(i-1, j, k));
+    }
+    return;
+  }
+
   unsigned int offset = (unsigned int) 2*faceid;
 
   cellids->clear();
@@ -870,26 +1191,22 @@ void Mesh_simple::cell_get_face_adj_cells(const Jali::Entity_ID cellid,
                                           const Jali::Entity_type ptype,
                                           Jali::Entity_ID_List
                                           *fadj_cellids) const {
-  unsigned int offset = (unsigned int) faces_per_cell_*cellid;
+  Jali::Entity_ID_List cellfaceids, fcells;
+  cell_get_faces_and_dirs_internal(cellid, &cellfaceids, nullptr);
 
   fadj_cellids->clear();
 
-  for (int i = 0; i < faces_per_cell_; i++) {
-    Entity_ID faceid = cell_to_face_[offset];
-
-    unsigned int foffset = (unsigned int) 2*faceid;
-
-    int adjcell0 = face_to_cell_[foffset];
-    if (adjcell0 != -1 && adjcell0 != cellid) {
-      fadj_cellids->push_back(adjcell0);
-    } else {
-      int adjcell1 = face_to_cell_[foffset+1];
-      if (adjcell1 != -1 && adjcell1 != cellid)
-        fadj_cellids->push_back(adjcell1);
-    }
+  for (auto const& faceid : cellfaceids) {
+    face_get_cells_internal(faceid, Entity_type::ALL, &fcells);
 
-    offset++;
+    for (auto const& adjcell : fcells)
+      if (adjcell != cellid) {
+        fadj_cellids->push_back(adjcell);
+        break;
+      }
   }
+
+  filter_by_ptype(ptype, cellbox_.num_owned(), fadj_cellids);
 }
 
 // Node connected neighboring cells of given cell
@@ -900,35 +1217,112 @@ void Mesh_simple::cell_get_node_adj_cells(const Jali::Entity_ID cellid,
                                           const Jali::Entity_type ptype,
                                           Jali::Entity_ID_List
                                           *nadj_cellids) const {
-  unsigned int offset = (unsigned int) nodes_per_cell_*cellid;
+  Jali::Entity_ID_List cellnodeids, nodecells;
+  cell_get_nodes(cellid, &cellnodeids);
 
   nadj_cellids->clear();
 
-  for (int i = 0; i < nodes_per_cell_; i++) {
-    Entity_ID nodeid = cell_to_node_[offset+i];
-
-    unsigned int offset2 = (unsigned int) cells_per_node_aug_*nodeid;
-    unsigned int ncell = node_to_cell_[offset2];
+  for (auto const& nodeid : cellnodeids) {
+    node_get_cells(nodeid, Entity_type::ALL, &nodecells);
 
-    for (int j = 0; j < ncell; j++) {
-      Entity_ID nodecell = node_to_cell_[offset2+j+1];
+    for (auto const& nodecell : nodecells) {
       if (nodecell == cellid) continue;
 
-      unsigned int found = 0;
-      unsigned int size = nadj_cellids->size();
-      for (int k = 0; k < size; k++) {
-        if ((*nadj_cellids)[k] == nodecell) {
-          found = 1;
-          break;
-        }
-      }
-
-      if (!found)
+      if (std::find(nadj_cellids->begin(), nadj_cellids->end(), nodecell) ==
+          nadj_cellids->end())
         nadj_cellids->push_back(nodecell);
     }
   }
+
+  filter_by_ptype(ptype, cellbox_.num_owned(), nadj_cellids);
 }
 
+// Geometry of a cell of the brick - the generic computation is only
+// needed once nodes have been moved
+
+int Mesh_simple::compute_cell_geometry(const Entity_ID cellid,
+                                       double *volume,
+                                       JaliGeometry::Point *centroid) const {
+  if (!implicit_connectivity_ || !coordinates_.empty())
+    return Mesh::compute_cell_geometry(cellid, volume, centroid);
+
+  double hx = (x1_ - x0_)/nx_global_;
+  double hy = (y1_ - y0_)/ny_global_;
+  double hz = (z1_ - z0_)/nz_global_;
+
+  int i, j, k;
+  cell_ijk_(cellid, &i, &j, &k);
+  i += offset_[0];
+  j += offset_[1];
+  k += offset_[2];
+
+  *volume = hx*hy*hz;
+  centroid->set(x0_ + (i+0.5)*hx, y0_ + (j+0.5)*hy, z0_ + (k+0.5)*hz);
+  return 1;
+}
+
+
+// Geometry of a face of the brick. As in the generic computation,
+// normal0 is the area weighted outward normal with respect to the cell
+// using the face in its natural direction and normal1 with respect to
+// the other cell (zero if the cell does not exist)
+
+int Mesh_simple::compute_face_geometry(const Entity_ID faceid,
+                                       double *area,
+                                       JaliGeometry::Point *centroid,
+                                       JaliGeometry::Point *normal0,
+                                       JaliGeometry::Point *normal1) const {
+  if (!implicit_connectivity_ || !coordinates_.empty())
+    return Mesh::compute_face_geometry(faceid, area, centroid, normal0,
+                                       normal1);
+
+  double hx = (x1_ - x0_)/nx_global_;
+  double hy = (y1_ - y0_)/ny_global_;
+  double hz = (z1_ - z0_)/nz_global_;
+
+  int orient, i, j, k;
+  face_ijk_(faceid, &orient, &i, &j, &k);
+
+  // whether the cells on either side are on this rank
+
+  JaliGeometry::Point normal(3);
+  bool has_cell0, has_cell1;
+  if (orient == 0) {
+    has_cell0 = (k > 0);
+    has_cell1 = (k < nz_);
+  } else if (orient == 1) {
+    has_cell0 = (j < ny_);
+    has_cell1 = (j > 0);
+  } else {
+    has_cell0 = (i > 0);
+    has_cell1 = (i < nx_);
+  }
+
+  i += offset_[0];
+  j += offset_[1];
+  k += offset_[2];
+  if (orient == 0) {
+    *area = hx*hy;
+    centroid->set(x0_ + (i+0.5)*hx, y0_ + (j+0.5)*hy, z0_ + k*hz);
+    normal.set(0.0, 0.0, *area);
+  } else if (orient == 1) {
+    *area = hx*hz;
+    centroid->set(x0_ + (i+0.5)*hx, y0_ + j*hy, z0_ + (k+0.5)*hz);
+    normal.set(0.0, -(*area), 0.0);
+  } else {
+    *area = hy*hz;
+    centroid->set(x0_ + i*hx, y0_ + (j+0.5)*hy, z0_ + (k+0.5)*hz);
+    normal.set(*area, 0.0, 0.0);
+  }
+
+  normal0->set(0.0, 0.0, 0.0);
+  normal1->set(0.0, 0.0, 0.0);
+  if (has_cell0) *normal0 = normal;
+  if (has_cell1) *normal1 = -normal;
+  return 1;
+}
+
+
 void
 Mesh_simple::get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr r,
                                       const Entity_kind kind,
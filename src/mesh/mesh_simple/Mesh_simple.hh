@@ -45,6 +45,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _MESH_SIMPLE_H_
 #define _MESH_SIMPLE_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -73,6 +74,18 @@ public:
   // of the call and making the pointer argument seem NULL. In C++11,
   // we could "delete" the illegal version of the call effectively
   // blocking the implicit conversion.
+  //
+  // If implicit_connectivity is true, the 3D mesh stores no
+  // connectivity or coordinates per entity - all topological and
+  // geometric queries are answered from the (i,j,k) indices of the
+  // entities. Node coordinates are only stored once a node is moved.
+  // Sides, wedges and corners cannot be requested in this mode
+  //
+  // On more than one rank, the brick is split into a grid of blocks
+  // of cells, one per rank. Each rank holds its block and
+  // num_ghost_layers_distmesh layers of ghost cells around it. Owned
+  // entities of each kind are numbered before the ghost entities and
+  // GIDs are the IDs the entities would have in the serial mesh
   Mesh_simple (double x0, double y0, double z0,
                double x1, double y1, double z1,
                int nx, int ny, int nz, const MPI_Comm& communicator,
@@ -87,7 +100,8 @@ public:
                const int num_ghost_layers_tile = 0,
                const int num_ghost_layers_distmesh = 0,
                const bool request_boundary_ghosts = false,
-               const Partitioner_type partitioner = Partitioner_type::METIS);
+               const Partitioner_type partitioner = Partitioner_type::METIS,
+               const bool implicit_connectivity = false);
 
   Mesh_simple (double x0, double y0,
                double x1, double y1,
@@ -190,6 +204,10 @@ public:
   // Get cell type
   Cell_type cell_get_type(const Entity_ID cellid) const;
 
+  // Whether connectivity and coordinates are computed from indices
+  // instead of being stored (see constructor)
+  bool implicit_connectivity() const { return implicit_connectivity_; }
+
 
   // Global ID of any entity
   Entity_ID GID(const Entity_ID lid, const Entity_kind kind) const;
@@ -344,22 +362,58 @@ public:
                                 Entity_ID_List *owned_entities,
                                 Entity_ID_List *ghost_entities) const;
 
+  // Geometry of cells and faces - computed directly in implicit
+  // connectivity mode as long as no node has been moved
 
+  int compute_cell_geometry(const Entity_ID cellid,
+                            double *volume,
+                            JaliGeometry::Point *centroid) const;
+  int compute_face_geometry(const Entity_ID faceid,
+                            double *area,
+                            JaliGeometry::Point *centroid,
+                            JaliGeometry::Point *normal0,
+                            JaliGeometry::Point *normal1) const;
 
 
  private:
+  void decompose_3d_(int num_ghost_layers);
   void update_internals_3d_();
+  void update_entity_lists_3d_();
+  void materialize_coordinates_3d_();
   void update_internals_1d_();
   void clear_internals_3d_();
   void clear_internals_1d_();
 
   std::vector<double> coordinates_;
 
+  // Local (i,j,k) indices of one kind of entities of the brick
+  // (nodes, cells or faces of one orientation) on this rank form an
+  // n[0] x n[1] x n[2] box of which the sub-box [lo, hi) is owned.
+  // Owned entities are numbered first, in (i,j,k) order of the owned
+  // box, followed by the ghost entities in (i,j,k) order of the box
+  struct IndexBox {
+    int n[3], lo[3], hi[3];
+
+    int num_owned() const {
+      return (hi[0]-lo[0])*(hi[1]-lo[1])*(hi[2]-lo[2]);
+    }
+    int num_all() const { return n[0]*n[1]*n[2]; }
+    inline int index(int i, int j, int k) const;
+    inline void ijk(int index, int *i, int *j, int *k) const;
+  };
+
   inline unsigned int node_index_(int i, int j, int k) const;
+  inline unsigned int face_index_(int orient, int i, int j, int k) const;
   inline unsigned int xyface_index_(int i, int j, int k) const;
   inline unsigned int yzface_index_(int i, int j, int k) const;
   inline unsigned int xzface_index_(int i, int j, int k) const;
   inline unsigned int cell_index_(int i, int j, int k) const;
+  // (i,j,k) indices of entities from their IDs; for faces, also the
+  // orientation (0 for xy, 1 for xz and 2 for yz faces)
+  inline void node_ijk_(Entity_ID n, int *i, int *j, int *k) const;
+  inline void cell_ijk_(Entity_ID c, int *i, int *j, int *k) const;
+  inline void face_ijk_(Entity_ID f, int *orient, int *i, int *j, int *k)
+      const;
   // 1d variants
   inline unsigned int node_index_(int i) const;
   inline unsigned int xyface_index_(int i) const;
@@ -368,9 +422,21 @@ public:
   inline unsigned int cell_index_(int i) const;
 
   int nx_, ny_, nz_;  // number of cells in the three coordinate directions
+  bool implicit_connectivity_ = false;
   // coordinates of lower left front and upper right back of brick
   double x0_, x1_, y0_, y1_, z0_, z1_;
 
+  // number of cells of the whole brick and (i,j,k) offset of the
+  // cells on this rank in it (nx_, ny_ and nz_ are the number of cells
+  // on this rank including ghosts)
+  int nx_global_, ny_global_, nz_global_;
+  int offset_[3] = {0, 0, 0};
+
+  IndexBox nodebox_, cellbox_;
+  IndexBox facebox_[3];  // xy, xz and yz faces
+  // starting IDs of owned and ghost faces of each orientation
+  int face_owned_start_[3], face_ghost_start_[3];
+
   int nodes_per_face_;
   int faces_per_cell_;
   int nodes_per_cell_;
@@ -478,24 +544,119 @@ public:
   // ------------------------
 
 
+  int Mesh_simple::IndexBox::index(int i, int j, int k) const {
+    int o0 = hi[0]-lo[0], o1 = hi[1]-lo[1], o2 = hi[2]-lo[2];
+    if (i >= lo[0] && i < hi[0] && j >= lo[1] && j < hi[1] &&
+        k >= lo[2] && k < hi[2])
+      return (i-lo[0]) + ((j-lo[1]) + (k-lo[2])*o1)*o0;
+
+    // ghost - position in the box less the owned entities before it
+    int nbefore = std::min(std::max(k-lo[2], 0), o2)*o0*o1;
+    if (k >= lo[2] && k < hi[2]) {
+      nbefore += std::min(std::max(j-lo[1], 0), o1)*o0;
+      if (j >= lo[1] && j < hi[1])
+        nbefore += std::min(std::max(i-lo[0], 0), o0);
+    }
+    return num_owned() + i + (j + k*n[1])*n[0] - nbefore;
+  }
+
+  void Mesh_simple::IndexBox::ijk(int index, int *i, int *j, int *k) const {
+    int o0 = hi[0]-lo[0], o1 = hi[1]-lo[1], o2 = hi[2]-lo[2];
+    int nowned = num_owned();
+    if (index < nowned) {
+      *i = lo[0] + index % o0;
+      *j = lo[1] + (index / o0) % o1;
+      *k = lo[2] + index / (o0*o1);
+      return;
+    }
+
+    // ghost - layers of constant k below and above the owned box are
+    // all ghosts, layers crossing it have a hole of o0*o1 entities
+    // and so do their rows of constant j crossing it (o0 entities)
+
+    int g = index - nowned;
+    int nlayer = n[0]*n[1];
+    int nlayer_holed = nlayer - o0*o1;
+    if (g < lo[2]*nlayer) {
+      *k = g / nlayer;
+      g %= nlayer;
+    } else if (g < lo[2]*nlayer + o2*nlayer_holed) {
+      g -= lo[2]*nlayer;
+      *k = lo[2] + g / nlayer_holed;
+      g %= nlayer_holed;
+
+      int nrow_holed = n[0] - o0;
+      if (g < lo[1]*n[0]) {
+        *j = g / n[0];
+        *i = g % n[0];
+      } else if (g < lo[1]*n[0] + o1*nrow_holed) {
+        g -= lo[1]*n[0];
+        *j = lo[1] + g / nrow_holed;
+        *i = g % nrow_holed;
+        if (*i >= lo[0]) *i += o0;
+      } else {
+        g -= lo[1]*n[0] + o1*nrow_holed;
+        *j = hi[1] + g / n[0];
+        *i = g % n[0];
+      }
+      return;
+    } else {
+      g -= lo[2]*nlayer + o2*nlayer_holed;
+      *k = hi[2] + g / nlayer;
+      g %= nlayer;
+    }
+    *j = g / n[0];
+    *i = g % n[0];
+  }
+
   unsigned int Mesh_simple::node_index_(int i, int j, int k) const {
-    return i + j*(nx_+1) + k*(nx_+1)*(ny_+1);
+    return nodebox_.index(i, j, k);
   }
 
   unsigned int Mesh_simple::cell_index_(int i, int j, int k) const {
-    return i + j*nx_ + k*nx_*ny_;
+    return cellbox_.index(i, j, k);
+  }
+
+  // Owned faces of the three orientations come first, followed by
+  // ghost faces of the three orientations
+
+  unsigned int Mesh_simple::face_index_(int orient, int i, int j, int k)
+      const {
+    int f = facebox_[orient].index(i, j, k);
+    int nowned = facebox_[orient].num_owned();
+    return (f < nowned) ? face_owned_start_[orient] + f :
+        face_ghost_start_[orient] + f - nowned;
   }
 
   unsigned int Mesh_simple::xyface_index_(int i, int j, int k) const {
-    return i + j*nx_ + k*nx_*ny_;
+    return face_index_(0, i, j, k);
   }
 
   unsigned int Mesh_simple::xzface_index_(int i, int j, int k) const {
-    return i + j*nx_ + k*nx_*(ny_+1) +  xyface_index_(0,0,nz_+1);
+    return face_index_(1, i, j, k);
   }
 
   unsigned int Mesh_simple::yzface_index_(int i, int j, int k) const {
-    return i + j*(nx_+1) + k*(nx_+1)*ny_ + xzface_index_(0,0,nz_);
+    return face_index_(2, i, j, k);
+  }
+
+  void Mesh_simple::node_ijk_(Entity_ID n, int *i, int *j, int *k) const {
+    nodebox_.ijk(n, i, j, k);
+  }
+
+  void Mesh_simple::cell_ijk_(Entity_ID c, int *i, int *j, int *k) const {
+    cellbox_.ijk(c, i, j, k);
+  }
+
+  void Mesh_simple::face_ijk_(Entity_ID f, int *orient,
+                              int *i, int *j, int *k) const {
+    int const *start = (f < face_ghost_start_[0]) ? face_owned_start_ :
+        face_ghost_start_;
+    *orient = (f >= start[2]) ? 2 : ((f >= start[1]) ? 1 : 0);
+    f -= start[*orient];
+    if (start == face_ghost_start_)
+      f += facebox_[*orient].num_owned();
+    facebox_[*orient].ijk(f, i, j, k);
   }
 
   // 1d variants
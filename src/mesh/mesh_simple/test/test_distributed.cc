@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "mpi.h"
+
+#include "UnitTest++.h"
+#include "../Mesh_simple.hh"
+
+// Gather the GIDs of the owned entities of some kind on all ranks and
+// check that they number the entities of the whole brick exactly once
+
+static void check_owned_gids(Jali::Mesh const& mesh,
+                             Jali::Entity_kind const kind, int const nglobal) {
+  int nowned = mesh.num_entities(kind, Jali::Entity_type::PARALLEL_OWNED);
+  std::vector<int> gids(nowned);
+  for (int i = 0; i < nowned; i++)
+    gids[i] = mesh.GID(i, kind);
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  std::vector<int> counts(nproc), offsets(nproc, 0);
+  MPI_Allgather(&nowned, 1, MPI_INT, counts.data(), 1, MPI_INT,
+                MPI_COMM_WORLD);
+  for (int p = 1; p < nproc; p++)
+    offsets[p] = offsets[p-1] + counts[p-1];
+  CHECK_EQUAL(nglobal, offsets[nproc-1] + counts[nproc-1]);
+
+  std::vector<int> allgids(nglobal);
+  MPI_Allgatherv(gids.data(), nowned, MPI_INT, allgids.data(), counts.data(),
+                 offsets.data(), MPI_INT, MPI_COMM_WORLD);
+  std::sort(allgids.begin(), allgids.end());
+  for (int i = 0; i < nglobal; i++)
+    CHECK_EQUAL(i, allgids[i]);
+
+  // Ghost entities are owned elsewhere
+
+  std::sort(gids.begin(), gids.end());
+  int nall = mesh.num_entities(kind, Jali::Entity_type::ALL);
+  for (int i = nowned; i < nall; i++)
+    CHECK(!std::binary_search(gids.begin(), gids.end(), mesh.GID(i, kind)));
+}
+
+TEST(DISTRIBUTED_MESH) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int const nx = 6, ny = 5, nz = 4;
+  for (bool implicit : {false, true}) {
+    Jali::Mesh_simple mesh(0.0, 0.0, 0.0, 6.0, 5.0, 4.0, nx, ny, nz,
+                           MPI_COMM_WORLD, NULL, true, false, false, false,
+                           false, 0, 0, 1, false,
+                           Jali::Partitioner_type::METIS, implicit);
+
+    check_owned_gids(mesh, Jali::Entity_kind::CELL, nx*ny*nz);
+    check_owned_gids(mesh, Jali::Entity_kind::NODE, (nx+1)*(ny+1)*(nz+1));
+    check_owned_gids(mesh, Jali::Entity_kind::FACE,
+                     nx*ny*(nz+1) + nx*(ny+1)*nz + (nx+1)*ny*nz);
+
+    // Owned entities are numbered first
+
+    int nowned = mesh.num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+    for (auto const& c : mesh.cells())
+      CHECK_EQUAL(c < nowned, mesh.entity_get_type(Jali::Entity_kind::CELL, c)
+                  == Jali::Entity_type::PARALLEL_OWNED);
+    if (nproc > 1)
+      CHECK(mesh.num_cells<Jali::Entity_type::PARALLEL_GHOST>() > 0);
+
+    // Cells are where their GIDs place them in the brick (unit spacing)
+
+    for (auto const& c : mesh.cells()) {
+      int gid = mesh.GID(c, Jali::Entity_kind::CELL);
+      JaliGeometry::Point ccen = mesh.cell_centroid(c);
+      CHECK_CLOSE(gid % nx + 0.5, ccen[0], 1.0e-12);
+      CHECK_CLOSE((gid / nx) % ny + 0.5, ccen[1], 1.0e-12);
+      CHECK_CLOSE(gid / (nx*ny) + 0.5, ccen[2], 1.0e-12);
+      CHECK_CLOSE(1.0, mesh.cell_volume(c), 1.0e-12);
+    }
+
+    // Every owned cell has all its face and node neighbors in the brick
+    // on this rank, and the neighbors can be restricted to owned cells
+
+    Jali::Entity_ID_List adjcells;
+    for (auto const& c : mesh.cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+      int gid = mesh.GID(c, Jali::Entity_kind::CELL);
+      int i = gid % nx, j = (gid / nx) % ny, k = gid / (nx*ny);
+      int nbrs = (i > 0) + (i < nx-1) + (j > 0) + (j < ny-1) +
+          (k > 0) + (k < nz-1);
+      mesh.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &adjcells);
+      CHECK_EQUAL(nbrs, adjcells.size());
+
+      mesh.cell_get_node_adj_cells(c, Jali::Entity_type::PARALLEL_OWNED,
+                                   &adjcells);
+      for (auto const& adjc : adjcells)
+        CHECK(adjc < nowned);
+    }
+  }
+}
@@ -0,0 +1,164 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <iostream>
+#include <vector>
+
+#include "UnitTest++.h"
+#include "../Mesh_simple.hh"
+
+// A mesh with implicit connectivity must answer all queries exactly
+// like the same mesh with explicit connectivity
+
+TEST(IMPLICIT_CONNECTIVITY) {
+  Jali::Mesh_simple Me(0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 3, 4, 5, MPI_COMM_WORLD);
+  Jali::Mesh_simple Mi(0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 3, 4, 5, MPI_COMM_WORLD,
+                       NULL, true, false, false, false, false, 0, 0, 0, false,
+                       Jali::Partitioner_type::METIS, true);
+
+  CHECK(!Me.implicit_connectivity());
+  CHECK(Mi.implicit_connectivity());
+
+  CHECK_EQUAL(Me.num_cells(), Mi.num_cells());
+  CHECK_EQUAL(Me.num_faces(), Mi.num_faces());
+  CHECK_EQUAL(Me.num_nodes(), Mi.num_nodes());
+
+  Jali::Entity_ID_List elist, ilist;
+  std::vector<Jali::dir_t> edirs, idirs;
+
+  for (auto const& c : Me.cells()) {
+    Me.cell_get_faces_and_dirs(c, &elist, &edirs);
+    Mi.cell_get_faces_and_dirs(c, &ilist, &idirs);
+    CHECK_ARRAY_EQUAL(elist, ilist, 6);
+    CHECK_ARRAY_EQUAL(edirs, idirs, 6);
+
+    Me.cell_get_nodes(c, &elist);
+    Mi.cell_get_nodes(c, &ilist);
+    CHECK_ARRAY_EQUAL(elist, ilist, 8);
+
+    Me.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &elist);
+    Mi.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &ilist);
+    CHECK_EQUAL(elist.size(), ilist.size());
+    CHECK_ARRAY_EQUAL(elist, ilist, elist.size());
+
+    Me.cell_get_node_adj_cells(c, Jali::Entity_type::ALL, &elist);
+    Mi.cell_get_node_adj_cells(c, Jali::Entity_type::ALL, &ilist);
+    CHECK_EQUAL(elist.size(), ilist.size());
+    CHECK_ARRAY_EQUAL(elist, ilist, elist.size());
+
+    CHECK_CLOSE(Me.cell_volume(c), Mi.cell_volume(c), 1.0e-12);
+    JaliGeometry::Point ecen = Me.cell_centroid(c);
+    JaliGeometry::Point icen = Mi.cell_centroid(c);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(ecen[d], icen[d], 1.0e-12);
+  }
+
+  for (auto const& f : Me.faces()) {
+    Me.face_get_nodes(f, &elist);
+    Mi.face_get_nodes(f, &ilist);
+    CHECK_ARRAY_EQUAL(elist, ilist, 4);
+
+    Me.face_get_cells(f, Jali::Entity_type::ALL, &elist);
+    Mi.face_get_cells(f, Jali::Entity_type::ALL, &ilist);
+    CHECK_EQUAL(elist.size(), ilist.size());
+    CHECK_ARRAY_EQUAL(elist, ilist, elist.size());
+
+    CHECK_CLOSE(Me.face_area(f), Mi.face_area(f), 1.0e-12);
+    JaliGeometry::Point ecen = Me.face_centroid(f);
+    JaliGeometry::Point icen = Mi.face_centroid(f);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(ecen[d], icen[d], 1.0e-12);
+
+    for (auto const& c : elist) {
+      JaliGeometry::Point enormal = Me.face_normal(f, false, c);
+      JaliGeometry::Point inormal = Mi.face_normal(f, false, c);
+      for (int d = 0; d < 3; d++)
+        CHECK_CLOSE(enormal[d], inormal[d], 1.0e-12);
+    }
+  }
+
+  for (auto const& n : Me.nodes()) {
+    JaliGeometry::Point exyz, ixyz;
+    Me.node_get_coordinates(n, &exyz);
+    Mi.node_get_coordinates(n, &ixyz);
+    for (int d = 0; d < 3; d++)
+      CHECK_EQUAL(exyz[d], ixyz[d]);
+
+    Me.node_get_cells(n, Jali::Entity_type::ALL, &elist);
+    Mi.node_get_cells(n, Jali::Entity_type::ALL, &ilist);
+    CHECK_EQUAL(elist.size(), ilist.size());
+    CHECK_ARRAY_EQUAL(elist, ilist, elist.size());
+
+    Me.node_get_faces(n, Jali::Entity_type::ALL, &elist);
+    Mi.node_get_faces(n, Jali::Entity_type::ALL, &ilist);
+    CHECK_EQUAL(elist.size(), ilist.size());
+    CHECK_ARRAY_EQUAL(elist, ilist, elist.size());
+
+    for (auto const& c : Me.cells()) {
+      Me.node_get_cell_faces(n, c, Jali::Entity_type::ALL, &elist);
+      Mi.node_get_cell_faces(n, c, Jali::Entity_type::ALL, &ilist);
+      CHECK_EQUAL(elist.size(), ilist.size());
+      CHECK_ARRAY_EQUAL(elist, ilist, elist.size());
+    }
+  }
+
+  // Moving a node of both meshes must change the geometry the same way
+  // (the mesh with implicit connectivity caches no geometry and sees
+  // the change right away; the other one once it updates its caches)
+
+  JaliGeometry::Point xyz;
+  Me.node_get_coordinates(30, &xyz);
+  xyz[0] += 0.05;
+  xyz[2] -= 0.1;
+  Me.node_set_coordinates(30, xyz);
+  Mi.node_set_coordinates(30, xyz);
+  Me.update_geometric_quantities();
+  Mi.update_geometric_quantities();
+
+  Jali::Entity_ID_List nodecells;
+  Me.node_get_cells(30, Jali::Entity_type::ALL, &nodecells);
+  for (auto const& c : nodecells) {
+    CHECK_CLOSE(Me.cell_volume(c), Mi.cell_volume(c), 1.0e-12);
+    CHECK(fabs(Mi.cell_volume(c) - 0.1) > 1.0e-6);
+  }
+}
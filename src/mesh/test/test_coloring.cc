@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// -------------------------------------------------------------
+/**
+ * @file   test_coloring.cc
+ *
+ * @brief  Unit tests for the colorings of mesh cells and tiles
+ */
+// -------------------------------------------------------------
+// -------------------------------------------------------------
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshFactory.hh"
+#include "TileScheduler.hh"
+
+TEST(MESH_COLORING) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, 3))
+      continue;
+
+    std::cerr << "Testing mesh coloring with " << framework_names[i] <<
+        std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.partitioner(Jali::Partitioner_type::RCB);
+    factory.num_tiles(27);
+    factory.num_ghost_layers_tile(1);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 9, 9, 9);
+    int nnodes = mesh->num_nodes<Jali::Entity_type::ALL>();
+    int ncells = mesh->num_cells<Jali::Entity_type::ALL>();
+
+    // Every cell has exactly one color and cells of a color share no
+    // node. First-fit coloring of a hex mesh needs at least 8 colors
+
+    std::vector<Jali::Entity_ID_List> const& cellcolors = mesh->cell_colors();
+    CHECK(cellcolors.size() >= 8);
+
+    std::vector<int> ncellcolors(ncells, 0);
+    Jali::Entity_ID_List cnodes;
+    for (int k = 0; k < cellcolors.size(); k++) {
+      std::vector<int> nodeused(nnodes, 0);
+      for (auto const& c : cellcolors[k]) {
+        ncellcolors[c]++;
+        CHECK_EQUAL(k, mesh->cell_color(c));
+        mesh->cell_get_nodes(c, &cnodes);
+        for (auto const& n : cnodes)
+          CHECK_EQUAL(1, ++nodeused[n]);
+      }
+    }
+    for (int c = 0; c < ncells; c++)
+      CHECK_EQUAL(1, ncellcolors[c]);
+
+    // Same for tiles including their halos
+
+    int ntiles = mesh->num_tiles();
+    std::vector<std::vector<int>> const& tilecolors = mesh->tile_colors();
+    CHECK(tilecolors.size() > 1);
+
+    std::vector<int> ntilecolors(ntiles, 0);
+    for (int k = 0; k < tilecolors.size(); k++) {
+      std::vector<int> nodeused(nnodes, 0);
+      for (auto const& t : tilecolors[k]) {
+        ntilecolors[t]++;
+        CHECK_EQUAL(k, mesh->tile_color(t));
+        for (auto const& n : mesh->tiles()[t]->nodes<Jali::Entity_type::ALL>())
+          CHECK_EQUAL(1, ++nodeused[n]);
+      }
+    }
+    for (int t = 0; t < ntiles; t++)
+      CHECK_EQUAL(1, ntilecolors[t]);
+
+    // Scatter the number of cells around each node without atomics
+
+    std::vector<int> nodecount(nnodes, 0);
+    Jali::TileScheduler scheduler(*mesh, 4);
+    scheduler.run_by_color([&](Jali::MeshTile& t) {
+        Jali::Entity_ID_List tcnodes;
+        for (auto const& c : t.cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+          mesh->cell_get_nodes(c, &tcnodes);
+          for (auto const& n : tcnodes)
+            nodecount[n]++;
+        }
+      });
+
+    Jali::Entity_ID_List ncells_of_node;
+    for (int n = 0; n < nnodes; n++) {
+      mesh->node_get_cells(n, Jali::Entity_type::PARALLEL_OWNED,
+                           &ncells_of_node);
+      CHECK_EQUAL(ncells_of_node.size(), nodecount[n]);
+    }
+
+    // Tile colors follow the tiles when they are rebuilt
+
+    mesh->rebuild_tiles(8);
+    int ntiles_colored = 0;
+    for (auto const& tileids : mesh->tile_colors())
+      ntiles_colored += tileids.size();
+    CHECK_EQUAL(8, ntiles_colored);
+  }
+}
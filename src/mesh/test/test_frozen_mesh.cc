@@ -0,0 +1,271 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// -------------------------------------------------------------
+/**
+ * @file   test_frozen_mesh.cc
+ *
+ * @brief  Unit tests for querying a frozen (read-only) mesh from
+ * many threads at once
+ *
+ * The threads start querying right after the mesh is frozen, so any
+ * data still built on first use would be built concurrently. Each
+ * thread's answers are compared against answers computed serially
+ */
+// -------------------------------------------------------------
+// -------------------------------------------------------------
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshFactory.hh"
+#include "BoxRegion.hh"
+#include "errors.hh"
+
+// Answers to a mix of queries flattened into lists of integers and
+// reals (compared exactly since every thread runs the same code)
+
+struct QueryAnswers {
+  std::vector<int> ids;
+  std::vector<double> vals;
+  bool operator==(QueryAnswers const& other) const {
+    return ids == other.ids && vals == other.vals;
+  }
+};
+
+void run_queries(Jali::Mesh const& mesh, Jali::MeshSet const& cellset,
+                 Jali::MeshSet const& nodeset,
+                 Jali::MeshSet const& emptyset,
+                 std::vector<JaliGeometry::Point> const& points,
+                 QueryAnswers *answers) {
+  answers->ids.clear();
+  answers->vals.clear();
+  int dim = mesh.space_dimension();
+
+  for (auto const& c : mesh.cells<Jali::Entity_type::ALL>()) {
+    Jali::Entity_ID_List faces, nodes;
+    std::vector<Jali::dir_t> dirs;
+    mesh.cell_get_faces_and_dirs(c, &faces, &dirs);
+    answers->ids.insert(answers->ids.end(), faces.begin(), faces.end());
+    answers->ids.insert(answers->ids.end(), dirs.begin(), dirs.end());
+    mesh.cell_get_nodes(c, &nodes);
+    answers->ids.insert(answers->ids.end(), nodes.begin(), nodes.end());
+    answers->ids.push_back(mesh.GID(c, Jali::Entity_kind::CELL));
+    answers->ids.push_back(mesh.cell_color(c));
+    answers->ids.push_back(cellset.contains(c));
+    answers->ids.push_back(cellset.index_in_set(c));
+    answers->ids.push_back(emptyset.contains(c));
+    answers->ids.push_back(emptyset.index_in_set(c));
+
+    answers->vals.push_back(mesh.cell_volume(c));
+    answers->vals.push_back(mesh.cell_volume(c, true));
+    JaliGeometry::Point cen = mesh.cell_centroid(c);
+    for (int d = 0; d < dim; d++)
+      answers->vals.push_back(cen[d]);
+  }
+
+  for (auto const& f : mesh.faces<Jali::Entity_type::ALL>()) {
+    Jali::Entity_ID_List fcells;
+    mesh.face_get_cells(f, Jali::Entity_type::ALL, &fcells);
+    answers->ids.insert(answers->ids.end(), fcells.begin(), fcells.end());
+    answers->vals.push_back(mesh.face_area(f));
+  }
+
+  for (auto const& n : mesh.nodes<Jali::Entity_type::ALL>()) {
+    Jali::Entity_ID_List ncells;
+    mesh.node_get_cells(n, Jali::Entity_type::ALL, &ncells);
+    answers->ids.insert(answers->ids.end(), ncells.begin(), ncells.end());
+    answers->ids.push_back(nodeset.contains(n));
+  }
+
+  for (auto const& p : points) {
+    Jali::Entity_ID_List near;
+    answers->ids.push_back(mesh.closest_node(p));
+    answers->ids.push_back(mesh.closest_cell(p));
+    mesh.closest_nodes(p, 4, &near);
+    answers->ids.insert(answers->ids.end(), near.begin(), near.end());
+    mesh.cells_within_radius(p, 0.3, &near);
+    std::sort(near.begin(), near.end());
+    answers->ids.insert(answers->ids.end(), near.begin(), near.end());
+  }
+
+  for (int t = 0; t < mesh.num_tiles(); t++) {
+    answers->ids.push_back(mesh.tile_color(t));
+    Jali::Entity_ID_List const& tilecells =
+        cellset.entities_in_tile(t, Jali::Entity_type::ALL);
+    answers->ids.insert(answers->ids.end(), tilecells.begin(),
+                        tilecells.end());
+  }
+}
+
+
+TEST(FROZEN_MESH_THREADS) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::Point boxlo(-0.01, -0.01, -0.01), boxhi(0.51, 0.51, 0.51);
+  JaliGeometry::BoxRegion box1("box1", 1, boxlo, boxhi);
+  gregions.push_back(&box1);
+  JaliGeometry::Point box2lo(2.0, 2.0, 2.0), box2hi(3.0, 3.0, 3.0);
+  JaliGeometry::BoxRegion box2("box2", 2, box2lo, box2hi);
+  gregions.push_back(&box2);
+  JaliGeometry::GeometricModel gm(dim, gregions);
+
+  // MSTK is left out since it answers some queries through MSTK
+  // calls (see Mesh::freeze)
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::Simple, Jali::Flat};
+  const char *framework_names[] = {"Simple", "Flat"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing frozen mesh queries on threads with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.num_tiles(8);
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+    // Sets must exist before freezing
+
+    std::shared_ptr<Jali::MeshSet> cellset =
+        mesh->find_meshset("box1", Jali::Entity_kind::CELL);
+    std::shared_ptr<Jali::MeshSet> nodeset =
+        mesh->find_meshset("box1", Jali::Entity_kind::NODE);
+    std::shared_ptr<Jali::MeshSet> emptyset =
+        mesh->find_meshset("box2", Jali::Entity_kind::CELL);
+    CHECK(cellset && nodeset && emptyset);
+    CHECK_EQUAL(0, emptyset->num_entities(Jali::Entity_type::ALL));
+    CHECK(!cellset->materialized(Jali::MeshSet_rep::REVERSE_MAP));
+
+    mesh->freeze();
+    CHECK(mesh->frozen());
+    CHECK(cellset->materialized(Jali::MeshSet_rep::REVERSE_MAP));
+    CHECK(nodeset->materialized(Jali::MeshSet_rep::REVERSE_MAP));
+    CHECK(emptyset->materialized(Jali::MeshSet_rep::BITMAP));
+
+    std::vector<JaliGeometry::Point> points;
+    srand(42);
+    for (int j = 0; j < 50; j++)
+      points.emplace_back(-0.2 + 1.4*rand()/RAND_MAX,
+                          -0.2 + 1.4*rand()/RAND_MAX,
+                          -0.2 + 1.4*rand()/RAND_MAX);
+
+    // Hammer the mesh from several threads, each repeating the
+    // queries and checking it gets the same answers every time
+
+    int const nthreads = 8, nreps = 5;
+    std::vector<QueryAnswers> thread_answers(nthreads);
+    std::vector<int> thread_mismatches(nthreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; t++)
+      threads.emplace_back([&, t]() {
+          run_queries(*mesh, *cellset, *nodeset, *emptyset, points,
+                      &thread_answers[t]);
+          for (int r = 1; r < nreps; r++) {
+            QueryAnswers answers;
+            run_queries(*mesh, *cellset, *nodeset, *emptyset, points,
+                        &answers);
+            if (!(answers == thread_answers[t])) thread_mismatches[t]++;
+          }
+        });
+    for (auto& thr : threads)
+      thr.join();
+
+    QueryAnswers expected;
+    run_queries(*mesh, *cellset, *nodeset, *emptyset, points, &expected);
+    CHECK(!expected.ids.empty());
+    for (int t = 0; t < nthreads; t++) {
+      CHECK_EQUAL(0, thread_mismatches[t]);
+      CHECK(thread_answers[t] == expected);
+    }
+
+    // A frozen mesh cannot be modified
+
+    JaliGeometry::Point xyz;
+    mesh->node_get_coordinates(0, &xyz);
+    CHECK_THROW(mesh->node_set_coordinates(0, xyz), Errors::Message);
+    CHECK_THROW(mesh->update_geometric_quantities(), Errors::Message);
+    CHECK_THROW(mesh->rebuild_spatial_index(), Errors::Message);
+    CHECK_THROW(mesh->rebuild_tiles(4), Errors::Message);
+    CHECK_THROW(mesh->release_meshset_caches(), Errors::Message);
+    CHECK_THROW(mesh->find_meshset("box1", Jali::Entity_kind::FACE),
+                Errors::Message);
+    CHECK_EQUAL(8, mesh->num_tiles());
+
+    // but it can be thawed, modified and frozen again
+
+    mesh->thaw();
+    CHECK(!mesh->frozen());
+    xyz[0] += 1.0e-3;
+    mesh->node_set_coordinates(0, xyz);
+    mesh->update_geometric_quantities();
+    mesh->freeze();
+    Jali::Entity_ID_List near;
+    mesh->nodes_within_radius(xyz, 1.0e-6, &near);
+    CHECK_EQUAL(1, near.size());
+    if (near.size()) CHECK_EQUAL(0, near[0]);
+  }
+}
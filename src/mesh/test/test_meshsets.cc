@@ -68,6 +68,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Point.hh"
 #include "BoxRegion.hh"
 #include "PlaneRegion.hh"
+#include "PointRegion.hh"
 #include "LogicalRegion.hh"
 #include "LabeledSetRegion.hh"
 #include "GeometricModel.hh"
@@ -766,3 +767,244 @@ TEST(MESH_SETS_LABELED_3D) {
     
   }
 }
+
+
+// Check that the bitmap and reverse map of a set are built only when
+// needed and that they agree with the entity lists
+
+TEST(MESH_SETS_LAZY_REPRESENTATIONS) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::Point box1lo(-0.51, -0.51, -0.51), box1hi(0.51, 0.51, 0.51);
+  JaliGeometry::BoxRegion box1("box1", 1, box1lo, box1hi);
+  gregions.push_back(&box1);
+  JaliGeometry::GeometricModel gm(dim, gregions);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing lazy mesh set representations with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.partitioner(Jali::Partitioner_type::BLOCK);
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+    std::shared_ptr<Jali::MeshSet> set =
+        mesh->find_meshset("box1", Jali::Entity_kind::CELL);
+    CHECK(set);
+
+    // Only the entity lists exist right after the set is built
+
+    CHECK(set->materialized(Jali::MeshSet_rep::ID_LIST));
+    CHECK(!set->materialized(Jali::MeshSet_rep::BITMAP));
+    CHECK(!set->materialized(Jali::MeshSet_rep::REVERSE_MAP));
+    std::size_t listbytes = mesh->meshsets_memory_used();
+
+    // Membership queries build only the bitmap
+
+    Jali::Entity_ID_List const& setcells = set->entities();
+    for (auto const& c : setcells)
+      CHECK(set->contains(c));
+    int ncontained = 0;
+    for (auto const& c : mesh->cells())
+      if (set->contains(c)) ncontained++;
+    CHECK_EQUAL(setcells.size(), ncontained);
+    CHECK(set->materialized(Jali::MeshSet_rep::BITMAP));
+    CHECK(!set->materialized(Jali::MeshSet_rep::REVERSE_MAP));
+    std::size_t bitmapbytes = mesh->meshsets_memory_used();
+    CHECK(bitmapbytes > listbytes);
+
+    // Index queries build the reverse map
+
+    for (int j = 0; j < setcells.size(); j++)
+      CHECK_EQUAL(j, set->index_in_set(setcells[j]));
+    CHECK(set->materialized(Jali::MeshSet_rep::REVERSE_MAP));
+    CHECK(mesh->meshsets_memory_used(Jali::Entity_kind::CELL) > bitmapbytes);
+    CHECK_EQUAL(0, mesh->meshsets_memory_used(Jali::Entity_kind::FACE));
+
+    // Releasing the caches brings us back to the original footprint
+    // and queries still work
+
+    mesh->release_meshset_caches();
+    CHECK_EQUAL(listbytes, mesh->meshsets_memory_used());
+    CHECK_EQUAL(0, set->index_in_set(setcells[0]));
+  }
+}
+
+
+// Check that small sets get a sparse reverse map and large ones a
+// dense one and that both give the same answers
+
+TEST(MESH_SETS_SPARSE_REVERSE_MAP) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  // box1 covers 1/8th of the domain, box2 only the corner cells
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::Point box1lo(-0.51, -0.51, -0.51), box1hi(0.51, 0.51, 0.51);
+  JaliGeometry::BoxRegion box1("box1", 1, box1lo, box1hi);
+  gregions.push_back(&box1);
+  JaliGeometry::Point box2lo(-1.01, -1.01, -1.01), box2hi(-0.74, -0.74, -0.74);
+  JaliGeometry::BoxRegion box2("box2", 2, box2lo, box2hi);
+  gregions.push_back(&box2);
+  JaliGeometry::GeometricModel gm(dim, gregions);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing sparse mesh set reverse maps with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.partitioner(Jali::Partitioner_type::BLOCK);
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+    int ncells = mesh->num_cells<Jali::Entity_type::ALL>();
+    for (auto const& setname : {"box1", "box2"}) {
+      std::shared_ptr<Jali::MeshSet> set =
+          mesh->find_meshset(setname, Jali::Entity_kind::CELL);
+      CHECK(set);
+
+      set->materialize(Jali::MeshSet_rep::REVERSE_MAP);
+      Jali::Entity_ID_List const& setcells = set->entities();
+      bool sparse = (!setcells.empty() && 16*setcells.size() < ncells);
+      CHECK_EQUAL(sparse, set->sparse_reverse_map());
+
+      // Every mesh cell must map to its position in the set or to -1
+
+      int nfound = 0;
+      for (auto const& c : mesh->cells()) {
+        int idx = set->index_in_set(c);
+        if (idx != -1) {
+          CHECK_EQUAL(c, setcells[idx]);
+          nfound++;
+        }
+        CHECK_EQUAL((idx != -1), set->contains(c));
+      }
+      CHECK_EQUAL(setcells.size(), nfound);
+
+      // A sparse map costs memory proportional to the set size
+
+      if (sparse)
+        CHECK(set->memory_used() < ncells*sizeof(Jali::Entity_ID));
+    }
+  }
+}
+
+
+// Check that sets built collectively resolve point regions on shared
+// nodes to a single cell and carry correct global statistics
+
+TEST(MESH_SETS_COLLECTIVE) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::Point box1lo(-0.51, -0.51, -0.51), box1hi(0.51, 0.51, 0.51);
+  JaliGeometry::BoxRegion box1("box1", 1, box1lo, box1hi);
+  gregions.push_back(&box1);
+
+  // The origin is a node shared by 8 cells
+
+  JaliGeometry::Point origin(0.0, 0.0, 0.0);
+  JaliGeometry::PointRegion pnt1("pnt1", 2, origin);
+  gregions.push_back(&pnt1);
+  JaliGeometry::GeometricModel gm(dim, gregions);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing collective set building with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.partitioner(Jali::Partitioner_type::BLOCK);
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+    mesh->build_sets_collectively({"box1", "pnt1"},
+                                  {Jali::Entity_kind::CELL,
+                                        Jali::Entity_kind::NODE});
+
+    // Exactly one cell across all ranks owns the point and it
+    // contains the point
+
+    std::shared_ptr<Jali::MeshSet> pntset =
+        mesh->find_meshset("pnt1", Jali::Entity_kind::CELL);
+    CHECK(pntset);
+    CHECK_EQUAL(1, pntset->global_num_entities());
+    int nowned_local = pntset->num_entities(Jali::Entity_type::PARALLEL_OWNED);
+    int nowned = 0;
+    MPI_Allreduce(&nowned_local, &nowned, 1, MPI_INT, MPI_SUM,
+                  MPI_COMM_WORLD);
+    CHECK_EQUAL(1, nowned);
+    for (auto const& c : pntset->entities())
+      CHECK(mesh->point_in_cell(origin, c));
+
+    // Global counts and bounding boxes of the box sets
+
+    std::shared_ptr<Jali::MeshSet> boxcells =
+        mesh->find_meshset("box1", Jali::Entity_kind::CELL);
+    CHECK_EQUAL(64, boxcells->global_num_entities());
+    JaliGeometry::Point lo, hi;
+    CHECK(boxcells->global_bounding_box(&lo, &hi));
+    for (int d = 0; d < dim; d++) {
+      CHECK_CLOSE(-0.5, lo[d], 1.0e-10);
+      CHECK_CLOSE(0.5, hi[d], 1.0e-10);
+    }
+
+    std::shared_ptr<Jali::MeshSet> boxnodes =
+        mesh->find_meshset("box1", Jali::Entity_kind::NODE);
+    CHECK_EQUAL(125, boxnodes->global_num_entities());
+    CHECK(boxnodes->global_bounding_box(&lo, &hi));
+    for (int d = 0; d < dim; d++) {
+      CHECK_CLOSE(-0.5, lo[d], 1.0e-10);
+      CHECK_CLOSE(0.5, hi[d], 1.0e-10);
+    }
+  }
+}
@@ -59,6 +59,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <mpi.h>
 #include <iostream>
+#include <algorithm>
 
 #include "Mesh.hh"
 #include "MeshTile.hh"
@@ -701,3 +702,395 @@ TEST(MESH_TILES_SETS) {
     }
   }
 }
+
+
+// Check that the per-tile partition of mesh sets agrees with a brute
+// force search of the tile entities
+
+TEST(MESH_TILES_SET_PARTITION) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::Point boxlo(-0.51, -0.51, -0.51), boxhi(0.51, 0.51, 0.51);
+  JaliGeometry::BoxRegion box1("box1", 1, boxlo, boxhi);
+  gregions.push_back(&box1);
+  JaliGeometry::GeometricModel gm(dim, gregions);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing tile partition of mesh sets with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    factory.num_tiles(8);
+    factory.num_ghost_layers_tile(1);
+    factory.partitioner(Jali::Partitioner_type::BLOCK);
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+    Jali::Entity_type const ptypes[3] = {Jali::Entity_type::PARALLEL_OWNED,
+                                         Jali::Entity_type::PARALLEL_GHOST,
+                                         Jali::Entity_type::ALL};
+
+    for (auto const& kind : {Jali::Entity_kind::CELL, Jali::Entity_kind::NODE}) {
+      std::shared_ptr<Jali::MeshSet> set = mesh->find_meshset("box1", kind);
+      CHECK(set);
+
+      int nowned_in_tiles = 0;
+      for (auto const& t : mesh->tiles()) {
+        for (auto const& ptype : ptypes) {
+          Jali::Entity_ID_List const& tileents = t->entities(kind, ptype);
+          Jali::Entity_ID_List expected;
+          for (auto const& e : set->entities()) {
+            if (ptype != Jali::Entity_type::ALL &&
+                mesh->entity_get_type(kind, e) != ptype) continue;
+            if (std::find(tileents.begin(), tileents.end(), e) !=
+                tileents.end())
+              expected.push_back(e);
+          }
+
+          Jali::Entity_ID_List setents;
+          t->get_set_entities("box1", kind, ptype, &setents);
+          CHECK_EQUAL(expected.size(), setents.size());
+          CHECK_ARRAY_EQUAL(expected, setents, expected.size());
+
+          if (ptype == Jali::Entity_type::PARALLEL_OWNED)
+            nowned_in_tiles += setents.size();
+        }
+      }
+
+      // Every owned set entity is owned by exactly one tile
+
+      CHECK_EQUAL(set->num_entities(Jali::Entity_type::PARALLEL_OWNED),
+                  nowned_in_tiles);
+    }
+  }
+}
+
+
+TEST(MESH_TILES_REBUILD) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::Point boxlo(-0.51, -0.51, -0.51), boxhi(0.51, 0.51, 0.51);
+  JaliGeometry::BoxRegion box1("box1", 1, boxlo, boxhi);
+  gregions.push_back(&box1);
+  JaliGeometry::GeometricModel gm(dim, gregions);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing rebuilding of mesh tiles with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    factory.num_tiles(4);
+    factory.num_ghost_layers_tile(1);
+    factory.partitioner(Jali::Partitioner_type::BLOCK);
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+    CHECK_EQUAL(4, mesh->num_tiles());
+
+    // Build the per-tile set lists for the original tiles
+
+    std::shared_ptr<Jali::MeshSet> set =
+        mesh->find_meshset("box1", Jali::Entity_kind::CELL);
+    CHECK(set);
+    set->build_tile_partition();
+
+    // Rebuild with a different count, partitioner and halo depth
+
+    mesh->rebuild_tiles(6, Jali::Partitioner_type::RCB, 0);
+    CHECK_EQUAL(6, mesh->num_tiles());
+    CHECK(Jali::Partitioner_type::RCB == mesh->tile_partitioner());
+    CHECK_EQUAL(0, mesh->num_ghost_layers_tile());
+
+    int ncells = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+    std::vector<int> ntiles_of_cell(ncells, 0);
+    int nset_owned_in_tiles = 0;
+    for (auto const& t : mesh->tiles()) {
+      CHECK_EQUAL(0, t->num_cells<Jali::Entity_type::PARALLEL_GHOST>());
+      for (auto const& c : t->cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+        ntiles_of_cell[c]++;
+        CHECK_EQUAL(t->ID(), mesh->master_tile_ID_of_cell(c));
+      }
+      for (auto const& n : t->nodes<Jali::Entity_type::PARALLEL_OWNED>())
+        CHECK_EQUAL(t->ID(), mesh->master_tile_ID_of_node(n));
+      for (auto const& f : t->faces<Jali::Entity_type::PARALLEL_OWNED>())
+        CHECK_EQUAL(t->ID(), mesh->master_tile_ID_of_face(f));
+
+      Jali::Entity_ID_List setents;
+      t->get_set_entities("box1", Jali::Entity_kind::CELL,
+                          Jali::Entity_type::PARALLEL_OWNED, &setents);
+      for (auto const& c : setents)
+        CHECK_EQUAL(t->ID(), mesh->master_tile_ID_of_cell(c));
+      nset_owned_in_tiles += setents.size();
+    }
+    for (int c = 0; c < ncells; c++)
+      CHECK_EQUAL(1, ntiles_of_cell[c]);
+    CHECK_EQUAL(set->num_entities(Jali::Entity_type::PARALLEL_OWNED),
+                nset_owned_in_tiles);
+
+    // Every node is owned by some tile
+
+    int nnodes = mesh->num_nodes<Jali::Entity_type::PARALLEL_OWNED>();
+    for (int n = 0; n < nnodes; n++) {
+      int tileid = mesh->master_tile_ID_of_node(n);
+      CHECK(tileid >= 0 && tileid < 6);
+    }
+
+    // Rebuild with the same settings but fewer tiles
+
+    mesh->rebuild_tiles(2);
+    CHECK_EQUAL(2, mesh->num_tiles());
+    CHECK(Jali::Partitioner_type::RCB == mesh->tile_partitioner());
+    for (int c = 0; c < ncells; c++) {
+      int tileid = mesh->master_tile_ID_of_cell(c);
+      CHECK(tileid == 0 || tileid == 1);
+    }
+
+    // Remove all tiles
+
+    mesh->clear_tiles();
+    CHECK_EQUAL(0, mesh->num_tiles());
+    for (int c = 0; c < ncells; c++)
+      CHECK_EQUAL(-1, mesh->master_tile_ID_of_cell(c));
+  }
+}
+
+
+TEST(MESH_SUBTILES) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, 3))
+      continue;
+
+    std::cerr << "Testing subtiles of mesh tiles with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    factory.num_tiles(4);
+    factory.num_ghost_layers_tile(1);
+    factory.partitioner(Jali::Partitioner_type::RCB);
+    factory.num_cells_per_subtile(20);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+    CHECK_EQUAL(20, mesh->num_cells_per_subtile());
+
+    // Subtiles split the owned entities of each tile into consecutive
+    // pieces of at most 20 cells
+
+    for (auto const& t : mesh->tiles()) {
+      int ntcells = t->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+      int nsub = t->num_subtiles();
+      CHECK_EQUAL((ntcells + 19)/20, nsub);
+
+      Jali::Entity_ID_List cells, nodes, faces;
+      for (int k = 0; k < nsub; k++) {
+        Jali::Entity_ID_List const& subcells = t->subtile_cells(k);
+        CHECK(subcells.size() <= 20 && subcells.size() >= 10);
+        CHECK(std::is_sorted(subcells.begin(), subcells.end()));
+        cells.insert(cells.end(), subcells.begin(), subcells.end());
+        nodes.insert(nodes.end(), t->subtile_nodes(k).begin(),
+                     t->subtile_nodes(k).end());
+        faces.insert(faces.end(), t->subtile_faces(k).begin(),
+                     t->subtile_faces(k).end());
+
+        // Every owned node of the subtile is a node of one of its cells
+
+        Jali::Entity_ID_List cnodes, subnodes;
+        for (auto const& c : subcells) {
+          mesh->cell_get_nodes(c, &cnodes);
+          subnodes.insert(subnodes.end(), cnodes.begin(), cnodes.end());
+        }
+        std::sort(subnodes.begin(), subnodes.end());
+        for (auto const& n : t->subtile_nodes(k))
+          CHECK(std::binary_search(subnodes.begin(), subnodes.end(), n));
+      }
+
+      CHECK(cells == t->cells<Jali::Entity_type::PARALLEL_OWNED>());
+      CHECK(nodes == t->nodes<Jali::Entity_type::PARALLEL_OWNED>());
+      CHECK(faces == t->faces<Jali::Entity_type::PARALLEL_OWNED>());
+      CHECK_EQUAL(t->num_cells<Jali::Entity_type::ALL>(),
+                  t->num_cells<Jali::Entity_type::PARALLEL_OWNED>() +
+                  t->num_cells<Jali::Entity_type::PARALLEL_GHOST>());
+      for (auto const& c : cells)
+        CHECK_EQUAL(t->ID(), mesh->master_tile_ID_of_cell(c));
+      for (auto const& n : nodes)
+        CHECK_EQUAL(t->ID(), mesh->master_tile_ID_of_node(n));
+    }
+
+    // Subtiles are rebuilt with the tiles
+
+    mesh->rebuild_tiles(2);
+    for (auto const& t : mesh->tiles())
+      CHECK_EQUAL((t->num_cells<Jali::Entity_type::PARALLEL_OWNED>() + 19)/20,
+                  t->num_subtiles());
+
+    // and can be turned off
+
+    mesh->subdivide_tiles(0);
+    for (auto const& t : mesh->tiles()) {
+      CHECK_EQUAL(1, t->num_subtiles());
+      CHECK(t->subtile_cells(0) ==
+            t->cells<Jali::Entity_type::PARALLEL_OWNED>());
+    }
+  }
+}
+
+
+TEST(MESH_TILES_LOCAL_NUMBERING) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, 3))
+      continue;
+
+    std::cerr << "Testing tile-local numbering with " <<
+        framework_names[i] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    factory.num_tiles(4);
+    factory.num_ghost_layers_tile(1);
+    factory.partitioner(Jali::Partitioner_type::RCB);
+    factory.tile_local_numbering(true);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 6, 6);
+
+    CHECK(mesh->tile_local_numbering());
+
+    for (auto const& t : mesh->tiles()) {
+      CHECK(t->has_local_numbering());
+
+      // Local IDs are positions in the ALL lists of the tile
+
+      Jali::Entity_ID_List const& tcells = t->cells<Jali::Entity_type::ALL>();
+      Jali::Entity_ID_List const& tnodes = t->nodes<Jali::Entity_type::ALL>();
+      Jali::Entity_ID_List const& tfaces = t->faces<Jali::Entity_type::ALL>();
+      for (int lc = 0; lc < tcells.size(); lc++) {
+        CHECK_EQUAL(lc, t->local_id(Jali::Entity_kind::CELL, tcells[lc]));
+        CHECK_EQUAL(tcells[lc], t->mesh_id(Jali::Entity_kind::CELL, lc));
+      }
+      for (int ln = 0; ln < tnodes.size(); ln++)
+        CHECK_EQUAL(ln, t->local_id(Jali::Entity_kind::NODE, tnodes[ln]));
+
+      // Entities not in the tile have no local ID
+
+      int ncells = mesh->num_cells<Jali::Entity_type::ALL>();
+      for (int c = 0; c < ncells; c++)
+        if (std::find(tcells.begin(), tcells.end(), c) == tcells.end())
+          CHECK_EQUAL(-1, t->local_id(Jali::Entity_kind::CELL, c));
+
+      // Local connectivity matches that of the mesh
+
+      std::vector<int> const& cnoffsets = t->local_cell_node_offsets();
+      std::vector<int> const& cfoffsets = t->local_cell_face_offsets();
+      CHECK_EQUAL(tcells.size() + 1, cnoffsets.size());
+      CHECK_EQUAL(tcells.size() + 1, cfoffsets.size());
+
+      Jali::Entity_ID_List cnodes, cfaces;
+      std::vector<Jali::dir_t> cfdirs;
+      for (int lc = 0; lc < tcells.size(); lc++) {
+        mesh->cell_get_nodes(tcells[lc], &cnodes);
+        CHECK_EQUAL(cnodes.size(), cnoffsets[lc+1] - cnoffsets[lc]);
+        for (int k = cnoffsets[lc]; k < cnoffsets[lc+1]; k++) {
+          int ln = t->local_cell_nodes()[k];
+          CHECK_EQUAL(cnodes[k - cnoffsets[lc]], tnodes[ln]);
+
+          JaliGeometry::Point xyz;
+          mesh->node_get_coordinates(tnodes[ln], &xyz);
+          CHECK_EQUAL(0.0, norm(xyz - t->local_node_coordinates()[ln]));
+        }
+
+        mesh->cell_get_faces_and_dirs(tcells[lc], &cfaces, &cfdirs);
+        CHECK_EQUAL(cfaces.size(), cfoffsets[lc+1] - cfoffsets[lc]);
+        for (int k = cfoffsets[lc]; k < cfoffsets[lc+1]; k++) {
+          CHECK_EQUAL(cfaces[k - cfoffsets[lc]],
+                      tfaces[t->local_cell_faces()[k]]);
+          CHECK_EQUAL(cfdirs[k - cfoffsets[lc]], t->local_cell_face_dirs()[k]);
+        }
+      }
+
+      std::vector<int> const& fcoffsets = t->local_face_cell_offsets();
+      CHECK_EQUAL(tfaces.size() + 1, fcoffsets.size());
+      for (int lf = 0; lf < tfaces.size(); lf++) {
+        CHECK(fcoffsets[lf+1] > fcoffsets[lf]);
+        for (int k = fcoffsets[lf]; k < fcoffsets[lf+1]; k++) {
+          int lc = t->local_face_cells()[k];
+          mesh->cell_get_faces(tcells[lc], &cfaces);
+          CHECK(std::find(cfaces.begin(), cfaces.end(), tfaces[lf]) !=
+                cfaces.end());
+        }
+      }
+    }
+
+    // The local numbering is rebuilt with the tiles and can be dropped
+
+    mesh->rebuild_tiles(2);
+    for (auto const& t : mesh->tiles())
+      CHECK(t->has_local_numbering());
+
+    mesh->tile_local_numbering(false);
+    for (auto const& t : mesh->tiles()) {
+      CHECK(!t->has_local_numbering());
+      CHECK_EQUAL(-1, t->local_id(Jali::Entity_kind::CELL,
+                                  t->cells<Jali::Entity_type::ALL>()[0]));
+    }
+  }
+}
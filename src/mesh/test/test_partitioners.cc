@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// -------------------------------------------------------------
+/**
+ * @file   test_partitioners.cc
+ *
+ * @brief  Unit tests for the built-in tile partitioners
+ *
+ * Checks that every owned cell ends up in exactly one tile, that the
+ * tiles are balanced and that the geometric partitioners cut fewer
+ * faces than chopping up the index space
+ */
+// -------------------------------------------------------------
+// -------------------------------------------------------------
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshFactory.hh"
+
+TEST(TILE_PARTITIONERS) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing tile partitioners with " << framework_names[i] <<
+        std::endl;
+
+    const Jali::Partitioner_type partitioners[] =
+        {Jali::Partitioner_type::INDEX, Jali::Partitioner_type::RCB,
+         Jali::Partitioner_type::HILBERT, Jali::Partitioner_type::MORTON};
+
+    for (int ntiles : {8, 7}) {
+      int index_cut_faces = 0;
+      for (auto const& partitioner : partitioners) {
+        Jali::MeshFactory factory(MPI_COMM_WORLD);
+        factory.framework(the_framework);
+        factory.partitioner(partitioner);
+        factory.num_tiles(ntiles);
+        std::shared_ptr<Jali::Mesh> mesh =
+            factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+        CHECK_EQUAL(ntiles, mesh->num_tiles());
+
+        // Each owned cell must be in exactly one tile
+
+        int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+        std::vector<int> ntiles_of_cell(nowned, 0);
+        for (auto const& t : mesh->tiles())
+          for (auto const& c : t->cells<Jali::Entity_type::PARALLEL_OWNED>())
+            ntiles_of_cell[c]++;
+        for (int c = 0; c < nowned; c++)
+          CHECK_EQUAL(1, ntiles_of_cell[c]);
+
+        double imbalance;
+        int ncut;
+        std::vector<int> halo_sizes;
+        mesh->tile_partition_quality(&imbalance, &ncut, &halo_sizes);
+        mesh->report_tile_partition_quality(std::cerr);
+
+        CHECK_EQUAL(ntiles, halo_sizes.size());
+        for (auto const& h : halo_sizes)
+          CHECK(h > 0);
+
+        if (partitioner == Jali::Partitioner_type::INDEX) {
+          index_cut_faces = ncut;
+        } else {
+          // Geometric partitioners should be as balanced as possible
+          // (tiles differ by at most one cell) and cut fewer faces
+
+          int maxcells = (nowned + ntiles - 1)/ntiles;
+          CHECK(imbalance <= static_cast<double>(maxcells)*ntiles/nowned +
+                1.0e-12);
+          CHECK(ncut <= index_cut_faces);
+        }
+
+        // For 8 tiles, each tile should be a 4x4x4 block
+
+        if (ntiles == 8 && partitioner != Jali::Partitioner_type::INDEX)
+          CHECK_EQUAL(3*64, ncut);
+      }
+    }
+  }
+}
+
+
+TEST(TILE_WEIGHTED_PARTITIONING) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing weighted tile partitioning with " <<
+        framework_names[i] << std::endl;
+
+    const Jali::Partitioner_type partitioners[] =
+        {Jali::Partitioner_type::INDEX, Jali::Partitioner_type::RCB,
+         Jali::Partitioner_type::HILBERT};
+
+    for (auto const& partitioner : partitioners) {
+      Jali::MeshFactory factory(MPI_COMM_WORLD);
+      factory.framework(the_framework);
+      factory.partitioner(partitioner);
+      factory.num_tiles(4);
+      std::shared_ptr<Jali::Mesh> mesh =
+          factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 8, 8, 8);
+
+      // Cells in one corner cost 10 times as much as the others
+
+      int ncells = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+      std::vector<double> cost(ncells);
+      for (int c = 0; c < ncells; c++) {
+        JaliGeometry::Point cen = mesh->cell_centroid(c);
+        cost[c] = (cen[0] < 0.25 && cen[1] < 0.25 && cen[2] < 0.25) ?
+            10.0 : 1.0;
+      }
+
+      auto cost_imbalance = [&]() {
+        std::vector<double> tilecost(mesh->num_tiles(), 0.0);
+        for (auto const& t : mesh->tiles())
+          for (auto const& c : t->cells<Jali::Entity_type::PARALLEL_OWNED>())
+            tilecost[t->ID()] += cost[c];
+        double maxcost = 0.0, totcost = 0.0;
+        for (auto const& tc : tilecost) {
+          maxcost = std::max(maxcost, tc);
+          totcost += tc;
+        }
+        return std::make_pair(tilecost, maxcost*tilecost.size()/totcost);
+      };
+
+      // Measured tile times equal to the tile costs should trigger
+      // rebalancing that fixes the imbalance in a few steps (each step
+      // only learns the average cost of the cells in a tile)
+
+      auto before = cost_imbalance();
+      CHECK(before.second > 1.2);
+      CHECK(mesh->rebalance_tiles(before.first, 1.1));
+      CHECK_EQUAL(4, mesh->num_tiles());
+
+      for (int iter = 0; iter < 5; iter++)
+        if (!mesh->rebalance_tiles(cost_imbalance().first, 1.1)) break;
+
+      auto after = cost_imbalance();
+      CHECK(after.second < 1.1);
+      CHECK(!mesh->rebalance_tiles(after.first, 1.1));
+
+      // Repartitioning with explicit weights (through a callback) gives
+      // balanced tiles as well and covers every owned cell once
+
+      mesh->repartition_tiles([&](Jali::Entity_ID c) {return cost[c];});
+      CHECK(cost_imbalance().second < 1.1);
+
+      std::vector<int> ntiles_of_cell(ncells, 0);
+      for (auto const& t : mesh->tiles())
+        for (auto const& c : t->cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+          ntiles_of_cell[c]++;
+          CHECK_EQUAL(t->ID(), mesh->master_tile_ID_of_cell(c));
+        }
+      for (int c = 0; c < ncells; c++)
+        CHECK_EQUAL(1, ntiles_of_cell[c]);
+    }
+  }
+}
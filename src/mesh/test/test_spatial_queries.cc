@@ -0,0 +1,194 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// -------------------------------------------------------------
+/**
+ * @file   test_spatial_queries.cc
+ *
+ * @brief  Unit tests for nearest node/cell queries on a mesh
+ *
+ * The k-d tree based queries are compared against brute force
+ * searches, before and after the mesh nodes are moved
+ */
+// -------------------------------------------------------------
+// -------------------------------------------------------------
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+#include "Point.hh"
+
+// brute force search for entities closest to a point
+
+void brute_force_closest(std::vector<JaliGeometry::Point> const& points,
+                         JaliGeometry::Point const& p, int k, double r,
+                         Jali::Entity_ID_List *nearest,
+                         Jali::Entity_ID_List *inradius) {
+  std::vector<std::pair<double, int>> dists;
+  for (int i = 0; i < points.size(); i++) {
+    JaliGeometry::Point vec = points[i]-p;
+    dists.emplace_back(vec*vec, i);
+  }
+  std::sort(dists.begin(), dists.end());
+
+  nearest->clear();
+  for (int i = 0; i < k; i++)
+    nearest->push_back(dists[i].second);
+
+  inradius->clear();
+  for (auto const& d : dists)
+    if (d.first <= r*r)
+      inradius->push_back(d.second);
+  std::sort(inradius->begin(), inradius->end());
+}
+
+void check_queries(std::shared_ptr<Jali::Mesh> mesh) {
+  std::vector<JaliGeometry::Point> nodexyz, cellcen;
+  for (auto const& n : mesh->nodes()) {
+    JaliGeometry::Point xyz;
+    mesh->node_get_coordinates(n, &xyz);
+    nodexyz.push_back(xyz);
+  }
+  for (auto const& c : mesh->cells())
+    cellcen.push_back(mesh->cell_centroid(c));
+
+  int const k = 5;
+  double const r = 0.3;
+  srand(42);
+  for (int i = 0; i < 20; i++) {
+    JaliGeometry::Point p(-1.2 + 2.4*rand()/RAND_MAX,
+                          -1.2 + 2.4*rand()/RAND_MAX,
+                          -1.2 + 2.4*rand()/RAND_MAX);
+
+    Jali::Entity_ID_List expected_nearest, expected_inradius;
+    Jali::Entity_ID_List nearest, inradius;
+
+    // Compare distances rather than IDs since there can be ties
+
+    brute_force_closest(nodexyz, p, k, r, &expected_nearest,
+                        &expected_inradius);
+    mesh->closest_nodes(p, k, &nearest);
+    CHECK_EQUAL(k, nearest.size());
+    for (int j = 0; j < k; j++)
+      CHECK_CLOSE(norm(nodexyz[expected_nearest[j]]-p),
+                  norm(nodexyz[nearest[j]]-p), 1.0e-12);
+    CHECK_CLOSE(norm(nodexyz[expected_nearest[0]]-p),
+                norm(nodexyz[mesh->closest_node(p)]-p), 1.0e-12);
+    mesh->nodes_within_radius(p, r, &inradius);
+    std::sort(inradius.begin(), inradius.end());
+    CHECK_EQUAL(expected_inradius.size(), inradius.size());
+    CHECK_ARRAY_EQUAL(expected_inradius, inradius, expected_inradius.size());
+
+    brute_force_closest(cellcen, p, k, r, &expected_nearest,
+                        &expected_inradius);
+    mesh->closest_cells(p, k, &nearest);
+    CHECK_EQUAL(k, nearest.size());
+    for (int j = 0; j < k; j++)
+      CHECK_CLOSE(norm(cellcen[expected_nearest[j]]-p),
+                  norm(cellcen[nearest[j]]-p), 1.0e-12);
+    CHECK_CLOSE(norm(cellcen[expected_nearest[0]]-p),
+                norm(cellcen[mesh->closest_cell(p)]-p), 1.0e-12);
+    mesh->cells_within_radius(p, r, &inradius);
+    std::sort(inradius.begin(), inradius.end());
+    CHECK_EQUAL(expected_inradius.size(), inradius.size());
+    CHECK_ARRAY_EQUAL(expected_inradius, inradius, expected_inradius.size());
+  }
+}
+
+
+TEST(SPATIAL_QUERIES) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing spatial queries with " << framework_names[i] <<
+        std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0, 6, 6, 6);
+
+    check_queries(mesh);
+
+    // Twist the mesh about the z-axis and check again - the node tree
+    // is refit automatically, the cell tree after the geometric
+    // quantities are updated
+
+    for (auto const& n : mesh->nodes()) {
+      JaliGeometry::Point xyz;
+      mesh->node_get_coordinates(n, &xyz);
+      double theta = 0.3*xyz[2];
+      JaliGeometry::Point newxyz(xyz[0]*cos(theta) - xyz[1]*sin(theta),
+                                 xyz[0]*sin(theta) + xyz[1]*cos(theta),
+                                 xyz[2]);
+      mesh->node_set_coordinates(n, newxyz);
+    }
+    mesh->update_geometric_quantities();
+
+    check_queries(mesh);
+
+    mesh->rebuild_spatial_index();
+    check_queries(mesh);
+  }
+}
@@ -0,0 +1,274 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// -------------------------------------------------------------
+/**
+ * @file   test_tile_scheduler.cc
+ *
+ * @brief  Unit tests for running kernels over mesh tiles on threads
+ */
+// -------------------------------------------------------------
+// -------------------------------------------------------------
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshFactory.hh"
+#include "TileScheduler.hh"
+#include "BoxRegion.hh"
+
+TEST(TILE_SCHEDULER) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  int dim = 3;
+
+  std::vector<JaliGeometry::RegionPtr> gregions;
+  JaliGeometry::Point boxlo(-0.01, -0.01, -0.01), boxhi(0.51, 0.51, 0.51);
+  JaliGeometry::BoxRegion box1("box1", 1, boxlo, boxhi);
+  gregions.push_back(&box1);
+  JaliGeometry::GeometricModel gm(dim, gregions);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, dim))
+      continue;
+
+    std::cerr << "Testing tile scheduler with " << framework_names[i] <<
+        std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.partitioner(Jali::Partitioner_type::RCB);
+    factory.num_tiles(16);
+    factory.num_ghost_layers_tile(1);
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 8, 8, 8);
+    int ntiles = mesh->num_tiles();
+
+    Jali::TileScheduler scheduler(*mesh, 4);
+    CHECK_EQUAL(4, scheduler.num_threads());
+
+    // Every tile is processed exactly once and the results add up
+
+    std::vector<int> nvisits(ntiles, 0);
+    std::vector<double> tilevol(ntiles, 0.0);
+    scheduler.run([&](Jali::MeshTile& t) {
+        nvisits[t.ID()]++;
+        for (auto const& c : t.cells<Jali::Entity_type::PARALLEL_OWNED>())
+          tilevol[t.ID()] += mesh->cell_volume(c);
+      });
+
+    double totvol = 0.0;
+    for (int t = 0; t < ntiles; t++) {
+      CHECK_EQUAL(1, nvisits[t]);
+      totvol += tilevol[t];
+    }
+    CHECK_CLOSE(1.0, totvol, 1.0e-12);
+
+    CHECK_EQUAL(ntiles, scheduler.tile_times().size());
+    for (auto const& time : scheduler.tile_times())
+      CHECK(time >= 0.0);
+
+    // With exclusive halos, no node may be touched by two running
+    // tiles at the same time
+
+    std::vector<std::atomic<int>> nusers(mesh->num_nodes());
+    for (auto& n : nusers) n = 0;
+    std::atomic<int> nconflicts(0);
+    std::fill(nvisits.begin(), nvisits.end(), 0);
+    scheduler.run([&](Jali::MeshTile& t) {
+        nvisits[t.ID()]++;
+        for (auto const& n : t.nodes<Jali::Entity_type::ALL>())
+          if (nusers[n]++ != 0) nconflicts++;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        for (auto const& n : t.nodes<Jali::Entity_type::ALL>())
+          nusers[n]--;
+      }, true);
+    CHECK_EQUAL(0, nconflicts);
+    for (int t = 0; t < ntiles; t++)
+      CHECK_EQUAL(1, nvisits[t]);
+
+    // Run only on tiles with cells of a set
+
+    std::shared_ptr<Jali::MeshSet> set =
+        mesh->find_meshset("box1", Jali::Entity_kind::CELL);
+    CHECK(set);
+    // (UnitTest++ checks are not thread safe, so the kernel only
+    // records what it saw)
+
+    std::vector<int> tilesetcells(ntiles, -1);
+    scheduler.run_on_set("box1", Jali::Entity_kind::CELL,
+                         Jali::Entity_type::PARALLEL_OWNED,
+                         [&](Jali::MeshTile& t,
+                             Jali::Entity_ID_List const& cells) {
+                           tilesetcells[t.ID()] = cells.size();
+                         });
+    int nsetcells = 0;
+    for (int t = 0; t < ntiles; t++) {
+      int nexpected = set->entities_in_tile(t,
+          Jali::Entity_type::PARALLEL_OWNED).size();
+      CHECK_EQUAL(nexpected ? nexpected : -1, tilesetcells[t]);
+      if (tilesetcells[t] > 0) nsetcells += tilesetcells[t];
+    }
+    CHECK_EQUAL(set->num_entities(Jali::Entity_type::PARALLEL_OWNED),
+                nsetcells);
+
+    // Exceptions thrown by the kernel reach the caller
+
+    bool caught = false;
+    try {
+      scheduler.run([&](Jali::MeshTile& t) {
+          if (t.ID() == 3) throw std::runtime_error("tile 3 failed");
+        });
+    } catch (std::runtime_error const& e) {
+      caught = true;
+    }
+    CHECK(caught);
+
+    // Tiles with more expensive cells get rebalanced using the
+    // measured times
+
+    scheduler.reset_tile_times();
+    scheduler.run([&](Jali::MeshTile& t) {
+        for (auto const& c : t.cells<Jali::Entity_type::PARALLEL_OWNED>())
+          if (mesh->cell_centroid(c)[0] < 0.25)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+      });
+    CHECK(scheduler.rebalance_tiles(1.5));
+    CHECK_EQUAL(ntiles, mesh->num_tiles());
+    for (auto const& time : scheduler.tile_times())
+      CHECK_EQUAL(0.0, time);
+  }
+}
+
+
+TEST(TILE_SCHEDULER_PINNED) {
+
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int i = 0; i < numframeworks; i++) {
+    Jali::MeshFramework_t the_framework = frameworks[i];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    bool parallel = (nproc > 1);
+    if (!Jali::framework_generates(the_framework, parallel, 3))
+      continue;
+
+    std::cerr << "Testing pinned tile runs with " << framework_names[i] <<
+        std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.num_tiles(10);
+    factory.num_ghost_layers_tile(1);
+    factory.tile_local_numbering(true);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 6, 6);
+    int ntiles = mesh->num_tiles();
+
+    Jali::TileScheduler scheduler(*mesh, 4, true);
+
+    // Home threads take contiguous blocks of tiles
+
+    CHECK_EQUAL(0, scheduler.home_thread(0));
+    CHECK_EQUAL(3, scheduler.home_thread(ntiles-1));
+    for (int t = 1; t < ntiles; t++)
+      CHECK(scheduler.home_thread(t) - scheduler.home_thread(t-1) <= 1);
+
+    // Every tile runs on its home thread even if the tiles of one
+    // thread are much slower than the others
+
+    std::vector<std::thread::id> tile_thread(ntiles);
+    scheduler.run_pinned([&](Jali::MeshTile& t) {
+        tile_thread[t.ID()] = std::this_thread::get_id();
+        if (scheduler.home_thread(t.ID()) == 1)
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      });
+    for (int t0 = 0; t0 < ntiles; t0++)
+      for (int t1 = 0; t1 < ntiles; t1++)
+        CHECK_EQUAL(scheduler.home_thread(t0) == scheduler.home_thread(t1),
+                    tile_thread[t0] == tile_thread[t1]);
+
+    // First touch keeps the contents of the tiles
+
+    std::vector<Jali::Entity_ID_List> tilecells(ntiles), tilenodes(ntiles);
+    std::vector<std::vector<int>> tileoffsets(ntiles);
+    for (auto const& t : mesh->tiles()) {
+      tilecells[t->ID()] = t->cells<Jali::Entity_type::ALL>();
+      tilenodes[t->ID()] = t->nodes<Jali::Entity_type::ALL>();
+      tileoffsets[t->ID()] = t->local_cell_node_offsets();
+    }
+
+    scheduler.first_touch_tiles();
+
+    for (auto const& t : mesh->tiles()) {
+      CHECK(tilecells[t->ID()] == t->cells<Jali::Entity_type::ALL>());
+      CHECK(tilenodes[t->ID()] == t->nodes<Jali::Entity_type::ALL>());
+      CHECK(tileoffsets[t->ID()] == t->local_cell_node_offsets());
+      CHECK_EQUAL(0, t->local_id(Jali::Entity_kind::CELL,
+                                 t->cells<Jali::Entity_type::ALL>()[0]));
+    }
+  }
+}
@@ -149,6 +149,43 @@ void State::export_to_mesh() {
 }
 
 
+//! \brief Redistribute state vectors from another state
+//! The old state lives on the mesh this state's mesh was redistributed
+//! from. Like export_to_mesh, we have to go case by case through the
+//! types the data can have
+
+void State::redistribute_from(State const& oldstate) {
+
+  State::const_iterator it = oldstate.cbegin();
+
+  while (it != oldstate.cend()) {
+    const std::shared_ptr<BaseStateVector> vec = *it;
+    Entity_kind kind = vec->entity_kind();
+    Entity_type type = vec->entity_type();
+
+    if ((kind != Entity_kind::NODE && kind != Entity_kind::CELL) ||
+        (type != Entity_type::PARALLEL_OWNED && type != Entity_type::ALL))
+      std::cerr << "Cannot redistribute vector " << vec->name() <<
+          " - only data on all or owned nodes or cells is supported\n";
+    else if (vec->get_type() == typeid(double))
+      redistribute_vector<double>(vec);
+    else if (vec->get_type() == typeid(int))
+      redistribute_vector<int>(vec);
+    else if (vec->get_type() == typeid(std::array<double, 2>))
+      redistribute_vector<std::array<double, 2>>(vec);
+    else if (vec->get_type() == typeid(std::array<double, 3>))
+      redistribute_vector<std::array<double, 3>>(vec);
+    else if (vec->get_type() == typeid(std::array<double, 6>))
+      redistribute_vector<std::array<double, 6>>(vec);
+    else
+      std::cerr << "Cannot redistribute vector " << vec->name() <<
+          " - unsupported data type\n";
+
+    ++it;
+  }
+}
+
+
 //! Print all state vectors
 
 std::ostream & operator<<(std::ostream & os, State const & s) {
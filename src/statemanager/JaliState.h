@@ -914,8 +914,36 @@ class State {
   void export_to_mesh();
 
 
+  /// @brief Add the state vectors of another state, moving their data
+  /// from its mesh to this state's mesh, which was made by
+  /// redistributing it (see MeshFactory::redistribute)
+  ///
+  /// Only vectors of data on the mesh (not on tiles) living on all or
+  /// owned NODEs or CELLs are redistributed; others are skipped with a
+  /// warning. This is a collective call over the communicator of the
+  /// mesh
+  void redistribute_from(State const& oldstate);
+
+
  private:
 
+  // Add a vector with the data of a vector on the mesh of another state
+  template <class T>
+  void redistribute_vector(std::shared_ptr<BaseStateVector> const vec) {
+    auto oldvec = std::dynamic_pointer_cast<StateVector<T, Mesh>>(vec);
+    if (!oldvec) {
+      std::cerr << "Cannot redistribute state vector " << vec->name() <<
+          " - only vectors on meshes can be redistributed\n";
+      return;
+    }
+    Entity_kind kind = vec->entity_kind();
+    Entity_type type = vec->entity_type();
+    std::vector<T> data(mymesh_->num_entities(kind, type));
+    mymesh_->redistribute_data(oldvec->mesh(), kind, sizeof(T),
+                               oldvec->get_raw_data(), type, data.data());
+    add(vec->name(), mymesh_, kind, type, data.data());
+  }
+
   // Constant pointer to the mesh associated with this state
   const std::shared_ptr<Mesh> mymesh_;
 
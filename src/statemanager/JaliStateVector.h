@@ -268,6 +268,7 @@ class StateVector : public BaseStateVector {
     BaseStateVector::entity_type_ = in_vector.entity_type_;
     mydomain_ = in_vector.mydomain_;
     mydata_ = in_vector.mydata_;  // shared_ptr counter will increment
+    return *this;
   }
 
   /// Destructor
@@ -320,6 +321,22 @@ class StateVector : public BaseStateVector {
 
   void clear() { mydata_->clear(); }
 
+  /*!
+    @brief Reallocate the data from the calling thread
+
+    On NUMA machines, memory pages are placed near the thread that
+    first writes them. Calling this from the thread that will work on
+    the vector (for vectors on mesh tiles, from a kernel given to
+    TileScheduler::run_pinned) moves the data to memory local to that
+    thread. Vectors sharing the data through assignment see the moved
+    data as well
+  */
+
+  void first_touch() {
+    std::vector<T> moved(mydata_->begin(), mydata_->end());
+    mydata_->swap(moved);
+  }
+
   //! Output the data
 
   std::ostream& print(std::ostream& os) const {
@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2017, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2017. Los Alamos National Security, LLC. This software was
+produced under U.S. Government contract DE-AC52-06NA25396 for Los
+Alamos National Laboratory (LANL), which is operated by Los Alamos
+National Security, LLC for the U.S. Department of Energy. The
+U.S. Government has rights to use, reproduce, and distribute this
+software.  NEITHER THE GOVERNMENT NOR LOS ALAMOS NATIONAL SECURITY,
+LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY
+FOR THE USE OF THIS SOFTWARE.  If software is modified to produce
+derivative works, such modified software should be clearly marked, so
+as not to confuse it with the version available from LANL.
+ 
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Los Alamos National Security, LLC, Los Alamos
+National Laboratory, LANL, the U.S. Government, nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+ 
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS
+ALAMOS NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <mpi.h>
+
+#include <array>
+#include <iostream>
+#include <vector>
+
+#include "JaliState.h"
+#include "JaliStateVector.h"
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+
+#include "UnitTest++.h"
+
+// Move the state vectors on a mesh to a redistributed copy of it
+
+TEST(Jali_State_Redistribute_4P) {
+
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  CHECK_EQUAL(4, size);
+
+  if (!Jali::framework_available(Jali::MSTK)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::MSTK);
+  std::shared_ptr<Jali::Mesh> mesh =
+      factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 4, 4, 4);
+
+  // Cell data is the global ID of the cell and node data the
+  // coordinates of the node, so both can be checked on the new mesh
+
+  Jali::State oldstate(mesh);
+
+  int ncells = mesh->num_cells<Jali::Entity_type::ALL>();
+  std::vector<double> cellgids(ncells);
+  for (int c = 0; c < ncells; c++)
+    cellgids[c] = mesh->GID(c, Jali::Entity_kind::CELL);
+  oldstate.add("cellgid", mesh, Jali::Entity_kind::CELL,
+               Jali::Entity_type::ALL, &(cellgids[0]));
+
+  int nnodes = mesh->num_nodes<Jali::Entity_type::PARALLEL_OWNED>();
+  std::vector<std::array<double, 3>> nodexyz(nnodes);
+  for (int n = 0; n < nnodes; n++) {
+    JaliGeometry::Point xyz;
+    mesh->node_get_coordinates(n, &xyz);
+    for (int d = 0; d < 3; d++) nodexyz[n][d] = xyz[d];
+  }
+  oldstate.add("nodexyz", mesh, Jali::Entity_kind::NODE,
+               Jali::Entity_type::PARALLEL_OWNED, &(nodexyz[0]));
+
+  int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+  std::vector<int> cell_ranks(nowned, (rank+1)%size);
+  std::shared_ptr<Jali::Mesh> newmesh = factory.redistribute(mesh,
+                                                             cell_ranks);
+
+  Jali::State newstate(newmesh);
+  newstate.redistribute_from(oldstate);
+
+  Jali::StateVector<double, Jali::Mesh> newcellgids;
+  CHECK(newstate.get("cellgid", newmesh, Jali::Entity_kind::CELL,
+                     Jali::Entity_type::ALL, &newcellgids));
+  std::vector<Jali::Entity_ID> const& prevgids =
+      newmesh->previous_GIDs(Jali::Entity_kind::CELL);
+  CHECK_EQUAL(newmesh->num_cells<Jali::Entity_type::ALL>(),
+              newcellgids.size());
+  for (int c = 0; c < newcellgids.size(); c++)
+    CHECK_EQUAL(prevgids[c], newcellgids[c]);
+
+  Jali::StateVector<std::array<double, 3>, Jali::Mesh> newnodexyz;
+  CHECK(newstate.get("nodexyz", newmesh, Jali::Entity_kind::NODE,
+                     Jali::Entity_type::PARALLEL_OWNED, &newnodexyz));
+  CHECK_EQUAL(newmesh->num_nodes<Jali::Entity_type::PARALLEL_OWNED>(),
+              newnodexyz.size());
+  for (int n = 0; n < newnodexyz.size(); n++) {
+    JaliGeometry::Point xyz;
+    newmesh->node_get_coordinates(n, &xyz);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(xyz[d], newnodexyz[n][d], 1.0e-12);
+  }
+}
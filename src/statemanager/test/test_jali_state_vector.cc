@@ -45,9 +45,11 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mpi.h"
 
 #include <iostream>
+#include <thread>
 
 #include "JaliStateVector.h"
 #include "Mesh.hh"
+#include "MeshTile.hh"
 #include "MeshFactory.hh"
 
 #include "UnitTest++.h"
@@ -207,3 +209,35 @@ TEST(JaliStateVectorArray) {
 
   std::cout << myvec1 << std::endl;
 }
+
+TEST(JaliStateVectorFirstTouch) {
+
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  mf.num_tiles(2);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 1.0, 1.0, 4, 4);
+
+  CHECK(mesh);
+
+  // Vector on a mesh tile moved to memory of another thread
+
+  std::shared_ptr<Jali::MeshTile> tile = mesh->tiles()[1];
+  Jali::StateVector<double, Jali::MeshTile> myvec1("var1", tile,
+                                                   Jali::Entity_kind::CELL,
+                                                   Jali::Entity_type::ALL,
+                                                   0.0);
+  for (int i = 0; i < myvec1.size(); i++)
+    myvec1[i] = i + 0.5;
+
+  Jali::StateVector<double, Jali::MeshTile> myvec2;
+  myvec2 = myvec1;
+
+  std::thread toucher([&]() {myvec1.first_touch();});
+  toucher.join();
+
+  // Data is unchanged and still shared with the assigned vector
+
+  CHECK_EQUAL(tile->num_cells<Jali::Entity_type::ALL>(), myvec1.size());
+  for (int i = 0; i < myvec1.size(); i++)
+    CHECK_EQUAL(i + 0.5, myvec1[i]);
+  CHECK_EQUAL(myvec1.get_raw_data(), myvec2.get_raw_data());
+}